@@ -0,0 +1,320 @@
+/*
+ * (C) 2024 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#include <warabi/Client.hpp>
+#include <warabi/Exception.hpp>
+#include "RecordFormat.hpp"
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <fmt/format.h>
+#include <tclap/CmdLine.h>
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <vector>
+
+namespace tl = thallium;
+namespace record = warabi::record;
+using Clock = std::chrono::steady_clock;
+
+static std::string g_address;
+static std::string g_protocol;
+static unsigned    g_provider_id;
+static std::string g_trace_file;
+static double      g_speed = 1.0;
+static unsigned    g_max_in_flight = 64;
+static std::string g_log_level = "info";
+static bool        g_json = false;
+
+static void parse_command_line(int argc, char** argv);
+
+struct OpStats {
+    size_t                count  = 0;
+    size_t                errors = 0;
+    size_t                bytes  = 0;
+    std::vector<uint64_t> latencies; // replayed, in ns
+    std::vector<uint64_t> recorded;  // recorded, in ns
+};
+
+struct Pending {
+    warabi::AsyncRequest request;
+    OpStats*             stats;
+    Clock::time_point    issued;
+};
+
+static uint64_t elapsedNs(Clock::time_point since) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - since).count();
+}
+
+static void complete(Pending& p) {
+    try {
+        p.request.wait();
+    } catch(const warabi::Exception& ex) {
+        spdlog::debug("Request failed: {}", ex.what());
+        p.stats->errors += 1;
+    }
+    p.stats->latencies.push_back(elapsedNs(p.issued));
+}
+
+/**
+ * @brief Complete the pending requests that are done, or the oldest one
+ * if block is true. Latencies are measured when a request is found to
+ * be completed, so they include the time until the next poll.
+ */
+static void reap(std::deque<Pending>& pending, bool block) {
+    if(block && !pending.empty()) {
+        complete(pending.front());
+        pending.pop_front();
+    }
+    for(auto it = pending.begin(); it != pending.end();) {
+        if(!it->request.completed()) { ++it; continue; }
+        complete(*it);
+        it = pending.erase(it);
+    }
+}
+
+static double percentile(std::vector<uint64_t>& values, double p) {
+    if(values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t i = std::min(values.size() - 1, (size_t)(p * values.size()));
+    return values[i] / 1000.0;
+}
+
+int main(int argc, char** argv) {
+    parse_command_line(argc, argv);
+    // keep stdout for the JSON report
+    if(g_json) spdlog::set_default_logger(spdlog::stderr_color_mt("warabi-replay"));
+    spdlog::set_level(spdlog::level::from_str(g_log_level));
+
+    // load the trace
+    record::Reader reader;
+    auto opened = reader.open(g_trace_file);
+    if(!opened.success()) {
+        std::cerr << opened.error() << std::endl;
+        exit(-1);
+    }
+    std::vector<record::Record> records;
+    std::map<uint32_t, std::string> clients;
+    record::Record r;
+    while(reader.next(r)) {
+        if(r.op == record::Op::Client) clients[r.client] = r.address;
+        else records.push_back(r);
+    }
+    // buffers are written out in the order they fill up, not in start order
+    std::stable_sort(records.begin(), records.end(),
+        [](const record::Record& a, const record::Record& b) { return a.start < b.start; });
+    spdlog::info("Loaded {} records from {} clients", records.size(), clients.size());
+
+    // find the regions used but not created by the trace, and their extent
+    std::map<warabi::RegionID, size_t> extents;
+    std::map<warabi::RegionID, bool>   created;
+    size_t max_size = 0;
+    for(auto& rec : records) {
+        max_size = std::max<size_t>(max_size, rec.size);
+        if(rec.op == record::Op::Create || rec.op == record::Op::CreateWrite) {
+            for(auto& region : rec.regions) created.emplace(region.first, true);
+            continue;
+        }
+        for(auto& region : rec.regions) {
+            created.emplace(region.first, false);
+            auto& extent = extents[region.first];
+            for(auto& segment : region.second)
+                extent = std::max(extent, segment.first + segment.second);
+        }
+    }
+
+    tl::engine engine(g_protocol, THALLIUM_CLIENT_MODE);
+
+    try {
+
+        warabi::Client client(engine);
+        auto target = client.makeTargetHandle(g_address, g_provider_id);
+
+        std::map<warabi::RegionID, warabi::RegionID> mapping;
+        for(auto& [region, was_created] : created) {
+            if(was_created) continue;
+            target.create(&mapping[region], extents[region]);
+        }
+        spdlog::info("Created {} regions accessed but not created in the trace", mapping.size());
+
+        std::vector<char> write_buffer(max_size, 'w');
+        std::vector<char> read_buffer(max_size);
+        std::map<record::Op, OpStats> stats;
+        std::deque<Pending> pending;
+        size_t skipped = 0;
+
+        auto start = Clock::now();
+        for(auto& rec : records) {
+            // wait for the time at which the request was sent (scaled)
+            if(g_speed > 0) {
+                auto at = start + std::chrono::nanoseconds((uint64_t)(rec.start / g_speed));
+                while(Clock::now() < at) {
+                    reap(pending, false);
+                    tl::thread::yield();
+                }
+            }
+            while(pending.size() >= g_max_in_flight) reap(pending, true);
+
+            auto& op_stats = stats[rec.op];
+            // translate the recorded regions into replayed regions
+            std::vector<warabi::RegionSegments> regions;
+            bool known = true;
+            if(rec.op != record::Op::Create && rec.op != record::Op::CreateWrite) {
+                for(auto& region : rec.regions) {
+                    auto it = mapping.find(region.first);
+                    if(it == mapping.end()) { known = false; break; }
+                    regions.emplace_back(it->second, region.second);
+                }
+            }
+            if(!known || (rec.op != record::Op::Create && rec.op != record::Op::CreateWrite
+                          && regions.empty())) {
+                skipped += 1;
+                continue;
+            }
+            op_stats.count += 1;
+            op_stats.bytes += rec.size;
+            op_stats.recorded.push_back(rec.duration);
+            bool persist = rec.flags & record::Flags::Persist;
+
+            // creations are synchronous since later requests need the new region
+            if(rec.op == record::Op::Create || rec.op == record::Op::CreateWrite) {
+                warabi::RegionID region;
+                auto issued = Clock::now();
+                try {
+                    if(rec.op == record::Op::Create)
+                        target.create(&region, rec.size);
+                    else
+                        target.createAndWrite(&region, write_buffer.data(), rec.size, persist);
+                    if(!rec.regions.empty()) mapping[rec.regions[0].first] = region;
+                } catch(const warabi::Exception& ex) {
+                    spdlog::debug("Request failed: {}", ex.what());
+                    op_stats.errors += 1;
+                }
+                op_stats.latencies.push_back(elapsedNs(issued));
+                continue;
+            }
+
+            Pending p{warabi::AsyncRequest{}, &op_stats, Clock::now()};
+            try {
+                switch(rec.op) {
+                case record::Op::Write:
+                    if(regions.size() == 1)
+                        target.write(regions[0].first, regions[0].second,
+                                     write_buffer.data(), persist, &p.request);
+                    else
+                        target.writev(regions, write_buffer.data(), persist, &p.request);
+                    break;
+                case record::Op::Read:
+                    if(regions.size() == 1)
+                        target.read(regions[0].first, regions[0].second,
+                                    read_buffer.data(), &p.request);
+                    else
+                        target.readv(regions, read_buffer.data(), &p.request);
+                    break;
+                case record::Op::Persist:
+                    target.persist(regions[0].first, regions[0].second, &p.request);
+                    break;
+                case record::Op::Erase:
+                    target.erase(regions[0].first, &p.request);
+                    mapping.erase(rec.regions[0].first);
+                    break;
+                default:
+                    break;
+                }
+            } catch(const warabi::Exception& ex) {
+                spdlog::debug("Request failed: {}", ex.what());
+                op_stats.errors += 1;
+                continue;
+            }
+            if(p.request) pending.push_back(std::move(p));
+        }
+        while(!pending.empty()) reap(pending, true);
+        double elapsed = elapsedNs(start) / 1e9;
+
+        // report
+        size_t total_count = 0, total_bytes = 0;
+        std::vector<uint64_t> all_latencies;
+        auto report = nlohmann::json::object();
+        report["ops"] = nlohmann::json::object();
+        if(!g_json)
+            fmt::print("{:<14}{:>10}{:>8}{:>12}{:>12}{:>12}{:>12}{:>14}{:>14}\n",
+                       "op", "count", "errors", "MiB", "p50 (us)", "p99 (us)", "max (us)",
+                       "rec p50 (us)", "rec p99 (us)");
+        for(auto& [op, s] : stats) {
+            total_count += s.count;
+            total_bytes += s.bytes;
+            all_latencies.insert(all_latencies.end(), s.latencies.begin(), s.latencies.end());
+            auto& entry = report["ops"][record::opName(op)];
+            entry["count"]           = s.count;
+            entry["errors"]          = s.errors;
+            entry["bytes"]           = s.bytes;
+            entry["p50_us"]          = percentile(s.latencies, 0.5);
+            entry["p99_us"]          = percentile(s.latencies, 0.99);
+            entry["max_us"]          = percentile(s.latencies, 1.0);
+            entry["recorded_p50_us"] = percentile(s.recorded, 0.5);
+            entry["recorded_p99_us"] = percentile(s.recorded, 0.99);
+            if(!g_json)
+                fmt::print("{:<14}{:>10}{:>8}{:>12.2f}{:>12.1f}{:>12.1f}{:>12.1f}{:>14.1f}{:>14.1f}\n",
+                           record::opName(op), s.count, s.errors, s.bytes / 1048576.0,
+                           entry["p50_us"].get<double>(), entry["p99_us"].get<double>(),
+                           entry["max_us"].get<double>(),
+                           entry["recorded_p50_us"].get<double>(),
+                           entry["recorded_p99_us"].get<double>());
+        }
+        report["requests"]         = total_count;
+        report["skipped"]          = skipped;
+        report["elapsed_s"]        = elapsed;
+        report["requests_per_s"]   = total_count / elapsed;
+        report["throughput_mib_s"] = total_bytes / 1048576.0 / elapsed;
+        report["p50_us"]           = percentile(all_latencies, 0.5);
+        report["p99_us"]           = percentile(all_latencies, 0.99);
+        if(g_json)
+            std::cout << report.dump(4) << std::endl;
+        else
+            fmt::print("\n{} requests ({} skipped) in {:.3f} s: {:.1f} req/s, {:.2f} MiB/s\n",
+                       total_count, skipped, elapsed, total_count / elapsed,
+                       total_bytes / 1048576.0 / elapsed);
+
+    } catch(const warabi::Exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        exit(-1);
+    }
+
+    return 0;
+}
+
+void parse_command_line(int argc, char** argv) {
+    try {
+        TCLAP::CmdLine cmd("Replays a trace recorded by a Warabi provider", ' ', "0.1");
+        TCLAP::ValueArg<std::string> addressArg("a","address","Address or server", true,"","string");
+        TCLAP::ValueArg<unsigned>    providerArg("p", "provider", "Provider id to contact (default 0)", false, 0, "int");
+        TCLAP::ValueArg<std::string> traceArg("t","trace","Trace file recorded by a provider", true,"","string");
+        TCLAP::ValueArg<double>      speedArg("s", "speed", "Speed relative to the recording, 0 for as fast as possible (default 1)", false, 1.0, "float");
+        TCLAP::ValueArg<unsigned>    inFlightArg("c", "concurrency", "Maximum number of requests in flight (default 64)", false, 64, "int");
+        TCLAP::SwitchArg             jsonArg("j", "json", "Print the report as JSON", cmd, false);
+        TCLAP::ValueArg<std::string> logLevel("v","verbose", "Log level (trace, debug, info, warning, error, critical, off)", false, "info", "string");
+        cmd.add(addressArg);
+        cmd.add(providerArg);
+        cmd.add(traceArg);
+        cmd.add(speedArg);
+        cmd.add(inFlightArg);
+        cmd.add(logLevel);
+        cmd.parse(argc, argv);
+        g_address = addressArg.getValue();
+        g_provider_id = providerArg.getValue();
+        g_trace_file = traceArg.getValue();
+        g_speed = speedArg.getValue();
+        g_max_in_flight = std::max(1u, inFlightArg.getValue());
+        g_log_level = logLevel.getValue();
+        g_json = jsonArg.getValue();
+        g_protocol = g_address.substr(0, g_address.find(":"));
+    } catch(TCLAP::ArgException &e) {
+        std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl;
+        exit(-1);
+    }
+}
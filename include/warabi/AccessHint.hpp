@@ -0,0 +1,28 @@
+/*
+ * (C) 2024 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __WARABI_ACCESS_HINT_HPP
+#define __WARABI_ACCESS_HINT_HPP
+
+#include <stdint.h>
+
+namespace warabi {
+
+/**
+ * @brief Hints a client can give a target about how it is going
+ * to access segments of regions, modeled after madvise(2). Targets
+ * are free to ignore them. Values match warabi_access_hint_t.
+ */
+enum class AccessHint : uint8_t {
+    Normal     = 0, // no particular access pattern
+    Sequential = 1, // segments will be read sequentially
+    Random     = 2, // segments will be read in random order
+    WillNeed   = 3, // segments will be read soon (prefetch them)
+    DontNeed   = 4  // segments won't be read in the near future
+};
+
+}
+
+#endif
@@ -15,6 +15,7 @@
 #include <thallium.hpp>
 
 #include <warabi/RegionID.hpp>
+#include <warabi/AccessHint.hpp>
 
 /**
  * @brief Helper class to register backend types into the backend factory.
@@ -24,6 +25,8 @@ class __WarabiBackendRegistration;
 
 namespace warabi {
 
+class TransferManager;
+
 /**
  * @brief Abstract class representing a handle to a region in
  * a given Backend. Each Backend implementation will typically
@@ -154,6 +157,15 @@ class Backend {
      */
     virtual std::string getConfig() const = 0;
 
+    /**
+     * @brief Returns JSON-formatted statistics about the target
+     * (e.g. where its memory is placed). The default implementation
+     * returns an empty object.
+     */
+    virtual std::string getStats() const {
+        return "{}";
+    }
+
     /**
      * @brief Create a region of a given size and return
      * an std::unique_ptr to a WritableRegion, or nullptr
@@ -165,6 +177,27 @@ class Backend {
      */
     virtual Result<std::unique_ptr<WritableRegion>> create(size_t size) = 0;
 
+    /**
+     * @brief Create a region of a given size and fill its content by
+     * calling fill() on it. fill() should not persist the data itself:
+     * if persist is true, the whole region is persisted once it is filled.
+     *
+     * The default implementation calls create(), fill(), then persist()
+     * on the region, and erases the region if fill() fails. Backends that
+     * can make the new region visible only once it has been filled (and
+     * thus make this operation crash-atomic) should override it.
+     *
+     * @param size Size of the region to create.
+     * @param fill Function filling the region.
+     * @param persist Whether to persist the region.
+     *
+     * @return the RegionID of the new region.
+     */
+    virtual Result<RegionID> createAndFill(
+            size_t size,
+            const std::function<Result<bool>(WritableRegion&)>& fill,
+            bool persist);
+
     /**
      * @brief Request access to a particular region for writing.
      * If the region does not exist, returns a nullptr.
@@ -177,12 +210,175 @@ class Backend {
      */
     virtual Result<std::unique_ptr<ReadableRegion>> read(const RegionID& region) = 0;
 
+    /**
+     * @brief The following functions access a region directly from its
+     * RegionID, without returning a WritableRegion or a ReadableRegion.
+     * Their default implementation goes through write() and read(),
+     * hence allocates a region object for each call; backends that can
+     * build their region objects on the stack should override them.
+     */
+
+    /**
+     * @brief Write data from a local buffer into a region.
+     */
+    virtual Result<bool> writeSegments(
+            const RegionID& region,
+            const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+            const void* data, bool persist);
+
+    /**
+     * @brief Pull data from a remote bulk handle into a region
+     * using the provided TransferManager.
+     */
+    virtual Result<bool> pullSegments(
+            const RegionID& region,
+            const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+            TransferManager& transferManager,
+            thallium::bulk data,
+            const thallium::endpoint& address,
+            size_t bulkOffset,
+            bool persist);
+
+    /**
+     * @brief Persist ranges of a region.
+     */
+    virtual Result<bool> persistSegments(
+            const RegionID& region,
+            const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes);
+
+    /**
+     * @brief Read data from a region into a local buffer.
+     */
+    virtual Result<bool> readSegments(
+            const RegionID& region,
+            const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+            void* data);
+
+    /**
+     * @brief Push data from a region to a remote bulk handle
+     * using the provided TransferManager.
+     */
+    virtual Result<bool> pushSegments(
+            const RegionID& region,
+            const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+            TransferManager& transferManager,
+            thallium::bulk data,
+            const thallium::endpoint& address,
+            size_t bulkOffset);
+
+    /**
+     * @brief The following functions access the segments of several
+     * regions at once, the data being laid out contiguously in the
+     * local buffer or remote bulk handle, in the order of the list.
+     * Their default implementation calls the corresponding *Segments
+     * function for each region in turn; backends that can present all
+     * the segments as a single region (so that the TransferManager can
+     * move them in one transfer) should override them.
+     */
+
+    /**
+     * @brief Write data from a local buffer into several regions.
+     */
+    virtual Result<bool> writeRegions(
+            const std::vector<RegionSegments>& regions,
+            const void* data, bool persist);
+
+    /**
+     * @brief Pull data from a remote bulk handle into several regions
+     * using the provided TransferManager.
+     */
+    virtual Result<bool> pullRegions(
+            const std::vector<RegionSegments>& regions,
+            TransferManager& transferManager,
+            thallium::bulk data,
+            const thallium::endpoint& address,
+            size_t bulkOffset,
+            bool persist);
+
+    /**
+     * @brief Read data from several regions into a local buffer.
+     */
+    virtual Result<bool> readRegions(
+            const std::vector<RegionSegments>& regions,
+            void* data);
+
+    /**
+     * @brief Push data from several regions to a remote bulk handle
+     * using the provided TransferManager.
+     */
+    virtual Result<bool> pushRegions(
+            const std::vector<RegionSegments>& regions,
+            TransferManager& transferManager,
+            thallium::bulk data,
+            const thallium::endpoint& address,
+            size_t bulkOffset);
+
     /**
      * @see TopicHandle::erase
      */
     virtual Result<bool> erase(
             const RegionID& region) = 0;
 
+    /**
+     * @brief Pin (pinned = true) or unpin (pinned = false) a region.
+     * Pins are counted, and a pinned region is never evicted by
+     * targets that have a capacity. The default implementation, for
+     * targets that never evict regions, does nothing.
+     */
+    virtual Result<bool> pin(
+            const RegionID& region, bool pinned) {
+        (void)region;
+        (void)pinned;
+        return Result<bool>{};
+    }
+
+    /**
+     * @brief Give the target a hint about how the segments of the
+     * given regions are going to be accessed (e.g. AccessHint::WillNeed
+     * to prefetch them). Hints are advisory: the default implementation
+     * ignores them.
+     */
+    virtual Result<bool> advise(
+            const std::vector<RegionSegments>& regions, AccessHint hint) {
+        (void)regions;
+        (void)hint;
+        return Result<bool>{};
+    }
+
+    /**
+     * @brief Size of the given region, for targets that can find it
+     * from the RegionID. The default implementation returns an error.
+     */
+    virtual Result<size_t> regionSize(const RegionID& region);
+
+    /**
+     * @brief Create a new region with the same content as the given
+     * one. Targets that support it share the data between the two
+     * regions until either is modified. The default implementation
+     * returns an error.
+     */
+    virtual Result<RegionID> clone(const RegionID& region);
+
+    /**
+     * @brief Record the current content of the target under the given
+     * name, so that restoreSnapshot can later bring the target back to
+     * that point in time. The default implementation returns an error.
+     */
+    virtual Result<bool> createSnapshot(const std::string& name);
+
+    /**
+     * @brief Bring the target back to the content it had when the named
+     * snapshot was created. Regions created since then become invalid.
+     * The default implementation returns an error.
+     */
+    virtual Result<bool> restoreSnapshot(const std::string& name);
+
+    /**
+     * @brief Delete a snapshot. The default implementation
+     * returns an error.
+     */
+    virtual Result<bool> deleteSnapshot(const std::string& name);
+
     /**
      * @brief Destroys the underlying target.
      *
@@ -99,6 +99,31 @@ class Client {
      */
     std::string getConfig() const;
 
+    /**
+     * @brief Enable tracing of the requests sent by this process,
+     * using a JSON-formatted configuration (see the "tracing" field
+     * of the provider configuration). The trace is written when the
+     * Client (and all its copies) is destroyed.
+     *
+     * @param config JSON-formatted tracing configuration.
+     */
+    void setTracingConfig(const std::string& config);
+
+    /**
+     * @brief Replace the TransferManager of a remote provider, or change
+     * its parameters, without restarting it (see
+     * Provider::setTransferManagerConfig for the format of the
+     * configuration). Returns once the transfers that were using the
+     * previous TransferManager have completed.
+     *
+     * @param address Address of the provider.
+     * @param provider_id Provider id.
+     * @param config JSON-formatted TransferManager configuration.
+     */
+    void setTransferManagerConfig(const std::string& address,
+                                  uint16_t provider_id,
+                                  const std::string& config) const;
+
     private:
 
     Client(const std::shared_ptr<ClientImpl>& impl);
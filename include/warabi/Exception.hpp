@@ -6,6 +6,7 @@
 #ifndef __WARABI_EXCEPTION_HPP
 #define __WARABI_EXCEPTION_HPP
 
+#include <cstdint>
 #include <exception>
 #include <string>
 
@@ -26,6 +27,39 @@ class Exception : public std::exception {
     }
 };
 
+/**
+ * @brief Exception thrown when a provider rejected a request
+ * because its target was overloaded. retryAfter() gives the number
+ * of milliseconds the provider suggests waiting before retrying.
+ */
+class BusyException : public Exception {
+
+    uint32_t m_retry_after;
+
+    public:
+
+    BusyException(const std::string& error, uint32_t retryAfter)
+    : Exception(error)
+    , m_retry_after(retryAfter) {}
+
+    uint32_t retryAfter() const noexcept {
+        return m_retry_after;
+    }
+};
+
+/**
+ * @brief Exception thrown when accessing a region that the target
+ * evicted to stay within its capacity. The region's content is lost
+ * and the region should be created again.
+ */
+class EvictedException : public Exception {
+
+    public:
+
+    EvictedException(const std::string& error)
+    : Exception(error) {}
+};
+
 }
 
 #endif
@@ -6,6 +6,7 @@
 #ifndef __WARABI_PROVIDER_HPP
 #define __WARABI_PROVIDER_HPP
 
+#include <warabi/Exception.hpp>
 #include <thallium.hpp>
 #include <memory>
 
@@ -92,6 +93,14 @@ class Provider {
      */
     std::string getConfig() const;
 
+    /**
+     * @brief Return JSON-formatted statistics about the provider
+     * (admission control, QoS, NUMA placement, and target).
+     *
+     * @return JSON formatted string.
+     */
+    std::string getStats() const;
+
     /**
      * @brief Checks whether the Provider instance is valid.
      */
@@ -120,6 +129,34 @@ class Provider {
                        uint16_t provider_id,
                        const std::string& options);
 
+    /**
+     * @brief Change the quality-of-service configuration of the provider
+     * at run time. The config argument should be a JSON string with the
+     * same format as the "qos" field of the provider's configuration
+     * (see QoSManager.hpp), or "null" to disable QoS. Requests that are
+     * waiting for admission are re-scheduled according to the new
+     * configuration. Throws an Exception if the configuration is invalid.
+     *
+     * @param config JSON-formatted QoS configuration.
+     */
+    void setQoSConfig(const std::string& config);
+
+    /**
+     * @brief Replace the TransferManager of the provider, or change its
+     * parameters, at run time. The config argument should be a JSON string
+     * with the same format as the "transfer_manager" field of the provider's
+     * configuration. If its "type" is missing or is the current type, its
+     * "config" is merged into the current one, e.g.
+     * {"config": {"num_buffers_per_pool": 16}} only changes the number of
+     * buffers of a pipeline TransferManager. New transfers use the new
+     * TransferManager immediately; the call returns once the transfers
+     * that were using the previous one have completed.
+     * Throws an Exception if the configuration is invalid.
+     *
+     * @param config JSON-formatted TransferManager configuration.
+     */
+    void setTransferManagerConfig(const std::string& config);
+
     private:
 
     std::shared_ptr<ProviderImpl> self;
@@ -7,7 +7,10 @@
 #define __WARABI_REGION_ID_HPP
 
 #include <stdint.h>
+#include <stddef.h>
 #include <array>
+#include <utility>
+#include <vector>
 
 namespace warabi {
 
@@ -18,6 +21,12 @@ namespace warabi {
  */
 typedef std::array<uint8_t, 16> RegionID;
 
+/**
+ * @brief A region and a list of (offset, size) segments in it, used by
+ * operations accessing several regions at once (readv and writev).
+ */
+typedef std::pair<RegionID, std::vector<std::pair<size_t, size_t>>> RegionSegments;
+
 }
 
 #endif
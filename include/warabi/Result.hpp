@@ -7,6 +7,7 @@
 #define __WARABI_RESULT_HPP
 
 #include <warabi/Exception.hpp>
+#include <cstdint>
 #include <string>
 
 namespace warabi {
@@ -18,6 +19,12 @@ namespace warabi {
  * - success must be set to true if the request succeeded, false otherwise
  * - error must be set to an error string if an error occured
  * - value must be set to the result of the request if it succeeded
+ * - retryAfter may be set to a non-zero number of milliseconds if the
+ *   request failed because the provider was busy, in which case check()
+ *   throws a BusyException instead of an Exception
+ * - evicted may be set to true if the request failed because the region
+ *   was evicted from its target, in which case check() throws an
+ *   EvictedException instead of an Exception
  *
  * This class is specialized for two types: bool and std::string.
  * If bool is used, both the value and the success fields will be
@@ -66,6 +73,38 @@ class Result {
         return m_error;
     }
 
+    /**
+     * @brief Number of milliseconds after which the request may
+     * be retried, if it failed because the provider was busy.
+     */
+    uint32_t& retryAfter() {
+        return m_retry_after;
+    }
+
+    /**
+     * @brief Number of milliseconds after which the request may
+     * be retried, if it failed because the provider was busy.
+     */
+    const uint32_t& retryAfter() const {
+        return m_retry_after;
+    }
+
+    /**
+     * @brief Whether the request failed because
+     * the region was evicted from its target.
+     */
+    bool& evicted() {
+        return m_evicted;
+    }
+
+    /**
+     * @brief Whether the request failed because
+     * the region was evicted from its target.
+     */
+    const bool& evicted() const {
+        return m_evicted;
+    }
+
     /**
      * @brief Value if the request succeeded.
      */
@@ -131,8 +170,12 @@ class Result {
      * contains an error.
      */
     void check() const {
-        if(!m_success)
-            throw Exception(m_error);
+        if(m_success) return;
+        if(m_retry_after)
+            throw BusyException(m_error, m_retry_after);
+        if(m_evicted)
+            throw EvictedException(m_error);
+        throw Exception(m_error);
     }
 
     /**
@@ -148,6 +191,8 @@ class Result {
             a & m_value;
         } else {
             a & m_error;
+            a & m_retry_after;
+            a & m_evicted;
         }
     }
 
@@ -155,6 +200,8 @@ class Result {
 
     bool        m_success = true;
     std::string m_error   = "";
+    uint32_t    m_retry_after = 0;
+    bool        m_evicted = false;
     T           m_value;
 };
 
@@ -185,6 +232,22 @@ class Result<std::string> {
         return m_content;
     }
 
+    uint32_t& retryAfter() {
+        return m_retry_after;
+    }
+
+    const uint32_t& retryAfter() const {
+        return m_retry_after;
+    }
+
+    bool& evicted() {
+        return m_evicted;
+    }
+
+    const bool& evicted() const {
+        return m_evicted;
+    }
+
     std::string& value() {
         return m_content;
     }
@@ -214,20 +277,30 @@ class Result<std::string> {
     }
 
     void check() const {
-        if(!m_success)
-            throw Exception(m_content);
+        if(m_success) return;
+        if(m_retry_after)
+            throw BusyException(m_content, m_retry_after);
+        if(m_evicted)
+            throw EvictedException(m_content);
+        throw Exception(m_content);
     }
 
     template<typename Archive>
     void serialize(Archive& a) {
         a & m_success;
         a & m_content;
+        if(!m_success) {
+            a & m_retry_after;
+            a & m_evicted;
+        }
     }
 
     private:
 
     bool        m_success = true;
     std::string m_content = "";
+    uint32_t    m_retry_after = 0;
+    bool        m_evicted = false;
 };
 
 template<>
@@ -257,6 +330,22 @@ class Result<bool> {
         return m_error;
     }
 
+    uint32_t& retryAfter() {
+        return m_retry_after;
+    }
+
+    const uint32_t& retryAfter() const {
+        return m_retry_after;
+    }
+
+    bool& evicted() {
+        return m_evicted;
+    }
+
+    const bool& evicted() const {
+        return m_evicted;
+    }
+
     bool& value() {
         return m_success;
     }
@@ -277,21 +366,30 @@ class Result<bool> {
     }
 
     void check() const {
-        if(!m_success)
-            throw Exception(m_error);
+        if(m_success) return;
+        if(m_retry_after)
+            throw BusyException(m_error, m_retry_after);
+        if(m_evicted)
+            throw EvictedException(m_error);
+        throw Exception(m_error);
     }
 
     template<typename Archive>
     void serialize(Archive& a) {
         a & m_success;
-        if(!m_success)
+        if(!m_success) {
             a & m_error;
+            a & m_retry_after;
+            a & m_evicted;
+        }
     }
 
     private:
 
     bool        m_success = true;
     std::string m_error   = "";
+    uint32_t    m_retry_after = 0;
+    bool        m_evicted = false;
 };
 
 }
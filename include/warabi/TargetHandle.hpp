@@ -14,6 +14,7 @@
 #include <warabi/Exception.hpp>
 #include <warabi/AsyncRequest.hpp>
 #include <warabi/RegionID.hpp>
+#include <warabi/AccessHint.hpp>
 
 namespace warabi {
 
@@ -279,6 +280,92 @@ class TargetHandle {
               size_t bulkOffset,
               AsyncRequest* req = nullptr) const;
 
+    /**
+     * @brief Read segments of several regions, in a single RPC, into
+     * the provided contiguous local memory buffer. The data of all the
+     * segments is laid out back to back, in the order of the regions.
+     *
+     * @param[in] regions Regions and offset/size pairs to read in each.
+     * @param[in] data Buffer into which to read.
+     * @param[out] req Optional request to make the call asynchronous.
+     */
+    void readv(const std::vector<RegionSegments>& regions,
+               char* data,
+               AsyncRequest* req = nullptr) const;
+
+    /**
+     * @brief Read segments of several regions, in a single RPC,
+     * into a bulk handle, contiguously from bulkOffset.
+     *
+     * @param[in] regions Regions and offset/size pairs to read in each.
+     * @param[in] data Bulk handle into which to push the data.
+     * @param[in] address Address of the process owning the bulk handle.
+     * @param[in] bulkOffset Offset at which to push in the provided bulk handle.
+     * @param[out] req Optional request to make the call asynchronous.
+     */
+    void readv(const std::vector<RegionSegments>& regions,
+               thallium::bulk data,
+               const std::string& address,
+               size_t bulkOffset,
+               AsyncRequest* req = nullptr) const;
+
+    /**
+     * @brief Write segments of several regions, in a single RPC, from
+     * the provided contiguous local memory buffer (laid out as in readv).
+     *
+     * @param[in] regions Regions and offset/size pairs to write in each.
+     * @param[in] data Buffer to write.
+     * @param[in] persist Whether to persist the data.
+     * @param[out] req Optional request to make the call asynchronous.
+     */
+    void writev(const std::vector<RegionSegments>& regions,
+                const char* data,
+                bool persist = false,
+                AsyncRequest* req = nullptr) const;
+
+    /**
+     * @brief Write segments of several regions, in a single RPC,
+     * from a bulk handle, contiguously from bulkOffset.
+     *
+     * @param[in] regions Regions and offset/size pairs to write in each.
+     * @param[in] data Bulk handle from which to pull the data.
+     * @param[in] address Address of the process owning the bulk handle.
+     * @param[in] bulkOffset Offset at which to pull in the provided bulk handle.
+     * @param[in] persist Whether to persist the data.
+     * @param[out] req Optional request to make the call asynchronous.
+     */
+    void writev(const std::vector<RegionSegments>& regions,
+                thallium::bulk data,
+                const std::string& address,
+                size_t bulkOffset,
+                bool persist = false,
+                AsyncRequest* req = nullptr) const;
+
+    /**
+     * @brief Tell the target how segments of regions are going to be
+     * accessed, so that it can prepare (e.g. read ahead). Hints are
+     * advisory and may be ignored by the target.
+     *
+     * @param[in] regions Regions and offset/size pairs the hint applies to.
+     * @param[in] hint Access hint.
+     * @param[out] req Optional request to make the call asynchronous.
+     */
+    void advise(const std::vector<RegionSegments>& regions,
+                AccessHint hint,
+                AsyncRequest* req = nullptr) const;
+
+    /**
+     * @brief Ask the target to prefetch segments of regions that are
+     * going to be read soon. Same as advise with AccessHint::WillNeed.
+     * Issuing it asynchronously before a compute phase lets the target
+     * hide the storage latency behind that phase.
+     *
+     * @param[in] regions Regions and offset/size pairs to prefetch.
+     * @param[out] req Optional request to make the call asynchronous.
+     */
+    void prefetch(const std::vector<RegionSegments>& regions,
+                  AsyncRequest* req = nullptr) const;
+
     /**
      * @brief Erase a region.
      *
@@ -288,6 +375,101 @@ class TargetHandle {
     void erase(const RegionID& region,
                AsyncRequest* req = nullptr) const;
 
+    /**
+     * @brief Pin a region so that the target doesn't evict it.
+     * Pins are counted: a region pinned n times needs to be unpinned
+     * n times before it may be evicted again. Only targets with a
+     * capacity evict regions; for others this has no effect.
+     *
+     * @param[in] region Region to pin.
+     * @param[out] req Optional request to make the call asynchronous.
+     */
+    void pin(const RegionID& region,
+             AsyncRequest* req = nullptr) const;
+
+    /**
+     * @brief Unpin a region previously pinned with pin().
+     *
+     * @param[in] region Region to unpin.
+     * @param[out] req Optional request to make the call asynchronous.
+     */
+    void unpin(const RegionID& region,
+               AsyncRequest* req = nullptr) const;
+
+    /**
+     * @brief Copy a region into a new region of the destination
+     * target. The copy is done by the provider of the source region,
+     * which sends the data directly to the destination's provider
+     * (or copies it locally if the destination is the same provider),
+     * without going through the client.
+     *
+     * @param[in] source Region to copy.
+     * @param[in] size Size of the region.
+     * @param[in] destination Target in which to create the copy.
+     * @param[out] region Created region ID.
+     * @param[in] persist Whether to also persist the copy.
+     * @param[out] req Optional request to make the call asynchronous.
+     */
+    void copy(const RegionID& source, size_t size,
+              const TargetHandle& destination,
+              RegionID* region,
+              bool persist = false,
+              AsyncRequest* req = nullptr) const;
+
+    /**
+     * @brief Same as copy, but erases the source region once the copy
+     * is complete. Moving a region to its own target leaves it in place
+     * and returns its ID.
+     */
+    void move(const RegionID& source, size_t size,
+              const TargetHandle& destination,
+              RegionID* region,
+              bool persist = false,
+              AsyncRequest* req = nullptr) const;
+
+    /**
+     * @brief Create a region with the same content as the given one.
+     * The memory and abtio targets share the data of the two regions
+     * until either is modified (copy-on-write).
+     *
+     * @param[in] source Region to clone.
+     * @param[out] region Created region ID.
+     * @param[out] req Optional request to make the call asynchronous.
+     */
+    void clone(const RegionID& source,
+               RegionID* region,
+               AsyncRequest* req = nullptr) const;
+
+    /**
+     * @brief Record the current content of the target under
+     * the given name.
+     *
+     * @param[in] name Name of the snapshot.
+     * @param[out] req Optional request to make the call asynchronous.
+     */
+    void createSnapshot(const std::string& name,
+                        AsyncRequest* req = nullptr) const;
+
+    /**
+     * @brief Bring the target back to the content it had when the
+     * named snapshot was created. Regions created since then become
+     * invalid. The snapshot is kept and may be restored again.
+     *
+     * @param[in] name Name of the snapshot.
+     * @param[out] req Optional request to make the call asynchronous.
+     */
+    void restoreSnapshot(const std::string& name,
+                         AsyncRequest* req = nullptr) const;
+
+    /**
+     * @brief Delete a snapshot.
+     *
+     * @param[in] name Name of the snapshot.
+     * @param[out] req Optional request to make the call asynchronous.
+     */
+    void deleteSnapshot(const std::string& name,
+                        AsyncRequest* req = nullptr) const;
+
     /**
      * @brief Set the threshold for eager writes
      * (default is 2048).
@@ -300,6 +482,28 @@ class TargetHandle {
      */
     void setEagerReadThreshold(size_t size);
 
+    /**
+     * @brief Enable a client-side cache of up to capacity bytes for
+     * reads below the eager read threshold (0, the default, disables it).
+     * Segments are cached only if the provider grants a lease on their
+     * region (see the "leases" field of the provider's configuration),
+     * and are served from the cache until the lease expires. Since the
+     * provider delays modifications of a region until the leases on it
+     * have expired, cached data is never stale. Copies of this
+     * TargetHandle share the same cache.
+     */
+    void setReadCacheCapacity(size_t capacity);
+
+    /**
+     * @brief Set the policy used when the provider rejects a request
+     * because its target is busy: the request is retried up to
+     * maxRetries times (default is 8), with a jittered exponential
+     * backoff starting from the delay suggested by the provider and
+     * capped to maxBackoffMs milliseconds (default is 1000).
+     * Once retries are exhausted, a BusyException is thrown.
+     */
+    void setRetryPolicy(size_t maxRetries, size_t maxBackoffMs);
+
     private:
 
     /**
@@ -310,6 +514,14 @@ class TargetHandle {
      */
     TargetHandle(const std::shared_ptr<TargetHandleImpl>& impl);
 
+    /**
+     * @brief Eager read going through the read cache.
+     */
+    void readCached(const RegionID& region,
+                    const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+                    char* data, size_t size,
+                    AsyncRequest* req) const;
+
     std::shared_ptr<TargetHandleImpl> self;
 };
 
@@ -69,6 +69,36 @@ warabi_err_t warabi_target_handle_free(warabi_target_handle_t th);
  */
 char* warabi_client_get_config(warabi_client_t client);
 
+/**
+ * @brief Enable tracing of the requests sent by this process
+ * (see warabi::Client::setTracingConfig).
+ *
+ * @param client Client.
+ * @param config JSON-formatted tracing configuration.
+ *
+ * @return warabi_err_t handle.
+ */
+warabi_err_t warabi_client_set_tracing_config(
+        warabi_client_t client,
+        const char* config);
+
+/**
+ * @brief Replace the transfer manager of a remote provider, or change
+ * its parameters (see warabi::Client::setTransferManagerConfig).
+ *
+ * @param client Client.
+ * @param address Address of the provider.
+ * @param provider_id Provider id.
+ * @param config JSON-formatted transfer manager configuration.
+ *
+ * @return warabi_err_t handle.
+ */
+warabi_err_t warabi_client_set_transfer_manager_config(
+        warabi_client_t client,
+        const char* address,
+        uint16_t provider_id,
+        const char* config);
+
 /**
  * @brief Create a region.
  *
@@ -263,6 +293,97 @@ warabi_err_t warabi_read_multi_bulk(
         size_t bulkOffset,
         warabi_async_request_t* req);
 
+/**
+ * @brief Read segments of several regions in a single RPC into a
+ * contiguous buffer. Region i has segmentCounts[i] segments, whose
+ * offsets and sizes follow those of region i-1 in the regionOffsets
+ * and regionSizes arrays.
+ *
+ * @param[in] th Target handle.
+ * @param[in] count Number of regions.
+ * @param[in] regions Array of regions.
+ * @param[in] segmentCounts Number of segments of each region.
+ * @param[in] regionOffsets Offsets of all the segments.
+ * @param[in] regionSizes Sizes of all the segments.
+ * @param[in] data Buffer into which to read.
+ * @param[out] req Optional asynchronous request.
+ *
+ * @return warabi_err_t handle.
+ */
+warabi_err_t warabi_readv(
+        warabi_target_handle_t th,
+        size_t count,
+        const warabi_region_t* regions,
+        const size_t* segmentCounts,
+        const size_t* regionOffsets,
+        const size_t* regionSizes,
+        char* data,
+        warabi_async_request_t* req);
+
+/**
+ * @brief Write segments of several regions in a single RPC from
+ * a contiguous buffer (arguments are laid out as in warabi_readv).
+ */
+warabi_err_t warabi_writev(
+        warabi_target_handle_t th,
+        size_t count,
+        const warabi_region_t* regions,
+        const size_t* segmentCounts,
+        const size_t* regionOffsets,
+        const size_t* regionSizes,
+        const char* data,
+        bool persist,
+        warabi_async_request_t* req);
+
+/**
+ * @brief Access hints (see warabi_advise).
+ */
+typedef enum warabi_access_hint_t {
+    WARABI_ACCESS_NORMAL     = 0,
+    WARABI_ACCESS_SEQUENTIAL = 1,
+    WARABI_ACCESS_RANDOM     = 2,
+    WARABI_ACCESS_WILLNEED   = 3,
+    WARABI_ACCESS_DONTNEED   = 4
+} warabi_access_hint_t;
+
+/**
+ * @brief Tell the target how segments of regions are going to be
+ * accessed (arguments are laid out as in warabi_readv). Hints are
+ * advisory and may be ignored by the target.
+ *
+ * @param[in] th Target handle.
+ * @param[in] count Number of regions.
+ * @param[in] regions Array of regions.
+ * @param[in] segmentCounts Number of segments of each region.
+ * @param[in] regionOffsets Offsets of all the segments.
+ * @param[in] regionSizes Sizes of all the segments.
+ * @param[in] hint Access hint.
+ * @param[out] req Optional asynchronous request.
+ *
+ * @return warabi_err_t handle.
+ */
+warabi_err_t warabi_advise(
+        warabi_target_handle_t th,
+        size_t count,
+        const warabi_region_t* regions,
+        const size_t* segmentCounts,
+        const size_t* regionOffsets,
+        const size_t* regionSizes,
+        warabi_access_hint_t hint,
+        warabi_async_request_t* req);
+
+/**
+ * @brief Same as warabi_advise with WARABI_ACCESS_WILLNEED.
+ */
+warabi_err_t warabi_prefetch(
+        warabi_target_handle_t th,
+        size_t count,
+        const warabi_region_t* regions,
+        const size_t* segmentCounts,
+        const size_t* regionOffsets,
+        const size_t* regionSizes,
+        warabi_async_request_t* req);
+
 /**
  * @brief Erase a region.
  *
@@ -277,6 +398,132 @@ warabi_err_t warabi_erase(
         warabi_region_t region,
         warabi_async_request_t* req);
 
+/**
+ * @brief Pin a region so that the target doesn't evict it.
+ * Pins are counted (see warabi::TargetHandle::pin).
+ *
+ * @param[in] th Target handle.
+ * @param[in] region Region to pin.
+ * @param[out] req Optional asynchronous request.
+ *
+ * @return warabi_err_t handle.
+ */
+warabi_err_t warabi_pin(
+        warabi_target_handle_t th,
+        warabi_region_t region,
+        warabi_async_request_t* req);
+
+/**
+ * @brief Unpin a region previously pinned with warabi_pin.
+ *
+ * @param[in] th Target handle.
+ * @param[in] region Region to unpin.
+ * @param[out] req Optional asynchronous request.
+ *
+ * @return warabi_err_t handle.
+ */
+warabi_err_t warabi_unpin(
+        warabi_target_handle_t th,
+        warabi_region_t region,
+        warabi_async_request_t* req);
+
+/**
+ * @brief Copy a region into a new region of the destination target
+ * (see warabi::TargetHandle::copy).
+ *
+ * @param[in] th Target handle of the source region.
+ * @param[in] source Region to copy.
+ * @param[in] size Size of the region.
+ * @param[in] dest Target handle of the destination target.
+ * @param[in] persist Whether to also persist the copy.
+ * @param[out] region Created region.
+ * @param[out] req Optional asynchronous request.
+ *
+ * @return warabi_err_t handle.
+ */
+warabi_err_t warabi_copy(
+        warabi_target_handle_t th,
+        warabi_region_t source,
+        size_t size,
+        warabi_target_handle_t dest,
+        bool persist,
+        warabi_region_t* region,
+        warabi_async_request_t* req);
+
+/**
+ * @brief Same as warabi_copy but erases the source region
+ * once the copy is complete.
+ */
+warabi_err_t warabi_move(
+        warabi_target_handle_t th,
+        warabi_region_t source,
+        size_t size,
+        warabi_target_handle_t dest,
+        bool persist,
+        warabi_region_t* region,
+        warabi_async_request_t* req);
+
+/**
+ * @brief Create a region with the same content as the given one
+ * (see warabi::TargetHandle::clone).
+ *
+ * @param[in] th Target handle.
+ * @param[in] source Region to clone.
+ * @param[out] region Created region.
+ * @param[out] req Optional asynchronous request.
+ *
+ * @return warabi_err_t handle.
+ */
+warabi_err_t warabi_clone(
+        warabi_target_handle_t th,
+        warabi_region_t source,
+        warabi_region_t* region,
+        warabi_async_request_t* req);
+
+/**
+ * @brief Record the current content of the target
+ * under the given name.
+ *
+ * @param[in] th Target handle.
+ * @param[in] name Name of the snapshot.
+ * @param[out] req Optional asynchronous request.
+ *
+ * @return warabi_err_t handle.
+ */
+warabi_err_t warabi_create_snapshot(
+        warabi_target_handle_t th,
+        const char* name,
+        warabi_async_request_t* req);
+
+/**
+ * @brief Bring the target back to the content it had
+ * when the named snapshot was created.
+ *
+ * @param[in] th Target handle.
+ * @param[in] name Name of the snapshot.
+ * @param[out] req Optional asynchronous request.
+ *
+ * @return warabi_err_t handle.
+ */
+warabi_err_t warabi_restore_snapshot(
+        warabi_target_handle_t th,
+        const char* name,
+        warabi_async_request_t* req);
+
+/**
+ * @brief Delete a snapshot.
+ *
+ * @param[in] th Target handle.
+ * @param[in] name Name of the snapshot.
+ * @param[out] req Optional asynchronous request.
+ *
+ * @return warabi_err_t handle.
+ */
+warabi_err_t warabi_delete_snapshot(
+        warabi_target_handle_t th,
+        const char* name,
+        warabi_async_request_t* req);
+
 /**
  * @brief Wait on an asynchronous request. This will also free the
  * underlying handle request handle.
@@ -325,6 +572,35 @@ warabi_err_t warabi_set_eager_read_threshold(
         warabi_target_handle_t th,
         size_t size);
 
+/**
+ * @brief Enable a client-side cache of up to capacity bytes for small
+ * reads, kept coherent through leases granted by the provider
+ * (0 disables it).
+ *
+ * @param th Target handle.
+ * @param capacity Capacity in bytes.
+ *
+ * @return warabi_err_t handle.
+ */
+warabi_err_t warabi_set_read_cache_capacity(
+        warabi_target_handle_t th,
+        size_t capacity);
+
+/**
+ * @brief Set the policy used to retry requests that the provider
+ * rejected because its target was busy.
+ *
+ * @param th Target handle.
+ * @param max_retries Maximum number of retries.
+ * @param max_backoff_ms Maximum delay between retries, in milliseconds.
+ *
+ * @return warabi_err_t handle.
+ */
+warabi_err_t warabi_set_retry_policy(
+        warabi_target_handle_t th,
+        size_t max_retries,
+        size_t max_backoff_ms);
+
 #ifdef __cplusplus
 }
 #endif
@@ -18,6 +18,12 @@ typedef struct warabi_err* warabi_err_t;
  */
 const char* warabi_err_message(warabi_err_t err);
 
+/**
+ * @brief Return 1 if the error was caused by accessing a region
+ * that its target evicted, 0 otherwise.
+ */
+int warabi_err_is_evicted(warabi_err_t err);
+
 /**
  * @brief Free the error handle.
  */
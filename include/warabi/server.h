@@ -53,6 +53,12 @@ warabi_err_t warabi_provider_deregister(warabi_provider_t provider);
  */
 char* warabi_provider_get_config(warabi_provider_t provider);
 
+/**
+ * @brief Get the provider statistics as a JSON string. The caller is
+ * responsible for freeing the returned string.
+ */
+char* warabi_provider_get_stats(warabi_provider_t provider);
+
 /**
  * @brief Request that the provider migrate its target to another
  * provider.
@@ -69,6 +75,29 @@ warabi_err_t warabi_provider_migrate(warabi_provider_t provider,
                                      uint16_t dest_provider_id,
                                      const char* migration_config);
 
+/**
+ * @brief Change the quality-of-service configuration of the provider.
+ *
+ * @param provider Provider.
+ * @param qos_config JSON-formatted QoS configuration, or "null" to disable QoS.
+ *
+ * @return warabi_err_t handle.
+ */
+warabi_err_t warabi_provider_set_qos_config(warabi_provider_t provider,
+                                            const char* qos_config);
+
+/**
+ * @brief Replace the transfer manager of the provider, or change its
+ * parameters (see warabi::Provider::setTransferManagerConfig).
+ *
+ * @param provider Provider.
+ * @param tm_config JSON-formatted transfer manager configuration.
+ *
+ * @return warabi_err_t handle.
+ */
+warabi_err_t warabi_provider_set_transfer_manager_config(warabi_provider_t provider,
+                                                         const char* tm_config);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,290 @@
+# (C) 2024 The University of Chicago
+# See COPYRIGHT in top-level directory.
+
+
+"""
+.. module:: autotune
+   :synopsis: This package provides a driver that searches the configuration
+   space of a Warabi provider (see config_space.py) for the configuration
+   that performs best on a given workload.
+
+The Autotuner samples configurations from the space built by a
+WarabiSpaceBuilder, starts a provider with each of them (by default, a
+bedrock process on the local machine), runs a workload against it (by
+default, warabi-replay on a trace recorded by a provider) and keeps the
+configuration that maximizes throughput or minimizes the 99th percentile
+latency. Search is either random or Bayesian (the latter requires SMAC).
+
+Example::
+
+    python -m mochi.warabi.autotune --trace my.trace --trials 20 \\
+        --objective throughput --output best-provider.json \\
+        --pipeline-first-buffer-size 65536 1048576
+
+"""
+
+
+import contextlib
+import json
+import math
+import os
+import queue
+import re
+import subprocess
+import tempfile
+import threading
+from dataclasses import dataclass, field
+from typing import Callable, ContextManager, Optional
+from mochi.bedrock.spec import ProcSpec, Config
+from .config_space import WarabiSpaceBuilder
+
+
+@dataclass
+class Trial:
+
+    provider_config: dict
+    metrics: dict = field(default_factory=dict)
+    cost: float = math.inf
+    error: Optional[str] = None
+
+
+class BedrockLauncher:
+    """
+    Starts a bedrock process with a given process configuration and yields
+    its address, waiting for bedrock to report it in its logs. The process
+    is terminated when leaving the context.
+    """
+
+    def __init__(self, *, executable: str = 'bedrock',
+                 protocol: str = 'na+sm',
+                 libraries: dict[str, str] = {'warabi': 'libwarabi-bedrock-module.so'},
+                 address_pattern: str = r'running at (\S+)',
+                 timeout: float = 30.0):
+        self.executable = executable
+        self.protocol = protocol
+        self.libraries = libraries
+        self.address_pattern = re.compile(address_pattern)
+        self.timeout = timeout
+
+    def _add_libraries(self, proc_config: dict) -> dict:
+        libraries = proc_config.get('libraries', {})
+        if isinstance(libraries, list):
+            libraries.extend(lib for lib in self.libraries.values() if lib not in libraries)
+        else:
+            libraries.update(self.libraries)
+        proc_config['libraries'] = libraries
+        return proc_config
+
+    @contextlib.contextmanager
+    def __call__(self, proc_config: dict):
+        with tempfile.NamedTemporaryFile('w', suffix='.json', delete=False) as f:
+            json.dump(self._add_libraries(proc_config), f)
+            config_file = f.name
+        process = subprocess.Popen(
+            [self.executable, self.protocol, '-c', config_file, '-v', 'info'],
+            stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+        # bedrock's output is read by a thread so that its pipe never fills up
+        lines = queue.Queue()
+        def read_output():
+            for line in process.stdout:
+                lines.put(line)
+            lines.put(None)
+        threading.Thread(target=read_output, daemon=True).start()
+        try:
+            address = None
+            while address is None:
+                line = lines.get(timeout=self.timeout)
+                if line is None:
+                    raise RuntimeError(f'bedrock exited with code {process.wait()}')
+                match = self.address_pattern.search(line)
+                if match:
+                    address = match.group(1)
+            yield address
+        finally:
+            process.terminate()
+            try:
+                process.wait(timeout=self.timeout)
+            except subprocess.TimeoutExpired:
+                process.kill()
+            os.unlink(config_file)
+
+
+class ReplayWorkload:
+    """
+    Replays a trace recorded by a Warabi provider against the provider
+    under evaluation using warabi-replay, and returns its JSON report
+    (which contains "throughput_mib_s", "requests_per_s", "p50_us" and
+    "p99_us", among others).
+    """
+
+    def __init__(self, trace: str, *, executable: str = 'warabi-replay',
+                 speed: float = 0.0, concurrency: int = 64,
+                 timeout: Optional[float] = None):
+        self.trace = trace
+        self.executable = executable
+        self.speed = speed
+        self.concurrency = concurrency
+        self.timeout = timeout
+
+    def __call__(self, address: str, provider_id: int) -> dict:
+        result = subprocess.run(
+            [self.executable, '-a', address, '-p', str(provider_id),
+             '-t', self.trace, '-s', str(self.speed),
+             '-c', str(self.concurrency), '-j', '-v', 'error'],
+            capture_output=True, text=True, timeout=self.timeout, check=True)
+        return json.loads(result.stdout)
+
+
+# Objectives map the metrics returned by a workload to a cost to minimize
+Objectives = {
+    'throughput': lambda metrics: -metrics['throughput_mib_s'],
+    'p99': lambda metrics: metrics['p99_us'],
+}
+
+
+# Ranges searched for the pipeline TransferManager's parameters (the
+# WarabiSpaceBuilder's own defaults are constants, leaving nothing to tune);
+# the number and size of buffers are sampled on a log scale
+PipelineRanges = {
+    'pipeline_num_pools': (1, 4),
+    'pipeline_num_buffers_per_pool': (2, 64),
+    'pipeline_first_buffer_size': (4096, 4194304),
+    'pipeline_buffer_size_multiplier': (2, 4),
+}
+
+
+class Autotuner:
+
+    def __init__(self, workload: Callable[[str, int], dict], *,
+                 builder: Optional[WarabiSpaceBuilder] = None,
+                 launcher: Optional[Callable[[dict], ContextManager[str]]] = None,
+                 objective: str|Callable[[dict], float] = 'throughput',
+                 protocol: str = 'na+sm',
+                 num_pools: int|tuple[int,int] = (1,3),
+                 num_xstreams: int|tuple[int,int] = (2,5),
+                 seed: Optional[int] = None):
+        self.workload = workload
+        self.builder = builder if builder is not None else \
+            WarabiSpaceBuilder(types=['memory'], **PipelineRanges)
+        self.launcher = launcher if launcher is not None else \
+            BedrockLauncher(protocol=protocol)
+        self.objective = Objectives[objective] if isinstance(objective, str) else objective
+        self.protocol = protocol
+        self.seed = seed
+        provider_space_factories = [
+            {
+                "family": "storage",
+                "builder": self.builder,
+                "count": 1
+            }
+        ]
+        self.space = ProcSpec.space(num_pools=num_pools, num_xstreams=num_xstreams,
+                                    provider_space_factories=provider_space_factories).freeze()
+        if seed is not None:
+            self.space.seed(seed)
+        self.trials: list[Trial] = []
+
+    def evaluate(self, config: Config) -> Trial:
+        """
+        Start a provider with the given configuration, run the workload
+        against it and return the resulting Trial (with an infinite cost
+        if the provider or the workload failed).
+        """
+        proc_config = json.loads(
+            ProcSpec.from_config(address=self.protocol, config=config).to_json())
+        provider = next(p for p in proc_config['providers'] if p['type'] == 'warabi')
+        trial = Trial(provider_config=provider['config'])
+        try:
+            with self.launcher(proc_config) as address:
+                trial.metrics = self.workload(address, provider['provider_id'])
+            trial.cost = self.objective(trial.metrics)
+        except Exception as e:
+            trial.error = str(e)
+        self.trials.append(trial)
+        return trial
+
+    def best(self) -> Optional[Trial]:
+        """
+        Return the best trial evaluated so far (None if none succeeded).
+        """
+        successful = [t for t in self.trials if t.error is None]
+        return min(successful, key=lambda t: t.cost) if successful else None
+
+    def random_search(self, num_trials: int) -> Optional[Trial]:
+        configs = self.space.sample_configuration(num_trials)
+        if not isinstance(configs, list):
+            configs = [configs]
+        for config in configs:
+            self.evaluate(config)
+        return self.best()
+
+    def bayesian_search(self, num_trials: int) -> Optional[Trial]:
+        from smac import HyperparameterOptimizationFacade, Scenario
+        scenario = Scenario(self.space, n_trials=num_trials, deterministic=True,
+                            seed=self.seed if self.seed is not None else 0)
+        def cost(config: Config, seed: int = 0) -> float:
+            trial = self.evaluate(config)
+            # SMAC needs finite costs, failed trials get a very bad one
+            return trial.cost if math.isfinite(trial.cost) else 1e30
+        smac = HyperparameterOptimizationFacade(scenario, cost, overwrite=True)
+        smac.optimize()
+        return self.best()
+
+    def search(self, num_trials: int, method: str = 'random') -> Optional[Trial]:
+        if method == 'random':
+            return self.random_search(num_trials)
+        if method == 'bayesian':
+            return self.bayesian_search(num_trials)
+        raise ValueError(f'Unknown search method "{method}"')
+
+
+def _range(low: int, high: int) -> int|tuple[int,int]:
+    return low if low == high else (low, high)
+
+
+def main():
+    import argparse
+    parser = argparse.ArgumentParser(
+        description='Search for the Warabi provider configuration that performs '
+                    'best when replaying a trace recorded by a provider')
+    parser.add_argument('--trace', required=True, help='Trace recorded by a provider')
+    parser.add_argument('--trials', type=int, default=20, help='Number of configurations to try')
+    parser.add_argument('--method', choices=['random', 'bayesian'], default='random')
+    parser.add_argument('--objective', choices=list(Objectives.keys()), default='throughput')
+    parser.add_argument('--protocol', default='na+sm')
+    parser.add_argument('--types', nargs='+', default=['memory'], help='Backend types to try')
+    parser.add_argument('--paths', nargs='*', default=[], help='Paths for persistent backends')
+    for name, (low, high) in PipelineRanges.items():
+        parser.add_argument('--' + name.replace('_', '-'), type=int, nargs=2,
+                            default=[low, high], metavar=('MIN', 'MAX'),
+                            help=f'Range of the pipeline TransferManager\'s '
+                                 f'{name[len("pipeline_"):]} (default: {low} {high})')
+    parser.add_argument('--speed', type=float, default=0.0,
+                        help='Replay speed relative to the recording (0: as fast as possible)')
+    parser.add_argument('--concurrency', type=int, default=64)
+    parser.add_argument('--seed', type=int, default=None)
+    parser.add_argument('--output', default=None,
+                        help='File to write the best provider configuration to (default: stdout)')
+    args = parser.parse_args()
+
+    tuner = Autotuner(
+        ReplayWorkload(args.trace, speed=args.speed, concurrency=args.concurrency),
+        builder=WarabiSpaceBuilder(
+            types=args.types, paths=args.paths,
+            **{name: _range(*getattr(args, name)) for name in PipelineRanges}),
+        launcher=BedrockLauncher(protocol=args.protocol),
+        objective=args.objective, protocol=args.protocol, seed=args.seed)
+    best = tuner.search(args.trials, args.method)
+    if best is None:
+        errors = '\n'.join(t.error for t in tuner.trials if t.error)
+        raise SystemExit(f'No configuration could be evaluated:\n{errors}')
+    output = json.dumps(best.provider_config, indent=4)
+    if args.output is None:
+        print(output)
+    else:
+        with open(args.output, 'w') as f:
+            f.write(output)
+
+
+if __name__ == "__main__":
+    main()
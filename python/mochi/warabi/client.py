@@ -0,0 +1,36 @@
+# (C) 2024 The University of Chicago
+# See COPYRIGHT in top-level directory.
+
+
+"""
+.. module:: client
+   :synopsis: This package provides access to the Warabi client library.
+
+A Client is created from a pymargo Engine. Data may be passed as any object
+supporting the buffer protocol (bytes, bytearray, memoryview, NumPy arrays...)
+as long as it is contiguous; its memory is used directly, without copy.
+Region IDs are 16-byte bytes objects.
+
+Example::
+
+    engine = Engine('na+sm')
+    client = Client(engine)
+    target = client.make_target_handle(address, provider_id=42)
+    region = target.create_and_write(numpy.arange(1024, dtype=numpy.float64))
+    result = numpy.empty(1024, dtype=numpy.float64)
+    target.read_into(region, 0, result)
+
+Methods with an _async suffix release the GIL and return an AsyncRequest,
+which keeps the buffer alive until the operation completes. An AsyncRequest
+may be waited on with wait(), or awaited in an asyncio event loop.
+
+"""
+
+
+import pywarabi_client
+
+
+Client = pywarabi_client.Client
+TargetHandle = pywarabi_client.TargetHandle
+AsyncRequest = pywarabi_client.AsyncRequest
+WarabiException = pywarabi_client.Exception
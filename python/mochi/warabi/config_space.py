@@ -23,6 +23,18 @@ from mochi.bedrock.spec import (
         ProviderSpec)
 
 
+def _integer_or_const(name: str, value: int|tuple[int,int], log: bool = False):
+    """
+    IntegerOrConst, sampled on a log scale when value is a range and log is
+    True (e.g. for buffer sizes, so that small values are tried as often as
+    large ones).
+    """
+    from mochi.bedrock.config_space import IntegerOrConst
+    if log and isinstance(value, tuple):
+        return IntegerOrConst(name, value, log=True)
+    return IntegerOrConst(name, value)
+
+
 @dataclass(frozen=True)
 class BackendType:
 
@@ -68,7 +80,6 @@ class WarabiSpaceBuilder:
         from mochi.bedrock.config_space import (
             CategoricalChoice,
             InCondition,
-            IntegerOrConst,
             EqualsCondition,
             CategoricalOrConst)
         # add a pool dependency
@@ -88,26 +99,26 @@ class WarabiSpaceBuilder:
         configuration_space.add(hp_tm_type)
         # add the parameters for pipeline transfer manager, if necessary
         if 'pipeline' in self.transfer_managers:
-            hp_pipeline_num_pools = IntegerOrConst('tm.pipeline.num_pools',
-                                                   self.pipeline_num_pools)
+            hp_pipeline_num_pools = _integer_or_const('tm.pipeline.num_pools',
+                                                     self.pipeline_num_pools)
             configuration_space.add(hp_pipeline_num_pools)
             pipeline_num_pools_cond = EqualsCondition(
                     hp_pipeline_num_pools, hp_tm_type, 'pipeline')
             configuration_space.add(pipeline_num_pools_cond)
-            hp_pipeline_num_buffers_per_pool = IntegerOrConst('tm.pipeline.num_buffers_per_pool',
-                                                              self.pipeline_num_buffers_per_pool)
+            hp_pipeline_num_buffers_per_pool = _integer_or_const('tm.pipeline.num_buffers_per_pool',
+                                                                self.pipeline_num_buffers_per_pool, log=True)
             configuration_space.add(hp_pipeline_num_buffers_per_pool)
             pipeline_num_buffers_per_pool_cond = EqualsCondition(
                     hp_pipeline_num_buffers_per_pool, hp_tm_type, 'pipeline')
             configuration_space.add(pipeline_num_buffers_per_pool_cond)
-            hp_pipeline_first_buffer_size = IntegerOrConst('tm.pipeline.first_buffer_size',
-                                                           self.pipeline_first_buffer_size)
+            hp_pipeline_first_buffer_size = _integer_or_const('tm.pipeline.first_buffer_size',
+                                                             self.pipeline_first_buffer_size, log=True)
             configuration_space.add(hp_pipeline_first_buffer_size)
             pipeline_first_buffer_size_cond = EqualsCondition(
                     hp_pipeline_first_buffer_size, hp_tm_type, 'pipeline')
             configuration_space.add(pipeline_first_buffer_size_cond)
-            hp_pipeline_buffer_size_multiplier = IntegerOrConst('tm.pipeline.buffer_size_multiplier',
-                                                                self.pipeline_buffer_size_multiplier)
+            hp_pipeline_buffer_size_multiplier = _integer_or_const('tm.pipeline.buffer_size_multiplier',
+                                                                  self.pipeline_buffer_size_multiplier)
             configuration_space.add(hp_pipeline_buffer_size_multiplier)
             pipeline_buffer_size_multiplier_cond = EqualsCondition(
                     hp_pipeline_buffer_size_multiplier, hp_tm_type, 'pipeline')
@@ -0,0 +1,55 @@
+# (C) 2024 The University of Chicago
+# See COPYRIGHT in top-level directory.
+
+
+import contextlib
+import unittest
+from .autotune import Autotuner
+from .config_space import WarabiSpaceBuilder
+
+
+class TestAutotune(unittest.TestCase):
+
+    def test_random_search(self):
+        launched = []
+        def launcher(proc_config):
+            launched.append(proc_config)
+            return contextlib.nullcontext('na+sm://fake')
+        def workload(address, provider_id):
+            # pretend that the pipeline TransferManager is faster,
+            # and all the more so with large buffers
+            config = launched[-1]['providers'][0]['config']
+            tm = config['transfer_manager']
+            throughput = 100.0
+            if tm['type'] == 'pipeline':
+                throughput += tm['config']['first_buffer_size'] / 1024
+            return {'throughput_mib_s': throughput, 'p99_us': 10.0}
+        tuner = Autotuner(workload, launcher=launcher, seed=1234)
+        best = tuner.search(32, 'random')
+        self.assertEqual(len(tuner.trials), 32)
+        self.assertIsNotNone(best)
+        self.assertEqual(best.cost, min(t.cost for t in tuner.trials))
+        # the pipeline's parameters are sampled, not constants
+        pipelines = [t.provider_config['transfer_manager']['config']
+                     for t in tuner.trials
+                     if t.provider_config['transfer_manager']['type'] == 'pipeline']
+        self.assertGreater(len(pipelines), 1)
+        for key in ['num_pools', 'num_buffers_per_pool',
+                    'first_buffer_size', 'buffer_size_multiplier']:
+            self.assertGreater(len(set(p[key] for p in pipelines)), 1, key)
+        # and the fastest configuration wins
+        self.assertEqual(best.provider_config['transfer_manager']['type'], 'pipeline')
+        self.assertEqual(best.provider_config['transfer_manager']['config']['first_buffer_size'],
+                         max(p['first_buffer_size'] for p in pipelines))
+
+    def test_failed_trials(self):
+        def launcher(proc_config):
+            raise RuntimeError('bedrock failed to start')
+        tuner = Autotuner(lambda address, provider_id: {}, launcher=launcher,
+                          builder=WarabiSpaceBuilder(types=['memory']))
+        self.assertIsNone(tuner.search(2, 'random'))
+        self.assertTrue(all(t.error for t in tuner.trials))
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,96 @@
+# (C) 2024 The University of Chicago
+# See COPYRIGHT in top-level directory.
+
+
+import asyncio
+import unittest
+import numpy
+from mochi.bedrock.server import Server as BedrockServer
+from .client import Client, WarabiException
+
+
+class TestClient(unittest.TestCase):
+
+    def setUp(self):
+        config = {
+            "libraries": {
+                "warabi": "libwarabi-bedrock-module.so"
+            },
+            "providers": [
+                {
+                    "type": "warabi",
+                    "name": "my_warabi_provider",
+                    "provider_id": 42,
+                    "config": {
+                        "target": {
+                            "type": "memory",
+                            "config": {}
+                        }
+                    }
+                }
+            ]
+        }
+        self.server = BedrockServer(address="na+sm", config=config)
+        self.engine = self.server.margo.engine
+        self.client = Client(self.engine)
+        self.target = self.client.make_target_handle(
+            str(self.engine.address), provider_id=42)
+
+    def tearDown(self):
+        del self.target
+        del self.client
+        del self.engine
+        self.server.finalize()
+        del self.server
+
+    def test_write_read(self):
+        # 8 KiB, above the eager threshold so the array is exposed directly
+        data = numpy.arange(1024, dtype=numpy.float64)
+        region = self.target.create(data.nbytes)
+        self.assertEqual(len(region), 16)
+        self.target.write(region, 0, data, persist=True)
+        result = numpy.zeros(1024, dtype=numpy.float64)
+        self.target.read_into(region, 0, result)
+        self.assertTrue(numpy.array_equal(data, result))
+        self.assertEqual(self.target.read(region, 8, 8), data[1:2].tobytes())
+
+    def test_segments(self):
+        region = self.target.create_and_write(b"abcdefghij")
+        self.target.write(region, [(0, 2), (8, 2)], memoryview(b"ABIJ"))
+        buffer = bytearray(4)
+        self.target.read_into(region, [(0, 2), (8, 2)], buffer)
+        self.assertEqual(buffer, b"ABIJ")
+        with self.assertRaises(ValueError):
+            self.target.read_into(region, [(0, 8)], buffer)
+
+    def test_non_contiguous(self):
+        region = self.target.create(64)
+        data = numpy.zeros((8, 8), dtype=numpy.uint8)
+        with self.assertRaises((BufferError, ValueError)):
+            self.target.write(region, 0, data[:, 0])
+
+    def test_async(self):
+        data = numpy.full(4096, 42, dtype=numpy.int32)
+        region = self.target.create_async(data.nbytes).wait()
+        self.target.write_async(region, 0, data).wait()
+        result = numpy.zeros_like(data)
+        req = self.target.read_into_async(region, 0, result)
+        req.wait()
+        self.assertTrue(req.completed())
+        self.assertTrue(numpy.array_equal(data, result))
+
+    def test_asyncio(self):
+        async def run():
+            region = await self.target.create_and_write_async(b"hello world")
+            result = bytearray(5)
+            await self.target.read_into_async(region, 6, result)
+            return result
+        self.assertEqual(asyncio.run(run()), b"world")
+
+    def test_invalid_region(self):
+        with self.assertRaises(WarabiException):
+            self.target.read(bytes(16), 0, 8)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,326 @@
+/*
+ * (C) 2024 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+#include <warabi/Client.hpp>
+#include <warabi/TargetHandle.hpp>
+#include <warabi/AsyncRequest.hpp>
+#include <warabi/Exception.hpp>
+
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace py = pybind11;
+using namespace pybind11::literals;
+using namespace warabi;
+
+using Segments = std::vector<std::pair<size_t, size_t>>;
+
+/**
+ * @brief Contiguous memory of an object implementing the buffer protocol
+ * (bytes, bytearray, memoryview, NumPy arrays...), exported for as long
+ * as this object lives. The memory is passed as-is to the TargetHandle,
+ * which exposes it for RDMA (or sends it with the RPC if it is small),
+ * so that no copy is made on the Python side.
+ *
+ * Must be created and destroyed with the GIL held.
+ */
+class Buffer {
+
+    Py_buffer m_view;
+
+    public:
+
+    Buffer(const py::object& obj, bool writable) {
+        int flags = PyBUF_C_CONTIGUOUS | (writable ? PyBUF_WRITABLE : 0);
+        if(PyObject_GetBuffer(obj.ptr(), &m_view, flags) != 0)
+            throw py::error_already_set();
+    }
+
+    Buffer(const Buffer&) = delete;
+    Buffer& operator=(const Buffer&) = delete;
+
+    ~Buffer() {
+        PyBuffer_Release(&m_view);
+    }
+
+    char* data() const {
+        return static_cast<char*>(m_view.buf);
+    }
+
+    size_t size() const {
+        return m_view.len;
+    }
+};
+
+/**
+ * @brief AsyncRequest returned to Python. It keeps the buffer of the
+ * operation exported (and the output region of create operations)
+ * until the operation completes.
+ */
+struct PyAsyncRequest {
+
+    AsyncRequest              request;
+    std::shared_ptr<Buffer>   buffer;
+    std::shared_ptr<RegionID> region;
+
+    PyAsyncRequest(std::shared_ptr<Buffer> b = nullptr,
+                   std::shared_ptr<RegionID> r = nullptr)
+    : buffer(std::move(b))
+    , region(std::move(r)) {}
+
+    py::object wait() {
+        {
+            py::gil_scoped_release release;
+            request.wait();
+        }
+        if(region) return py::bytes(reinterpret_cast<const char*>(region->data()), region->size());
+        return py::none();
+    }
+
+    bool completed() const {
+        return request.completed();
+    }
+
+    ~PyAsyncRequest() {
+        if(!request) return;
+        // an AsyncRequest is waited on when destroyed, which must not
+        // hold the GIL; errors can only be reported by wait() itself
+        py::gil_scoped_release release;
+        try { request.wait(); } catch(...) {}
+    }
+};
+
+static RegionID toRegionID(const py::bytes& region) {
+    RegionID id;
+    std::string str = region;
+    if(str.size() != id.size())
+        throw py::value_error("Invalid region ID (expected 16 bytes)");
+    std::memcpy(id.data(), str.data(), id.size());
+    return id;
+}
+
+static py::bytes fromRegionID(const RegionID& id) {
+    return py::bytes(reinterpret_cast<const char*>(id.data()), id.size());
+}
+
+static size_t totalSize(const Segments& segments) {
+    size_t size = 0;
+    for(auto& segment : segments) size += segment.second;
+    return size;
+}
+
+static void checkSize(const Buffer& buffer, size_t size) {
+    if(buffer.size() < size)
+        throw py::value_error("Buffer too small for the requested segments");
+}
+
+/* Operations shared by the synchronous (req == nullptr) and
+ * asynchronous bindings. They are called with the GIL held
+ * and release it while the TargetHandle is used. */
+
+static void create(const TargetHandle& th, RegionID* region, size_t size, AsyncRequest* req) {
+    py::gil_scoped_release release;
+    th.create(region, size, req);
+}
+
+static void write(const TargetHandle& th, const py::bytes& region, size_t offset,
+                  const Buffer& data, bool persist, AsyncRequest* req) {
+    auto id = toRegionID(region);
+    py::gil_scoped_release release;
+    th.write(id, offset, data.data(), data.size(), persist, req);
+}
+
+static void writeSegments(const TargetHandle& th, const py::bytes& region,
+                          const Segments& segments,
+                          const Buffer& data, bool persist, AsyncRequest* req) {
+    auto id = toRegionID(region);
+    checkSize(data, totalSize(segments));
+    py::gil_scoped_release release;
+    th.write(id, segments, data.data(), persist, req);
+}
+
+static void createAndWrite(const TargetHandle& th, RegionID* region,
+                           const Buffer& data, bool persist, AsyncRequest* req) {
+    py::gil_scoped_release release;
+    th.createAndWrite(region, data.data(), data.size(), persist, req);
+}
+
+static void persist(const TargetHandle& th, const py::bytes& region,
+                    const Segments& segments, AsyncRequest* req) {
+    auto id = toRegionID(region);
+    py::gil_scoped_release release;
+    th.persist(id, segments, req);
+}
+
+static void readInto(const TargetHandle& th, const py::bytes& region, size_t offset,
+                     const Buffer& data, std::optional<size_t> size, AsyncRequest* req) {
+    auto id = toRegionID(region);
+    if(size) checkSize(data, *size);
+    py::gil_scoped_release release;
+    th.read(id, offset, data.data(), size.value_or(data.size()), req);
+}
+
+static void readSegmentsInto(const TargetHandle& th, const py::bytes& region,
+                             const Segments& segments,
+                             const Buffer& data, AsyncRequest* req) {
+    auto id = toRegionID(region);
+    checkSize(data, totalSize(segments));
+    py::gil_scoped_release release;
+    th.read(id, segments, data.data(), req);
+}
+
+static void erase(const TargetHandle& th, const py::bytes& region, AsyncRequest* req) {
+    auto id = toRegionID(region);
+    py::gil_scoped_release release;
+    th.erase(id, req);
+}
+
+PYBIND11_MODULE(pywarabi_client, m) {
+    m.doc() = "Python binding for the Warabi client library";
+
+    py::register_exception<Exception>(m, "Exception", PyExc_RuntimeError);
+
+    py::class_<PyAsyncRequest>(m, "AsyncRequest")
+        .def("wait", &PyAsyncRequest::wait,
+             "Wait for the operation to complete. Returns the created region "
+             "for create operations, None otherwise.")
+        .def("completed", &PyAsyncRequest::completed)
+        .def("__await__", [](py::object self) {
+            // wait() releases the GIL, so it can run in an executor thread
+            auto loop = py::module_::import("asyncio").attr("get_running_loop")();
+            return loop.attr("run_in_executor")(py::none(), self.attr("wait")).attr("__await__")();
+        });
+
+    py::class_<Client>(m, "Client")
+        .def(py::init([](const py::object& engine) {
+            // accept a pymargo Engine or the margo_instance_id capsule it holds
+            py::object mid = py::hasattr(engine, "get_internal_mid")
+                ? engine.attr("get_internal_mid")() : engine;
+            return Client{static_cast<margo_instance_id>(mid.cast<py::capsule>())};
+        }), "engine"_a, py::keep_alive<1, 2>())
+        .def_property_readonly("config", &Client::getConfig)
+        .def("make_target_handle", &Client::makeTargetHandle,
+             "address"_a, "provider_id"_a = 0, py::keep_alive<0, 1>())
+        .def("set_tracing_config", &Client::setTracingConfig, "config"_a)
+        .def("set_transfer_manager_config", &Client::setTransferManagerConfig,
+             "address"_a, "provider_id"_a, "config"_a,
+             py::call_guard<py::gil_scoped_release>());
+
+    py::class_<TargetHandle>(m, "TargetHandle")
+        .def("create", [](const TargetHandle& th, size_t size) {
+            RegionID region;
+            create(th, &region, size, nullptr);
+            return fromRegionID(region);
+        }, "size"_a)
+        .def("create_async", [](const TargetHandle& th, size_t size) {
+            auto req = std::make_unique<PyAsyncRequest>(nullptr, std::make_shared<RegionID>());
+            create(th, req->region.get(), size, &req->request);
+            return req;
+        }, "size"_a)
+        .def("write", [](const TargetHandle& th, const py::bytes& region, size_t offset,
+                         const py::object& data, bool persist) {
+            Buffer buffer{data, false};
+            write(th, region, offset, buffer, persist, nullptr);
+        }, "region"_a, "offset"_a, "data"_a, "persist"_a = false)
+        .def("write", [](const TargetHandle& th, const py::bytes& region, const Segments& segments,
+                         const py::object& data, bool persist) {
+            Buffer buffer{data, false};
+            writeSegments(th, region, segments, buffer, persist, nullptr);
+        }, "region"_a, "segments"_a, "data"_a, "persist"_a = false)
+        .def("write_async", [](const TargetHandle& th, const py::bytes& region, size_t offset,
+                               const py::object& data, bool persist) {
+            auto req = std::make_unique<PyAsyncRequest>(std::make_shared<Buffer>(data, false));
+            write(th, region, offset, *req->buffer, persist, &req->request);
+            return req;
+        }, "region"_a, "offset"_a, "data"_a, "persist"_a = false)
+        .def("write_async", [](const TargetHandle& th, const py::bytes& region, const Segments& segments,
+                               const py::object& data, bool persist) {
+            auto req = std::make_unique<PyAsyncRequest>(std::make_shared<Buffer>(data, false));
+            writeSegments(th, region, segments, *req->buffer, persist, &req->request);
+            return req;
+        }, "region"_a, "segments"_a, "data"_a, "persist"_a = false)
+        .def("create_and_write", [](const TargetHandle& th, const py::object& data, bool persist) {
+            Buffer buffer{data, false};
+            RegionID region;
+            createAndWrite(th, &region, buffer, persist, nullptr);
+            return fromRegionID(region);
+        }, "data"_a, "persist"_a = false)
+        .def("create_and_write_async", [](const TargetHandle& th, const py::object& data, bool persist) {
+            auto req = std::make_unique<PyAsyncRequest>(
+                std::make_shared<Buffer>(data, false), std::make_shared<RegionID>());
+            createAndWrite(th, req->region.get(), *req->buffer, persist, &req->request);
+            return req;
+        }, "data"_a, "persist"_a = false)
+        .def("persist", [](const TargetHandle& th, const py::bytes& region, size_t offset, size_t size) {
+            persist(th, region, {{offset, size}}, nullptr);
+        }, "region"_a, "offset"_a, "size"_a)
+        .def("persist", [](const TargetHandle& th, const py::bytes& region, const Segments& segments) {
+            persist(th, region, segments, nullptr);
+        }, "region"_a, "segments"_a)
+        .def("persist_async", [](const TargetHandle& th, const py::bytes& region, size_t offset, size_t size) {
+            auto req = std::make_unique<PyAsyncRequest>();
+            persist(th, region, {{offset, size}}, &req->request);
+            return req;
+        }, "region"_a, "offset"_a, "size"_a)
+        .def("persist_async", [](const TargetHandle& th, const py::bytes& region, const Segments& segments) {
+            auto req = std::make_unique<PyAsyncRequest>();
+            persist(th, region, segments, &req->request);
+            return req;
+        }, "region"_a, "segments"_a)
+        .def("read", [](const TargetHandle& th, const py::bytes& region, size_t offset, size_t size) {
+            // read directly into the memory of a new bytes object
+            py::object result = py::reinterpret_steal<py::object>(
+                PyBytes_FromStringAndSize(nullptr, size));
+            if(!result) throw py::error_already_set();
+            auto id = toRegionID(region);
+            char* data = PyBytes_AS_STRING(result.ptr());
+            {
+                py::gil_scoped_release release;
+                th.read(id, offset, data, size);
+            }
+            return result;
+        }, "region"_a, "offset"_a, "size"_a)
+        .def("read_into", [](const TargetHandle& th, const py::bytes& region, size_t offset,
+                             const py::object& data, std::optional<size_t> size) {
+            Buffer buffer{data, true};
+            readInto(th, region, offset, buffer, size, nullptr);
+        }, "region"_a, "offset"_a, "data"_a, "size"_a = py::none(),
+           "Read into a preallocated writable buffer (e.g. a NumPy array), "
+           "filling it entirely unless size is provided.")
+        .def("read_into", [](const TargetHandle& th, const py::bytes& region, const Segments& segments,
+                             const py::object& data) {
+            Buffer buffer{data, true};
+            readSegmentsInto(th, region, segments, buffer, nullptr);
+        }, "region"_a, "segments"_a, "data"_a)
+        .def("read_into_async", [](const TargetHandle& th, const py::bytes& region, size_t offset,
+                                   const py::object& data, std::optional<size_t> size) {
+            auto req = std::make_unique<PyAsyncRequest>(std::make_shared<Buffer>(data, true));
+            readInto(th, region, offset, *req->buffer, size, &req->request);
+            return req;
+        }, "region"_a, "offset"_a, "data"_a, "size"_a = py::none())
+        .def("read_into_async", [](const TargetHandle& th, const py::bytes& region, const Segments& segments,
+                                   const py::object& data) {
+            auto req = std::make_unique<PyAsyncRequest>(std::make_shared<Buffer>(data, true));
+            readSegmentsInto(th, region, segments, *req->buffer, &req->request);
+            return req;
+        }, "region"_a, "segments"_a, "data"_a)
+        .def("erase", [](const TargetHandle& th, const py::bytes& region) {
+            erase(th, region, nullptr);
+        }, "region"_a)
+        .def("erase_async", [](const TargetHandle& th, const py::bytes& region) {
+            auto req = std::make_unique<PyAsyncRequest>();
+            erase(th, region, &req->request);
+            return req;
+        }, "region"_a)
+        .def("set_eager_write_threshold", &TargetHandle::setEagerWriteThreshold, "size"_a)
+        .def("set_eager_read_threshold", &TargetHandle::setEagerReadThreshold, "size"_a)
+        .def("set_read_cache_capacity", &TargetHandle::setReadCacheCapacity, "capacity"_a)
+        .def("set_retry_policy", &TargetHandle::setRetryPolicy,
+             "max_retries"_a, "max_backoff_ms"_a);
+}
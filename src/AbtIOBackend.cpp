@@ -11,13 +11,25 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
 #include "AbtIOBackend.hpp"
+#include <warabi/TransferManager.hpp>
 #include "Defer.hpp"
+#include "Numa.hpp"
+#include "Tracer.hpp"
 #include <nlohmann/json.hpp>
 #include <nlohmann/json-schema.hpp>
 #include <fmt/format.h>
+#include <spdlog/spdlog.h>
+#include <deque>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <mutex>
+#include <numeric>
+#include <unordered_map>
 
 namespace warabi {
 
@@ -41,23 +53,93 @@ static inline auto RegionIDtoOffsetSize(const RegionID& rid) {
     return p;
 }
 
-struct AbtIORegion : public WritableRegion, public ReadableRegion {
+#define WARABI_ALIGN_UP(x, _alignment) \
+    ((((size_t)(x)) + ((_alignment) - 1)) / (_alignment) * (_alignment))
+
+#define WARABI_ALIGN_DOWN(x, _alignment) \
+    (((size_t)(x)) / (_alignment) * (_alignment))
+
+/**
+ * @brief Memory allocated with posix_memalign and freed automatically.
+ */
+struct AlignedBuffer : public std::unique_ptr<char, decltype(&free)> {
+
+    using std::unique_ptr<char, decltype(&free)>::unique_ptr;
+
+    static AlignedBuffer allocate(size_t alignment, size_t size) {
+        void* ptr = nullptr;
+        if(posix_memalign(&ptr, alignment, size) != 0)
+            ptr = nullptr;
+        return AlignedBuffer{static_cast<char*>(ptr), &free};
+    }
+};
+
+// Staging buffers are bound to the target's NUMA node only from this size
+// on: smaller ones are short-lived and not worth an extra system call.
+static constexpr size_t WARABI_ABTIO_NUMA_BIND_MIN_SIZE = 1024*1024;
+
+// Size of the buffer segments are read ahead into.
+static constexpr size_t WARABI_ABTIO_READAHEAD_CHUNK_SIZE = 4*1024*1024;
+
+/**
+ * @brief Allocate a staging buffer for the target,
+ * on its NUMA node if it has one.
+ */
+static AlignedBuffer allocateBuffer(const AbtIOTarget* target, size_t alignment, size_t size) {
+    if(target->m_numa_node < 0 || size < WARABI_ABTIO_NUMA_BIND_MIN_SIZE)
+        return AlignedBuffer::allocate(alignment, size);
+    auto buffer = AlignedBuffer::allocate(std::max(alignment, numa::pageSize()), size);
+    if(buffer) numa::bind(buffer.get(), size, target->m_numa_node);
+    return buffer;
+}
+
+static bool findDevice(const std::string& path, dev_t& dev);
+
+/**
+ * @brief Find the alignment required by O_DIRECT for the given file:
+ * the one reported by statx if the kernel supports STATX_DIOALIGN,
+ * otherwise the logical block size of its device, otherwise its
+ * preferred I/O block size.
+ */
+static size_t directIOAlignment(int fd, const std::string& path) {
+#ifdef STATX_DIOALIGN
+    struct statx stx;
+    if(statx(fd, "", AT_EMPTY_PATH, STATX_DIOALIGN, &stx) == 0
+    && (stx.stx_mask & STATX_DIOALIGN) && stx.stx_dio_offset_align != 0)
+        return std::max(stx.stx_dio_offset_align, stx.stx_dio_mem_align);
+#endif
+    dev_t dev;
+    if(findDevice(path, dev)) {
+        auto sysfs = fmt::format("/sys/dev/block/{}:{}", major(dev), minor(dev));
+        for(auto& candidate : {sysfs + "/queue/logical_block_size",
+                               sysfs + "/../queue/logical_block_size"}) {
+            std::ifstream f{candidate};
+            size_t block_size = 0;
+            if(f >> block_size && block_size) return block_size;
+        }
+    }
+    struct stat statbuf;
+    if(fstat(fd, &statbuf) == 0 && statbuf.st_blksize > 0)
+        return statbuf.st_blksize;
+    return 4096;
+}
+
+struct AbtIORegion final : public WritableRegion, public ReadableRegion {
 
     AbtIORegion(
             AbtIOTarget* owner,
             RegionID id,
-            size_t regionOffset)
+            size_t regionOffset,
+            MigrationGuard::Token token)
     : m_owner(owner)
     , m_id(std::move(id))
-    , m_region_offset(regionOffset) {}
+    , m_region_offset(regionOffset)
+    , m_token(std::move(token)) {}
 
-    AbtIOTarget*     m_owner;
-    RegionID         m_id;
-    size_t           m_region_offset;
-
-    ~AbtIORegion() {
-        m_owner->m_migration_lock.unlock();
-    }
+    AbtIOTarget*          m_owner;
+    RegionID              m_id;
+    size_t                m_region_offset;
+    MigrationGuard::Token m_token;
 
     Result<RegionID> getRegionID() override {
         Result<RegionID> result;
@@ -73,87 +155,40 @@ struct AbtIORegion : public WritableRegion, public ReadableRegion {
             bool persist) override {
         (void)persist;
         Result<bool> result;
-        void* data = nullptr;
         size_t size = std::accumulate(
             regionOffsetSizes.begin(), regionOffsetSizes.end(), (size_t)0,
             [](size_t acc, const std::pair<size_t, size_t>& p) { return acc + p.second; });
-        int ret = posix_memalign((void**)(&data), m_owner->m_alignment, size);
+        auto data = allocateBuffer(m_owner, m_owner->m_alignment, size);
         // LCOV_EXCL_START
-        if(ret != 0) {
-            result.error() = fmt::format("posix_memalign failed in write: {}", strerror(ret));
+        if(!data) {
+            result.error() = fmt::format("posix_memalign failed in write: {}", strerror(ENOMEM));
             result.success() = false;
             return result;
         }
         // LCOV_EXCL_STOP
-        auto localBulk = m_owner->m_engine.expose({{data, size}}, thallium::bulk_mode::write_only);
+        auto localBulk = m_owner->m_engine.expose({{data.get(), size}}, thallium::bulk_mode::write_only);
         localBulk << remoteBulk.on(address)(remoteBulkOffset, size);
-        result = write(regionOffsetSizes, data, persist);
-        free(data);
-        return result;
+        return write(regionOffsetSizes, data.get(), persist);
     }
 
     Result<bool> write(
             const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
             const void* data, bool persist) override {
-        (void)persist;
-        Result<bool> result;
-        std::vector<abt_io_op*> ops(regionOffsetSizes.size());
-        std::vector<ssize_t> rets(regionOffsetSizes.size());
-
-        const char* ptr = static_cast<const char*>(data);
-        size_t offset = 0;
-        int i = 0;
-        for(const auto& seg : regionOffsetSizes) {
-            abt_io_op* op = abt_io_pwrite_nb(
-                m_owner->m_abtio,
-                m_owner->m_fd,
-                ptr + offset,
-                seg.second,
-                m_region_offset + seg.first,
-                rets.data() + i);
-            ops[i] = op;
-            offset += seg.second;
-            i += 1;
-        }
-        int ret = 0;
-        for(auto& op : ops) {
-            ret = abt_io_op_wait(op);
-            abt_io_op_free(op);
-            if(ret != 0) {
-                result.success() = false;
-                result.error() = "Write failed (abt_io_op_wait returned -1)";
-            }
-        }
+        auto result = submit(regionOffsetSizes, const_cast<void*>(data), true);
         if(!result.success())
             return result;
-        for(auto& r : rets) {
-            if(r < 0) {
-                result.success() = false;
-                result.error() = fmt::format("Read failed: {}", strerror(-r));
-            }
-        }
-        if(!result.success())
-            return result;
-        if(persist) {
-            ret = abt_io_fdatasync(m_owner->m_abtio, m_owner->m_fd);
-            if(ret != 0) {
-                result.success() = false;
-                result.error() = "Persist failed (abt_io_fdatasync returned -1)";
-            }
-        }
+        if(persist)
+            return m_owner->flush();
+        m_owner->markDirty(std::accumulate(
+            regionOffsetSizes.begin(), regionOffsetSizes.end(), (size_t)0,
+            [](size_t acc, const std::pair<size_t, size_t>& p) { return acc + p.second; }));
         return result;
     }
 
     Result<bool> persist(
             const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes) override {
         (void)regionOffsetSizes;
-        Result<bool> result;
-        int ret = abt_io_fdatasync(m_owner->m_abtio, m_owner->m_fd);
-        if(ret != 0) {
-            result.success() = false;
-            result.error() = "Persist failed (abt_io_fdatasync returned -1)";
-        }
-        return result;
+        return m_owner->flush();
     }
 
     Result<bool> read(
@@ -162,64 +197,219 @@ struct AbtIORegion : public WritableRegion, public ReadableRegion {
             const thallium::endpoint& address,
             size_t remoteBulkOffset) override {
         Result<bool> result;
-        void* data = nullptr;
         size_t size = std::accumulate(
             regionOffsetSizes.begin(), regionOffsetSizes.end(), (size_t)0,
             [](size_t acc, const std::pair<size_t, size_t>& p) { return acc + p.second; });
-        int ret = posix_memalign((void**)(&data), m_owner->m_alignment, size);
-        if(ret != 0) {
-            result.error() = fmt::format("posix_memalign failed in write: {}", strerror(ret));
+        auto data = allocateBuffer(m_owner, m_owner->m_alignment, size);
+        if(!data) {
+            result.error() = fmt::format("posix_memalign failed in read: {}", strerror(ENOMEM));
             result.success() = false;
             return result;
         }
-        result = read(regionOffsetSizes, data);
-        if(!result.success()) {
-            free(data);
+        result = read(regionOffsetSizes, data.get());
+        if(!result.success())
             return result;
-        }
-        auto localBulk = m_owner->m_engine.expose({{data, size}}, thallium::bulk_mode::read_only);
+        auto localBulk = m_owner->m_engine.expose({{data.get(), size}}, thallium::bulk_mode::read_only);
         localBulk >> remoteBulk.on(address)(remoteBulkOffset, size);
-        free(data);
         return result;
      }
 
     Result<bool> read(
             const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
             void* data) override {
-        Result<bool> result;
-        std::vector<abt_io_op*> ops(regionOffsetSizes.size());
-        std::vector<ssize_t> rets(regionOffsetSizes.size());
+        return submit(regionOffsetSizes, data, false);
+    }
+
+    struct IOSegment {
+        size_t fileOffset;
+        size_t size;
+        char*  ptr;
+    };
 
+    Result<bool> submit(
+            const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+            void* data, bool isWrite) {
+        if(m_owner->m_directio)
+            return submitDirect(regionOffsetSizes, static_cast<char*>(data), isWrite);
+        std::vector<IOSegment> segments;
+        segments.reserve(regionOffsetSizes.size());
         char* ptr = static_cast<char*>(data);
-        size_t offset = 0;
-        int i = 0;
         for(const auto& seg : regionOffsetSizes) {
-            abt_io_op* op = abt_io_pread_nb(
-                m_owner->m_abtio,
-                m_owner->m_fd,
-                ptr + offset,
-                seg.second,
-                m_region_offset + seg.first,
-                rets.data() + i);
-            ops[i] = op;
-            offset += seg.second;
-            i += 1;
+            segments.push_back({m_region_offset + seg.first, seg.second, ptr});
+            ptr += seg.second;
+        }
+        return submitSegments(segments, isWrite);
+    }
+
+    /**
+     * @brief O_DIRECT requires file offsets, sizes, and memory addresses
+     * to be aligned. The aligned middle of each segment is issued directly
+     * (through a bounce buffer if its memory isn't aligned), while its
+     * unaligned head and tail blocks go through read-modify-write.
+     */
+    Result<bool> submitDirect(
+            const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+            char* data, bool isWrite) {
+        const size_t alignment = m_owner->m_alignment;
+        Result<bool> result;
+
+        struct PartialBlock {
+            size_t blockOffset;
+            size_t offsetInBlock;
+            size_t size;
+            char*  ptr;
+        };
+        std::vector<IOSegment>    direct;
+        std::vector<IOSegment>    bounced; // bounced[i].ptr is the user's memory
+        std::vector<PartialBlock> partials;
+        std::vector<AlignedBuffer> buffers;
+
+        char* ptr = data;
+        for(const auto& seg : regionOffsetSizes) {
+            size_t begin = m_region_offset + seg.first;
+            size_t end   = begin + seg.second;
+            size_t alignedBegin = WARABI_ALIGN_UP(begin, alignment);
+            size_t alignedEnd   = WARABI_ALIGN_DOWN(end, alignment);
+            if(alignedBegin >= alignedEnd) {
+                // no full block in this segment
+                for(size_t pos = begin; pos < end;) {
+                    size_t block = WARABI_ALIGN_DOWN(pos, alignment);
+                    size_t len   = std::min(end, block + alignment) - pos;
+                    partials.push_back({block, pos - block, len, ptr + (pos - begin)});
+                    pos += len;
+                }
+                ptr += seg.second;
+                continue;
+            }
+            if(begin != alignedBegin) {
+                size_t block = alignedBegin - alignment;
+                partials.push_back({block, begin - block, alignedBegin - begin, ptr});
+            }
+            char*  middle     = ptr + (alignedBegin - begin);
+            size_t middleSize = alignedEnd - alignedBegin;
+            if(reinterpret_cast<uintptr_t>(middle) % alignment == 0) {
+                direct.push_back({alignedBegin, middleSize, middle});
+            } else {
+                buffers.push_back(allocateBuffer(m_owner, alignment, middleSize));
+                if(!buffers.back()) {
+                    result.success() = false;
+                    result.error() = "Could not allocate aligned bounce buffer";
+                    return result;
+                }
+                if(isWrite) std::memcpy(buffers.back().get(), middle, middleSize);
+                else bounced.push_back({alignedBegin, middleSize, middle});
+                direct.push_back({alignedBegin, middleSize, buffers.back().get()});
+            }
+            if(end != alignedEnd)
+                partials.push_back({alignedEnd, 0, end - alignedEnd, ptr + (alignedEnd - begin)});
+            ptr += seg.second;
+        }
+
+        result = submitSegments(direct, isWrite);
+        if(!result.success())
+            return result;
+
+        if(!isWrite) {
+            // when reading, every buffer corresponds to a bounced segment
+            for(size_t i = 0; i < bounced.size(); ++i)
+                std::memcpy(bounced[i].ptr, buffers[i].get(), bounced[i].size);
+        }
+
+        if(partials.empty())
+            return result;
+        auto block = AlignedBuffer::allocate(alignment, alignment);
+        if(!block) {
+            result.success() = false;
+            result.error() = "Could not allocate aligned bounce buffer";
+            return result;
+        }
+        Tracer::Span span{"target", "abt_io_unaligned"};
+        for(auto& partial : partials) {
+            // blocks never span two regions, so this lock only protects against
+            // concurrent read-modify-writes of the same block of the same region
+            auto& lock = m_owner->m_rmw_locks[(partial.blockOffset / alignment) % m_owner->m_rmw_locks.size()];
+            std::unique_lock<thallium::mutex> guard{lock};
+            ssize_t s = abt_io_pread(m_owner->m_abtio, m_owner->m_fd,
+                                     block.get(), alignment, partial.blockOffset);
+            if(s < 0) {
+                result.success() = false;
+                result.error() = fmt::format("Read failed: {}", strerror(-s));
+                return result;
+            }
+            if((size_t)s < alignment)
+                std::memset(block.get() + s, 0, alignment - s);
+            if(!isWrite) {
+                std::memcpy(partial.ptr, block.get() + partial.offsetInBlock, partial.size);
+                continue;
+            }
+            std::memcpy(block.get() + partial.offsetInBlock, partial.ptr, partial.size);
+            s = abt_io_pwrite(m_owner->m_abtio, m_owner->m_fd,
+                              block.get(), alignment, partial.blockOffset);
+            if(s != (ssize_t)alignment) {
+                result.success() = false;
+                result.error() = fmt::format("Write failed: {}",
+                    s < 0 ? strerror(-s) : "short write");
+                return result;
+            }
         }
-        int ret = 0;
-        for(auto& op : ops) {
-            ret = abt_io_op_wait(op);
+        return result;
+    }
+
+    /**
+     * @brief Issue one abt-io operation per segment and wait for them,
+     * never having more operations in flight than the target allows.
+     * When no slot is available, we first complete our own oldest
+     * operation, and only block if we have none pending, so that
+     * requests holding slots cannot wait on each other.
+     */
+    Result<bool> submitSegments(const std::vector<IOSegment>& segments, bool isWrite) {
+        Result<bool> result;
+        Tracer::Span span{"target", isWrite ? "abt_io_pwrite" : "abt_io_pread"};
+        std::vector<ssize_t> rets(segments.size());
+        std::deque<abt_io_op*> pending;
+
+        auto waitOldest = [&]() {
+            auto op = pending.front();
+            pending.pop_front();
+            int ret = abt_io_op_wait(op);
             abt_io_op_free(op);
+            m_owner->releaseSlot();
             if(ret != 0) {
                 result.success() = false;
-                result.error() = "Read failed (abt_io_op_wait returned -1)";
+                result.error() = fmt::format(
+                    "{} failed (abt_io_op_wait returned {})", isWrite ? "Write" : "Read", ret);
             }
+        };
+
+        int i = 0;
+        for(const auto& seg : segments) {
+            while(!m_owner->tryAcquireSlot()) {
+                if(pending.empty()) {
+                    m_owner->acquireSlot();
+                    break;
+                }
+                waitOldest();
+            }
+            abt_io_op* op = isWrite ?
+                abt_io_pwrite_nb(
+                    m_owner->m_abtio, m_owner->m_fd,
+                    seg.ptr, seg.size, seg.fileOffset,
+                    rets.data() + i)
+                : abt_io_pread_nb(
+                    m_owner->m_abtio, m_owner->m_fd,
+                    seg.ptr, seg.size, seg.fileOffset,
+                    rets.data() + i);
+            pending.push_back(op);
+            i += 1;
         }
+        while(!pending.empty()) waitOldest();
         if(!result.success())
             return result;
         for(auto& r : rets) {
             if(r < 0) {
                 result.success() = false;
-                result.error() = fmt::format("Read failed: {}", strerror(-r));
+                result.error() = fmt::format(
+                    "{} failed: {}", isWrite ? "Write" : "Read", strerror(-r));
             }
         }
         return result;
@@ -227,92 +417,307 @@ struct AbtIORegion : public WritableRegion, public ReadableRegion {
 };
 
 AbtIOTarget::AbtIOTarget(thallium::engine engine, const json& config,
-                         abt_io_instance_id abtio, int fd, size_t file_size)
+                         std::shared_ptr<AbtIOInstance> abtio, int fd, size_t file_size)
 : m_engine(std::move(engine))
 , m_config(config)
-, m_abtio(abtio)
+, m_abtio_instance(std::move(abtio))
+, m_abtio(m_abtio_instance->id())
 , m_fd(fd)
 , m_file_size(file_size)
 , m_filename(config["path"].get_ref<const std::string&>())
 , m_alignment(config.value("alignment", 8))
-{}
+, m_directio(config.value("directio", false))
+, m_numa_node(numaNodeFromConfig(config))
+, m_max_inflight_ops(config.value("max_inflight_ops", (size_t)0))
+, m_durability(durabilityFromConfig(config))
+, m_sync_interval_ms(config.value("sync_interval_ms", (size_t)1000))
+, m_sync_bytes(config.value("sync_bytes", (size_t)0))
+{
+    m_file_size = WARABI_ALIGN_UP(m_file_size.load(), m_alignment);
+    struct stat statbuf;
+    m_clone_alignment = fstat(m_fd, &statbuf) == 0 && statbuf.st_blksize > 0
+                      ? (size_t)statbuf.st_blksize : 4096;
+    // a multiple of both, so that m_file_size stays aligned to m_alignment
+    m_clone_alignment = std::lcm(m_clone_alignment, m_alignment);
+    if(m_config.contains("sync")) {
+        m_config.erase("sync");
+        if(!m_config.contains("durability"))
+            m_config["durability"] = durabilityName(m_durability);
+    }
+    if(m_durability == Durability::Periodic) {
+        m_flusher = m_engine.get_handler_pool().make_thread([this]() {
+            std::unique_lock<thallium::mutex> lock{m_flush_mutex};
+            while(!m_flush_stop) {
+                struct timespec deadline;
+                clock_gettime(CLOCK_REALTIME, &deadline);
+                deadline.tv_sec  += m_sync_interval_ms / 1000;
+                deadline.tv_nsec += (m_sync_interval_ms % 1000) * 1000000;
+                if(deadline.tv_nsec >= 1000000000) {
+                    deadline.tv_sec  += 1;
+                    deadline.tv_nsec -= 1000000000;
+                }
+                m_flush_cv.wait_until(lock, &deadline);
+                if(m_flush_stop || m_dirty_bytes.exchange(0) == 0)
+                    continue;
+                lock.unlock();
+                abt_io_fdatasync(m_abtio, m_fd);
+                lock.lock();
+            }
+        });
+    }
+}
 
 AbtIOTarget::~AbtIOTarget() {
+    stopFlusher();
     if(m_fd && m_abtio) abt_io_close(m_abtio, m_fd);
-    if(m_abtio) abt_io_finalize(m_abtio);
+}
+
+AbtIOTarget::Durability AbtIOTarget::durabilityFromConfig(const json& config) {
+    auto durability = config.value("durability", "");
+    if(durability == "none")     return Durability::None;
+    if(durability == "per_write") return Durability::PerWrite;
+    if(durability == "periodic") return Durability::Periodic;
+    if(durability.empty() && config.value("sync", false))
+        return Durability::PerWrite;
+    return Durability::OnPersist;
+}
+
+const char* AbtIOTarget::durabilityName(Durability durability) {
+    switch(durability) {
+    case Durability::None:      return "none";
+    case Durability::PerWrite:  return "per_write";
+    case Durability::Periodic:  return "periodic";
+    case Durability::OnPersist: return "on_persist";
+    }
+    return "on_persist";
+}
+
+Result<bool> AbtIOTarget::flush() {
+    Result<bool> result;
+    if(m_durability == Durability::None || m_durability == Durability::PerWrite)
+        return result;
+    m_dirty_bytes = 0;
+    Tracer::Span span{"target", "fdatasync"};
+    int ret = abt_io_fdatasync(m_abtio, m_fd);
+    if(ret != 0) {
+        result.success() = false;
+        result.error() = "Persist failed (abt_io_fdatasync returned -1)";
+    }
+    return result;
+}
+
+void AbtIOTarget::markDirty(size_t size) {
+    if(m_durability != Durability::Periodic) return;
+    auto dirty = m_dirty_bytes.fetch_add(size) + size;
+    if(m_sync_bytes && dirty >= m_sync_bytes && dirty - size < m_sync_bytes) {
+        std::unique_lock<thallium::mutex> lock{m_flush_mutex};
+        m_flush_cv.notify_one();
+    }
+}
+
+void AbtIOTarget::stopFlusher() {
+    if(!m_flusher) return;
+    {
+        std::unique_lock<thallium::mutex> lock{m_flush_mutex};
+        m_flush_stop = true;
+        m_flush_cv.notify_one();
+    }
+    (*m_flusher)->join();
+    m_flusher.reset();
+}
+
+bool AbtIOTarget::tryAcquireSlot() {
+    if(!m_max_inflight_ops) return true;
+    auto current = m_inflight_ops.load();
+    while(current < m_max_inflight_ops) {
+        if(m_inflight_ops.compare_exchange_weak(current, current + 1))
+            return true;
+    }
+    return false;
+}
+
+void AbtIOTarget::acquireSlot() {
+    if(!m_max_inflight_ops) return;
+    std::unique_lock<thallium::mutex> lock{m_inflight_mutex};
+    m_inflight_cv.wait(lock, [this]() { return tryAcquireSlot(); });
+}
+
+void AbtIOTarget::releaseSlot() {
+    if(!m_max_inflight_ops) return;
+    m_inflight_ops.fetch_sub(1);
+    std::unique_lock<thallium::mutex> lock{m_inflight_mutex};
+    m_inflight_cv.notify_one();
 }
 
 std::string AbtIOTarget::getConfig() const {
     return m_config.dump();
 }
 
+std::string AbtIOTarget::getStats() const {
+    auto stats = json::object();
+    stats["numa_node"] = m_numa_node;
+    dev_t dev;
+    stats["device_numa_node"] = findDevice(m_filename, dev) ? numa::nodeOfBlockDevice(dev) : -1;
+    stats["inflight_ops"] = m_inflight_ops.load();
+    stats["clones"] = m_clones.load();
+    // clones the filesystem could not share, and that were copied instead
+    stats["clone_copies"] = m_clone_copies.load();
+    stats["readahead_bytes"] = m_readahead_bytes.load();
+    // access hints ignored because the file is opened with O_DIRECT
+    stats["ignored_hints"] = m_ignored_hints.load();
+    return stats.dump();
+}
+
+int AbtIOTarget::numaNodeFromConfig(const json& config) {
+    if(!config.contains("numa_node"))
+        return -1;
+    auto& numa_node = config["numa_node"];
+    if(numa_node.is_number_integer())
+        return numa_node.get<int>();
+    dev_t dev;
+    if(!findDevice(config["path"].get_ref<const std::string&>(), dev))
+        return -1;
+    return numa::nodeOfBlockDevice(dev);
+}
+
 Result<bool> AbtIOTarget::destroy() {
     Result<bool> result;
+    stopFlusher();
     abt_io_close(m_abtio, m_fd);
     m_fd = 0;
     std::filesystem::remove(m_filename.c_str());
-    abt_io_finalize(m_abtio);
+    std::error_code ec;
+    auto target_path = std::filesystem::path{m_filename};
+    auto snapshot_prefix = target_path.filename().string() + ".snapshot.";
+    auto dir = target_path.has_parent_path() ? target_path.parent_path() : ".";
+    for(auto& entry : std::filesystem::directory_iterator{dir, ec}) {
+        if(entry.path().filename().string().rfind(snapshot_prefix, 0) == 0)
+            std::filesystem::remove(entry.path(), ec);
+    }
+    m_abtio_instance.reset();
     m_abtio = nullptr;
     return result;
 }
 
-#define WARABI_ALIGN_UP(x, _alignment) \
-    ((((unsigned long)(x)) + (_alignment - 1)) & (~(_alignment - 1)))
-
 Result<std::unique_ptr<WritableRegion>> AbtIOTarget::create(size_t size) {
     Result<std::unique_ptr<WritableRegion>> result;
     size_t alignedSize = WARABI_ALIGN_UP(size, m_alignment);
     size_t offset = m_file_size.fetch_add(alignedSize);
     auto regionID = OffsetSizeToRegionID(offset, alignedSize);
 
-    void* zero_block = nullptr;
-    int ret = posix_memalign((void**)(&zero_block), m_alignment, size);
-    if(ret != 0) {
-        result.error() = fmt::format("posix_memalign failed in create: {}", strerror(ret));
+    auto zero_block = AlignedBuffer::allocate(m_alignment, alignedSize);
+    if(!zero_block) {
+        result.error() = fmt::format("posix_memalign failed in create: {}", strerror(ENOMEM));
         result.success() = false;
         return result;
     }
-    m_migration_lock.rdlock();
-    ssize_t s = abt_io_pwrite(m_abtio, m_fd, zero_block, alignedSize, offset);
+    std::memset(zero_block.get(), 0, alignedSize);
+    auto token = m_migration_guard.enter();
+    ssize_t s = abt_io_pwrite(m_abtio, m_fd, zero_block.get(), alignedSize, offset);
     if(s != (ssize_t)alignedSize) {
         result.error() = fmt::format("abt_io_pwrite failed in create: {}", strerror(-s));
         result.success() = false;
-        m_migration_lock.unlock();
         return result;
     }
-    result.value() = std::make_unique<AbtIORegion>(this, regionID, offset);
+    result.value() = std::make_unique<AbtIORegion>(this, regionID, offset, std::move(token));
     return result;
 }
 
 Result<std::unique_ptr<WritableRegion>> AbtIOTarget::write(const RegionID& region_id, bool persist) {
     (void)persist;
     Result<std::unique_ptr<WritableRegion>> result;
-    m_migration_lock.rdlock();
+    auto token = m_migration_guard.enter();
     if(!m_fd) {
         result.success() = false;
         result.error() = fmt::format("File {} has been destroyed", m_filename);
-        m_migration_lock.unlock();
         return result;
     }
     auto regionOffsetSize = RegionIDtoOffsetSize(region_id);
     result.value() = std::make_unique<AbtIORegion>(
-        this, region_id, regionOffsetSize.first);
+        this, region_id, regionOffsetSize.first, std::move(token));
     return result;
 }
 
 Result<std::unique_ptr<ReadableRegion>> AbtIOTarget::read(const RegionID& region_id) {
     Result<std::unique_ptr<ReadableRegion>> result;
     auto regionOffsetSize = RegionIDtoOffsetSize(region_id);
-    m_migration_lock.rdlock();
+    auto token = m_migration_guard.enter();
     result.value() = std::make_unique<AbtIORegion>(
-        this, region_id, regionOffsetSize.first);
+        this, region_id, regionOffsetSize.first, std::move(token));
     return result;
 }
 
+template<typename Function>
+Result<bool> AbtIOTarget::accessRegion(const RegionID& region_id, Function&& function) {
+    Result<bool> result;
+    auto token = m_migration_guard.enter();
+    if(!m_fd) {
+        result.success() = false;
+        result.error() = fmt::format("File {} has been destroyed", m_filename);
+        return result;
+    }
+    auto regionOffsetSize = RegionIDtoOffsetSize(region_id);
+    AbtIORegion region{this, region_id, regionOffsetSize.first, std::move(token)};
+    return function(region);
+}
+
+Result<bool> AbtIOTarget::writeSegments(
+        const RegionID& region_id,
+        const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+        const void* data, bool persist) {
+    return accessRegion(region_id, [&](AbtIORegion& region) {
+        return region.write(regionOffsetSizes, data, persist);
+    });
+}
+
+Result<bool> AbtIOTarget::pullSegments(
+        const RegionID& region_id,
+        const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+        TransferManager& transferManager,
+        thallium::bulk data,
+        const thallium::endpoint& address,
+        size_t bulkOffset,
+        bool persist) {
+    return accessRegion(region_id, [&](AbtIORegion& region) {
+        return transferManager.pull(
+            region, regionOffsetSizes, data, address, bulkOffset, persist);
+    });
+}
+
+Result<bool> AbtIOTarget::persistSegments(
+        const RegionID& region_id,
+        const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes) {
+    return accessRegion(region_id, [&](AbtIORegion& region) {
+        return region.persist(regionOffsetSizes);
+    });
+}
+
+Result<bool> AbtIOTarget::readSegments(
+        const RegionID& region_id,
+        const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+        void* data) {
+    return accessRegion(region_id, [&](AbtIORegion& region) {
+        return region.read(regionOffsetSizes, data);
+    });
+}
+
+Result<bool> AbtIOTarget::pushSegments(
+        const RegionID& region_id,
+        const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+        TransferManager& transferManager,
+        thallium::bulk data,
+        const thallium::endpoint& address,
+        size_t bulkOffset) {
+    return accessRegion(region_id, [&](AbtIORegion& region) {
+        return transferManager.push(
+            region, regionOffsetSizes, data, address, bulkOffset);
+    });
+}
+
 Result<bool> AbtIOTarget::erase(const RegionID& region_id) {
     Result<bool> result;
     auto regionOffsetSize = RegionIDtoOffsetSize(region_id);
-    m_migration_lock.rdlock();
+    auto token = m_migration_guard.enter();
     int ret = abt_io_fallocate(
         m_abtio, m_fd,
         FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
@@ -321,11 +726,309 @@ Result<bool> AbtIOTarget::erase(const RegionID& region_id) {
         result.error() = "abt_io_fallocate failed to erase region";
         result.success() = false;
     }
-    m_migration_lock.unlock();
 
     return result;
 }
 
+Result<bool> AbtIOTarget::advise(
+        const std::vector<RegionSegments>& regions, AccessHint hint) {
+    Result<bool> result;
+    auto token = m_migration_guard.enter();
+    if(!m_fd) {
+        result.success() = false;
+        result.error() = fmt::format("File {} has been destroyed", m_filename);
+        return result;
+    }
+    // with O_DIRECT there is no page cache for the hints to act on
+    if(m_directio) {
+        m_ignored_hints += 1;
+        return result;
+    }
+    if(hint == AccessHint::WillNeed)
+        return readAhead(regions);
+    int advice;
+    switch(hint) {
+    case AccessHint::Sequential: advice = POSIX_FADV_SEQUENTIAL; break;
+    case AccessHint::Random:     advice = POSIX_FADV_RANDOM;     break;
+    case AccessHint::DontNeed:   advice = POSIX_FADV_DONTNEED;   break;
+    default:                     advice = POSIX_FADV_NORMAL;
+    }
+    for(auto& region : regions) {
+        auto regionOffsetSize = RegionIDtoOffsetSize(region.first);
+        for(auto& segment : region.second) {
+            if(segment.first >= regionOffsetSize.second) continue;
+            size_t size = std::min(segment.second, regionOffsetSize.second - segment.first);
+            int ret = posix_fadvise(m_fd, regionOffsetSize.first + segment.first, size, advice);
+            if(ret != 0) {
+                result.success() = false;
+                result.error() = fmt::format("posix_fadvise failed: {}", strerror(ret));
+                return result;
+            }
+        }
+    }
+    return result;
+}
+
+Result<bool> AbtIOTarget::readAhead(const std::vector<RegionSegments>& regions) {
+    Result<bool> result;
+    size_t total = 0;
+    for(auto& region : regions) {
+        auto regionSize = RegionIDtoOffsetSize(region.first).second;
+        for(auto& segment : region.second) {
+            if(segment.first < regionSize)
+                total += std::min(segment.second, regionSize - segment.first);
+        }
+    }
+    if(total == 0) return result;
+    // the data is read in chunks into the same buffer and discarded
+    size_t chunkSize = std::min(total, WARABI_ABTIO_READAHEAD_CHUNK_SIZE);
+    auto buffer = allocateBuffer(this, m_alignment, chunkSize);
+    if(!buffer) {
+        result.error() = fmt::format("posix_memalign failed in readAhead: {}", strerror(ENOMEM));
+        result.success() = false;
+        return result;
+    }
+    Tracer::Span span{"target", "readahead"};
+    for(auto& region : regions) {
+        auto regionOffsetSize = RegionIDtoOffsetSize(region.first);
+        // the caller's token covers the region
+        AbtIORegion reader{this, region.first, regionOffsetSize.first, MigrationGuard::Token{}};
+        std::vector<std::pair<size_t, size_t>> chunk;
+        size_t chunkBytes = 0;
+        auto readChunk = [&]() {
+            if(chunk.empty()) return true;
+            result = reader.read(chunk, buffer.get());
+            chunk.clear();
+            chunkBytes = 0;
+            return result.success();
+        };
+        for(auto& segment : region.second) {
+            if(segment.first >= regionOffsetSize.second) continue;
+            size_t end = segment.first + std::min(segment.second, regionOffsetSize.second - segment.first);
+            for(size_t offset = segment.first; offset < end;) {
+                size_t size = std::min(end - offset, chunkSize - chunkBytes);
+                chunk.push_back({offset, size});
+                chunkBytes += size;
+                offset += size;
+                if(chunkBytes == chunkSize && !readChunk()) return result;
+            }
+        }
+        if(!readChunk()) return result;
+    }
+    m_readahead_bytes += total;
+    return result;
+}
+
+int AbtIOTarget::cloneFileRange(int srcFd, size_t srcOffset,
+                                int dstFd, size_t dstOffset, size_t size,
+                                bool* cloned) {
+    if(cloned) *cloned = false;
+    if(size == 0) return 0;
+#ifdef FICLONERANGE
+    struct file_clone_range range;
+    range.src_fd      = srcFd;
+    range.src_offset  = srcOffset;
+    range.src_length  = size;
+    range.dest_offset = dstOffset;
+    if(ioctl(dstFd, FICLONERANGE, &range) == 0) {
+        if(cloned) *cloned = true;
+        return 0;
+    }
+#endif
+    // in-kernel copy, which some filesystems (e.g. NFS, CIFS) offload
+    loff_t in = srcOffset, out = dstOffset;
+    size_t done = 0;
+    while(done < size) {
+        ssize_t n = copy_file_range(srcFd, &in, dstFd, &out, size - done, 0);
+        if(n <= 0) break;
+        done += n;
+    }
+    // copy through a staging buffer, e.g. if the file was opened with O_DIRECT
+    size_t chunk = WARABI_ALIGN_UP(std::min<size_t>(size - done, 4*1024*1024), m_alignment);
+    auto buffer = allocateBuffer(this, m_alignment, chunk);
+    if(done < size && !buffer) return -ENOMEM;
+    while(done < size) {
+        size_t n = std::min(chunk, size - done);
+        ssize_t r = abt_io_pread(m_abtio, srcFd, buffer.get(), n, srcOffset + done);
+        if(r < 0) return r;
+        if(r == 0) break; // end of the source file
+        ssize_t w = abt_io_pwrite(m_abtio, dstFd, buffer.get(), r, dstOffset + done);
+        if(w < 0) return w;
+        done += w;
+    }
+    return 0;
+}
+
+Result<size_t> AbtIOTarget::regionSize(const RegionID& region_id) {
+    Result<size_t> result;
+    auto regionOffsetSize = RegionIDtoOffsetSize(region_id);
+    if(regionOffsetSize.first + regionOffsetSize.second > m_file_size.load()) {
+        result.success() = false;
+        result.error() = "Invalid RegionID";
+        return result;
+    }
+    result.value() = regionOffsetSize.second;
+    return result;
+}
+
+Result<RegionID> AbtIOTarget::clone(const RegionID& region_id) {
+    Result<RegionID> result;
+    auto regionOffsetSize = RegionIDtoOffsetSize(region_id);
+    auto token = m_migration_guard.enter();
+    if(!m_fd) {
+        result.success() = false;
+        result.error() = fmt::format("File {} has been destroyed", m_filename);
+        return result;
+    }
+    if(regionOffsetSize.first + regionOffsetSize.second > m_file_size.load()) {
+        result.success() = false;
+        result.error() = "Invalid RegionID";
+        return result;
+    }
+    // reflinks work on whole filesystem blocks, so the blocks containing
+    // the region are cloned to a block-aligned range at the end of the
+    // file, and the clone starts at the same offset within its first block
+    size_t size  = regionOffsetSize.second;
+    size_t first = WARABI_ALIGN_DOWN(regionOffsetSize.first, m_clone_alignment);
+    size_t last  = WARABI_ALIGN_UP(regionOffsetSize.first + size, m_clone_alignment);
+    size_t blocks_size = last - first;
+    size_t file_size = m_file_size.load();
+    size_t offset = 0;
+    do {
+        offset = WARABI_ALIGN_UP(file_size, m_clone_alignment);
+    } while(!m_file_size.compare_exchange_weak(file_size, offset + blocks_size));
+    bool cloned = false;
+    int ret = cloneFileRange(m_fd, first, m_fd, offset, blocks_size, &cloned);
+    if(ret != 0) {
+        result.success() = false;
+        result.error() = fmt::format("Failed to clone region: {}", strerror(-ret));
+        return result;
+    }
+    m_clones += 1;
+    if(!cloned) m_clone_copies += 1;
+    // clones are not covered by O_DSYNC
+    if(m_durability == Durability::PerWrite) abt_io_fdatasync(m_abtio, m_fd);
+    else markDirty(blocks_size);
+    result.value() = OffsetSizeToRegionID(offset + (regionOffsetSize.first - first), size);
+    return result;
+}
+
+std::string AbtIOTarget::snapshotPath(const std::string& name) const {
+    return m_filename + ".snapshot." + name;
+}
+
+Result<bool> AbtIOTarget::createSnapshot(const std::string& name) {
+    Result<bool> result;
+    if(name.empty() || name.find('/') != std::string::npos) {
+        result.success() = false;
+        result.error() = fmt::format("Invalid snapshot name \"{}\"", name);
+        return result;
+    }
+    // wait for operations in progress so that the snapshot is consistent
+    m_migration_guard.beginMigration();
+    DEFER(m_migration_guard.endMigration());
+    if(!m_fd) {
+        result.success() = false;
+        result.error() = fmt::format("File {} has been destroyed", m_filename);
+        return result;
+    }
+    auto path = snapshotPath(name);
+    int fd = open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if(fd < 0) {
+        result.success() = false;
+        result.error() = fmt::format("Could not create snapshot file {}: {}", path, strerror(errno));
+        return result;
+    }
+    int ret = cloneFileRange(m_fd, 0, fd, 0, m_file_size.load());
+    if(ret == 0 && fdatasync(fd) != 0) ret = -errno;
+    close(fd);
+    if(ret != 0) {
+        std::filesystem::remove(path);
+        result.success() = false;
+        result.error() = fmt::format("Could not create snapshot: {}", strerror(-ret));
+    }
+    return result;
+}
+
+Result<bool> AbtIOTarget::restoreSnapshot(const std::string& name) {
+    Result<bool> result;
+    if(name.empty() || name.find('/') != std::string::npos) {
+        result.success() = false;
+        result.error() = fmt::format("Invalid snapshot name \"{}\"", name);
+        return result;
+    }
+    m_migration_guard.beginMigration();
+    DEFER(m_migration_guard.endMigration());
+    if(!m_fd) {
+        result.success() = false;
+        result.error() = fmt::format("File {} has been destroyed", m_filename);
+        return result;
+    }
+    int fd = open(snapshotPath(name).c_str(), O_RDONLY);
+    if(fd < 0) {
+        result.success() = false;
+        result.error() = fmt::format("Snapshot \"{}\" not found", name);
+        return result;
+    }
+    DEFER(close(fd));
+    struct stat statbuf;
+    if(fstat(fd, &statbuf) != 0) {
+        result.success() = false;
+        result.error() = fmt::format("Could not stat snapshot: {}", strerror(errno));
+        return result;
+    }
+    // the snapshot is restored into a new file that then replaces the
+    // target's file, so that a crash during the restore leaves either
+    // the current file or the restored one, never a mix of the two
+    auto restore_path = m_filename + ".restore";
+    std::error_code ec;
+    std::filesystem::remove(restore_path, ec); // left by a previous crash
+    int flags = fcntl(m_fd, F_GETFL);
+    flags = flags < 0 ? 0 : (flags & (O_DIRECT | O_DSYNC));
+    int restore_fd = abt_io_open(m_abtio, restore_path.c_str(), O_CREAT | O_EXCL | O_RDWR | flags, 0644);
+    if(restore_fd < 0) {
+        result.success() = false;
+        result.error() = fmt::format(
+            "Could not create file {}: {}", restore_path, strerror(-restore_fd));
+        return result;
+    }
+    int ret = cloneFileRange(fd, 0, restore_fd, 0, statbuf.st_size);
+    // regions created after the snapshot become holes: the file keeps
+    // its size so that their offsets are not given to new regions
+    if(ret == 0 && (size_t)statbuf.st_size < m_file_size.load())
+        ret = abt_io_ftruncate(m_abtio, restore_fd, m_file_size.load());
+    if(ret == 0) ret = abt_io_fdatasync(m_abtio, restore_fd);
+    if(ret == 0 && rename(restore_path.c_str(), m_filename.c_str()) != 0) ret = -errno;
+    if(ret != 0) {
+        abt_io_close(m_abtio, restore_fd);
+        std::filesystem::remove(restore_path, ec);
+        result.success() = false;
+        result.error() = fmt::format("Could not restore snapshot: {}", strerror(-ret));
+        return result;
+    }
+    // make the rename durable
+    auto dir = std::filesystem::path{m_filename}.parent_path();
+    int dir_fd = open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if(dir_fd >= 0) {
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+    abt_io_close(m_abtio, m_fd);
+    m_fd = restore_fd;
+    return result;
+}
+
+Result<bool> AbtIOTarget::deleteSnapshot(const std::string& name) {
+    Result<bool> result;
+    std::error_code ec;
+    if(name.empty() || name.find('/') != std::string::npos
+    || !std::filesystem::remove(snapshotPath(name), ec)) {
+        result.success() = false;
+        result.error() = fmt::format("Snapshot \"{}\" not found", name);
+    }
+    return result;
+}
+
 Result<std::unique_ptr<MigrationHandle>> AbtIOTarget::startMigration(bool removeSource) {
     Result<std::unique_ptr<MigrationHandle>> result;
     result.value() = std::make_unique<AbtIOMigrationHandle>(this, removeSource);
@@ -350,7 +1053,6 @@ Result<std::unique_ptr<warabi::Backend>> AbtIOTarget::recover(
     config["path"]           = filenames[0];
     bool directio            = config.value("directio", false);
     const auto& path         = filenames[0];
-    abt_io_instance_id abtio = ABT_IO_INSTANCE_NULL;
 
     bool file_exists = std::filesystem::exists(path);
     if(!file_exists) {
@@ -359,29 +1061,23 @@ Result<std::unique_ptr<warabi::Backend>> AbtIOTarget::recover(
         return result;
     }
 
-    if(config.contains("abt_io")) {
-        auto abtio_config = config["abt_io"].dump();
-        struct abt_io_init_info args = {
-            abtio_config.c_str(),
-            ABT_POOL_NULL
-        };
-        abtio = abt_io_init_ext(&args);
-    } else {
-        abtio = abt_io_init(1);
-    }
-    if(abtio == ABT_IO_INSTANCE_NULL) {
+    auto instance = AbtIOInstance::forTarget(config, path);
+    if(!instance.success()) {
         result.success() = false;
-        result.error() = "Could not create ABT-IO instance";
+        result.error() = instance.error();
         return result;
     }
+    auto abtio = instance.value()->id();
 
     int fd = 0;
     int oflags = O_RDWR;
     if(directio) oflags |= O_DIRECT;
+    if(durabilityFromConfig(config) == Durability::PerWrite) oflags |= O_DSYNC;
 retry_without_odirect:
     fd = abt_io_open(abtio, path.c_str(), oflags, 0);
     if(fd == -EINVAL && directio) {
-        oflags = O_RDWR;
+        spdlog::warn("[warabi] Could not open {} with O_DIRECT, falling back to buffered I/O", path);
+        oflags &= ~O_DIRECT;
         config["directio"] = false;
         directio = false;
         goto retry_without_odirect;
@@ -404,8 +1100,15 @@ retry_without_odirect:
     }
     file_size = statbuf.st_size;
 
+    if(directio) {
+        size_t dio_alignment = directIOAlignment(fd, path);
+        size_t alignment = config.value("alignment", (size_t)8);
+        if(alignment % dio_alignment != 0)
+            config["alignment"] = std::lcm(alignment, dio_alignment);
+    }
+
     result.value() = std::make_unique<warabi::AbtIOTarget>(
-        engine, config, abtio, fd, file_size);
+        engine, config, std::move(instance.value()), fd, file_size);
     return result;
 }
 
@@ -414,26 +1117,9 @@ Result<std::unique_ptr<warabi::Backend>> AbtIOTarget::create(const thallium::eng
     const auto& path         = config["path"].get_ref<const std::string&>();
     bool override_if_exists  = config.value("override_if_exists", false);
     bool directio            = config.value("directio", false);
-    abt_io_instance_id abtio = ABT_IO_INSTANCE_NULL;
 
     Result<std::unique_ptr<warabi::Backend>> result;
 
-    if(config.contains("abt_io")) {
-        auto abtio_config = config["abt_io"].dump();
-        struct abt_io_init_info args = {
-            abtio_config.c_str(),
-            ABT_POOL_NULL
-        };
-        abtio = abt_io_init_ext(&args);
-    } else {
-        abtio = abt_io_init(1);
-    }
-    if(abtio == ABT_IO_INSTANCE_NULL) {
-        result.success() = false;
-        result.error() = "Could not create ABT-IO instance";
-        return result;
-    }
-
     bool file_exists = std::filesystem::exists(path);
     if(file_exists && override_if_exists) {
         std::filesystem::remove(path.c_str());
@@ -446,17 +1132,28 @@ Result<std::unique_ptr<warabi::Backend>> AbtIOTarget::create(const thallium::eng
         if(!fd) {
             result.success() = false;
             result.error() = fmt::format("Could not open file {}: {}", path, strerror(errno));
-            abt_io_finalize(abtio);
             return result;
         }
         close(fd);
     }
+
+    // the instance is chosen once the file exists,
+    // so that we can find the device it is on
+    auto instance = AbtIOInstance::forTarget(config, path);
+    if(!instance.success()) {
+        result.success() = false;
+        result.error() = instance.error();
+        return result;
+    }
+    auto abtio = instance.value()->id();
     int oflags = O_RDWR;
     if(directio) oflags |= O_DIRECT;
+    if(durabilityFromConfig(config) == Durability::PerWrite) oflags |= O_DSYNC;
 retry_without_odirect:
     fd = abt_io_open(abtio, path.c_str(), oflags, 0);
     if(fd == -EINVAL && directio) {
-        oflags = O_RDWR;
+        spdlog::warn("[warabi] Could not open {} with O_DIRECT, falling back to buffered I/O", path);
+        oflags &= ~O_DIRECT;
         config["directio"] = false;
         directio = false;
         goto retry_without_odirect;
@@ -479,8 +1176,15 @@ retry_without_odirect:
     }
     file_size = statbuf.st_size;
 
+    if(directio) {
+        size_t dio_alignment = directIOAlignment(fd, path);
+        size_t alignment = config.value("alignment", (size_t)8);
+        if(alignment % dio_alignment != 0)
+            config["alignment"] = std::lcm(alignment, dio_alignment);
+    }
+
     result.value() = std::make_unique<warabi::AbtIOTarget>(
-        engine, config, abtio, fd, file_size);
+        engine, config, std::move(instance.value()), fd, file_size);
     return result;
 }
 
@@ -494,8 +1198,19 @@ Result<bool> AbtIOTarget::validate(const json& config) {
             "override_if_exists": {"type": "boolean"},
             "alignment": {"type": "integer", "minimum": 8, "multipleOf": 8},
             "sync": {"type": "boolean"},
+            "durability": {"enum": ["none", "per_write", "periodic", "on_persist"]},
+            "sync_interval_ms": {"type": "integer", "minimum": 1},
+            "sync_bytes": {"type": "integer", "minimum": 0},
             "directio": {"type": "boolean"},
-            "abt_io": {"type": "object"}
+            "abt_io": {"type": ["object", "string"]},
+            "abt_io_threads": {"type": "integer", "minimum": 1},
+            "max_inflight_ops": {"type": "integer", "minimum": 0},
+            "numa_node": {
+                "oneOf": [
+                    {"type": "integer", "minimum": 0},
+                    {"const": "device"}
+                ]
+            }
         },
         "required": ["path"]
     }
@@ -527,4 +1242,124 @@ Result<bool> AbtIOTarget::validate(const json& config) {
     return result;
 }
 
+// Instances sized from the device's queue depth are capped to this many
+// execution streams; devices whose queue depth is unknown get the default.
+static constexpr size_t WARABI_ABTIO_MAX_AUTO_THREADS = 64;
+static constexpr size_t WARABI_ABTIO_DEFAULT_THREADS  = 4;
+
+struct AbtIORegistry {
+
+    std::mutex                                                    m_mutex;
+    std::unordered_map<std::string, std::weak_ptr<AbtIOInstance>> m_instances;
+
+    static AbtIORegistry& get() {
+        static AbtIORegistry registry;
+        return registry;
+    }
+};
+
+static bool findDevice(const std::string& path, dev_t& dev) {
+    std::filesystem::path p{path};
+    struct stat statbuf;
+    // the file may not exist yet, in which case we look
+    // at the closest existing parent directory
+    while(stat(p.c_str(), &statbuf) != 0) {
+        if(!p.has_relative_path()) return false;
+        p = p.parent_path();
+    }
+    dev = statbuf.st_dev;
+    return true;
+}
+
+size_t AbtIOInstance::deviceQueueDepth(const std::string& path) {
+    dev_t dev;
+    if(!findDevice(path, dev)) return 0;
+    auto sysfs = fmt::format("/sys/dev/block/{}:{}", major(dev), minor(dev));
+    // partitions don't have a queue directory, their parent device does
+    for(auto& candidate : {sysfs + "/queue/nr_requests", sysfs + "/../queue/nr_requests"}) {
+        std::ifstream f{candidate};
+        size_t depth = 0;
+        if(f >> depth) return depth;
+    }
+    return 0;
+}
+
+Result<std::shared_ptr<AbtIOInstance>> AbtIOInstance::forTarget(
+        const json& config, const std::string& path) {
+    Result<std::shared_ptr<AbtIOInstance>> result;
+
+    if(config.contains("abt_io") && config["abt_io"].is_object()) {
+        auto abtio_config = config["abt_io"].dump();
+        struct abt_io_init_info args = {
+            abtio_config.c_str(),
+            ABT_POOL_NULL
+        };
+        auto abtio = abt_io_init_ext(&args);
+        if(abtio == ABT_IO_INSTANCE_NULL) {
+            result.success() = false;
+            result.error() = "Could not create ABT-IO instance";
+            return result;
+        }
+        result.value() = std::make_shared<AbtIOInstance>(abtio, true, 0);
+        return result;
+    }
+
+    std::string name;
+    if(config.contains("abt_io")) {
+        name = config["abt_io"].get<std::string>();
+    } else {
+        dev_t dev = 0;
+        findDevice(path, dev);
+        name = fmt::format("__device_{}:{}__", major(dev), minor(dev));
+    }
+
+    auto& registry = AbtIORegistry::get();
+    std::unique_lock<std::mutex> lock{registry.m_mutex};
+    auto instance = registry.m_instances[name].lock();
+    if(instance) {
+        result.value() = std::move(instance);
+        return result;
+    }
+
+    size_t num_threads = config.value("abt_io_threads", (size_t)0);
+    if(!num_threads) {
+        num_threads = std::min(deviceQueueDepth(path), WARABI_ABTIO_MAX_AUTO_THREADS);
+        if(!num_threads) num_threads = WARABI_ABTIO_DEFAULT_THREADS;
+    }
+    auto abtio = abt_io_init(num_threads);
+    if(abtio == ABT_IO_INSTANCE_NULL) {
+        result.success() = false;
+        result.error() = fmt::format(
+            "Could not create ABT-IO instance \"{}\" with {} threads", name, num_threads);
+        return result;
+    }
+    instance = std::make_shared<AbtIOInstance>(abtio, true, num_threads);
+    registry.m_instances[name] = instance;
+    result.value() = std::move(instance);
+    return result;
+}
+
+Result<std::shared_ptr<AbtIOInstance>> AbtIOInstance::registerExternal(
+        const std::string& name, abt_io_instance_id id) {
+    Result<std::shared_ptr<AbtIOInstance>> result;
+    auto& registry = AbtIORegistry::get();
+    std::unique_lock<std::mutex> lock{registry.m_mutex};
+    auto instance = registry.m_instances[name].lock();
+    if(instance) {
+        // e.g. several providers depending on the same bedrock abt-io component
+        if(instance->id() == id) {
+            result.value() = std::move(instance);
+            return result;
+        }
+        result.success() = false;
+        result.error() = fmt::format(
+            "Another ABT-IO instance is already registered as \"{}\"", name);
+        return result;
+    }
+    instance = std::make_shared<AbtIOInstance>(id, false, 0);
+    registry.m_instances[name] = instance;
+    result.value() = std::move(instance);
+    return result;
+}
+
 }
@@ -7,7 +7,11 @@
 #define __ABTIO_BACKEND_HPP
 
 #include <warabi/Backend.hpp>
+#include "AbtIOInstance.hpp"
+#include "MigrationGuard.hpp"
 #include <abt-io.h>
+#include <array>
+#include <optional>
 
 namespace warabi {
 
@@ -16,19 +20,64 @@ using json = nlohmann::json;
 /**
  * AbtIO-based implementation of an warabi Backend.
  */
-class AbtIOTarget : public warabi::Backend {
+class AbtIOTarget final : public warabi::Backend {
 
     public:
 
     thallium::engine               m_engine;
     json                           m_config;
+    std::shared_ptr<AbtIOInstance> m_abtio_instance;
     abt_io_instance_id             m_abtio;
     int                            m_fd;
     std::atomic<size_t>            m_file_size;
     std::string                    m_filename;
-    bool                           m_sync;
     size_t                         m_alignment;
-    thallium::rwlock               m_migration_lock;
+    // Alignment of cloned ranges: reflinks need filesystem-block-aligned
+    // offsets and lengths, so clones are placed at multiples of st_blksize
+    // (and of m_alignment)
+    size_t                         m_clone_alignment;
+    std::atomic<size_t>            m_clones{0};
+    std::atomic<size_t>            m_clone_copies{0};
+    std::atomic<size_t>            m_readahead_bytes{0};
+    std::atomic<size_t>            m_ignored_hints{0};
+    bool                           m_directio;
+    // NUMA node of the staging buffers (-1 if not bound), set by "numa_node"
+    // to a node or to "device" for the node of the file's device
+    int                            m_numa_node;
+    MigrationGuard                 m_migration_guard;
+
+    // Locks protecting read-modify-writes of partial blocks in O_DIRECT mode
+    std::array<thallium::mutex, 64> m_rmw_locks;
+
+    // Per-target bound on the number of abt-io operations in flight
+    // (0 means unbounded), useful when the abt-io instance is shared
+    size_t                         m_max_inflight_ops;
+    std::atomic<size_t>            m_inflight_ops{0};
+    thallium::mutex                m_inflight_mutex;
+    thallium::condition_variable   m_inflight_cv;
+
+    /**
+     * @brief Durability modes:
+     * - None: data is never explicitly flushed, persist is a no-op;
+     * - PerWrite: the file is opened with O_DSYNC, so every write is
+     *   durable when it completes and persist is a no-op;
+     * - Periodic: a background ULT flushes the file every
+     *   "sync_interval_ms" milliseconds or as soon as "sync_bytes"
+     *   bytes have been written since the last flush, whichever comes
+     *   first; persist still flushes synchronously;
+     * - OnPersist (default): the file is flushed only when persist
+     *   is requested.
+     */
+    enum class Durability { None, PerWrite, Periodic, OnPersist };
+
+    Durability                     m_durability;
+    size_t                         m_sync_interval_ms;
+    size_t                         m_sync_bytes;
+    std::atomic<size_t>            m_dirty_bytes{0};
+    thallium::mutex                m_flush_mutex;
+    thallium::condition_variable   m_flush_cv;
+    bool                           m_flush_stop = false;
+    std::optional<thallium::managed<thallium::thread>> m_flusher;
 
     struct AbtIOMigrationHandle : public MigrationHandle {
 
@@ -38,14 +87,14 @@ class AbtIOTarget : public warabi::Backend {
         AbtIOMigrationHandle(AbtIOTarget* target, bool removeSource)
         : m_target(target)
         , m_remove_source(removeSource) {
-            m_target->m_migration_lock.wrlock();
+            m_target->m_migration_guard.beginMigration();
         }
 
         ~AbtIOMigrationHandle() {
             if(m_remove_source) {
                 m_target->destroy();
             }
-            m_target->m_migration_lock.unlock();
+            m_target->m_migration_guard.endMigration();
         }
 
         std::string getRoot() const override {
@@ -75,7 +124,7 @@ class AbtIOTarget : public warabi::Backend {
      * @brief Constructor.
      */
     AbtIOTarget(thallium::engine engine, const json& config,
-                abt_io_instance_id abtio, int fd, size_t file_size);
+                std::shared_ptr<AbtIOInstance> abtio, int fd, size_t file_size);
 
     /**
      * @brief Move-constructor.
@@ -97,6 +146,12 @@ class AbtIOTarget : public warabi::Backend {
      */
     std::string getConfig() const override;
 
+    /**
+     * @brief Get statistics (NUMA placement and operations in flight)
+     * as a JSON-formatted string.
+     */
+    std::string getStats() const override;
+
     /**
      * @brief Create a region of a given size and return
      * an std::unique_ptr to a WritableRegion, or nullptr
@@ -120,11 +175,104 @@ class AbtIOTarget : public warabi::Backend {
      */
     Result<std::unique_ptr<ReadableRegion>> read(const RegionID& region) override;
 
+    /**
+     * @brief Direct region access, building the region object on the stack.
+     * @see Backend::writeSegments and the other *Segments functions.
+     */
+    Result<bool> writeSegments(
+            const RegionID& region,
+            const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+            const void* data, bool persist) override;
+
+    Result<bool> pullSegments(
+            const RegionID& region,
+            const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+            TransferManager& transferManager,
+            thallium::bulk data,
+            const thallium::endpoint& address,
+            size_t bulkOffset,
+            bool persist) override;
+
+    Result<bool> persistSegments(
+            const RegionID& region,
+            const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes) override;
+
+    Result<bool> readSegments(
+            const RegionID& region,
+            const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+            void* data) override;
+
+    Result<bool> pushSegments(
+            const RegionID& region,
+            const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+            TransferManager& transferManager,
+            thallium::bulk data,
+            const thallium::endpoint& address,
+            size_t bulkOffset) override;
+
     /**
      * @see TopicHandle::erase
      */
     Result<bool> erase(const RegionID& region) override;
 
+    /**
+     * @brief Pass the hint to the kernel with posix_fadvise, except for
+     * AccessHint::WillNeed, for which the segments are read through abt-io
+     * (see readAhead). Hints are ignored with O_DIRECT, and counted as such
+     * in the target's statistics.
+     */
+    Result<bool> advise(const std::vector<RegionSegments>& regions, AccessHint hint) override;
+
+    /**
+     * @brief Read the segments into the page cache. The reads are done by
+     * abt-io's execution streams rather than by posix_fadvise on the
+     * handler's, and the data is discarded.
+     */
+    Result<bool> readAhead(const std::vector<RegionSegments>& regions);
+
+    /**
+     * @see Backend::regionSize
+     */
+    Result<size_t> regionSize(const RegionID& region) override;
+
+    /**
+     * @brief Clone a region at the end of the file, sharing its blocks
+     * (reflink) if the filesystem supports it, copying them otherwise.
+     */
+    Result<RegionID> clone(const RegionID& region) override;
+
+    /**
+     * @brief Snapshots are reflinked copies of the file, named
+     * after it with a ".snapshot.<name>" suffix.
+     * @see Backend::createSnapshot
+     */
+    Result<bool> createSnapshot(const std::string& name) override;
+
+    /**
+     * @see Backend::restoreSnapshot
+     */
+    Result<bool> restoreSnapshot(const std::string& name) override;
+
+    /**
+     * @see Backend::deleteSnapshot
+     */
+    Result<bool> deleteSnapshot(const std::string& name) override;
+
+    /**
+     * @brief Path of the file holding the named snapshot.
+     */
+    std::string snapshotPath(const std::string& name) const;
+
+    /**
+     * @brief Make the range [dstOffset, dstOffset+size) of dstFd share
+     * (or, failing that, hold a copy of) the range starting at srcOffset
+     * in srcFd. Returns 0 or a negative error code. If provided, cloned
+     * is set to whether the range was shared rather than copied.
+     */
+    int cloneFileRange(int srcFd, size_t srcOffset,
+                       int dstFd, size_t dstOffset, size_t size,
+                       bool* cloned = nullptr);
+
     /**
      * @brief Destroy the underlying storage.
      */
@@ -135,6 +283,63 @@ class AbtIOTarget : public warabi::Backend {
      */
     Result<std::unique_ptr<MigrationHandle>> startMigration(bool removeSource) override;
 
+    /**
+     * @brief Get the durability mode requested by a configuration
+     * (the legacy "sync": true is equivalent to "durability": "per_write").
+     */
+    static Durability durabilityFromConfig(const json& config);
+
+    /**
+     * @brief Get the name of a durability mode, as used in configurations.
+     */
+    static const char* durabilityName(Durability durability);
+
+    /**
+     * @brief Get the NUMA node requested by a configuration (-1 if none
+     * or if the node of the file's device cannot be determined).
+     */
+    static int numaNodeFromConfig(const json& config);
+
+    /**
+     * @brief Flush the file to the device unless the durability
+     * mode makes it unnecessary.
+     */
+    Result<bool> flush();
+
+    /**
+     * @brief Account for bytes written, waking up the background
+     * flusher if enough bytes have accumulated.
+     */
+    void markDirty(size_t size);
+
+    /**
+     * @brief Stop the background flusher, if any.
+     */
+    void stopFlusher();
+
+    /**
+     * @brief Try to take one of the target's in-flight operation slots.
+     */
+    bool tryAcquireSlot();
+
+    /**
+     * @brief Take one of the target's in-flight operation slots,
+     * blocking until one is available.
+     */
+    void acquireSlot();
+
+    /**
+     * @brief Give back an in-flight operation slot.
+     */
+    void releaseSlot();
+
+    /**
+     * @brief Build the region object for the given RegionID on the
+     * stack and call function on it.
+     */
+    template<typename Function>
+    Result<bool> accessRegion(const RegionID& region, Function&& function);
+
     /**
      * @brief Static factory function used by the TargetFactory to
      * create a AbtIOTarget.
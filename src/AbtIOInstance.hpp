@@ -0,0 +1,104 @@
+/*
+ * (C) 2024 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __ABTIO_INSTANCE_HPP
+#define __ABTIO_INSTANCE_HPP
+
+#include <warabi/Result.hpp>
+#include <nlohmann/json.hpp>
+#include <abt-io.h>
+#include <memory>
+#include <string>
+
+namespace warabi {
+
+/**
+ * @brief Reference-counted wrapper around an abt_io_instance_id.
+ *
+ * AbtIOInstances can be shared by multiple targets, possibly belonging
+ * to different providers. Named instances are kept in a process-wide
+ * registry for as long as at least one target (or the component that
+ * registered them) holds a reference to them.
+ *
+ * An abtio target picks its instance as follows, depending on the
+ * "abt_io" field of its configuration:
+ * - object: a dedicated instance is created from this configuration;
+ * - string: the named instance is used if it has been registered
+ *   (e.g. as a bedrock dependency), otherwise it is created;
+ * - absent: the target uses an instance shared by all the targets
+ *   whose file is on the same block device.
+ *
+ * Instances created by warabi without an explicit configuration are
+ * given as many execution streams as the "abt_io_threads" field of the
+ * target's configuration, or as the queue depth of the device if this
+ * field is not provided.
+ */
+class AbtIOInstance {
+
+    public:
+
+    AbtIOInstance(abt_io_instance_id id, bool owned, size_t num_threads)
+    : m_id(id)
+    , m_owned(owned)
+    , m_num_threads(num_threads) {}
+
+    AbtIOInstance(const AbtIOInstance&) = delete;
+    AbtIOInstance& operator=(const AbtIOInstance&) = delete;
+
+    ~AbtIOInstance() {
+        if(m_owned && m_id != ABT_IO_INSTANCE_NULL)
+            abt_io_finalize(m_id);
+    }
+
+    /**
+     * @brief Underlying abt-io instance.
+     */
+    abt_io_instance_id id() const {
+        return m_id;
+    }
+
+    /**
+     * @brief Number of execution streams of the instance,
+     * or 0 if unknown (e.g. the instance was created externally).
+     */
+    size_t numThreads() const {
+        return m_num_threads;
+    }
+
+    /**
+     * @brief Get the instance an abtio target with the given
+     * configuration should use for the file at the given path.
+     */
+    static Result<std::shared_ptr<AbtIOInstance>> forTarget(
+        const nlohmann::json& config, const std::string& path);
+
+    /**
+     * @brief Register an externally-managed abt-io instance under
+     * the provided name. The instance is not finalized by warabi.
+     * It remains registered for as long as the returned pointer
+     * (or any target using it) is alive. Registering the same instance
+     * again under the same name returns the existing registration;
+     * registering a different instance under a name in use fails.
+     */
+    static Result<std::shared_ptr<AbtIOInstance>> registerExternal(
+        const std::string& name, abt_io_instance_id id);
+
+    /**
+     * @brief Find the queue depth (nr_requests) of the block device
+     * containing the file (or directory) at the given path.
+     * Returns 0 if it could not be determined.
+     */
+    static size_t deviceQueueDepth(const std::string& path);
+
+    private:
+
+    abt_io_instance_id m_id;
+    bool               m_owned;
+    size_t             m_num_threads;
+};
+
+}
+
+#endif
@@ -0,0 +1,205 @@
+/*
+ * (C) 2024 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __WARABI_ADMISSION_CONTROLLER_HPP
+#define __WARABI_ADMISSION_CONTROLLER_HPP
+
+#include <warabi/Result.hpp>
+#include <nlohmann/json.hpp>
+#include <nlohmann/json-schema.hpp>
+#include <fmt/format.h>
+
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+
+namespace warabi {
+
+/**
+ * @brief The AdmissionController bounds the number of operations and
+ * the number of bytes in flight on the provider's target. Requests that
+ * would exceed these bounds are rejected immediately (instead of piling
+ * up in the handler pool) with a "busy" Result carrying a retry-after
+ * hint, computed from the current occupancy of the target.
+ *
+ * A request larger than "max_inflight_bytes" is still admitted when
+ * no other byte-carrying request is in flight, so that it cannot be
+ * starved.
+ *
+ * Example of configuration:
+ *
+ * {
+ *     "max_inflight_ops": 256,
+ *     "max_inflight_bytes": 1073741824,
+ *     "retry_after_ms": 10
+ * }
+ *
+ * A bound of 0 (or a missing bound) means unlimited.
+ */
+class AdmissionController {
+
+    using json = nlohmann::json;
+
+    public:
+
+    /**
+     * @brief RAII object returned by admit(). Evaluates to true
+     * if the request was admitted, in which case its destructor
+     * releases the resources it accounts for.
+     */
+    class Ticket {
+
+        friend class AdmissionController;
+
+        AdmissionController* m_owner       = nullptr;
+        size_t               m_size        = 0;
+        uint32_t             m_retry_after = 0;
+
+        Ticket(AdmissionController* owner, size_t size)
+        : m_owner(owner)
+        , m_size(size) {}
+
+        Ticket(uint32_t retryAfter)
+        : m_retry_after(retryAfter) {}
+
+        public:
+
+        Ticket() = default;
+
+        Ticket(const Ticket&) = delete;
+
+        Ticket(Ticket&& other)
+        : m_owner(other.m_owner)
+        , m_size(other.m_size)
+        , m_retry_after(other.m_retry_after) {
+            other.m_owner = nullptr;
+        }
+
+        Ticket& operator=(const Ticket&) = delete;
+        Ticket& operator=(Ticket&&) = delete;
+
+        ~Ticket() {
+            if(m_owner) m_owner->release(m_size);
+        }
+
+        /**
+         * @brief Whether the request was admitted.
+         */
+        operator bool() const {
+            return m_retry_after == 0;
+        }
+
+        /**
+         * @brief Number of milliseconds after which the client
+         * should retry, if the request was not admitted.
+         */
+        uint32_t retryAfter() const {
+            return m_retry_after;
+        }
+    };
+
+    AdmissionController() = default;
+
+    AdmissionController(const AdmissionController&) = delete;
+    AdmissionController& operator=(const AdmissionController&) = delete;
+
+    /**
+     * @brief Validate an "admission" configuration object.
+     */
+    static Result<bool> validate(const json& config) {
+        static const json schema = R"(
+        {
+            "type": "object",
+            "properties": {
+                "max_inflight_ops": {"type": "integer", "minimum": 0},
+                "max_inflight_bytes": {"type": "integer", "minimum": 0},
+                "retry_after_ms": {"type": "integer", "minimum": 1}
+            }
+        }
+        )"_json;
+        Result<bool> result;
+        nlohmann::json_schema::json_validator validator;
+        validator.set_root_schema(schema);
+        try {
+            validator.validate(config);
+        } catch(const std::exception& ex) {
+            result.success() = false;
+            result.error() = fmt::format(
+                "Error(s) while validating JSON config for warabi admission control: {}", ex.what());
+        }
+        return result;
+    }
+
+    /**
+     * @brief Configure the AdmissionController (the configuration
+     * is expected to have been validated).
+     */
+    void configure(const json& config) {
+        m_max_ops     = config.value("max_inflight_ops", (size_t)0);
+        m_max_bytes   = config.value("max_inflight_bytes", (size_t)0);
+        m_retry_after = config.value("retry_after_ms", (uint32_t)10);
+        m_config      = config;
+        m_enabled     = m_max_ops || m_max_bytes;
+    }
+
+    /**
+     * @brief Return the configuration (null if never configured).
+     */
+    const json& getConfig() const {
+        return m_config;
+    }
+
+    /**
+     * @brief Try to admit a request carrying the given number of bytes.
+     */
+    Ticket admit(size_t size) {
+        if(!m_enabled) return Ticket{};
+        auto ops   = m_inflight_ops.fetch_add(1) + 1;
+        auto bytes = m_inflight_bytes.fetch_add(size) + size;
+        bool ops_ok   = !m_max_ops || ops <= m_max_ops;
+        bool bytes_ok = !m_max_bytes || bytes <= m_max_bytes || bytes == size;
+        if(ops_ok && bytes_ok)
+            return Ticket{this, size};
+        release(size);
+        m_rejected.fetch_add(1, std::memory_order_relaxed);
+        // the hint grows with the occupancy of the target,
+        // so that clients back off more when it is saturated
+        double occupancy = std::max(
+            m_max_ops ? (double)ops / m_max_ops : 0.0,
+            m_max_bytes ? (double)bytes / m_max_bytes : 0.0);
+        return Ticket{(uint32_t)std::max(1.0, m_retry_after * occupancy)};
+    }
+
+    /**
+     * @brief Return statistics as a JSON object.
+     */
+    json getStats() const {
+        auto stats = json::object();
+        stats["inflight_ops"]   = m_inflight_ops.load();
+        stats["inflight_bytes"] = m_inflight_bytes.load();
+        stats["rejected"]       = m_rejected.load();
+        return stats;
+    }
+
+    private:
+
+    void release(size_t size) {
+        m_inflight_ops.fetch_sub(1);
+        m_inflight_bytes.fetch_sub(size);
+    }
+
+    json                m_config;
+    std::atomic<bool>   m_enabled{false};
+    std::atomic<size_t> m_max_ops{0};
+    std::atomic<size_t> m_max_bytes{0};
+    uint32_t            m_retry_after = 10;
+    std::atomic<size_t> m_inflight_ops{0};
+    std::atomic<size_t> m_inflight_bytes{0};
+    std::atomic<size_t> m_rejected{0};
+};
+
+}
+
+#endif
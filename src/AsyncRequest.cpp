@@ -59,7 +59,7 @@ void AsyncRequest::wait() const {
 
 bool AsyncRequest::completed() const {
     if(not self) throw Exception("Invalid warabi::AsyncRequest object");
-    return self->m_async_response.received();
+    return !self->m_async_response || self->m_async_response->received();
 }
 
 }
@@ -7,6 +7,7 @@
 #define __WARABI_ASYNC_REQUEST_IMPL_H
 
 #include <functional>
+#include <optional>
 #include <thallium.hpp>
 
 namespace warabi {
@@ -18,7 +19,14 @@ struct AsyncRequestImpl {
     AsyncRequestImpl(tl::async_response&& async_response)
     : m_async_response(std::move(async_response)) {}
 
-    tl::async_response                     m_async_response;
+    /**
+     * @brief Request completed without sending an RPC
+     * (e.g. served from the client's read cache).
+     */
+    AsyncRequestImpl()
+    : m_wait_callback([](AsyncRequestImpl&) {}) {}
+
+    std::optional<tl::async_response>      m_async_response;
     bool                                   m_waited = false;
     std::function<void(AsyncRequestImpl&)> m_wait_callback;
 
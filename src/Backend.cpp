@@ -4,6 +4,7 @@
  * See COPYRIGHT in top-level directory.
  */
 #include "warabi/Backend.hpp"
+#include "warabi/TransferManager.hpp"
 #include <fmt/format.h>
 
 namespace tl = thallium;
@@ -12,6 +13,192 @@ namespace warabi {
 
 using json = nlohmann::json;
 
+Result<RegionID> Backend::createAndFill(
+        size_t size,
+        const std::function<Result<bool>(WritableRegion&)>& fill,
+        bool persist) {
+    Result<RegionID> result;
+    auto region = create(size);
+    if(!region.success()) {
+        result.success() = false;
+        result.error() = region.error();
+        return result;
+    }
+    result = region.value()->getRegionID();
+    if(!result.success()) return result;
+    auto fillResult = fill(*region.value());
+    if(fillResult.success() && persist)
+        fillResult = region.value()->persist({{0, size}});
+    if(!fillResult.success()) {
+        // release the region before erasing it
+        region.value().reset();
+        erase(result.value());
+        result.success() = false;
+        result.error() = fillResult.error();
+    }
+    return result;
+}
+
+template<typename RegionResult>
+static inline Result<bool> regionError(const RegionResult& region) {
+    Result<bool> result;
+    result.success() = false;
+    result.error() = region.error();
+    result.evicted() = region.evicted();
+    return result;
+}
+
+Result<bool> Backend::writeSegments(
+        const RegionID& region_id,
+        const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+        const void* data, bool persist) {
+    auto region = write(region_id, persist);
+    if(!region.success()) return regionError(region);
+    return region.value()->write(regionOffsetSizes, data, persist);
+}
+
+Result<bool> Backend::pullSegments(
+        const RegionID& region_id,
+        const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+        TransferManager& transferManager,
+        thallium::bulk data,
+        const thallium::endpoint& address,
+        size_t bulkOffset,
+        bool persist) {
+    auto region = write(region_id, persist);
+    if(!region.success()) return regionError(region);
+    return transferManager.pull(
+        *region.value(), regionOffsetSizes, data, address, bulkOffset, persist);
+}
+
+Result<bool> Backend::persistSegments(
+        const RegionID& region_id,
+        const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes) {
+    auto region = write(region_id, true);
+    if(!region.success()) return regionError(region);
+    return region.value()->persist(regionOffsetSizes);
+}
+
+Result<bool> Backend::readSegments(
+        const RegionID& region_id,
+        const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+        void* data) {
+    auto region = read(region_id);
+    if(!region.success()) return regionError(region);
+    return region.value()->read(regionOffsetSizes, data);
+}
+
+Result<bool> Backend::pushSegments(
+        const RegionID& region_id,
+        const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+        TransferManager& transferManager,
+        thallium::bulk data,
+        const thallium::endpoint& address,
+        size_t bulkOffset) {
+    auto region = read(region_id);
+    if(!region.success()) return regionError(region);
+    return transferManager.push(
+        *region.value(), regionOffsetSizes, data, address, bulkOffset);
+}
+
+static inline size_t segmentsSize(const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes) {
+    size_t size = 0;
+    for(auto& segment : regionOffsetSizes) size += segment.second;
+    return size;
+}
+
+Result<bool> Backend::writeRegions(
+        const std::vector<RegionSegments>& regions,
+        const void* data, bool persist) {
+    Result<bool> result;
+    auto ptr = static_cast<const char*>(data);
+    for(auto& region : regions) {
+        result = writeSegments(region.first, region.second, ptr, persist);
+        if(!result.success()) break;
+        ptr += segmentsSize(region.second);
+    }
+    return result;
+}
+
+Result<bool> Backend::pullRegions(
+        const std::vector<RegionSegments>& regions,
+        TransferManager& transferManager,
+        thallium::bulk data,
+        const thallium::endpoint& address,
+        size_t bulkOffset,
+        bool persist) {
+    Result<bool> result;
+    for(auto& region : regions) {
+        result = pullSegments(region.first, region.second,
+                              transferManager, data, address, bulkOffset, persist);
+        if(!result.success()) break;
+        bulkOffset += segmentsSize(region.second);
+    }
+    return result;
+}
+
+Result<bool> Backend::readRegions(
+        const std::vector<RegionSegments>& regions,
+        void* data) {
+    Result<bool> result;
+    auto ptr = static_cast<char*>(data);
+    for(auto& region : regions) {
+        result = readSegments(region.first, region.second, ptr);
+        if(!result.success()) break;
+        ptr += segmentsSize(region.second);
+    }
+    return result;
+}
+
+Result<bool> Backend::pushRegions(
+        const std::vector<RegionSegments>& regions,
+        TransferManager& transferManager,
+        thallium::bulk data,
+        const thallium::endpoint& address,
+        size_t bulkOffset) {
+    Result<bool> result;
+    for(auto& region : regions) {
+        result = pushSegments(region.first, region.second,
+                              transferManager, data, address, bulkOffset);
+        if(!result.success()) break;
+        bulkOffset += segmentsSize(region.second);
+    }
+    return result;
+}
+
+template<typename T>
+static inline Result<T> notSupported(const char* operation) {
+    Result<T> result;
+    result.success() = false;
+    result.error() = fmt::format("{} is not supported by this target", operation);
+    return result;
+}
+
+Result<size_t> Backend::regionSize(const RegionID& region) {
+    (void)region;
+    return notSupported<size_t>("regionSize");
+}
+
+Result<RegionID> Backend::clone(const RegionID& region) {
+    (void)region;
+    return notSupported<RegionID>("clone");
+}
+
+Result<bool> Backend::createSnapshot(const std::string& name) {
+    (void)name;
+    return notSupported<bool>("createSnapshot");
+}
+
+Result<bool> Backend::restoreSnapshot(const std::string& name) {
+    (void)name;
+    return notSupported<bool>("restoreSnapshot");
+}
+
+Result<bool> Backend::deleteSnapshot(const std::string& name) {
+    (void)name;
+    return notSupported<bool>("deleteSnapshot");
+}
+
 Result<std::unique_ptr<Backend>> TargetFactory::createTarget(
         const std::string& backend_name,
         const tl::engine& engine,
@@ -5,13 +5,16 @@
  */
 
 #include "warabi/Provider.hpp"
+#include "AbtIOInstance.hpp"
 #include <bedrock/AbstractComponent.hpp>
+#include <nlohmann/json.hpp>
 
 namespace tl = thallium;
 
 class WarabiComponent : public bedrock::AbstractComponent {
 
-    std::unique_ptr<warabi::Provider> m_provider;
+    std::shared_ptr<warabi::AbtIOInstance> m_abtio;
+    std::unique_ptr<warabi::Provider>      m_provider;
 
     public:
 
@@ -20,8 +23,10 @@ class WarabiComponent : public bedrock::AbstractComponent {
                    const std::string& config,
                    const tl::pool& pool,
                    remi_client_t remi_cl = nullptr,
-                   remi_provider_t remi_pr = nullptr)
-    : m_provider{
+                   remi_provider_t remi_pr = nullptr,
+                   std::shared_ptr<warabi::AbtIOInstance> abtio = nullptr)
+    : m_abtio{std::move(abtio)}
+    , m_provider{
         std::make_unique<warabi::Provider>(
             engine, provider_id, config, pool, remi_cl, remi_pr)}
     {}
@@ -53,9 +58,28 @@ class WarabiComponent : public bedrock::AbstractComponent {
                 auto component = it->second[0]->getHandle<bedrock::ComponentPtr>();
                 remi_receiver = static_cast<remi_provider_t>(component->getHandle());
             }
+            std::shared_ptr<warabi::AbtIOInstance> abtio;
+            auto config = args.config;
+            it = args.dependencies.find("abt_io");
+            if(it != args.dependencies.end() && !it->second.empty()) {
+                auto component = it->second[0]->getHandle<bedrock::ComponentPtr>();
+                auto name = it->second[0]->getName();
+                abtio = warabi::AbtIOInstance::registerExternal(
+                    name, static_cast<abt_io_instance_id>(component->getHandle())).valueOrThrow();
+                // abtio targets that don't specify an abt-io instance use this one
+                auto json_config = config.empty() ? nlohmann::json::object()
+                                                  : nlohmann::json::parse(config);
+                if(json_config.contains("target")
+                && json_config["target"].value("type", "") == "abtio") {
+                    auto& target_config = json_config["target"]["config"];
+                    if(target_config.is_object() && !target_config.contains("abt_io"))
+                        target_config["abt_io"] = name;
+                }
+                config = json_config.dump();
+            }
             return std::make_shared<WarabiComponent>(
-                args.engine, args.provider_id, args.config, pool,
-                remi_sender, remi_receiver);
+                args.engine, args.provider_id, config, pool,
+                remi_sender, remi_receiver, std::move(abtio));
         }
 
     static std::vector<bedrock::Dependency>
@@ -82,6 +106,13 @@ class WarabiComponent : public bedrock::AbstractComponent {
                     /* is_required */ false,
                     /* is_array */ false,
                     /* is_updatable */ false
+                },
+                bedrock::Dependency{
+                    /* name */ "abt_io",
+                    /* type */ "abt_io",
+                    /* is_required */ false,
+                    /* is_array */ false,
+                    /* is_updatable */ false
                 }
             };
             return dependencies;
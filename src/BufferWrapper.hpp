@@ -6,6 +6,8 @@
 #ifndef __WARABI_BUFFER_WRAPPER_H
 #define __WARABI_BUFFER_WRAPPER_H
 
+#include <cstdint>
+
 namespace warabi {
 
 class BufferWrapper {
@@ -87,6 +89,28 @@ class BufferWrapper {
 
 };
 
+/**
+ * @brief Data returned by a read, along with the duration (in
+ * milliseconds) of the lease granted on the region, 0 if none.
+ */
+struct LeasedBuffer {
+
+    uint32_t      lease_ms = 0;
+    BufferWrapper buffer;
+
+    template<typename Archive>
+    void save(Archive& ar) const {
+        ar & lease_ms;
+        ar & buffer;
+    }
+
+    template<typename Archive>
+    void load(Archive& ar) {
+        ar & lease_ms;
+        ar & buffer;
+    }
+};
+
 }
 
 #endif
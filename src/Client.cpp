@@ -12,6 +12,8 @@
 #include "TargetHandleImpl.hpp"
 
 #include <thallium/serialization/stl/string.hpp>
+#include <nlohmann/json.hpp>
+#include <fmt/format.h>
 
 namespace tl = thallium;
 
@@ -59,4 +61,30 @@ std::string Client::getConfig() const {
     return "{}";
 }
 
+void Client::setTracingConfig(const std::string& config) {
+    if(not self) throw Exception("Invalid warabi::Client object");
+    nlohmann::json json_config;
+    try {
+        json_config = nlohmann::json::parse(config);
+    } catch(const std::exception& ex) {
+        throw Exception(fmt::format("Could not parse tracing configuration: {}", ex.what()));
+    }
+    auto config_is_valid = Tracer::validate(json_config);
+    if(!config_is_valid.success())
+        throw Exception(config_is_valid.error());
+    Tracer::instance().configure(json_config);
+    self->m_tracing = true;
+}
+
+void Client::setTransferManagerConfig(
+        const std::string& address,
+        uint16_t provider_id,
+        const std::string& config) const {
+    if(not self) throw Exception("Invalid warabi::Client object");
+    auto endpoint = self->m_engine.lookup(address);
+    auto ph       = tl::provider_handle(endpoint, provider_id);
+    Result<bool> result = self->m_set_transfer_manager.on(ph)(config);
+    result.check();
+}
+
 }
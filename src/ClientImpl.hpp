@@ -6,6 +6,7 @@
 #ifndef __WARABI_CLIENT_IMPL_H
 #define __WARABI_CLIENT_IMPL_H
 
+#include "Tracer.hpp"
 #include <thallium.hpp>
 #include <thallium/serialization/stl/unordered_set.hpp>
 #include <thallium/serialization/stl/unordered_map.hpp>
@@ -29,7 +30,21 @@ class ClientImpl {
     tl::remote_procedure m_create_write_eager;
     tl::remote_procedure m_read;
     tl::remote_procedure m_read_eager;
+    tl::remote_procedure m_read_leased;
+    tl::remote_procedure m_readv;
+    tl::remote_procedure m_readv_eager;
+    tl::remote_procedure m_writev;
+    tl::remote_procedure m_writev_eager;
+    tl::remote_procedure m_advise;
     tl::remote_procedure m_erase;
+    tl::remote_procedure m_pin;
+    tl::remote_procedure m_copy;
+    tl::remote_procedure m_clone;
+    tl::remote_procedure m_create_snapshot;
+    tl::remote_procedure m_restore_snapshot;
+    tl::remote_procedure m_delete_snapshot;
+    tl::remote_procedure m_set_transfer_manager;
+    bool                 m_tracing = false;
 
     ClientImpl(const tl::engine& engine)
     : m_engine(engine)
@@ -41,13 +56,28 @@ class ClientImpl {
     , m_create_write_eager(m_engine.define("warabi_create_write_eager"))
     , m_read(m_engine.define("warabi_read"))
     , m_read_eager(m_engine.define("warabi_read_eager"))
+    , m_read_leased(m_engine.define("warabi_read_leased"))
+    , m_readv(m_engine.define("warabi_readv"))
+    , m_readv_eager(m_engine.define("warabi_readv_eager"))
+    , m_writev(m_engine.define("warabi_writev"))
+    , m_writev_eager(m_engine.define("warabi_writev_eager"))
+    , m_advise(m_engine.define("warabi_advise"))
     , m_erase(m_engine.define("warabi_erase"))
+    , m_pin(m_engine.define("warabi_pin"))
+    , m_copy(m_engine.define("warabi_copy"))
+    , m_clone(m_engine.define("warabi_clone"))
+    , m_create_snapshot(m_engine.define("warabi_create_snapshot"))
+    , m_restore_snapshot(m_engine.define("warabi_restore_snapshot"))
+    , m_delete_snapshot(m_engine.define("warabi_delete_snapshot"))
+    , m_set_transfer_manager(m_engine.define("warabi_set_transfer_manager"))
     {}
 
     ClientImpl(margo_instance_id mid)
     : ClientImpl(tl::engine(mid)) {}
 
-    ~ClientImpl() {}
+    ~ClientImpl() {
+        if(m_tracing) Tracer::instance().flush();
+    }
 };
 
 }
@@ -0,0 +1,324 @@
+/*
+ * (C) 2024 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __WARABI_COPY_ENGINE_HPP
+#define __WARABI_COPY_ENGINE_HPP
+
+#include <warabi/Result.hpp>
+#include <nlohmann/json.hpp>
+#include <nlohmann/json-schema.hpp>
+#include <fmt/format.h>
+#include <thallium.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define WARABI_COPY_ENGINE_X86
+#include <immintrin.h>
+#endif
+
+namespace warabi {
+
+namespace copy_kernels {
+
+/**
+ * @brief Copy fewer than 32 bytes using at most two (overlapping)
+ * loads and stores of the largest fitting width.
+ */
+static inline void copySmall(char* dst, const char* src, size_t n) {
+    if(n >= 16) {
+        uint64_t a[2], b[2];
+        std::memcpy(a, src, 16);
+        std::memcpy(b, src + n - 16, 16);
+        std::memcpy(dst, a, 16);
+        std::memcpy(dst + n - 16, b, 16);
+    } else if(n >= 8) {
+        uint64_t a, b;
+        std::memcpy(&a, src, 8);
+        std::memcpy(&b, src + n - 8, 8);
+        std::memcpy(dst, &a, 8);
+        std::memcpy(dst + n - 8, &b, 8);
+    } else if(n >= 4) {
+        uint32_t a, b;
+        std::memcpy(&a, src, 4);
+        std::memcpy(&b, src + n - 4, 4);
+        std::memcpy(dst, &a, 4);
+        std::memcpy(dst + n - 4, &b, 4);
+    } else {
+        for(size_t i = 0; i < n; ++i) dst[i] = src[i];
+    }
+}
+
+static inline void copyGeneric(char* dst, const char* src, size_t n) {
+    if(n < 32) copySmall(dst, src, n);
+    else std::memcpy(dst, src, n);
+}
+
+#ifdef WARABI_COPY_ENGINE_X86
+
+__attribute__((target("avx2")))
+static inline void copyAVX2(char* dst, const char* src, size_t n) {
+    if(n < 32) {
+        copySmall(dst, src, n);
+        return;
+    }
+    size_t i = 0;
+    for(; i + 128 <= n; i += 128) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(src + i + 32));
+        __m256i c = _mm256_loadu_si256((const __m256i*)(src + i + 64));
+        __m256i d = _mm256_loadu_si256((const __m256i*)(src + i + 96));
+        _mm256_storeu_si256((__m256i*)(dst + i), a);
+        _mm256_storeu_si256((__m256i*)(dst + i + 32), b);
+        _mm256_storeu_si256((__m256i*)(dst + i + 64), c);
+        _mm256_storeu_si256((__m256i*)(dst + i + 96), d);
+    }
+    for(; i + 32 <= n; i += 32) {
+        _mm256_storeu_si256((__m256i*)(dst + i),
+            _mm256_loadu_si256((const __m256i*)(src + i)));
+    }
+    if(i < n) {
+        // last (overlapping) 32 bytes
+        _mm256_storeu_si256((__m256i*)(dst + n - 32),
+            _mm256_loadu_si256((const __m256i*)(src + n - 32)));
+    }
+}
+
+__attribute__((target("avx2")))
+static inline void streamAVX2(char* dst, const char* src, size_t n) {
+    size_t head = std::min(n, (size_t)((32 - ((uintptr_t)dst & 31)) & 31));
+    copySmall(dst, src, head);
+    dst += head; src += head; n -= head;
+    size_t i = 0;
+    for(; i + 128 <= n; i += 128) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(src + i + 32));
+        __m256i c = _mm256_loadu_si256((const __m256i*)(src + i + 64));
+        __m256i d = _mm256_loadu_si256((const __m256i*)(src + i + 96));
+        _mm256_stream_si256((__m256i*)(dst + i), a);
+        _mm256_stream_si256((__m256i*)(dst + i + 32), b);
+        _mm256_stream_si256((__m256i*)(dst + i + 64), c);
+        _mm256_stream_si256((__m256i*)(dst + i + 96), d);
+    }
+    for(; i + 32 <= n; i += 32) {
+        _mm256_stream_si256((__m256i*)(dst + i),
+            _mm256_loadu_si256((const __m256i*)(src + i)));
+    }
+    _mm_sfence();
+    copySmall(dst + i, src + i, n - i);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static inline void copyAVX512(char* dst, const char* src, size_t n) {
+    size_t i = 0;
+    for(; i + 256 <= n; i += 256) {
+        __m512i a = _mm512_loadu_si512((const void*)(src + i));
+        __m512i b = _mm512_loadu_si512((const void*)(src + i + 64));
+        __m512i c = _mm512_loadu_si512((const void*)(src + i + 128));
+        __m512i d = _mm512_loadu_si512((const void*)(src + i + 192));
+        _mm512_storeu_si512((void*)(dst + i), a);
+        _mm512_storeu_si512((void*)(dst + i + 64), b);
+        _mm512_storeu_si512((void*)(dst + i + 128), c);
+        _mm512_storeu_si512((void*)(dst + i + 192), d);
+    }
+    for(; i + 64 <= n; i += 64) {
+        _mm512_storeu_si512((void*)(dst + i),
+            _mm512_loadu_si512((const void*)(src + i)));
+    }
+    if(i < n) {
+        // masked tail, which also handles tiny segments in one load/store
+        __mmask64 mask = (__mmask64)((~0ULL) >> (64 - (n - i)));
+        _mm512_mask_storeu_epi8(dst + i, mask,
+            _mm512_maskz_loadu_epi8(mask, src + i));
+    }
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static inline void streamAVX512(char* dst, const char* src, size_t n) {
+    size_t head = std::min(n, (size_t)((64 - ((uintptr_t)dst & 63)) & 63));
+    copyAVX512(dst, src, head);
+    dst += head; src += head; n -= head;
+    size_t i = 0;
+    for(; i + 64 <= n; i += 64) {
+        _mm512_stream_si512((__m512i*)(dst + i),
+            _mm512_loadu_si512((const void*)(src + i)));
+    }
+    _mm_sfence();
+    copyAVX512(dst + i, src + i, n - i);
+}
+
+#endif
+
+} // namespace copy_kernels
+
+/**
+ * @brief The CopyEngine copies data between contiguous buffers and the
+ * segments of a region. The kernel is selected once at run time from
+ * the features of the CPU (AVX-512, AVX2, or plain memcpy). Copies of
+ * at least "non_temporal_threshold" bytes use non-temporal stores so
+ * that they don't evict useful data from the last-level cache, and
+ * copies of at least "parallel_threshold" bytes are split across
+ * "num_threads" ULTs in the caller's pool.
+ *
+ * Example of configuration (with default values):
+ *
+ * {
+ *     "non_temporal_threshold": 2097152,
+ *     "parallel_threshold": 16777216,
+ *     "num_threads": 1
+ * }
+ *
+ * A threshold of 0 disables the corresponding feature.
+ */
+class CopyEngine {
+
+    using json = nlohmann::json;
+
+    struct Kernels {
+        void (*copy)(char*, const char*, size_t);
+        void (*stream)(char*, const char*, size_t);
+        const char* name;
+    };
+
+    static const Kernels& kernels() {
+        static const Kernels k = []() {
+#ifdef WARABI_COPY_ENGINE_X86
+            __builtin_cpu_init();
+            if(__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+                return Kernels{copy_kernels::copyAVX512, copy_kernels::streamAVX512, "avx512"};
+            if(__builtin_cpu_supports("avx2"))
+                return Kernels{copy_kernels::copyAVX2, copy_kernels::streamAVX2, "avx2"};
+#endif
+            return Kernels{copy_kernels::copyGeneric, copy_kernels::copyGeneric, "generic"};
+        }();
+        return k;
+    }
+
+    size_t m_nt_threshold       = 2*1024*1024;
+    size_t m_parallel_threshold = 16*1024*1024;
+    size_t m_num_threads        = 1;
+
+    public:
+
+    CopyEngine() = default;
+
+    /**
+     * @brief Validate a "copy" configuration object.
+     */
+    static Result<bool> validate(const json& config) {
+        static const json schema = R"(
+        {
+            "type": "object",
+            "properties": {
+                "non_temporal_threshold": {"type": "integer", "minimum": 0},
+                "parallel_threshold": {"type": "integer", "minimum": 0},
+                "num_threads": {"type": "integer", "minimum": 1}
+            }
+        }
+        )"_json;
+        Result<bool> result;
+        nlohmann::json_schema::json_validator validator;
+        validator.set_root_schema(schema);
+        try {
+            validator.validate(config);
+        } catch(const std::exception& ex) {
+            result.success() = false;
+            result.error() = fmt::format(
+                "Error(s) while validating JSON config for warabi copy engine: {}", ex.what());
+        }
+        return result;
+    }
+
+    /**
+     * @brief Configure the CopyEngine (the configuration
+     * is expected to have been validated).
+     */
+    void configure(const json& config) {
+        m_nt_threshold       = config.value("non_temporal_threshold", m_nt_threshold);
+        m_parallel_threshold = config.value("parallel_threshold", m_parallel_threshold);
+        m_num_threads        = config.value("num_threads", m_num_threads);
+    }
+
+    /**
+     * @brief Name of the kernel selected for this CPU.
+     */
+    static const char* kernelName() {
+        return kernels().name;
+    }
+
+    /**
+     * @brief Copy size bytes from src to dst.
+     */
+    void copy(void* dst, const void* src, size_t size) const {
+        auto d = static_cast<char*>(dst);
+        auto s = static_cast<const char*>(src);
+        if(m_num_threads > 1 && m_parallel_threshold && size >= m_parallel_threshold)
+            copyParallel(d, s, size);
+        else
+            copySerial(d, s, size);
+    }
+
+    /**
+     * @brief Copy a contiguous buffer into the segments
+     * (offset, size) of the memory starting at base.
+     */
+    void scatter(char* base,
+                 const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+                 const void* src) const {
+        auto s = static_cast<const char*>(src);
+        for(auto& segment : regionOffsetSizes) {
+            copy(base + segment.first, s, segment.second);
+            s += segment.second;
+        }
+    }
+
+    /**
+     * @brief Copy the segments (offset, size) of the memory
+     * starting at base into a contiguous buffer.
+     */
+    void gather(void* dst,
+                const char* base,
+                const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes) const {
+        auto d = static_cast<char*>(dst);
+        for(auto& segment : regionOffsetSizes) {
+            copy(d, base + segment.first, segment.second);
+            d += segment.second;
+        }
+    }
+
+    private:
+
+    void copySerial(char* dst, const char* src, size_t size) const {
+        if(m_nt_threshold && size >= m_nt_threshold)
+            kernels().stream(dst, src, size);
+        else
+            kernels().copy(dst, src, size);
+    }
+
+    void copyParallel(char* dst, const char* src, size_t size) const {
+        // chunks are multiples of 4 KiB so that only the last one
+        // has a partial page; the calling ULT copies the first chunk
+        size_t chunk = (size / m_num_threads + 4095) & ~(size_t)4095;
+        std::vector<thallium::managed<thallium::thread>> ults;
+        ults.reserve(m_num_threads - 1);
+        auto pool = thallium::thread::self().get_last_pool();
+        for(size_t offset = chunk; offset < size; offset += chunk) {
+            size_t n = std::min(chunk, size - offset);
+            ults.push_back(pool.make_thread([this, dst, src, offset, n]() {
+                copySerial(dst + offset, src + offset, n);
+            }));
+        }
+        copySerial(dst, src, std::min(chunk, size));
+        for(auto& ult : ults) ult->join();
+    }
+};
+
+}
+
+#endif
@@ -4,6 +4,9 @@
  * See COPYRIGHT in top-level directory.
  */
 #include "warabi/TransferManager.hpp"
+#include "Tracer.hpp"
+#include "Probes.hpp"
+#include <numeric>
 
 namespace warabi {
 
@@ -29,6 +32,9 @@ class DefaultTransferManager : public TransferManager {
             thallium::endpoint address,
             size_t bulkOffset,
             bool persist) override {
+        Tracer::Span span{"transfer", "rdma_pull"};
+        probe::Scope probe_scope{probe::Kind::Transfer, "pull",
+            totalSize(regionOffsetSizes), regionOffsetSizes.size()};
         return region.write(regionOffsetSizes, data, address, bulkOffset, persist);
     }
 
@@ -38,9 +44,17 @@ class DefaultTransferManager : public TransferManager {
             thallium::bulk data,
             thallium::endpoint address,
             size_t bulkOffset) override {
+        Tracer::Span span{"transfer", "rdma_push"};
+        probe::Scope probe_scope{probe::Kind::Transfer, "push",
+            totalSize(regionOffsetSizes), regionOffsetSizes.size()};
         return region.read(regionOffsetSizes, data, address, bulkOffset);
     }
 
+    static size_t totalSize(const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes) {
+        return std::accumulate(regionOffsetSizes.begin(), regionOffsetSizes.end(), (size_t)0,
+                [](size_t acc, const std::pair<size_t, size_t>& p) { return acc + p.second; });
+    }
+
     using json = nlohmann::json;
 
     static Result<std::unique_ptr<TransferManager>> create(
@@ -0,0 +1,171 @@
+/*
+ * (C) 2024 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __WARABI_EVICTION_POLICY_HPP
+#define __WARABI_EVICTION_POLICY_HPP
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace warabi {
+
+/**
+ * @brief An EvictionPolicy tracks the resident regions of a target,
+ * identified by their index, and selects which one to evict when the
+ * target needs room. It is not thread-safe: the target calls it with
+ * its own lock held. Regions that can't be evicted (e.g. pinned ones)
+ * are skipped through the predicate passed to victim().
+ */
+class EvictionPolicy {
+
+    public:
+
+    virtual ~EvictionPolicy() = default;
+
+    /**
+     * @brief Name of the policy ("lru" or "clock").
+     */
+    virtual const char* name() const = 0;
+
+    /**
+     * @brief Start tracking a newly resident region.
+     */
+    virtual void insert(size_t index) = 0;
+
+    /**
+     * @brief Record an access to a resident region.
+     */
+    virtual void touch(size_t index) = 0;
+
+    /**
+     * @brief Stop tracking a region (evicted or erased).
+     */
+    virtual void remove(size_t index) = 0;
+
+    /**
+     * @brief Select the region to evict among the tracked regions for
+     * which evictable(index) is true. Returns false if there is none.
+     * The selected region is still tracked until remove() is called.
+     */
+    virtual bool victim(const std::function<bool(size_t)>& evictable, size_t& index) = 0;
+
+    /**
+     * @brief Create a policy from its name, or return
+     * nullptr if the name is not known.
+     */
+    static std::unique_ptr<EvictionPolicy> create(const std::string& name);
+};
+
+/**
+ * @brief Least-recently-used policy: every access moves
+ * the region to the front of a list, victims are taken
+ * from the back.
+ */
+class LRUPolicy final : public EvictionPolicy {
+
+    using List = std::list<size_t>;
+
+    List                        m_list;
+    std::vector<List::iterator> m_positions;
+
+    public:
+
+    const char* name() const override {
+        return "lru";
+    }
+
+    void insert(size_t index) override {
+        if(index >= m_positions.size())
+            m_positions.resize(index + 1, m_list.end());
+        if(m_positions[index] != m_list.end()) return;
+        m_positions[index] = m_list.insert(m_list.begin(), index);
+    }
+
+    void touch(size_t index) override {
+        if(index >= m_positions.size() || m_positions[index] == m_list.end()) return;
+        m_list.splice(m_list.begin(), m_list, m_positions[index]);
+    }
+
+    void remove(size_t index) override {
+        if(index >= m_positions.size() || m_positions[index] == m_list.end()) return;
+        m_list.erase(m_positions[index]);
+        m_positions[index] = m_list.end();
+    }
+
+    bool victim(const std::function<bool(size_t)>& evictable, size_t& index) override {
+        for(auto it = m_list.rbegin(); it != m_list.rend(); ++it) {
+            if(!evictable(*it)) continue;
+            index = *it;
+            return true;
+        }
+        return false;
+    }
+};
+
+/**
+ * @brief CLOCK policy: an access only sets a reference bit, which
+ * is cheaper than moving the region in a list. The hand sweeps the
+ * regions, clearing reference bits, and stops on the first evictable
+ * region whose bit is already clear.
+ */
+class ClockPolicy final : public EvictionPolicy {
+
+    enum State : uint8_t { Absent, Resident, Referenced };
+
+    std::vector<State> m_states;
+    size_t             m_hand = 0;
+
+    public:
+
+    const char* name() const override {
+        return "clock";
+    }
+
+    void insert(size_t index) override {
+        if(index >= m_states.size())
+            m_states.resize(index + 1, Absent);
+        m_states[index] = Referenced;
+    }
+
+    void touch(size_t index) override {
+        if(index < m_states.size() && m_states[index] != Absent)
+            m_states[index] = Referenced;
+    }
+
+    void remove(size_t index) override {
+        if(index < m_states.size())
+            m_states[index] = Absent;
+    }
+
+    bool victim(const std::function<bool(size_t)>& evictable, size_t& index) override {
+        // two sweeps: the first may only clear reference bits
+        for(size_t step = 0; step < 2*m_states.size(); ++step) {
+            if(m_hand >= m_states.size()) m_hand = 0;
+            size_t i = m_hand++;
+            if(m_states[i] == Absent || !evictable(i)) continue;
+            if(m_states[i] == Referenced) {
+                m_states[i] = Resident;
+                continue;
+            }
+            index = i;
+            return true;
+        }
+        return false;
+    }
+};
+
+inline std::unique_ptr<EvictionPolicy> EvictionPolicy::create(const std::string& name) {
+    if(name == "lru")   return std::make_unique<LRUPolicy>();
+    if(name == "clock") return std::make_unique<ClockPolicy>();
+    return nullptr;
+}
+
+}
+
+#endif
@@ -0,0 +1,277 @@
+/*
+ * (C) 2024 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __WARABI_LEASE_MANAGER_HPP
+#define __WARABI_LEASE_MANAGER_HPP
+
+#include <warabi/Result.hpp>
+#include <warabi/RegionID.hpp>
+#include "Tracer.hpp"
+#include <nlohmann/json.hpp>
+#include <nlohmann/json-schema.hpp>
+#include <fmt/format.h>
+#include <thallium.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace warabi {
+
+/**
+ * @brief The LeaseManager grants read leases on regions to clients that
+ * cache what they read. A lease is a promise that the content of the
+ * region won't change for "duration_ms" milliseconds: an operation that
+ * modifies a region (write, erase) first waits for the leases on that
+ * region to expire, and no new lease is granted on a region while such
+ * an operation is pending. Clients start counting the duration of the
+ * lease before sending their request, so their copy always expires
+ * before the lease does on the provider.
+ *
+ * Leases are disabled unless the provider is configured with a
+ * "leases" object. Example of configuration:
+ *
+ * {
+ *     "duration_ms": 100
+ * }
+ *
+ * A longer duration makes client caches more effective but can delay
+ * writes to leased regions by up to that duration.
+ */
+class LeaseManager {
+
+    using json  = nlohmann::json;
+    using Clock = std::chrono::steady_clock;
+
+    struct RegionIDHash {
+        size_t operator()(const RegionID& id) const {
+            uint64_t a, b;
+            std::memcpy(&a, id.data(), 8);
+            std::memcpy(&b, id.data() + 8, 8);
+            return std::hash<uint64_t>{}(a ^ (b * 0x9e3779b97f4a7c15ULL));
+        }
+    };
+
+    struct Lease {
+        int64_t  expiry  = 0; // in ms of the steady clock
+        uint32_t writers = 0; // pending operations modifying the region
+    };
+
+    public:
+
+    /**
+     * @brief RAII object returned by acquireWrite() and acquireExclusive().
+     * Prevents new leases on its regions (or on all the regions) until it
+     * is destroyed.
+     */
+    class WriteGuard {
+
+        friend class LeaseManager;
+
+        LeaseManager*         m_owner = nullptr;
+        std::vector<RegionID> m_regions;
+        bool                  m_exclusive = false;
+
+        WriteGuard(LeaseManager* owner, std::vector<RegionID>&& regions, bool exclusive)
+        : m_owner(owner)
+        , m_regions(std::move(regions))
+        , m_exclusive(exclusive) {}
+
+        public:
+
+        WriteGuard() = default;
+
+        WriteGuard(const WriteGuard&) = delete;
+
+        WriteGuard(WriteGuard&& other)
+        : m_owner(other.m_owner)
+        , m_regions(std::move(other.m_regions))
+        , m_exclusive(other.m_exclusive) {
+            other.m_owner = nullptr;
+        }
+
+        WriteGuard& operator=(const WriteGuard&) = delete;
+        WriteGuard& operator=(WriteGuard&&) = delete;
+
+        ~WriteGuard() {
+            if(m_owner) m_owner->releaseWrite(m_regions, m_exclusive);
+        }
+    };
+
+    LeaseManager(const thallium::engine& engine)
+    : m_engine(engine) {}
+
+    LeaseManager(const LeaseManager&) = delete;
+    LeaseManager& operator=(const LeaseManager&) = delete;
+
+    /**
+     * @brief Validate a "leases" configuration object.
+     */
+    static Result<bool> validate(const json& config) {
+        static const json schema = R"(
+        {
+            "type": "object",
+            "properties": {
+                "duration_ms": {"type": "integer", "minimum": 0}
+            }
+        }
+        )"_json;
+        Result<bool> result;
+        nlohmann::json_schema::json_validator validator;
+        validator.set_root_schema(schema);
+        try {
+            validator.validate(config);
+        } catch(const std::exception& ex) {
+            result.success() = false;
+            result.error() = fmt::format(
+                "Error(s) while validating JSON config for warabi leases: {}", ex.what());
+        }
+        return result;
+    }
+
+    /**
+     * @brief Configure the LeaseManager (the configuration
+     * is expected to have been validated).
+     */
+    void configure(const json& config) {
+        m_duration = config.value("duration_ms", (uint32_t)100);
+        m_config   = config;
+        m_enabled  = m_duration > 0;
+    }
+
+    /**
+     * @brief Return the configuration (null if never configured).
+     */
+    const json& getConfig() const {
+        return m_config;
+    }
+
+    /**
+     * @brief Grant a lease on a region. Returns its duration in
+     * milliseconds, or 0 if no lease could be granted.
+     */
+    uint32_t grant(const RegionID& region) {
+        if(!m_enabled) return 0;
+        auto now = nowMs();
+        std::unique_lock<thallium::mutex> lock{m_mutex};
+        if(m_exclusive) return 0;
+        if(m_leases.size() >= m_purge_threshold) purge(now);
+        auto& lease = m_leases[region];
+        if(lease.writers) return 0;
+        lease.expiry = std::max(lease.expiry, now + m_duration);
+        m_max_expiry = std::max(m_max_expiry, lease.expiry);
+        m_granted.fetch_add(1, std::memory_order_relaxed);
+        return m_duration;
+    }
+
+    /**
+     * @brief Called before modifying the given regions: waits for their
+     * leases to expire. The returned guard must be kept until the
+     * modification is done.
+     */
+    WriteGuard acquireWrite(std::vector<RegionID> regions) {
+        if(!m_enabled) return WriteGuard{};
+        int64_t expiry = 0;
+        {
+            std::unique_lock<thallium::mutex> lock{m_mutex};
+            for(auto& region : regions) {
+                auto& lease = m_leases[region];
+                lease.writers += 1;
+                expiry = std::max(expiry, lease.expiry);
+            }
+        }
+        waitUntil(expiry);
+        return WriteGuard{this, std::move(regions), false};
+    }
+
+    WriteGuard acquireWrite(const RegionID& region) {
+        return acquireWrite(std::vector<RegionID>{region});
+    }
+
+    /**
+     * @brief Called before modifying the whole target (e.g. restoring
+     * a snapshot): waits for all the leases to expire.
+     */
+    WriteGuard acquireExclusive() {
+        if(!m_enabled) return WriteGuard{};
+        int64_t expiry = 0;
+        {
+            std::unique_lock<thallium::mutex> lock{m_mutex};
+            m_exclusive += 1;
+            expiry = m_max_expiry;
+        }
+        waitUntil(expiry);
+        return WriteGuard{this, {}, true};
+    }
+
+    /**
+     * @brief Return statistics as a JSON object.
+     */
+    json getStats() const {
+        auto stats = json::object();
+        stats["granted"]        = m_granted.load();
+        stats["delayed_writes"] = m_delayed_writes.load();
+        return stats;
+    }
+
+    private:
+
+    static int64_t nowMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            Clock::now().time_since_epoch()).count();
+    }
+
+    void waitUntil(int64_t expiry) {
+        auto now = nowMs();
+        if(expiry <= now) return;
+        m_delayed_writes.fetch_add(1, std::memory_order_relaxed);
+        Tracer::Span span{"provider", "lease_wait"};
+        // round up, the lease may expire during the current millisecond
+        thallium::thread::sleep(m_engine, expiry - now + 1);
+    }
+
+    void releaseWrite(const std::vector<RegionID>& regions, bool exclusive) {
+        auto now = nowMs();
+        std::unique_lock<thallium::mutex> lock{m_mutex};
+        if(exclusive) m_exclusive -= 1;
+        for(auto& region : regions) {
+            auto it = m_leases.find(region);
+            if(it == m_leases.end()) continue;
+            it->second.writers -= 1;
+            if(it->second.writers == 0 && it->second.expiry <= now)
+                m_leases.erase(it);
+        }
+    }
+
+    void purge(int64_t now) {
+        for(auto it = m_leases.begin(); it != m_leases.end();) {
+            if(it->second.writers == 0 && it->second.expiry <= now)
+                it = m_leases.erase(it);
+            else
+                ++it;
+        }
+        m_purge_threshold = std::max<size_t>(1024, 2*m_leases.size());
+    }
+
+    thallium::engine                                     m_engine;
+    json                                                 m_config;
+    std::atomic<bool>                                    m_enabled{false};
+    uint32_t                                             m_duration = 100;
+    thallium::mutex                                      m_mutex;
+    std::unordered_map<RegionID, Lease, RegionIDHash>    m_leases;
+    size_t                                               m_purge_threshold = 1024;
+    int64_t                                              m_max_expiry = 0;
+    uint32_t                                             m_exclusive = 0;
+    std::atomic<size_t>                                  m_granted{0};
+    std::atomic<size_t>                                  m_delayed_writes{0};
+};
+
+}
+
+#endif
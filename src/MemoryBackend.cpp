@@ -4,44 +4,72 @@
  * See COPYRIGHT in top-level directory.
  */
 #include "MemoryBackend.hpp"
+#include <warabi/TransferManager.hpp>
+#include <nlohmann/json-schema.hpp>
+#include <fmt/format.h>
+#include <algorithm>
 #include <iostream>
 
 namespace warabi {
 
+using nlohmann::json_schema::json_validator;
+
 WARABI_REGISTER_BACKEND(memory, MemoryTarget);
 
-struct MemoryRegion : public WritableRegion, public ReadableRegion {
+/**
+ * @brief Call f(pointer, size) on each piece of the segments of a
+ * region, split at extent boundaries. Returns false if a segment is
+ * out of the region's bounds.
+ */
+template<typename Function>
+static bool forEachExtent(
+        MemoryTarget::Slot& slot, size_t extentSize,
+        const MemoryTarget::Segments& regionOffsetSizes, Function&& f) {
+    for(auto& segment : regionOffsetSizes) {
+        if(segment.first + segment.second > slot.size) return false;
+    }
+    for(auto& segment : regionOffsetSizes) {
+        size_t offset = segment.first, remaining = segment.second;
+        while(remaining) {
+            size_t within = offset % extentSize;
+            size_t n = std::min(remaining, extentSize - within);
+            f(slot.extents[offset / extentSize]->data() + within, n);
+            offset += n;
+            remaining -= n;
+        }
+    }
+    return true;
+}
 
-    MemoryRegion(
+/**
+ * @brief Transfer functions shared by MemoryRegion and MemoryRegionSet,
+ * which provide forEachPiece(regionOffsetSizes, f) to call f(pointer, size)
+ * on the memory backing the segments.
+ */
+template<typename Derived>
+struct MemoryRegionBase : public WritableRegion, public ReadableRegion {
+
+    MemoryRegionBase(
             thallium::engine engine,
-            RegionID id,
-            std::vector<char>& region,
-            std::unique_lock<thallium::mutex>&& lock)
+            std::unique_lock<thallium::mutex>&& lock,
+            const CopyEngine& copyEngine)
     : m_engine(std::move(engine))
-    , m_id(std::move(id))
-    , m_region(region)
-    , m_lock(std::move(lock)) {}
+    , m_lock(std::move(lock))
+    , m_copy_engine(copyEngine) {}
 
     thallium::engine                  m_engine;
-    RegionID                          m_id;
-    std::vector<char>&                m_region;
     std::unique_lock<thallium::mutex> m_lock;
+    const CopyEngine&                 m_copy_engine;
 
-    std::vector<std::pair<void*, size_t>> convertToSegments(
-        const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes) {
-        std::vector<std::pair<void*, size_t>> segments;
-        segments.reserve(regionOffsetSizes.size());
-        for(size_t i=0; i < regionOffsetSizes.size(); ++i) {
-            if(regionOffsetSizes[i].second == 0) continue;
-            segments.push_back({m_region.data() + regionOffsetSizes[i].first,
-                                regionOffsetSizes[i].second});
-        }
-        return segments;
+    template<typename Function>
+    bool forEachPiece(const MemoryTarget::Segments& regionOffsetSizes, Function&& f) {
+        return static_cast<Derived*>(this)->forEachPiece(regionOffsetSizes, std::forward<Function>(f));
     }
 
-    Result<RegionID> getRegionID() override {
-        Result<RegionID> result;
-        result.value() = m_id;
+    static Result<bool> outOfBounds() {
+        Result<bool> result;
+        result.success() = false;
+        result.error() = "Segment out of the region's bounds";
         return result;
     }
 
@@ -53,11 +81,13 @@ struct MemoryRegion : public WritableRegion, public ReadableRegion {
             bool persist) override {
         (void)persist;
         Result<bool> result;
-        auto segments = convertToSegments(regionOffsetSizes);
+        std::vector<std::pair<void*, size_t>> segments;
+        size_t totalSize = 0;
+        if(!forEachPiece(regionOffsetSizes, [&](char* ptr, size_t n) {
+            segments.push_back({ptr, n});
+            totalSize += n;
+        })) return outOfBounds();
         if(segments.size() == 0) return result;
-        size_t totalSize = std::accumulate(
-            segments.begin(), segments.end(), (size_t)0,
-            [](size_t acc, const auto& pair) { return acc + pair.second; });
         auto localBulk = m_engine.expose(segments, thallium::bulk_mode::write_only);
         localBulk << remoteBulk.on(address)(remoteBulkOffset, totalSize);
         return result;
@@ -67,15 +97,12 @@ struct MemoryRegion : public WritableRegion, public ReadableRegion {
             const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
             const void* data, bool persist) override {
         (void)persist;
-        Result<bool> result;
-        auto segments = convertToSegments(regionOffsetSizes);
-        size_t offset = 0;
-        const char* ptr = (const char*)data;
-        for(auto& segment : segments) {
-            std::memcpy(segment.first, ptr + offset, segment.second);
-            offset += segment.second;
-        }
-        return result;
+        auto src = static_cast<const char*>(data);
+        if(!forEachPiece(regionOffsetSizes, [&](char* ptr, size_t n) {
+            m_copy_engine.copy(ptr, src, n);
+            src += n;
+        })) return outOfBounds();
+        return Result<bool>{};
     }
 
     Result<bool> persist(
@@ -90,11 +117,13 @@ struct MemoryRegion : public WritableRegion, public ReadableRegion {
             const thallium::endpoint& address,
             size_t remoteBulkOffset) override {
         Result<bool> result;
-        auto segments = convertToSegments(regionOffsetSizes);
+        std::vector<std::pair<void*, size_t>> segments;
+        size_t totalSize = 0;
+        if(!forEachPiece(regionOffsetSizes, [&](char* ptr, size_t n) {
+            segments.push_back({ptr, n});
+            totalSize += n;
+        })) return outOfBounds();
         if(segments.size() == 0) return result;
-        size_t totalSize = std::accumulate(
-            segments.begin(), segments.end(), (size_t)0,
-            [](size_t acc, const auto& pair) { return acc + pair.second; });
         auto localBulk = m_engine.expose(segments, thallium::bulk_mode::read_only);
         localBulk >> remoteBulk.on(address)(remoteBulkOffset, totalSize);
         return result;
@@ -103,27 +132,158 @@ struct MemoryRegion : public WritableRegion, public ReadableRegion {
     Result<bool> read(
             const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
             void* data) override {
-        Result<bool> result;
-        auto segments = convertToSegments(regionOffsetSizes);
-        if(segments.size() == 0) return result;
-        size_t offset = 0;
-        char* ptr = (char*)data;
-        for(auto& segment : segments) {
-            std::memcpy(ptr + offset, segment.first, segment.second);
-            offset += segment.second;
+        auto dst = static_cast<char*>(data);
+        if(!forEachPiece(regionOffsetSizes, [&](char* ptr, size_t n) {
+            m_copy_engine.copy(dst, ptr, n);
+            dst += n;
+        })) return outOfBounds();
+        return Result<bool>{};
+    }
+};
+
+struct MemoryRegion final : public MemoryRegionBase<MemoryRegion> {
+
+    MemoryRegion(
+            thallium::engine engine,
+            RegionID id,
+            MemoryTarget::Slot& slot,
+            size_t extentSize,
+            std::unique_lock<thallium::mutex>&& lock,
+            const CopyEngine& copyEngine)
+    : MemoryRegionBase(std::move(engine), std::move(lock), copyEngine)
+    , m_id(std::move(id))
+    , m_slot(slot)
+    , m_extent_size(extentSize) {}
+
+    RegionID            m_id;
+    MemoryTarget::Slot& m_slot;
+    size_t              m_extent_size;
+
+    template<typename Function>
+    bool forEachPiece(const MemoryTarget::Segments& regionOffsetSizes, Function&& f) {
+        return forEachExtent(m_slot, m_extent_size, regionOffsetSizes, std::forward<Function>(f));
+    }
+
+    Result<RegionID> getRegionID() override {
+        Result<RegionID> result;
+        result.value() = m_id;
+        return result;
+    }
+};
+
+/**
+ * @brief Segments of several regions presented as a single region, whose
+ * offsets are those of the concatenation of the segments, so that the
+ * TransferManager moves all of them at once (in a single RDMA operation
+ * for the default TransferManager).
+ */
+struct MemoryRegionSet final : public MemoryRegionBase<MemoryRegionSet> {
+
+    MemoryRegionSet(
+            thallium::engine engine,
+            std::vector<std::pair<char*, size_t>>&& pieces,
+            std::unique_lock<thallium::mutex>&& lock,
+            const CopyEngine& copyEngine)
+    : MemoryRegionBase(std::move(engine), std::move(lock), copyEngine)
+    , m_pieces(std::move(pieces)) {
+        m_offsets.reserve(m_pieces.size());
+        for(auto& piece : m_pieces) {
+            m_offsets.push_back(m_size);
+            m_size += piece.second;
+        }
+    }
+
+    std::vector<std::pair<char*, size_t>> m_pieces;
+    std::vector<size_t>                   m_offsets; // offset of each piece
+    size_t                                m_size = 0;
+
+    size_t size() const {
+        return m_size;
+    }
+
+    template<typename Function>
+    bool forEachPiece(const MemoryTarget::Segments& regionOffsetSizes, Function&& f) {
+        for(auto& segment : regionOffsetSizes) {
+            if(segment.first + segment.second > m_size) return false;
+        }
+        for(auto& segment : regionOffsetSizes) {
+            size_t offset = segment.first, remaining = segment.second;
+            if(!remaining) continue;
+            size_t i = std::upper_bound(m_offsets.begin(), m_offsets.end(), offset)
+                     - m_offsets.begin() - 1;
+            for(; remaining; ++i) {
+                size_t within = offset - m_offsets[i];
+                size_t n = std::min(remaining, m_pieces[i].second - within);
+                f(m_pieces[i].first + within, n);
+                offset += n;
+                remaining -= n;
+            }
         }
+        return true;
+    }
+
+    Result<RegionID> getRegionID() override {
+        Result<RegionID> result;
+        result.success() = false;
+        result.error() = "A MemoryRegionSet doesn't have a RegionID";
         return result;
     }
 };
 
 MemoryTarget::MemoryTarget(thallium::engine engine, const json& config)
 : m_engine(std::move(engine))
-, m_config(config) {}
+, m_config(config) {
+    m_copy_engine.configure(config.value("copy", json::object()));
+    m_page_policy = std::make_shared<PagePolicy>();
+    m_page_policy->node           = config.value("numa_node", -1);
+    m_page_policy->huge_page_size = config.value("huge_page_size", (size_t)0);
+    m_page_policy->hugetlbfs_path = config.value("hugetlbfs_path", "");
+    m_allocator = PageAllocator<char>{m_page_policy};
+    m_capacity = config.value("capacity", (size_t)0);
+    if(m_capacity)
+        m_eviction = EvictionPolicy::create(config.value("eviction", "lru"));
+    m_extent_size = config.value("extent_size",
+        std::max<size_t>(4*1024*1024, m_page_policy->huge_page_size));
+}
+
+static RegionID makeRegionID(uint64_t index, uint64_t size) {
+    RegionID region_id;
+    std::memcpy(region_id.data(), static_cast<void*>(&index), sizeof(index));
+    std::memcpy(region_id.data() + sizeof(index), static_cast<void*>(&size), sizeof(size));
+    return region_id;
+}
 
 std::string MemoryTarget::getConfig() const {
     return m_config.dump();
 }
 
+std::string MemoryTarget::getStats() const {
+    auto stats = json::object();
+    stats["numa_node"] = m_page_policy->node;
+    stats["huge_page_size"] = m_page_policy->huge_page_size;
+    stats["huge_page_allocations"] = m_page_policy->huge_page_allocations.load();
+    stats["huge_page_fallbacks"] = m_page_policy->fallback_allocations.load();
+    auto& regions_per_node = stats["regions_per_node"] = json::object();
+    auto lock = std::unique_lock<thallium::mutex>{m_mutex};
+    size_t evicted = 0, pinned = 0;
+    for(auto& region : m_regions) {
+        if(region.state == Slot::State::Evicted) ++evicted;
+        if(region.pins) ++pinned;
+        if(region.extents.empty()) continue;
+        auto node = std::to_string(numa::nodeOfAddress(region.extents.front()->data()));
+        regions_per_node[node] = regions_per_node.value(node, 0) + 1;
+    }
+    stats["capacity"] = m_capacity;
+    stats["used_bytes"] = m_used;
+    stats["eviction"] = m_eviction ? m_eviction->name() : "none";
+    stats["evictions"] = m_evictions;
+    stats["evicted_regions"] = evicted;
+    stats["pinned_regions"] = pinned;
+    stats["extent_size"] = m_extent_size;
+    stats["snapshots"] = m_snapshots.size();
+    return stats.dump();
+}
+
 Result<bool> MemoryTarget::destroy() {
     Result<bool> result;
     result.value() = true;
@@ -133,14 +293,26 @@ Result<bool> MemoryTarget::destroy() {
 Result<std::unique_ptr<WritableRegion>> MemoryTarget::create(size_t size) {
     Result<std::unique_ptr<WritableRegion>> result;
     auto lock = std::unique_lock<thallium::mutex>{m_mutex};
-    m_regions.emplace_back(size);
-    auto& region = m_regions.back();
+    auto room = makeRoom(size);
+    if(!room.success()) {
+        result.success() = false;
+        result.error() = room.error();
+        return result;
+    }
+    Slot slot;
+    slot.size = size;
+    slot.extents.reserve((size + m_extent_size - 1) / m_extent_size);
+    for(size_t offset = 0; offset < size; offset += m_extent_size) {
+        slot.extents.push_back(std::make_shared<Buffer>(
+            std::min(m_extent_size, size - offset), m_allocator));
+    }
+    m_regions.push_back(std::move(slot));
     uint64_t index = m_regions.size() - 1;
-    RegionID region_id;
-    uint64_t s = size;
-    std::memcpy(region_id.data(), static_cast<void*>(&index), sizeof(index));
-    std::memcpy(region_id.data() + sizeof(index), static_cast<void*>(&s), sizeof(s));
-    result.value() = std::make_unique<MemoryRegion>(m_engine, region_id, region, std::move(lock));
+    m_used += size;
+    if(m_eviction) m_eviction->insert(index);
+    result.value() = std::make_unique<MemoryRegion>(
+        m_engine, makeRegionID(index, size), m_regions.back(),
+        m_extent_size, std::move(lock), m_copy_engine);
     return result;
 }
 
@@ -150,6 +322,131 @@ ssize_t MemoryTarget::regiondIDtoIndex(const RegionID& regionID) {
     return static_cast<ssize_t>(r);
 }
 
+template<typename ResultType>
+bool MemoryTarget::checkAccess(ssize_t index, ResultType& result) {
+    if(index >= (ssize_t)m_regions.size()) {
+        result.error() = "Invalid RegionID information";
+        result.success() = false;
+        return false;
+    }
+    switch(m_regions[index].state) {
+    case Slot::State::Evicted:
+        result.error() = "Region has been evicted";
+        result.evicted() = true;
+        result.success() = false;
+        return false;
+    case Slot::State::Erased:
+        result.error() = "Region has been erased";
+        result.success() = false;
+        return false;
+    default:
+        if(m_eviction) m_eviction->touch(index);
+        return true;
+    }
+}
+
+static size_t releasableBytes(const MemoryTarget::Slot& slot) {
+    size_t size = 0;
+    for(auto& extent : slot.extents)
+        if(extent.use_count() == 1) size += extent->size();
+    return size;
+}
+
+Result<bool> MemoryTarget::makeRoom(size_t size, const std::vector<size_t>& keep) {
+    Result<bool> result;
+    if(!m_capacity) return result;
+    if(size > m_capacity) {
+        result.error() = fmt::format(
+            "Region size ({}) exceeds the target's capacity ({})", size, m_capacity);
+        result.success() = false;
+        return result;
+    }
+    auto kept = [&keep](size_t index) {
+        return std::find(keep.begin(), keep.end(), index) != keep.end();
+    };
+    // evicting a region whose extents are all shared with clones
+    // or snapshots would lose it without freeing anything
+    auto evictable = [&](size_t index) {
+        auto& slot = m_regions[index];
+        return slot.pins == 0 && !kept(index) && releasableBytes(slot) != 0;
+    };
+    while(m_used + size > m_capacity) {
+        size_t victim;
+        if(!m_eviction->victim(evictable, victim)) {
+            size_t held = 0;
+            for(size_t index = 0; index < m_regions.size(); ++index) {
+                if(m_regions[index].pins || kept(index))
+                    held += releasableBytes(m_regions[index]);
+            }
+            result.error() = fmt::format(
+                "Target is full: {} of its {} used bytes are held by pinned or "
+                "in-use regions, the rest by extents shared with clones or snapshots",
+                held, m_used);
+            result.success() = false;
+            return result;
+        }
+        release(victim, Slot::State::Evicted);
+        m_evictions += 1;
+    }
+    return result;
+}
+
+void MemoryTarget::dropExtents(Slot& slot) {
+    for(auto& extent : slot.extents) {
+        // extents still referenced by clones or snapshots stay allocated
+        if(extent.use_count() == 1) m_used -= extent->size();
+    }
+    slot.extents.clear();
+    slot.extents.shrink_to_fit();
+}
+
+Result<bool> MemoryTarget::unshare(size_t index, const Segments* segments,
+                                   const std::vector<size_t>& keep) {
+    Result<bool> result;
+    auto& slot = m_regions[index];
+    std::vector<size_t> shared;
+    auto addExtent = [&](size_t i) {
+        if(slot.extents[i].use_count() > 1) shared.push_back(i);
+    };
+    if(!segments) {
+        for(size_t i = 0; i < slot.extents.size(); ++i) addExtent(i);
+    } else {
+        for(auto& segment : *segments) {
+            if(segment.second == 0) continue;
+            size_t first = segment.first / m_extent_size;
+            size_t last  = std::min((segment.first + segment.second - 1) / m_extent_size,
+                                    slot.extents.size() - 1);
+            for(size_t i = first; i <= last && i < slot.extents.size(); ++i) addExtent(i);
+        }
+        std::sort(shared.begin(), shared.end());
+        shared.erase(std::unique(shared.begin(), shared.end()), shared.end());
+    }
+    if(shared.empty()) return result;
+    // the copies count against the capacity like new regions
+    size_t size = 0;
+    for(auto i : shared) size += slot.extents[i]->size();
+    result = makeRoom(size, keep);
+    if(!result.success()) return result;
+    for(auto i : shared) {
+        auto& extent = slot.extents[i];
+        // evicting a clone may have left this region as the only owner
+        if(extent.use_count() == 1) continue;
+        auto copy = std::make_shared<Buffer>(extent->size(), m_allocator);
+        m_copy_engine.copy(copy->data(), extent->data(), extent->size());
+        m_used += copy->size();
+        extent = std::move(copy);
+    }
+    return result;
+}
+
+void MemoryTarget::release(size_t index, Slot::State state) {
+    auto& slot = m_regions[index];
+    dropExtents(slot);
+    slot.state = state;
+    slot.pins  = 0;
+    if(m_eviction) m_eviction->remove(index);
+}
+
 Result<std::unique_ptr<WritableRegion>> MemoryTarget::write(const RegionID& region_id, bool persist) {
     (void)persist;
     Result<std::unique_ptr<WritableRegion>> result;
@@ -160,12 +457,16 @@ Result<std::unique_ptr<WritableRegion>> MemoryTarget::write(const RegionID& regi
         return result;
     }
     auto lock = std::unique_lock<thallium::mutex>{m_mutex};
-    if(index >= (ssize_t)m_regions.size()) {
-        result.error() = "Invalid RegionID information";
+    if(!checkAccess(index, result)) return result;
+    // the segments that will be written are not known yet
+    auto unshared = unshare(index, nullptr, {(size_t)index});
+    if(!unshared.success()) {
+        result.error() = unshared.error();
         result.success() = false;
         return result;
     }
-    result.value() = std::make_unique<MemoryRegion>(m_engine, region_id, m_regions[index], std::move(lock));
+    result.value() = std::make_unique<MemoryRegion>(
+        m_engine, region_id, m_regions[index], m_extent_size, std::move(lock), m_copy_engine);
     return result;
 }
 
@@ -178,12 +479,173 @@ Result<std::unique_ptr<ReadableRegion>> MemoryTarget::read(const RegionID& regio
         return result;
     }
     auto lock = std::unique_lock<thallium::mutex>{m_mutex};
-    if(index >= (ssize_t)m_regions.size()) {
+    if(!checkAccess(index, result)) return result;
+    result.value() = std::make_unique<MemoryRegion>(
+        m_engine, region_id, m_regions[index], m_extent_size, std::move(lock), m_copy_engine);
+    return result;
+}
+
+template<typename Function>
+Result<bool> MemoryTarget::accessRegion(const RegionID& region_id, const Segments* written,
+                                        Function&& function) {
+    Result<bool> result;
+    auto index = regiondIDtoIndex(region_id);
+    if(index < 0) {
         result.error() = "Invalid RegionID information";
         result.success() = false;
         return result;
     }
-    result.value() = std::make_unique<MemoryRegion>(m_engine, region_id, m_regions[index], std::move(lock));
+    auto lock = std::unique_lock<thallium::mutex>{m_mutex};
+    if(!checkAccess(index, result)) return result;
+    if(written) {
+        auto unshared = unshare(index, written, {(size_t)index});
+        if(!unshared.success()) return unshared;
+    }
+    MemoryRegion region{m_engine, region_id, m_regions[index], m_extent_size, std::move(lock), m_copy_engine};
+    return function(region);
+}
+
+Result<bool> MemoryTarget::writeSegments(
+        const RegionID& region_id,
+        const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+        const void* data, bool persist) {
+    return accessRegion(region_id, &regionOffsetSizes, [&](MemoryRegion& region) {
+        return region.write(regionOffsetSizes, data, persist);
+    });
+}
+
+Result<bool> MemoryTarget::pullSegments(
+        const RegionID& region_id,
+        const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+        TransferManager& transferManager,
+        thallium::bulk data,
+        const thallium::endpoint& address,
+        size_t bulkOffset,
+        bool persist) {
+    return accessRegion(region_id, &regionOffsetSizes, [&](MemoryRegion& region) {
+        return transferManager.pull(
+            region, regionOffsetSizes, data, address, bulkOffset, persist);
+    });
+}
+
+Result<bool> MemoryTarget::persistSegments(
+        const RegionID& region_id,
+        const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes) {
+    return accessRegion(region_id, nullptr, [&](MemoryRegion& region) {
+        return region.persist(regionOffsetSizes);
+    });
+}
+
+Result<bool> MemoryTarget::readSegments(
+        const RegionID& region_id,
+        const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+        void* data) {
+    return accessRegion(region_id, nullptr, [&](MemoryRegion& region) {
+        return region.read(regionOffsetSizes, data);
+    });
+}
+
+Result<bool> MemoryTarget::pushSegments(
+        const RegionID& region_id,
+        const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+        TransferManager& transferManager,
+        thallium::bulk data,
+        const thallium::endpoint& address,
+        size_t bulkOffset) {
+    return accessRegion(region_id, nullptr, [&](MemoryRegion& region) {
+        return transferManager.push(
+            region, regionOffsetSizes, data, address, bulkOffset);
+    });
+}
+
+template<typename Function>
+Result<bool> MemoryTarget::accessRegions(
+        const std::vector<RegionSegments>& regions, bool written,
+        Function&& function) {
+    Result<bool> result;
+    auto lock = std::unique_lock<thallium::mutex>{m_mutex};
+    std::vector<size_t> indices;
+    indices.reserve(regions.size());
+    for(auto& region : regions) {
+        auto index = regiondIDtoIndex(region.first);
+        if(index < 0) {
+            result.error() = "Invalid RegionID information";
+            result.success() = false;
+            return result;
+        }
+        if(!checkAccess(index, result)) return result;
+        indices.push_back(index);
+    }
+    // none of the regions accessed can be evicted to unshare another
+    std::vector<std::pair<char*, size_t>> pieces;
+    for(size_t i = 0; i < regions.size(); ++i) {
+        if(written) {
+            auto unshared = unshare(indices[i], &regions[i].second, indices);
+            if(!unshared.success()) return unshared;
+        }
+        if(!forEachExtent(m_regions[indices[i]], m_extent_size, regions[i].second,
+                          [&](char* ptr, size_t n) { pieces.push_back({ptr, n}); }))
+            return MemoryRegion::outOfBounds();
+    }
+    MemoryRegionSet set{m_engine, std::move(pieces), std::move(lock), m_copy_engine};
+    return function(set);
+}
+
+Result<bool> MemoryTarget::writeRegions(
+        const std::vector<RegionSegments>& regions,
+        const void* data, bool persist) {
+    return accessRegions(regions, true, [&](MemoryRegionSet& set) {
+        return set.write({{0, set.size()}}, data, persist);
+    });
+}
+
+Result<bool> MemoryTarget::pullRegions(
+        const std::vector<RegionSegments>& regions,
+        TransferManager& transferManager,
+        thallium::bulk data,
+        const thallium::endpoint& address,
+        size_t bulkOffset,
+        bool persist) {
+    return accessRegions(regions, true, [&](MemoryRegionSet& set) {
+        return transferManager.pull(
+            set, {{0, set.size()}}, data, address, bulkOffset, persist);
+    });
+}
+
+Result<bool> MemoryTarget::readRegions(
+        const std::vector<RegionSegments>& regions,
+        void* data) {
+    return accessRegions(regions, false, [&](MemoryRegionSet& set) {
+        return set.read({{0, set.size()}}, data);
+    });
+}
+
+Result<bool> MemoryTarget::pushRegions(
+        const std::vector<RegionSegments>& regions,
+        TransferManager& transferManager,
+        thallium::bulk data,
+        const thallium::endpoint& address,
+        size_t bulkOffset) {
+    return accessRegions(regions, false, [&](MemoryRegionSet& set) {
+        return transferManager.push(
+            set, {{0, set.size()}}, data, address, bulkOffset);
+    });
+}
+
+Result<bool> MemoryTarget::advise(
+        const std::vector<RegionSegments>& regions, AccessHint hint) {
+    Result<bool> result;
+    if(hint != AccessHint::WillNeed) return result;
+    auto lock = std::unique_lock<thallium::mutex>{m_mutex};
+    for(auto& region : regions) {
+        auto index = regiondIDtoIndex(region.first);
+        if(index < 0) {
+            result.error() = "Invalid RegionID information";
+            result.success() = false;
+            return result;
+        }
+        if(!checkAccess(index, result)) return result;
+    }
     return result;
 }
 
@@ -196,7 +658,121 @@ Result<bool> MemoryTarget::erase(const RegionID& region_id) {
         result.success() = false;
         return result;
     }
-    m_regions[index].clear();
+    release(index, Slot::State::Erased);
+    return result;
+}
+
+Result<bool> MemoryTarget::pin(const RegionID& region_id, bool pinned) {
+    auto index = regiondIDtoIndex(region_id);
+    Result<bool> result;
+    if(index < 0) {
+        result.error() = "Invalid RegionID information";
+        result.success() = false;
+        return result;
+    }
+    auto lock = std::unique_lock<thallium::mutex>{m_mutex};
+    if(!checkAccess(index, result)) return result;
+    auto& pins = m_regions[index].pins;
+    if(pinned) {
+        pins += 1;
+    } else if(pins == 0) {
+        result.error() = "Region is not pinned";
+        result.success() = false;
+    } else {
+        pins -= 1;
+    }
+    return result;
+}
+
+Result<size_t> MemoryTarget::regionSize(const RegionID& region_id) {
+    auto index = regiondIDtoIndex(region_id);
+    Result<size_t> result;
+    if(index < 0) {
+        result.error() = "Invalid RegionID information";
+        result.success() = false;
+        return result;
+    }
+    auto lock = std::unique_lock<thallium::mutex>{m_mutex};
+    if(!checkAccess(index, result)) return result;
+    result.value() = m_regions[index].size;
+    return result;
+}
+
+Result<RegionID> MemoryTarget::clone(const RegionID& region_id) {
+    auto index = regiondIDtoIndex(region_id);
+    Result<RegionID> result;
+    if(index < 0) {
+        result.error() = "Invalid RegionID information";
+        result.success() = false;
+        return result;
+    }
+    auto lock = std::unique_lock<thallium::mutex>{m_mutex};
+    if(!checkAccess(index, result)) return result;
+    Slot copy;
+    copy.size    = m_regions[index].size;
+    copy.extents = m_regions[index].extents;
+    m_regions.push_back(std::move(copy));
+    uint64_t clone_index = m_regions.size() - 1;
+    if(m_eviction) m_eviction->insert(clone_index);
+    result.value() = makeRegionID(clone_index, m_regions.back().size);
+    return result;
+}
+
+Result<bool> MemoryTarget::createSnapshot(const std::string& name) {
+    Result<bool> result;
+    auto lock = std::unique_lock<thallium::mutex>{m_mutex};
+    if(m_snapshots.count(name)) {
+        result.error() = fmt::format("Snapshot \"{}\" already exists", name);
+        result.success() = false;
+        return result;
+    }
+    m_snapshots.emplace(name, m_regions);
+    return result;
+}
+
+Result<bool> MemoryTarget::restoreSnapshot(const std::string& name) {
+    Result<bool> result;
+    auto lock = std::unique_lock<thallium::mutex>{m_mutex};
+    auto it = m_snapshots.find(name);
+    if(it == m_snapshots.end()) {
+        result.error() = fmt::format("Snapshot \"{}\" not found", name);
+        result.success() = false;
+        return result;
+    }
+    auto& snapshot = it->second;
+    for(size_t index = 0; index < m_regions.size(); ++index) {
+        auto& slot = m_regions[index];
+        dropExtents(slot);
+        if(index < snapshot.size()) {
+            slot = snapshot[index];
+        } else {
+            // regions created after the snapshot keep their index so
+            // that their RegionID doesn't alias a future region
+            slot.state = Slot::State::Erased;
+            slot.pins  = 0;
+        }
+    }
+    if(m_eviction) {
+        m_eviction = EvictionPolicy::create(m_eviction->name());
+        for(size_t index = 0; index < m_regions.size(); ++index) {
+            if(m_regions[index].state == Slot::State::Resident)
+                m_eviction->insert(index);
+        }
+    }
+    return result;
+}
+
+Result<bool> MemoryTarget::deleteSnapshot(const std::string& name) {
+    Result<bool> result;
+    auto lock = std::unique_lock<thallium::mutex>{m_mutex};
+    auto it = m_snapshots.find(name);
+    if(it == m_snapshots.end()) {
+        result.error() = fmt::format("Snapshot \"{}\" not found", name);
+        result.success() = false;
+        return result;
+    }
+    for(auto& slot : it->second) dropExtents(slot);
+    m_snapshots.erase(it);
     return result;
 }
 
@@ -227,8 +803,38 @@ Result<std::unique_ptr<warabi::Backend>> MemoryTarget::create(const thallium::en
 }
 
 Result<bool> MemoryTarget::validate(const json& config) {
-    (void)config;
-    return Result<bool>{};
+
+    static const json schema = R"(
+    {
+        "type": "object",
+        "properties": {
+            "numa_node": {"type": "integer", "minimum": 0},
+            "huge_page_size": {"enum": [0, 2097152, 1073741824]},
+            "hugetlbfs_path": {"type": "string"},
+            "capacity": {"type": "integer", "minimum": 0},
+            "extent_size": {"type": "integer", "minimum": 4096},
+            "eviction": {"enum": ["lru", "clock"]},
+            "copy": {"type": "object"}
+        }
+    }
+    )"_json;
+
+    Result<bool> result;
+
+    json_validator validator;
+    validator.set_root_schema(schema);
+    try {
+        validator.validate(config);
+    } catch(const std::exception& ex) {
+        result.success() = false;
+        result.error() = fmt::format(
+            "Error(s) while validating JSON config for warabi MemoryTarget: {}", ex.what());
+        return result;
+    }
+
+    if(config.contains("copy"))
+        return CopyEngine::validate(config["copy"]);
+    return result;
 }
 
 }
@@ -7,6 +7,10 @@
 #define __MEMORY_BACKEND_HPP
 
 #include <warabi/Backend.hpp>
+#include "CopyEngine.hpp"
+#include "PageAllocator.hpp"
+#include "EvictionPolicy.hpp"
+#include <unordered_map>
 
 namespace warabi {
 
@@ -14,16 +18,108 @@ using json = nlohmann::json;
 
 /**
  * Memory-based implementation of an warabi Backend.
+ *
+ * When the configuration has a non-zero "capacity" (in bytes), the
+ * target acts as a cache: creating a region that would exceed the
+ * capacity first evicts unpinned regions according to the "eviction"
+ * policy ("lru" by default, or "clock"). Accessing an evicted region
+ * fails with Result::evicted() set.
+ *
+ * Regions are stored as extents of "extent_size" bytes (by default the
+ * larger of 4 MiB and the huge page size) that clones and snapshots
+ * share: clone() and snapshot() only copy references to extents, and
+ * writing into a shared extent first copies it (copy-on-write).
  */
-class MemoryTarget : public warabi::Backend {
+class MemoryTarget final : public warabi::Backend {
+
+    public:
+
+    // Large regions follow the target's PagePolicy ("numa_node",
+    // "huge_page_size" and "hugetlbfs_path" in the configuration)
+    using Buffer = std::vector<char, PageAllocator<char>>;
 
-    thallium::engine               m_engine;
-    json                           m_config;
-    std::vector<std::vector<char>> m_regions;
-    thallium::mutex                m_mutex;
+    struct Slot {
+        enum class State : uint8_t { Resident, Evicted, Erased };
+        std::vector<std::shared_ptr<Buffer>> extents;
+        size_t   size  = 0;
+        State    state = State::Resident;
+        uint32_t pins  = 0;
+    };
+
+    using Segments = std::vector<std::pair<size_t, size_t>>;
+
+    private:
+
+    thallium::engine                m_engine;
+    json                            m_config;
+    std::vector<Slot>               m_regions;
+    mutable thallium::mutex         m_mutex;
+    CopyEngine                      m_copy_engine;
+    std::shared_ptr<PagePolicy>     m_page_policy;
+    PageAllocator<char>             m_allocator;
+    size_t                          m_capacity = 0;
+    size_t                          m_used = 0;
+    size_t                          m_evictions = 0;
+    std::unique_ptr<EvictionPolicy> m_eviction;
+    size_t                          m_extent_size;
+    std::unordered_map<std::string, std::vector<Slot>> m_snapshots;
 
     static ssize_t regiondIDtoIndex(const RegionID& regionID);
 
+    /**
+     * @brief Check that the region at the given index can be accessed,
+     * filling result with the error otherwise, and record the access
+     * in the eviction policy. Must be called with m_mutex held.
+     */
+    template<typename ResultType>
+    bool checkAccess(ssize_t index, ResultType& result);
+
+    /**
+     * @brief Evict regions until size more bytes fit in the capacity,
+     * never evicting the regions in keep. Must be called with m_mutex held.
+     */
+    Result<bool> makeRoom(size_t size, const std::vector<size_t>& keep = {});
+
+    /**
+     * @brief Free the memory of a region (unless shared) and put it
+     * in the given state. Must be called with m_mutex held.
+     */
+    void release(size_t index, Slot::State state);
+
+    /**
+     * @brief Build the region object for the given RegionID on the
+     * stack and call function on it. If written is not null, the
+     * extents covered by these segments are unshared first.
+     */
+    template<typename Function>
+    Result<bool> accessRegion(const RegionID& region, const Segments* written,
+                              Function&& function);
+
+    /**
+     * @brief Build a single region object presenting the segments of
+     * all the regions (in order) on the stack and call function on it.
+     * If written is true, the extents covered are unshared first.
+     */
+    template<typename Function>
+    Result<bool> accessRegions(const std::vector<RegionSegments>& regions,
+                               bool written, Function&& function);
+
+    /**
+     * @brief Give the region its own copy of the extents covered by
+     * the segments (of all its extents if segments is null) that it
+     * shares with clones or snapshots, first making room for the copies
+     * without evicting the regions in keep (which should include index).
+     * Must be called with m_mutex held.
+     */
+    Result<bool> unshare(size_t index, const Segments* segments,
+                         const std::vector<size_t>& keep);
+
+    /**
+     * @brief Drop the references of a slot to its extents, accounting
+     * for the memory freed. Must be called with m_mutex held.
+     */
+    void dropExtents(Slot& slot);
+
     public:
 
     /**
@@ -51,6 +147,12 @@ class MemoryTarget : public warabi::Backend {
      */
     std::string getConfig() const override;
 
+    /**
+     * @brief Get the NUMA placement of the target's regions and
+     * its eviction statistics as a JSON-formatted string.
+     */
+    std::string getStats() const override;
+
     /**
      * @brief Create a region of a given size and return
      * an std::unique_ptr to a WritableRegion, or nullptr
@@ -74,11 +176,111 @@ class MemoryTarget : public warabi::Backend {
      */
     Result<std::unique_ptr<ReadableRegion>> read(const RegionID& region) override;
 
+    /**
+     * @brief Direct region access, building the region object on the stack.
+     * @see Backend::writeSegments and the other *Segments functions.
+     */
+    Result<bool> writeSegments(
+            const RegionID& region,
+            const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+            const void* data, bool persist) override;
+
+    Result<bool> pullSegments(
+            const RegionID& region,
+            const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+            TransferManager& transferManager,
+            thallium::bulk data,
+            const thallium::endpoint& address,
+            size_t bulkOffset,
+            bool persist) override;
+
+    Result<bool> persistSegments(
+            const RegionID& region,
+            const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes) override;
+
+    Result<bool> readSegments(
+            const RegionID& region,
+            const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+            void* data) override;
+
+    Result<bool> pushSegments(
+            const RegionID& region,
+            const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+            TransferManager& transferManager,
+            thallium::bulk data,
+            const thallium::endpoint& address,
+            size_t bulkOffset) override;
+
+    /**
+     * @brief Multi-region access, presenting all the segments
+     * as a single region to the TransferManager.
+     * @see Backend::writeRegions and the other *Regions functions.
+     */
+    Result<bool> writeRegions(
+            const std::vector<RegionSegments>& regions,
+            const void* data, bool persist) override;
+
+    Result<bool> pullRegions(
+            const std::vector<RegionSegments>& regions,
+            TransferManager& transferManager,
+            thallium::bulk data,
+            const thallium::endpoint& address,
+            size_t bulkOffset,
+            bool persist) override;
+
+    Result<bool> readRegions(
+            const std::vector<RegionSegments>& regions,
+            void* data) override;
+
+    Result<bool> pushRegions(
+            const std::vector<RegionSegments>& regions,
+            TransferManager& transferManager,
+            thallium::bulk data,
+            const thallium::endpoint& address,
+            size_t bulkOffset) override;
+
     /**
      * @see TopicHandle::erase
      */
     Result<bool> erase(const RegionID& region) override;
 
+    /**
+     * @brief The data is always resident, so the only hint with an
+     * effect is AccessHint::WillNeed, which counts as an access for
+     * the eviction policy (and fails if a region was evicted).
+     */
+    Result<bool> advise(const std::vector<RegionSegments>& regions, AccessHint hint) override;
+
+    /**
+     * @see Backend::pin
+     */
+    Result<bool> pin(const RegionID& region, bool pinned) override;
+
+    /**
+     * @see Backend::regionSize
+     */
+    Result<size_t> regionSize(const RegionID& region) override;
+
+    /**
+     * @see Backend::clone
+     */
+    Result<RegionID> clone(const RegionID& region) override;
+
+    /**
+     * @see Backend::createSnapshot
+     */
+    Result<bool> createSnapshot(const std::string& name) override;
+
+    /**
+     * @see Backend::restoreSnapshot
+     */
+    Result<bool> restoreSnapshot(const std::string& name) override;
+
+    /**
+     * @see Backend::deleteSnapshot
+     */
+    Result<bool> deleteSnapshot(const std::string& name) override;
+
     /**
      * @brief Destroy the underlying storage.
      */
@@ -0,0 +1,159 @@
+/*
+ * (C) 2024 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __WARABI_MIGRATION_GUARD_HPP
+#define __WARABI_MIGRATION_GUARD_HPP
+
+#include <thallium.hpp>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+namespace warabi {
+
+/**
+ * @brief The MigrationGuard prevents a migration from starting while
+ * operations are accessing a target, and operations from accessing the
+ * target while it is being migrated.
+ *
+ * Operations are tracked by counters spread across cache lines, each
+ * execution stream using its own counter, so that the fast path of
+ * enter() and of the Token's destructor only touches a cache line local
+ * to the calling ES (plus a read of the shared "migrating" flag, which
+ * only changes when a migration starts or ends).
+ *
+ * beginMigration() raises the "migrating" flag then waits for all the
+ * counters to drain to zero. Operations that see the flag raised back
+ * off and wait for endMigration().
+ */
+class MigrationGuard {
+
+    struct alignas(64) Counter {
+        std::atomic<int64_t> value{0};
+    };
+
+    static constexpr size_t NUM_COUNTERS = 64;
+
+    std::array<Counter, NUM_COUNTERS> m_counters;
+    std::atomic<bool>                 m_migrating{false};
+    thallium::mutex                   m_mutex;
+    thallium::condition_variable      m_cv;
+
+    static size_t localSlot() {
+        static std::atomic<size_t> next_slot{0};
+        thread_local size_t slot = next_slot.fetch_add(1) % NUM_COUNTERS;
+        return slot;
+    }
+
+    public:
+
+    /**
+     * @brief RAII object representing an operation in progress.
+     * The slot is recorded so that the counter incremented by enter()
+     * is the one decremented, even if the ULT changed ES in between.
+     */
+    class Token {
+
+        friend class MigrationGuard;
+
+        MigrationGuard* m_owner = nullptr;
+        size_t          m_slot  = 0;
+
+        Token(MigrationGuard* owner, size_t slot)
+        : m_owner(owner)
+        , m_slot(slot) {}
+
+        public:
+
+        Token() = default;
+
+        Token(const Token&) = delete;
+        Token& operator=(const Token&) = delete;
+
+        Token(Token&& other)
+        : m_owner(other.m_owner)
+        , m_slot(other.m_slot) {
+            other.m_owner = nullptr;
+        }
+
+        Token& operator=(Token&& other) {
+            if(this == &other) return *this;
+            release();
+            m_owner = other.m_owner;
+            m_slot  = other.m_slot;
+            other.m_owner = nullptr;
+            return *this;
+        }
+
+        ~Token() {
+            release();
+        }
+
+        /**
+         * @brief Signal the end of the operation before
+         * the Token is destroyed.
+         */
+        void release() {
+            if(!m_owner) return;
+            m_owner->m_counters[m_slot].value.fetch_sub(1, std::memory_order_release);
+            m_owner = nullptr;
+        }
+    };
+
+    MigrationGuard() = default;
+
+    MigrationGuard(const MigrationGuard&) = delete;
+    MigrationGuard& operator=(const MigrationGuard&) = delete;
+
+    /**
+     * @brief Signal the start of an operation, waiting if a
+     * migration is in progress.
+     */
+    Token enter() {
+        auto slot = localSlot();
+        auto& counter = m_counters[slot].value;
+        while(true) {
+            // sequentially-consistent increment and load ensure that either
+            // beginMigration() sees our increment, or we see its flag
+            counter.fetch_add(1, std::memory_order_seq_cst);
+            if(!m_migrating.load(std::memory_order_seq_cst))
+                return Token{this, slot};
+            counter.fetch_sub(1, std::memory_order_release);
+            std::unique_lock<thallium::mutex> lock{m_mutex};
+            m_cv.wait(lock, [this]() { return !m_migrating.load(); });
+        }
+    }
+
+    /**
+     * @brief Prevent new operations from starting and
+     * wait for the ones in progress to complete.
+     */
+    void beginMigration() {
+        {
+            // only one migration at a time
+            std::unique_lock<thallium::mutex> lock{m_mutex};
+            m_cv.wait(lock, [this]() { return !m_migrating.load(); });
+            m_migrating.store(true, std::memory_order_seq_cst);
+        }
+        for(auto& counter : m_counters) {
+            while(counter.value.load(std::memory_order_acquire) != 0)
+                thallium::thread::yield();
+        }
+    }
+
+    /**
+     * @brief Let operations resume after beginMigration().
+     */
+    void endMigration() {
+        std::unique_lock<thallium::mutex> lock{m_mutex};
+        m_migrating.store(false, std::memory_order_seq_cst);
+        m_cv.notify_all();
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,287 @@
+/*
+ * (C) 2024 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __WARABI_NUMA_HPP
+#define __WARABI_NUMA_HPP
+
+#include <warabi/Result.hpp>
+#include <nlohmann/json.hpp>
+#include <nlohmann/json-schema.hpp>
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <sys/types.h>
+
+#include <atomic>
+#include <climits>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+
+namespace warabi {
+
+/**
+ * @brief Helpers to find the NUMA node of devices and memory, and to
+ * bind memory and threads to a node. They call the mbind and
+ * get_mempolicy system calls directly so that warabi doesn't depend
+ * on libnuma; on systems without NUMA support they fail gracefully
+ * and leave placement to the kernel.
+ */
+namespace numa {
+
+// values from linux/mempolicy.h
+static constexpr int           POLICY_BIND = 2;
+static constexpr unsigned      FLAG_MOVE   = 1 << 1; // MPOL_MF_MOVE
+static constexpr unsigned long FLAG_NODE   = 1 << 0; // MPOL_F_NODE
+static constexpr unsigned long FLAG_ADDR   = 1 << 1; // MPOL_F_ADDR
+static constexpr int           MAX_NODES   = 1024;
+
+inline size_t pageSize() {
+    static const size_t page_size = sysconf(_SC_PAGESIZE);
+    return page_size;
+}
+
+/**
+ * @brief NUMA node of a device given its sysfs path (-1 if unknown).
+ * Walks up the (resolved) path until a numa_node file is found, so
+ * that it works for block devices, partitions and network interfaces.
+ */
+inline int nodeOfSysfsDevice(const std::string& sysfsPath) {
+    std::error_code ec;
+    auto p = std::filesystem::canonical(sysfsPath, ec);
+    if(ec) return -1;
+    for(; p.has_relative_path(); p = p.parent_path()) {
+        for(auto candidate : {p / "numa_node", p / "device" / "numa_node"}) {
+            std::ifstream f{candidate};
+            int node = -1;
+            if(f >> node) return node;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief NUMA node of a block device (-1 if unknown).
+ */
+inline int nodeOfBlockDevice(dev_t dev) {
+    return nodeOfSysfsDevice(fmt::format("/sys/dev/block/{}:{}", major(dev), minor(dev)));
+}
+
+/**
+ * @brief NUMA node of a network interface, e.g. "ib0" (-1 if unknown).
+ */
+inline int nodeOfNetworkInterface(const std::string& name) {
+    return nodeOfSysfsDevice("/sys/class/net/" + name);
+}
+
+/**
+ * @brief NUMA node of the page containing the given address
+ * (-1 if unknown). The page is faulted in if needed.
+ */
+inline int nodeOfAddress(const void* ptr) {
+#ifdef SYS_get_mempolicy
+    int node = -1;
+    if(syscall(SYS_get_mempolicy, &node, nullptr, 0,
+               const_cast<void*>(ptr), FLAG_NODE | FLAG_ADDR) == 0)
+        return node;
+#else
+    (void)ptr;
+#endif
+    return -1;
+}
+
+/**
+ * @brief Bind the pages fully contained in [ptr, ptr+size) to the given
+ * node, moving those already allocated. Returns false on failure.
+ */
+inline bool bind(void* ptr, size_t size, int node) {
+    if(node < 0 || node >= MAX_NODES) return false;
+    auto begin = ((uintptr_t)ptr + pageSize() - 1) & ~(pageSize() - 1);
+    auto end   = ((uintptr_t)ptr + size) & ~(pageSize() - 1);
+    if(begin >= end) return true;
+#ifdef SYS_mbind
+    unsigned long mask[MAX_NODES / (CHAR_BIT * sizeof(unsigned long))] = {0};
+    mask[node / (CHAR_BIT * sizeof(unsigned long))] = 1UL << (node % (CHAR_BIT * sizeof(unsigned long)));
+    return syscall(SYS_mbind, (void*)begin, end - begin, POLICY_BIND,
+                   mask, (unsigned long)MAX_NODES, FLAG_MOVE) == 0;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Restrict the calling thread to the CPUs of the given node.
+ */
+inline bool pinCurrentThread(int node) {
+    std::ifstream f{fmt::format("/sys/devices/system/node/node{}/cpulist", node)};
+    std::string cpulist;
+    if(!(f >> cpulist)) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    std::stringstream ss{cpulist};
+    std::string range;
+    while(std::getline(ss, range, ',')) {
+        auto dash = range.find('-');
+        int first = std::atoi(range.c_str());
+        int last  = dash == std::string::npos ? first : std::atoi(range.c_str() + dash + 1);
+        for(int cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu)
+            CPU_SET(cpu, &set);
+    }
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+}
+
+/**
+ * @brief The NumaPolicy of a provider designates the node its handlers
+ * should run on, either directly ("node") or as the node of a network
+ * interface ("nic"). When "pin_handlers" is true, each execution stream
+ * running the provider's handlers restricts itself to the CPUs of that
+ * node the first time it runs one of them (execution streams can also be
+ * pinned ahead of time through the "cpubind"/"affinity" fields of their
+ * Margo configuration). Target memory and staging buffers are bound
+ * through the "numa_node" field of the target's or transfer manager's
+ * own configuration.
+ *
+ * Example of configuration:
+ *
+ * {
+ *     "nic": "ib0",
+ *     "pin_handlers": true
+ * }
+ */
+class NumaPolicy {
+
+    using json = nlohmann::json;
+
+    public:
+
+    NumaPolicy() = default;
+
+    NumaPolicy(const NumaPolicy&) = delete;
+    NumaPolicy& operator=(const NumaPolicy&) = delete;
+
+    /**
+     * @brief Validate a "numa" configuration object.
+     */
+    static Result<bool> validate(const json& config) {
+        static const json schema = R"(
+        {
+            "type": "object",
+            "properties": {
+                "node": {"type": "integer", "minimum": 0},
+                "nic": {"type": "string"},
+                "pin_handlers": {"type": "boolean"}
+            }
+        }
+        )"_json;
+        Result<bool> result;
+        nlohmann::json_schema::json_validator validator;
+        validator.set_root_schema(schema);
+        try {
+            validator.validate(config);
+        } catch(const std::exception& ex) {
+            result.success() = false;
+            result.error() = fmt::format(
+                "Error(s) while validating JSON config for warabi NUMA policy: {}", ex.what());
+        }
+        return result;
+    }
+
+    /**
+     * @brief Configure the NumaPolicy (the configuration
+     * is expected to have been validated).
+     */
+    void configure(const json& config) {
+        m_config = config;
+        if(config.contains("node"))
+            m_node = config["node"].get<int>();
+        else if(config.contains("nic"))
+            m_node = numa::nodeOfNetworkInterface(config["nic"].get<std::string>());
+        else
+            m_node = -1;
+        m_pin = m_node >= 0 && config.value("pin_handlers", false);
+    }
+
+    /**
+     * @brief Return the configuration (null if never configured).
+     */
+    const json& getConfig() const {
+        return m_config;
+    }
+
+    /**
+     * @brief Node designated by the policy (-1 if none).
+     */
+    int node() const {
+        return m_node;
+    }
+
+    /**
+     * @brief Called by handlers: pins the calling execution stream
+     * the first time it runs one of this policy's handlers. A stream
+     * shared with a provider that already pinned it to another node
+     * is left where it is (with a warning) rather than re-pinned
+     * back and forth.
+     */
+    void pinHandler() {
+        if(!m_pin) return;
+        struct Stream {
+            int                          node = -1;
+            std::unordered_set<uint64_t> policies;
+        };
+        thread_local Stream stream;
+        if(!stream.policies.insert(m_id).second) return;
+        if(stream.node >= 0 && stream.node != m_node) {
+            m_pin_conflicts.fetch_add(1, std::memory_order_relaxed);
+            spdlog::warn("[warabi] Execution stream already pinned to NUMA node {}"
+                         " by another provider, not pinning it to node {}",
+                         stream.node, m_node);
+            return;
+        }
+        if(stream.node == m_node || numa::pinCurrentThread(m_node)) {
+            stream.node = m_node;
+            m_pinned_threads.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Return statistics as a JSON object.
+     */
+    json getStats() const {
+        auto stats = json::object();
+        stats["node"]           = m_node;
+        stats["pinned_threads"] = m_pinned_threads.load();
+        stats["pin_conflicts"]  = m_pin_conflicts.load();
+        return stats;
+    }
+
+    private:
+
+    static uint64_t nextId() {
+        static std::atomic<uint64_t> next_id{0};
+        return next_id.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    json                m_config;
+    int                 m_node = -1;
+    bool                m_pin  = false;
+    // identifies the policy in the streams' thread-local state
+    // (unlike its address, which a later policy may reuse)
+    const uint64_t      m_id   = nextId();
+    std::atomic<size_t> m_pinned_threads{0};
+    std::atomic<size_t> m_pin_conflicts{0};
+};
+
+}
+
+#endif
@@ -0,0 +1,161 @@
+/*
+ * (C) 2024 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __WARABI_PAGE_ALLOCATOR_HPP
+#define __WARABI_PAGE_ALLOCATOR_HPP
+
+#include "Numa.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+
+namespace warabi {
+
+/**
+ * @brief Describes how the pages of large allocations should be backed:
+ * - node: NUMA node to bind them to (-1 for none);
+ * - huge_page_size: size of the huge pages to use (0 for none), e.g.
+ *   2 MiB or 1 GiB, taken from the kernel's huge page pool with
+ *   MAP_HUGETLB, or from a file in hugetlbfs_path if not empty.
+ *
+ * If no huge page is available, the allocation falls back to regular
+ * pages with transparent huge pages requested through madvise.
+ */
+struct PagePolicy {
+    int         node           = -1;
+    size_t      huge_page_size = 0;
+    std::string hugetlbfs_path;
+
+    // number of allocations backed by huge pages or that fell back
+    mutable std::atomic<size_t> huge_page_allocations{0};
+    mutable std::atomic<size_t> fallback_allocations{0};
+
+    /**
+     * @brief Whether an allocation of size bytes should use huge pages.
+     */
+    bool useHugePages(size_t size) const {
+        return huge_page_size && size >= huge_page_size;
+    }
+
+    /**
+     * @brief Allocate size bytes (as returned by mappedSize)
+     * with mmap following the policy.
+     */
+    void* map(size_t size) const {
+        void* ptr = MAP_FAILED;
+        bool huge = useHugePages(size);
+        if(huge) {
+            if(!hugetlbfs_path.empty()) {
+                int fd = open(hugetlbfs_path.c_str(), O_TMPFILE | O_RDWR, 0600);
+                if(fd < 0) {
+                    // O_TMPFILE not supported by this file system
+                    std::string filename = hugetlbfs_path + "/warabi-XXXXXX";
+                    fd = mkstemp(filename.data());
+                    if(fd >= 0) unlink(filename.c_str());
+                }
+                if(fd >= 0) {
+                    if(ftruncate(fd, size) == 0)
+                        ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                    close(fd);
+                }
+            } else {
+                int log2_size = __builtin_ctzll(huge_page_size);
+                ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (log2_size << MAP_HUGE_SHIFT),
+                           -1, 0);
+            }
+            if(ptr != MAP_FAILED)
+                huge_page_allocations.fetch_add(1, std::memory_order_relaxed);
+        }
+        if(ptr == MAP_FAILED) {
+            ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if(ptr == MAP_FAILED) return nullptr;
+            if(huge) {
+                madvise(ptr, size, MADV_HUGEPAGE);
+                fallback_allocations.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        if(node >= 0) numa::bind(ptr, size, node);
+        return ptr;
+    }
+
+    /**
+     * @brief Size actually mapped for an allocation of size bytes.
+     */
+    size_t mappedSize(size_t size) const {
+        if(!useHugePages(size)) return size;
+        return (size + huge_page_size - 1) / huge_page_size * huge_page_size;
+    }
+
+    /**
+     * @brief Whether an allocation of size bytes should be mapped
+     * (rather than taken from the heap).
+     */
+    bool shouldMap(size_t size) const {
+        return useHugePages(size) || (node >= 0 && size >= numa::pageSize());
+    }
+};
+
+/**
+ * @brief Allocator whose large allocations follow a PagePolicy (NUMA
+ * binding, huge pages). Allocations too small to be worth mapping come
+ * from operator new. Allocations of at least a huge page are mapped
+ * with their size rounded up to a multiple of the huge page size.
+ */
+template<typename T>
+struct PageAllocator {
+
+    using value_type = T;
+
+    std::shared_ptr<const PagePolicy> policy;
+
+    PageAllocator() = default;
+
+    explicit PageAllocator(std::shared_ptr<const PagePolicy> p)
+    : policy(std::move(p)) {}
+
+    template<typename U>
+    PageAllocator(const PageAllocator<U>& other)
+    : policy(other.policy) {}
+
+    T* allocate(size_t n) {
+        size_t size = n * sizeof(T);
+        if(!policy || !policy->shouldMap(size))
+            return static_cast<T*>(::operator new(size));
+        void* ptr = policy->map(policy->mappedSize(size));
+        if(!ptr) throw std::bad_alloc{};
+        return static_cast<T*>(ptr);
+    }
+
+    void deallocate(T* ptr, size_t n) {
+        size_t size = n * sizeof(T);
+        if(!policy || !policy->shouldMap(size))
+            ::operator delete(ptr);
+        else
+            munmap(ptr, policy->mappedSize(size));
+    }
+
+    template<typename U>
+    bool operator==(const PageAllocator<U>& other) const { return policy == other.policy; }
+
+    template<typename U>
+    bool operator!=(const PageAllocator<U>& other) const { return policy != other.policy; }
+};
+
+}
+
+#endif
@@ -4,6 +4,10 @@
  * See COPYRIGHT in top-level directory.
  */
 #include "warabi/TransferManager.hpp"
+#include "Numa.hpp"
+#include "Tracer.hpp"
+#include "Probes.hpp"
+#include <sys/mman.h>
 #include <margo-bulk-pool.h>
 #include <thallium.hpp>
 #include <fmt/format.h>
@@ -90,7 +94,8 @@ class PipelineTransferManager : public TransferManager {
                 tl::thread::self().get_last_pool().make_thread(
                     [&region, &data, &address, persist, i, this,
                      &regionOffsetSizesSets, bulkOffset=bulkOffsets[i],
-                     &ultResults]() mutable {
+                     &ultResults, trace_id=Tracer::current()]() mutable {
+                    Tracer::Scope trace_scope{trace_id};
                     auto& regionOffsetSizes = regionOffsetSizesSets[i];
                     auto& result = ultResults[i];
                     // compute the size of this list of segments
@@ -103,14 +108,21 @@ class PipelineTransferManager : public TransferManager {
                     // wrap it in a thallium bulk
                     auto localBulk = m_engine.wrap(bulk, true);
                     // issue the transfer
-                    localBulk << data.on(address).select(bulkOffset, size);
+                    {
+                        Tracer::Span span{"transfer", "rdma_pull"};
+                        probe::Scope probe_scope{probe::Kind::Transfer, "pull", size, regionOffsetSizes.size()};
+                        localBulk << data.on(address).select(bulkOffset, size);
+                    }
                     // access the underlying memory
                     void* bufPtr = nullptr;
                     hg_size_t bufSize = 0;
                     hg_uint32_t actualCount = 0;
                     margo_bulk_access(bulk, 0, size, HG_BULK_READWRITE, 1, &bufPtr, &bufSize, &actualCount);
                     // write the data into the region
-                    result = region.write(regionOffsetSizes, bufPtr, persist);
+                    {
+                        Tracer::Span span{"transfer", "region_write"};
+                        result = region.write(regionOffsetSizes, bufPtr, persist);
+                    }
                     // release the buffer
                     margo_bulk_poolset_release(m_poolset, bulk);
             }));
@@ -168,7 +180,8 @@ class PipelineTransferManager : public TransferManager {
                 tl::thread::self().get_last_pool().make_thread(
                     [&region, &data, &address, i, this,
                      &regionOffsetSizesSets, bulkOffset=bulkOffsets[i],
-                     &ultResults]() mutable {
+                     &ultResults, trace_id=Tracer::current()]() mutable {
+                    Tracer::Scope trace_scope{trace_id};
                     auto& regionOffsetSizes = regionOffsetSizesSets[i];
                     auto& result = ultResults[i];
                     // compute the size of this list of segments
@@ -184,11 +197,18 @@ class PipelineTransferManager : public TransferManager {
                     hg_uint32_t actualCount = 0;
                     margo_bulk_access(bulk, 0, size, HG_BULK_READWRITE, 1, &bufPtr, &bufSize, &actualCount);
                     // read the data from the region
-                    result = region.read(regionOffsetSizes, bufPtr);
+                    {
+                        Tracer::Span span{"transfer", "region_read"};
+                        result = region.read(regionOffsetSizes, bufPtr);
+                    }
                     // wrap it in a thallium bulk
                     auto localBulk = m_engine.wrap(bulk, true);
                     // issue the transfer
-                    localBulk >> data.on(address).select(bulkOffset, size);
+                    {
+                        Tracer::Span span{"transfer", "rdma_push"};
+                        probe::Scope probe_scope{probe::Kind::Transfer, "push", size, regionOffsetSizes.size()};
+                        localBulk >> data.on(address).select(bulkOffset, size);
+                    }
                     // release the buffer
                     margo_bulk_poolset_release(m_poolset, bulk);
             }));
@@ -226,10 +246,63 @@ class PipelineTransferManager : public TransferManager {
             return result;
         }
 
+        auto numa_node = config.value("numa_node", -1);
+        auto transparent_huge_pages = config.value("transparent_huge_pages", false);
+        if(numa_node >= 0 || transparent_huge_pages)
+            placeBuffers(poolset, num_pools, num_buffers_per_pool,
+                         first_buffer_size, buffer_size_multiplier,
+                         numa_node, transparent_huge_pages);
+
         result.value() = std::make_unique<PipelineTransferManager>(engine, config, poolset);
         return result;
     }
 
+    /**
+     * @brief Bind (and move) the memory of all the buffers of the poolset
+     * to the given NUMA node (if node >= 0), and request transparent huge
+     * pages for them. The buffers are allocated by margo, so explicit huge
+     * pages (MAP_HUGETLB) cannot be used here. All the buffers are taken
+     * out of their pool to access them, then released.
+     */
+    static void placeBuffers(margo_bulk_poolset_t poolset,
+                             size_t num_pools, size_t num_buffers_per_pool,
+                             size_t first_buffer_size, size_t buffer_size_multiplier,
+                             int node, bool transparentHugePages) {
+        std::vector<hg_bulk_t> bulks;
+        bulks.reserve(num_pools * num_buffers_per_pool);
+        size_t buffer_size = first_buffer_size;
+        for(size_t i = 0; i < num_pools; ++i) {
+            for(size_t j = 0; j < num_buffers_per_pool; ++j) {
+                hg_bulk_t bulk = HG_BULK_NULL;
+                if(margo_bulk_poolset_tryget(poolset, buffer_size, HG_FALSE, &bulk) != HG_SUCCESS
+                || bulk == HG_BULK_NULL)
+                    break;
+                bulks.push_back(bulk);
+                void* ptr = nullptr;
+                hg_size_t size = 0;
+                hg_uint32_t count = 0;
+                margo_bulk_access(bulk, 0, buffer_size, HG_BULK_READWRITE, 1, &ptr, &size, &count);
+                if(!ptr) continue;
+                if(transparentHugePages) adviseHugePages(ptr, size);
+                if(node >= 0) numa::bind(ptr, size, node);
+            }
+            buffer_size *= buffer_size_multiplier;
+        }
+        for(auto bulk : bulks)
+            margo_bulk_poolset_release(poolset, bulk);
+    }
+
+    /**
+     * @brief Request transparent huge pages for the 2 MiB-aligned
+     * part of [ptr, ptr+size), if any.
+     */
+    static void adviseHugePages(void* ptr, size_t size) {
+        constexpr uintptr_t huge_page_size = 2*1024*1024;
+        auto begin = ((uintptr_t)ptr + huge_page_size - 1) & ~(huge_page_size - 1);
+        auto end   = ((uintptr_t)ptr + size) & ~(huge_page_size - 1);
+        if(begin < end) madvise((void*)begin, end - begin, MADV_HUGEPAGE);
+    }
+
     static Result<bool> validate(const json& config) {
         static const json schema = R"(
         {
@@ -238,7 +311,9 @@ class PipelineTransferManager : public TransferManager {
                 "num_pools": {"type": "integer", "minimum": 1},
                 "num_buffers_per_pool": {"type": "integer", "minimum": 1},
                 "first_buffer_size": {"type": "integer", "minimum": 1},
-                "buffer_size_multiplier": {"type": "integer", "exclusiveMinimum": 1}
+                "buffer_size_multiplier": {"type": "integer", "exclusiveMinimum": 1},
+                "numa_node": {"type": "integer", "minimum": 0},
+                "transparent_huge_pages": {"type": "boolean"}
             },
             "required": ["num_pools", "num_buffers_per_pool", "first_buffer_size", "buffer_size_multiplier"]
         }
@@ -5,9 +5,14 @@
  */
 #include "Defer.hpp"
 #include "PmemBackend.hpp"
+#include "Numa.hpp"
+#include <warabi/TransferManager.hpp>
 #include <nlohmann/json.hpp>
 #include <nlohmann/json-schema.hpp>
 #include <fmt/format.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
 #include <filesystem>
 #include <iostream>
 
@@ -30,18 +35,24 @@ static inline PMEMoid RegionIDtoPMEMoid(const RegionID& regionID) {
     return result;
 }
 
-struct PmemRegion : public WritableRegion, public ReadableRegion {
+struct PmemRegion final : public WritableRegion, public ReadableRegion {
 
     PmemRegion(PmemTarget* target,
+               PMEMobjpool* pool,
                RegionID id,
-               char* regionPtr)
+               char* regionPtr,
+               MigrationGuard::Token token)
     : m_target(target)
+    , m_pool(pool)
     , m_id(std::move(id))
-    , m_region_ptr(regionPtr) {}
+    , m_region_ptr(regionPtr)
+    , m_token(std::move(token)) {}
 
-    PmemTarget* m_target;
-    RegionID    m_id;
-    char*       m_region_ptr;
+    PmemTarget*           m_target;
+    PMEMobjpool*          m_pool;
+    RegionID              m_id;
+    char*                 m_region_ptr;
+    MigrationGuard::Token m_token;
 
     std::vector<std::pair<void*, size_t>> convertToSegments(
         const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes) {
@@ -76,30 +87,24 @@ struct PmemRegion : public WritableRegion, public ReadableRegion {
             [](size_t acc, const auto& pair) { return acc + pair.second; });
         auto localBulk = m_target->m_engine.expose(segments, thallium::bulk_mode::write_only);
         localBulk << remoteBulk.on(address)(remoteBulkOffset, totalSize);
-        m_target->m_migration_lock.unlock();
         return result;
     }
 
     Result<bool> write(
             const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
             const void* data, bool persist) override {
-        (void)persist;
         Result<bool> result;
-        auto segments = convertToSegments(regionOffsetSizes);
+        if(!persist) {
+            m_target->m_copy_engine.scatter(m_region_ptr, regionOffsetSizes, data);
+            return result;
+        }
         size_t offset = 0;
         const char* ptr = (const char*)data;
-        if(persist) {
-            for(auto& segment : segments) {
-                pmemobj_memcpy_persist(m_target->m_pmem_pool, segment.first, ptr + offset, segment.second);
-                offset += segment.second;
-            }
-        } else {
-            for(auto& segment : segments) {
-                std::memcpy(segment.first, ptr + offset, segment.second);
-                offset += segment.second;
-            }
+        for(auto& segment : regionOffsetSizes) {
+            if(segment.second == 0) continue;
+            pmemobj_memcpy_persist(m_pool, m_region_ptr + segment.first, ptr + offset, segment.second);
+            offset += segment.second;
         }
-        m_target->m_migration_lock.unlock();
         return result;
     }
 
@@ -108,10 +113,9 @@ struct PmemRegion : public WritableRegion, public ReadableRegion {
         Result<bool> result;
         for(size_t i=0; i < regionOffsetSizes.size(); ++i) {
             if(regionOffsetSizes[i].second > 0) {
-                pmemobj_persist(m_target->m_pmem_pool, m_region_ptr + regionOffsetSizes[i].first, regionOffsetSizes[i].second);
+                pmemobj_persist(m_pool, m_region_ptr + regionOffsetSizes[i].first, regionOffsetSizes[i].second);
             }
         }
-        m_target->m_migration_lock.unlock();
         return result;
     }
 
@@ -128,66 +132,292 @@ struct PmemRegion : public WritableRegion, public ReadableRegion {
             [](size_t acc, const auto& pair) { return acc + pair.second; });
         auto localBulk = m_target->m_engine.expose(segments, thallium::bulk_mode::read_only);
         localBulk >> remoteBulk.on(address)(remoteBulkOffset, totalSize);
-        m_target->m_migration_lock.unlock();
         return result;
      }
 
     Result<bool> read(
             const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
             void* data) override {
+        m_target->m_copy_engine.gather(data, m_region_ptr, regionOffsetSizes);
+        return Result<bool>{};
+    }
+};
+
+/**
+ * @brief WritableRegion wrapping an object reserved by createAndFill but
+ * not published yet. Writes are plain copies, since createAndFill persists
+ * the whole object at once, and the RegionID is not valid yet.
+ */
+struct PmemConstructionRegion : public WritableRegion {
+
+    PmemConstructionRegion(const thallium::engine& engine, const CopyEngine& copyEngine, char* ptr)
+    : m_engine(engine)
+    , m_copy_engine(copyEngine)
+    , m_ptr(ptr) {}
+
+    const thallium::engine& m_engine;
+    const CopyEngine&       m_copy_engine;
+    char*                   m_ptr;
+
+    Result<RegionID> getRegionID() override {
+        Result<RegionID> result;
+        result.success() = false;
+        result.error() = "RegionID not available while the region is being created";
+        return result;
+    }
+
+    Result<bool> write(
+            const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+            thallium::bulk remoteBulk,
+            const thallium::endpoint& address,
+            size_t remoteBulkOffset,
+            bool persist) override {
+        (void)persist;
         Result<bool> result;
-        auto segments = convertToSegments(regionOffsetSizes);
-        if(segments.size() == 0) return result;
-        size_t offset = 0;
-        char* ptr = (char*)data;
-        for(auto& segment : segments) {
-            std::memcpy(ptr + offset, segment.first, segment.second);
-            offset += segment.second;
+        std::vector<std::pair<void*, size_t>> segments;
+        size_t totalSize = 0;
+        for(auto& seg : regionOffsetSizes) {
+            if(seg.second == 0) continue;
+            segments.push_back({m_ptr + seg.first, seg.second});
+            totalSize += seg.second;
         }
-        m_target->m_migration_lock.unlock();
+        if(segments.size() == 0) return result;
+        auto localBulk = m_engine.expose(segments, thallium::bulk_mode::write_only);
+        localBulk << remoteBulk.on(address)(remoteBulkOffset, totalSize);
         return result;
     }
+
+    Result<bool> write(
+            const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+            const void* data, bool persist) override {
+        (void)persist;
+        m_copy_engine.scatter(m_ptr, regionOffsetSizes, data);
+        return Result<bool>{};
+    }
+
+    Result<bool> persist(
+            const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes) override {
+        (void)regionOffsetSizes;
+        return Result<bool>{};
+    }
 };
 
-PmemTarget::PmemTarget(thallium::engine engine, const json& config, PMEMobjpool* pool)
+PmemTarget::PmemTarget(thallium::engine engine, const json& config, std::vector<Shard> shards)
 : m_engine(std::move(engine))
 , m_config(config)
-, m_pmem_pool(pool)
-, m_filename(config["path"].get_ref<const std::string&>()) {}
+, m_shards(std::move(shards))
+, m_filename(config["path"].get_ref<const std::string&>())
+, m_alloc_header_size(config.value("alloc_class_header", "compact") == "none" ? 0 : 16) {
+    m_copy_engine.configure(config.value("copy", json::object()));
+}
 
 PmemTarget::~PmemTarget() {
-    if(m_pmem_pool)
-        pmemobj_close(m_pmem_pool);
+    closeShards();
 }
 
 std::string PmemTarget::getConfig() const {
     return m_config.dump();
 }
 
-Result<bool> PmemTarget::destroy() {
-    if(m_pmem_pool) {
-        pmemobj_close(m_pmem_pool);
-        m_pmem_pool = nullptr;
+std::string PmemTarget::getStats() const {
+    auto stats = json::object();
+    auto& shards = stats["shards"] = json::array();
+    for(auto& shard : m_shards) {
+        auto entry = json::object();
+        entry["path"] = shard.filename;
+        struct stat statbuf;
+        entry["numa_node"] = stat(shard.filename.c_str(), &statbuf) == 0
+                           ? numa::nodeOfBlockDevice(statbuf.st_dev) : -1;
+        unsigned narenas = 0;
+        if(shard.pool)
+            pmemobj_ctl_get(shard.pool, "heap.narenas.automatic", &narenas);
+        entry["automatic_arenas"] = narenas;
+        shards.push_back(std::move(entry));
     }
+    return stats.dump();
+}
+
+void PmemTarget::closeShards() {
+    for(auto& shard : m_shards) {
+        if(shard.pool) pmemobj_close(shard.pool);
+        shard.pool = nullptr;
+    }
+}
+
+void PmemTarget::reopenShards() {
+    for(auto& shard : m_shards) {
+        if(shard.pool) continue;
+        auto reopened = openShard(shard.filename, m_config, 0);
+        if(reopened.success()) shard = std::move(reopened.value());
+    }
+}
+
+PmemTarget::Shard& PmemTarget::nextShard(size_t size, uint64_t& flags) {
+    auto& shard = m_shards[m_next_shard.fetch_add(1, std::memory_order_relaxed) % m_shards.size()];
+    // use the smallest allocation class that fits the region (and its header)
+    flags = 0;
+    for(auto& alloc_class : shard.alloc_classes) {
+        if(alloc_class.first >= size + m_alloc_header_size) {
+            flags = POBJ_CLASS_ID(alloc_class.second);
+            break;
+        }
+    }
+    return shard;
+}
+
+PmemTarget::Shard* PmemTarget::findShard(const PMEMoid& oid) {
+    if(OID_IS_NULL(oid)) return nullptr;
+    auto pool = pmemobj_pool_by_oid(oid);
+    if(!pool) return nullptr;
+    for(auto& shard : m_shards)
+        if(shard.pool == pool) return &shard;
+    return nullptr;
+}
+
+std::string PmemTarget::shardFilename(const std::string& path, size_t index) {
+    if(index == 0) return path;
+    return fmt::format("{}.{}", path, index);
+}
+
+Result<PmemTarget::Shard> PmemTarget::openShard(
+        const std::string& filename, const json& config, size_t size) {
+    Result<Shard> result;
+    Shard shard;
+    shard.filename = filename;
+
+    if(size)
+        shard.pool = pmemobj_create(filename.c_str(), NULL, size, 0644);
+    else
+        shard.pool = pmemobj_open(filename.c_str(), NULL);
+    if(!shard.pool) {
+        result.success() = false;
+        result.error() = fmt::format(
+            "Failed to {} pmemobj target at {}: {}",
+            size ? "create" : "open", filename, pmemobj_errormsg());
+        return result;
+    }
+
+    // PMDK assigns threads (i.e. execution streams) round-robin to its
+    // automatic arenas, of which there is one per CPU by default; arenas
+    // made by heap.arena.create are not automatic until marked as such
+    if(config.contains("num_arenas")) {
+        unsigned num_arenas = config["num_arenas"].get<unsigned>();
+        unsigned total = 0;
+        pmemobj_ctl_get(shard.pool, "heap.narenas.total", &total);
+        while(total < num_arenas) {
+            unsigned arena_id = 0;
+            if(pmemobj_ctl_exec(shard.pool, "heap.arena.create", &arena_id) != 0)
+                break;
+            total += 1;
+        }
+        // arena ids start at 1
+        for(unsigned arena_id = 1; arena_id <= total; ++arena_id) {
+            int automatic = arena_id <= num_arenas;
+            pmemobj_ctl_set(shard.pool,
+                fmt::format("heap.arena.{}.automatic", arena_id).c_str(), &automatic);
+        }
+    }
+
+    auto header = config.value("alloc_class_header", "compact") == "none" ?
+        POBJ_HEADER_NONE : POBJ_HEADER_COMPACT;
+    for(auto& unit_size_json : config.value("alloc_classes", json::array())) {
+        size_t unit_size = unit_size_json.get<size_t>();
+        struct pobj_alloc_class_desc desc;
+        desc.unit_size       = unit_size;
+        desc.alignment       = 0;
+        // blocks of about 256KB, so that each class doesn't waste much space
+        desc.units_per_block = std::max<size_t>(1, (256*1024) / unit_size);
+        desc.header_type     = header;
+        desc.class_id        = 0;
+        if(pmemobj_ctl_set(shard.pool, "heap.alloc_class.new.desc", &desc) != 0) {
+            result.success() = false;
+            result.error() = fmt::format(
+                "Failed to register allocation class of size {} in {}: {}",
+                unit_size, filename, pmemobj_errormsg());
+            pmemobj_close(shard.pool);
+            return result;
+        }
+        shard.alloc_classes.emplace_back(unit_size, desc.class_id);
+    }
+    std::sort(shard.alloc_classes.begin(), shard.alloc_classes.end());
+
+    result.value() = std::move(shard);
+    return result;
+}
+
+Result<bool> PmemTarget::destroy() {
+    closeShards();
     std::error_code ec;
-    std::filesystem::remove(m_filename.c_str(), ec);
+    for(auto& shard : m_shards)
+        std::filesystem::remove(shard.filename.c_str(), ec);
     return Result<bool>{};
 }
 
 Result<std::unique_ptr<WritableRegion>> PmemTarget::create(size_t size) {
     Result<std::unique_ptr<WritableRegion>> result;
     PMEMoid oid;
-    m_migration_lock.rdlock();
-    int ret = pmemobj_alloc(m_pmem_pool, &oid, size, 0, NULL, NULL);
+    auto token = m_migration_guard.enter();
+    uint64_t flags = 0;
+    auto& shard = nextShard(size, flags);
+    int ret = pmemobj_xalloc(shard.pool, &oid, size, 0, flags, NULL, NULL);
     if(ret != 0) {
         result.success() = false;
-        result.error() = fmt::format("pmemobj_alloc failed: {}", pmemobj_errormsg());
-        m_migration_lock.unlock();
+        result.error() = fmt::format("pmemobj_xalloc failed: {}", pmemobj_errormsg());
         return result;
     }
     RegionID regionID = PMEMoidToRegionID(oid);
     char* ptr = (char*)pmemobj_direct_inline(oid);
-    result.value() = std::make_unique<PmemRegion>(this, regionID, ptr);
+    result.value() = std::make_unique<PmemRegion>(
+        this, shard.pool, regionID, ptr, std::move(token));
+    return result;
+}
+
+Result<RegionID> PmemTarget::createAndFill(
+        size_t size,
+        const std::function<Result<bool>(WritableRegion&)>& fill,
+        bool persist) {
+    (void)persist;
+    Result<RegionID> result;
+
+    // The object is reserved rather than allocated with a constructor:
+    // fill() may do a long RDMA transfer during which the ULT yields, which
+    // must not happen while pmemobj holds the locks of the arena (as it does
+    // when running a constructor). The reservation only becomes a persistent
+    // object once published, so a crash or a failed fill() leaves nothing.
+    auto token = m_migration_guard.enter();
+    uint64_t flags = 0;
+    auto& shard = nextShard(size, flags);
+    struct pobj_action action;
+    PMEMoid oid = pmemobj_xreserve(shard.pool, &action, size, 0, flags);
+    if(OID_IS_NULL(oid)) {
+        result.success() = false;
+        result.error() = fmt::format("pmemobj_xreserve failed: {}", pmemobj_errormsg());
+        return result;
+    }
+    char* ptr = static_cast<char*>(pmemobj_direct_inline(oid));
+
+    Result<bool> filled;
+    try {
+        PmemConstructionRegion region{m_engine, m_copy_engine, ptr};
+        filled = fill(region);
+    } catch(const std::exception& ex) {
+        filled.success() = false;
+        filled.error() = fmt::format("Failed to fill region: {}", ex.what());
+    }
+    if(!filled.success()) {
+        pmemobj_cancel(shard.pool, &action, 1);
+        result.success() = false;
+        result.error() = filled.error();
+        return result;
+    }
+
+    pmemobj_persist(shard.pool, ptr, size);
+    if(pmemobj_publish(shard.pool, &action, 1) != 0) {
+        result.success() = false;
+        result.error() = fmt::format("pmemobj_publish failed: {}", pmemobj_errormsg());
+        return result;
+    }
+    result.value() = PMEMoidToRegionID(oid);
     return result;
 }
 
@@ -195,45 +425,154 @@ Result<std::unique_ptr<WritableRegion>> PmemTarget::write(const RegionID& region
     (void)persist;
     Result<std::unique_ptr<WritableRegion>> result;
     PMEMoid oid = RegionIDtoPMEMoid(region_id);
-    char* ptr = (char*)pmemobj_direct_inline(oid);
-    if(!ptr) {
+    auto token = m_migration_guard.enter();
+    auto shard = findShard(oid);
+    if(!shard) {
         result.success() = false;
         result.error() = "Invalid RegionID";
         return result;
     }
-    m_migration_lock.rdlock();
-    result.value() = std::make_unique<PmemRegion>(this, region_id, ptr);
+    char* ptr = (char*)pmemobj_direct_inline(oid);
+    result.value() = std::make_unique<PmemRegion>(
+        this, shard->pool, region_id, ptr, std::move(token));
     return result;
 }
 
 Result<std::unique_ptr<ReadableRegion>> PmemTarget::read(const RegionID& region_id) {
     PMEMoid oid = RegionIDtoPMEMoid(region_id);
     Result<std::unique_ptr<ReadableRegion>> result;
-    char* ptr = (char*)pmemobj_direct_inline(oid);
-    if(!ptr) {
+    auto token = m_migration_guard.enter();
+    auto shard = findShard(oid);
+    if(!shard) {
         result.success() = false;
         result.error() = "Invalid RegionID";
         return result;
     }
-    m_migration_lock.rdlock();
-    result.value() = std::make_unique<PmemRegion>(this, region_id, ptr);
+    char* ptr = (char*)pmemobj_direct_inline(oid);
+    result.value() = std::make_unique<PmemRegion>(
+        this, shard->pool, region_id, ptr, std::move(token));
     return result;
 }
 
+template<typename Function>
+Result<bool> PmemTarget::accessRegion(const RegionID& region_id, Function&& function) {
+    PMEMoid oid = RegionIDtoPMEMoid(region_id);
+    Result<bool> result;
+    auto token = m_migration_guard.enter();
+    auto shard = findShard(oid);
+    if(!shard) {
+        result.success() = false;
+        result.error() = "Invalid RegionID";
+        return result;
+    }
+    char* ptr = (char*)pmemobj_direct_inline(oid);
+    PmemRegion region{this, shard->pool, region_id, ptr, std::move(token)};
+    return function(region);
+}
+
+Result<bool> PmemTarget::writeSegments(
+        const RegionID& region_id,
+        const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+        const void* data, bool persist) {
+    return accessRegion(region_id, [&](PmemRegion& region) {
+        return region.write(regionOffsetSizes, data, persist);
+    });
+}
+
+Result<bool> PmemTarget::pullSegments(
+        const RegionID& region_id,
+        const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+        TransferManager& transferManager,
+        thallium::bulk data,
+        const thallium::endpoint& address,
+        size_t bulkOffset,
+        bool persist) {
+    return accessRegion(region_id, [&](PmemRegion& region) {
+        return transferManager.pull(
+            region, regionOffsetSizes, data, address, bulkOffset, persist);
+    });
+}
+
+Result<bool> PmemTarget::persistSegments(
+        const RegionID& region_id,
+        const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes) {
+    return accessRegion(region_id, [&](PmemRegion& region) {
+        return region.persist(regionOffsetSizes);
+    });
+}
+
+Result<bool> PmemTarget::readSegments(
+        const RegionID& region_id,
+        const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+        void* data) {
+    return accessRegion(region_id, [&](PmemRegion& region) {
+        return region.read(regionOffsetSizes, data);
+    });
+}
+
+Result<bool> PmemTarget::pushSegments(
+        const RegionID& region_id,
+        const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+        TransferManager& transferManager,
+        thallium::bulk data,
+        const thallium::endpoint& address,
+        size_t bulkOffset) {
+    return accessRegion(region_id, [&](PmemRegion& region) {
+        return transferManager.push(
+            region, regionOffsetSizes, data, address, bulkOffset);
+    });
+}
+
 Result<bool> PmemTarget::erase(const RegionID& region_id) {
     auto oid = RegionIDtoPMEMoid(region_id);
     Result<bool> result;
-    char* ptr = (char*)pmemobj_direct_inline(oid);
-    if(!ptr) {
+    auto token = m_migration_guard.enter();
+    if(!findShard(oid)) {
         result.success() = false;
         result.error() = "Invalid RegionID";
         return result;
     }
-    m_migration_lock.rdlock();
     pmemobj_free(&oid);
     return result;
 }
 
+Result<bool> PmemTarget::advise(
+        const std::vector<RegionSegments>& regions, AccessHint hint) {
+    Result<bool> result;
+    int advice;
+    switch(hint) {
+    case AccessHint::Sequential: advice = MADV_SEQUENTIAL; break;
+    case AccessHint::Random:     advice = MADV_RANDOM;     break;
+    case AccessHint::WillNeed:   advice = MADV_WILLNEED;   break;
+    // the data lives in the file, there is nothing to release
+    case AccessHint::DontNeed:   return result;
+    default:                     advice = MADV_NORMAL;
+    }
+    auto token = m_migration_guard.enter();
+    const size_t page_size = numa::pageSize();
+    for(auto& region : regions) {
+        PMEMoid oid = RegionIDtoPMEMoid(region.first);
+        if(!findShard(oid)) {
+            result.success() = false;
+            result.error() = "Invalid RegionID";
+            return result;
+        }
+        char* ptr = (char*)pmemobj_direct_inline(oid);
+        size_t size = pmemobj_alloc_usable_size(oid);
+        for(auto& segment : region.second) {
+            if(segment.first >= size) continue;
+            auto begin = (uintptr_t)ptr + segment.first;
+            auto end   = begin + std::min(segment.second, size - segment.first);
+            auto page  = begin & ~(page_size - 1);
+            madvise((void*)page, end - page, advice);
+            if(hint != AccessHint::WillNeed) continue;
+            for(; page < end; page += page_size)
+                (void)*(volatile char*)std::max(page, begin);
+        }
+    }
+    return result;
+}
+
 Result<std::unique_ptr<MigrationHandle>> PmemTarget::startMigration(bool removeSource) {
     Result<std::unique_ptr<MigrationHandle>> result;
     result.value() = std::make_unique<PmemMigrationHandle>(this, removeSource);
@@ -249,34 +588,39 @@ Result<std::unique_ptr<warabi::Backend>> PmemTarget::recover(
         result.success() = false;
         return result;
     }
-    if(filenames.size() > 1) {
-        result.error() = "Pmem backend cannot recover from multiple files";
-        result.success() = false;
-        return result;
-    }
+    // shard files are named path, path.1, path.2, etc. but may
+    // be listed in lexicographical order, so we restore shard order
+    auto sorted_filenames = filenames;
+    std::sort(sorted_filenames.begin(), sorted_filenames.end(),
+        [](const std::string& lhs, const std::string& rhs) {
+            return std::make_pair(lhs.size(), lhs) < std::make_pair(rhs.size(), rhs);
+        });
     json cfg = config;
-    cfg["path"] = filenames[0];
-    const auto& path = filenames[0];
-
-    PMEMobjpool* pool = nullptr;
-
-    bool file_exists = std::filesystem::exists(path);
-    if(!file_exists) {
-        result.error() = fmt::format("File {} not found", path);
-        result.success() = false;
-        return result;
+    cfg["path"] = sorted_filenames[0];
+    cfg["num_shards"] = sorted_filenames.size();
+
+    std::vector<Shard> shards;
+    for(auto& path : sorted_filenames) {
+        bool file_exists = std::filesystem::exists(path);
+        if(!file_exists) {
+            result.error() = fmt::format("File {} not found", path);
+            result.success() = false;
+            break;
+        }
+        auto shard = openShard(path, cfg, 0);
+        if(!shard.success()) {
+            result.error() = shard.error();
+            result.success() = false;
+            break;
+        }
+        shards.push_back(std::move(shard.value()));
     }
-
-    pool = pmemobj_open(path.c_str(), NULL);
-    if(!pool) {
-        result.success() = false;
-        result.error() = fmt::format(
-            "Failed to open pmemobj target at {}: {}",
-            path, pmemobj_errormsg());
+    if(!result.success()) {
+        for(auto& shard : shards) pmemobj_close(shard.pool);
         return result;
     }
 
-    result.value() = std::make_unique<warabi::PmemTarget>(engine, cfg, pool);
+    result.value() = std::make_unique<warabi::PmemTarget>(engine, cfg, std::move(shards));
     return result;
 }
 
@@ -284,31 +628,34 @@ Result<std::unique_ptr<warabi::Backend>> PmemTarget::create(const thallium::engi
     const auto& path = config["path"].get_ref<const std::string&>();
     size_t create_if_missing_with_size = config.value("create_if_missing_with_size", 0);
     bool override_if_exists = config.value("override_if_exists", false);
+    size_t num_shards = config.value("num_shards", 1);
 
     Result<std::unique_ptr<warabi::Backend>> result;
 
-    PMEMobjpool* pool = nullptr;
-
-    bool file_exists = std::filesystem::exists(path);
-    if(file_exists && override_if_exists) {
-        std::filesystem::remove(path.c_str());
-        file_exists = false;
-    }
-    if(!file_exists) {
-        std::filesystem::create_directories(std::filesystem::path{path}.parent_path());
-        pool = pmemobj_create(path.c_str(), NULL, create_if_missing_with_size, 0644);
-    } else {
-        pool = pmemobj_open(path.c_str(), NULL);
+    std::vector<Shard> shards;
+    for(size_t i = 0; i < num_shards; ++i) {
+        auto filename = shardFilename(path, i);
+        bool file_exists = std::filesystem::exists(filename);
+        if(file_exists && override_if_exists) {
+            std::filesystem::remove(filename.c_str());
+            file_exists = false;
+        }
+        if(!file_exists)
+            std::filesystem::create_directories(std::filesystem::path{filename}.parent_path());
+        auto shard = openShard(filename, config, file_exists ? 0 : create_if_missing_with_size);
+        if(!shard.success()) {
+            result.success() = false;
+            result.error() = shard.error();
+            break;
+        }
+        shards.push_back(std::move(shard.value()));
     }
-    if(!pool) {
-        result.success() = false;
-        result.error() = fmt::format(
-            "Failed to create or open pmemobj target: {}",
-            pmemobj_errormsg());
+    if(!result.success()) {
+        for(auto& shard : shards) pmemobj_close(shard.pool);
         return result;
     }
 
-    result.value() = std::make_unique<warabi::PmemTarget>(engine, config, pool);
+    result.value() = std::make_unique<warabi::PmemTarget>(engine, config, std::move(shards));
     return result;
 }
 
@@ -320,7 +667,15 @@ Result<bool> PmemTarget::validate(const json& config) {
         "properties": {
             "path": {"type": "string"},
             "create_if_missing_with_size": {"type": "integer", "minimum": 8388608},
-            "override_if_exists": {"type": "boolean"}
+            "override_if_exists": {"type": "boolean"},
+            "num_shards": {"type": "integer", "minimum": 1},
+            "num_arenas": {"type": "integer", "minimum": 1},
+            "alloc_classes": {
+                "type": "array",
+                "items": {"type": "integer", "minimum": 8}
+            },
+            "alloc_class_header": {"enum": ["none", "compact"]},
+            "copy": {"type": "object"}
         },
         "required": ["path"]
     }
@@ -338,11 +693,18 @@ Result<bool> PmemTarget::validate(const json& config) {
             "Error(s) while validating JSON config for warabi PmemTarget: {}", ex.what());
         return result;
     }
+    if(config.contains("copy")) {
+        result = CopyEngine::validate(config["copy"]);
+        if(!result.success()) return result;
+    }
 
     const auto& path = config["path"].get_ref<const std::string&>();
     size_t create_if_missing_with_size = config.value("create_if_missing_with_size", 0);
     bool override_if_exists = config.value("override_if_exists", false);
-    bool file_exists = std::filesystem::exists(path);
+    size_t num_shards = config.value("num_shards", 1);
+    bool file_exists = true;
+    for(size_t i = 0; i < num_shards; ++i)
+        file_exists = file_exists && std::filesystem::exists(shardFilename(path, i));
 
     if(!file_exists && !create_if_missing_with_size) {
         result.error() = fmt::format(
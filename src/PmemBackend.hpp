@@ -7,6 +7,8 @@
 #define __PMEM_BACKEND_HPP
 
 #include <warabi/Backend.hpp>
+#include "MigrationGuard.hpp"
+#include "CopyEngine.hpp"
 #include <libpmemobj.h>
 
 namespace warabi {
@@ -18,15 +20,35 @@ struct PmemRegion;
 /**
  * Pmem-based implementation of an warabi Backend.
  */
-class PmemTarget : public warabi::Backend {
+class PmemTarget final : public warabi::Backend {
 
     friend struct PmemRegion;
 
+    /**
+     * @brief A target is made of one or more pools (shards), each in
+     * its own file. Regions are spread across shards in round-robin;
+     * the shard a region belongs to is identified by the pool UUID
+     * stored in its PMEMoid, hence in its RegionID.
+     */
+    struct Shard {
+        PMEMobjpool*                         pool = nullptr;
+        std::string                          filename;
+        // allocation classes registered in this pool, as (unit size, class id)
+        // sorted by unit size; class ids are not persistent, they are
+        // registered again every time the pool is opened
+        std::vector<std::pair<size_t, unsigned>> alloc_classes;
+    };
+
     thallium::engine               m_engine;
     json                           m_config;
-    PMEMobjpool*                   m_pmem_pool;
+    CopyEngine                     m_copy_engine;
+    std::vector<Shard>             m_shards;
+    std::atomic<size_t>            m_next_shard{0};
     std::string                    m_filename;
-    thallium::rwlock               m_migration_lock;
+    // size of the header of allocations made with the registered
+    // allocation classes (POBJ_HEADER_COMPACT or POBJ_HEADER_NONE)
+    size_t                         m_alloc_header_size;
+    MigrationGuard                 m_migration_guard;
 
     struct PmemMigrationHandle : public MigrationHandle {
 
@@ -36,10 +58,9 @@ class PmemTarget : public warabi::Backend {
         PmemMigrationHandle(PmemTarget* target, bool removeSource)
         : m_target(target)
         , m_remove_source(removeSource) {
-            m_target->m_migration_lock.wrlock();
+            m_target->m_migration_guard.beginMigration();
             if(m_remove_source) {
-                pmemobj_close(m_target->m_pmem_pool);
-                m_target->m_pmem_pool = nullptr;
+                m_target->closeShards();
             }
         }
 
@@ -47,7 +68,7 @@ class PmemTarget : public warabi::Backend {
             if(m_remove_source) {
                 m_target->destroy();
             }
-            m_target->m_migration_lock.unlock();
+            m_target->m_migration_guard.endMigration();
         }
 
         std::string getRoot() const override {
@@ -60,26 +81,37 @@ class PmemTarget : public warabi::Backend {
         }
 
         std::list<std::string> getFiles() const override {
-            size_t found = m_target->m_filename.find_last_of("/");
-            if(found != std::string::npos) {
-                return {m_target->m_filename.substr(found + 1)};
-            } else {
-                return {m_target->m_filename};
+            std::list<std::string> files;
+            for(auto& shard : m_target->m_shards) {
+                size_t found = shard.filename.find_last_of("/");
+                if(found != std::string::npos) {
+                    files.push_back(shard.filename.substr(found + 1));
+                } else {
+                    files.push_back(shard.filename);
+                }
             }
+            return files;
         }
 
         void cancel() override {
             m_remove_source = false;
-            m_target->m_pmem_pool = pmemobj_open(m_target->m_filename.c_str(), nullptr);
+            m_target->reopenShards();
         }
     };
 
+    /**
+     * @brief Build the region object for the given RegionID on the
+     * stack and call function on it.
+     */
+    template<typename Function>
+    Result<bool> accessRegion(const RegionID& region, Function&& function);
+
     public:
 
     /**
      * @brief Constructor.
      */
-    PmemTarget(thallium::engine engine, const json& config, PMEMobjpool* pool);
+    PmemTarget(thallium::engine engine, const json& config, std::vector<Shard> shards);
 
     /**
      * @brief Move-constructor.
@@ -101,6 +133,12 @@ class PmemTarget : public warabi::Backend {
      */
     std::string getConfig() const override;
 
+    /**
+     * @brief Get the NUMA node of the device of each
+     * shard as a JSON-formatted string.
+     */
+    std::string getStats() const override;
+
     /**
      * @brief Create a region of a given size and return
      * an std::unique_ptr to a WritableRegion, or nullptr
@@ -112,6 +150,19 @@ class PmemTarget : public warabi::Backend {
      */
     Result<std::unique_ptr<WritableRegion>> create(size_t size) override;
 
+    /**
+     * @brief Create a region by reserving an object (pmemobj_xreserve),
+     * filling it, persisting it with a single flush and drain, then
+     * publishing it, so that the region exists only if fill() succeeds
+     * (the reservation is cancelled otherwise). The region is always
+     * persisted, regardless of the persist argument, since it must be
+     * durable before it is published.
+     */
+    Result<RegionID> createAndFill(
+            size_t size,
+            const std::function<Result<bool>(WritableRegion&)>& fill,
+            bool persist) override;
+
     /**
      * @brief Request access to a particular region for writing.
      * If the region does not exist, returns a nullptr.
@@ -124,11 +175,53 @@ class PmemTarget : public warabi::Backend {
      */
     Result<std::unique_ptr<ReadableRegion>> read(const RegionID& region) override;
 
+    /**
+     * @brief Direct region access, building the region object on the stack.
+     * @see Backend::writeSegments and the other *Segments functions.
+     */
+    Result<bool> writeSegments(
+            const RegionID& region,
+            const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+            const void* data, bool persist) override;
+
+    Result<bool> pullSegments(
+            const RegionID& region,
+            const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+            TransferManager& transferManager,
+            thallium::bulk data,
+            const thallium::endpoint& address,
+            size_t bulkOffset,
+            bool persist) override;
+
+    Result<bool> persistSegments(
+            const RegionID& region,
+            const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes) override;
+
+    Result<bool> readSegments(
+            const RegionID& region,
+            const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+            void* data) override;
+
+    Result<bool> pushSegments(
+            const RegionID& region,
+            const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+            TransferManager& transferManager,
+            thallium::bulk data,
+            const thallium::endpoint& address,
+            size_t bulkOffset) override;
+
     /**
      * @see TopicHandle::erase
      */
     Result<bool> erase(const RegionID& region) override;
 
+    /**
+     * @brief Pass the hint to the kernel with madvise. For
+     * AccessHint::WillNeed, also pre-touch the pages so that the
+     * page faults happen now rather than during the next read.
+     */
+    Result<bool> advise(const std::vector<RegionSegments>& regions, AccessHint hint) override;
+
     /**
      * @brief Destroy the underlying storage.
      */
@@ -139,6 +232,38 @@ class PmemTarget : public warabi::Backend {
      */
     Result<std::unique_ptr<MigrationHandle>> startMigration(bool removeSource) override;
 
+    /**
+     * @brief Close the pools of all the shards.
+     */
+    void closeShards();
+
+    /**
+     * @brief Reopen the pools of all the shards after closeShards().
+     */
+    void reopenShards();
+
+    /**
+     * @brief Pick the shard in which to allocate the next region of the
+     * given size, and set flags to the allocation class to use.
+     */
+    Shard& nextShard(size_t size, uint64_t& flags);
+
+    /**
+     * @brief Find the shard a PMEMoid belongs to (nullptr if none).
+     */
+    Shard* findShard(const PMEMoid& oid);
+
+    /**
+     * @brief Open (or create, if size is not 0) the pool of a shard and
+     * apply the allocator settings from the configuration.
+     */
+    static Result<Shard> openShard(const std::string& filename, const json& config, size_t size);
+
+    /**
+     * @brief Name of the file of the shard of given index.
+     */
+    static std::string shardFilename(const std::string& path, size_t index);
+
     /**
      * @brief Static factory function used by the TargetFactory to
      * create a PmemTarget.
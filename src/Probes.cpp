@@ -0,0 +1,18 @@
+/*
+ * (C) 2024 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#include "Probes.hpp"
+
+#ifdef WARABI_HAS_USDT
+
+// sys/sdt.h expects the semaphores in the .probes section
+#define WARABI_DEFINE_PROBE_SEMAPHORE(name) \
+    __attribute__((section(".probes"))) unsigned short warabi_##name##_semaphore = 0;
+extern "C" {
+WARABI_PROBE_SEMAPHORES(WARABI_DEFINE_PROBE_SEMAPHORE)
+}
+#undef WARABI_DEFINE_PROBE_SEMAPHORE
+
+#endif
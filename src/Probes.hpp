@@ -0,0 +1,167 @@
+/*
+ * (C) 2024 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __WARABI_PROBES_HPP
+#define __WARABI_PROBES_HPP
+
+#include "config.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#ifdef WARABI_HAS_USDT
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+#include <time.h>
+
+/*
+ * Probe semaphores, defined in Probes.cpp. sys/sdt.h records their address
+ * in the probes' notes; they are hidden so that the client and server
+ * libraries each check their own.
+ */
+#define WARABI_PROBE_SEMAPHORES(X) \
+    X(handler_entry) X(handler_return) \
+    X(backend_entry) X(backend_return) \
+    X(transfer_entry) X(transfer_return) \
+    X(client_issue) X(client_complete)
+#define WARABI_DECLARE_PROBE_SEMAPHORE(name) \
+    extern "C" __attribute__((visibility("hidden"))) unsigned short warabi_##name##_semaphore;
+WARABI_PROBE_SEMAPHORES(WARABI_DECLARE_PROBE_SEMAPHORE)
+#undef WARABI_DECLARE_PROBE_SEMAPHORE
+#endif
+
+/**
+ * @brief USDT (user-level statically defined tracing) probes placed on the
+ * hot paths of warabi. They are compiled in when warabi is built with
+ * ENABLE_USDT=ON (the default when sys/sdt.h is available). Each probe
+ * has a semaphore that tools increment when they attach to it, and the
+ * probe's arguments (in particular its timestamps) are only computed when
+ * it is non-zero, so a probe costs a load and a branch until a tool such
+ * as bpftrace or perf attaches to it, e.g.:
+ *
+ *   bpftrace -e 'usdt:libwarabi-server.so:warabi:handler_return
+ *                { @us[str(arg0)] = hist(arg3 / 1000); }'
+ *
+ * Each probed operation has an entry and a return probe:
+ *
+ *   warabi:handler_entry(rpc, size, segments)
+ *   warabi:handler_return(rpc, size, segments, latency_ns)
+ *       RPC handlers of the provider (rpc is the RPC name, without
+ *       the "warabi_" prefix), from reception to response.
+ *   warabi:backend_entry(op, size, segments)
+ *   warabi:backend_return(op, size, segments, latency_ns)
+ *       Calls to the target (op is "read", "write", "persist"...).
+ *   warabi:transfer_entry(op, size, segments)
+ *   warabi:transfer_return(op, size, segments, latency_ns)
+ *       RDMA transfers of the TransferManager (op is "pull" or "push"),
+ *       one per chunk for the pipeline TransferManager.
+ *   warabi:client_issue(rpc, size, segments)
+ *   warabi:client_complete(rpc, size, segments, latency_ns)
+ *       Requests sent by TargetHandles, from issue to completion
+ *       (including retries).
+ *
+ * Without ENABLE_USDT, probes compile to nothing.
+ */
+namespace warabi {
+
+namespace probe {
+
+template<typename... Args>
+inline void ignore(const Args&...) {}
+
+#ifdef WARABI_HAS_USDT
+#define WARABI_PROBE(...) STAP_PROBEV(warabi, __VA_ARGS__)
+#define WARABI_PROBE_ENABLED(name) __builtin_expect(warabi_##name##_semaphore != 0, 0)
+#else
+#define WARABI_PROBE(name, ...) ::warabi::probe::ignore(__VA_ARGS__)
+#define WARABI_PROBE_ENABLED(name) false
+#endif
+
+enum class Kind : uint8_t { Handler, Backend, Transfer };
+
+/**
+ * @brief Current time in nanoseconds (0 without USDT support).
+ */
+inline uint64_t now() {
+#ifdef WARABI_HAS_USDT
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief RAII object firing the entry probe of an operation when
+ * constructed and its return probe when destroyed.
+ */
+class Scope {
+
+#ifdef WARABI_HAS_USDT
+    Kind        m_kind;
+    const char* m_name;
+    size_t      m_size;
+    size_t      m_segments;
+    uint64_t    m_start = 0; // 0 if the return probe was not enabled
+#endif
+
+    public:
+
+#ifdef WARABI_HAS_USDT
+    Scope(Kind kind, const char* name, size_t size, size_t segments)
+    : m_kind(kind)
+    , m_name(name)
+    , m_size(size)
+    , m_segments(segments) {
+        bool timed = false;
+        switch(m_kind) {
+        case Kind::Handler:
+            if(WARABI_PROBE_ENABLED(handler_entry))
+                WARABI_PROBE(handler_entry, m_name, m_size, m_segments);
+            timed = WARABI_PROBE_ENABLED(handler_return);
+            break;
+        case Kind::Backend:
+            if(WARABI_PROBE_ENABLED(backend_entry))
+                WARABI_PROBE(backend_entry, m_name, m_size, m_segments);
+            timed = WARABI_PROBE_ENABLED(backend_return);
+            break;
+        case Kind::Transfer:
+            if(WARABI_PROBE_ENABLED(transfer_entry))
+                WARABI_PROBE(transfer_entry, m_name, m_size, m_segments);
+            timed = WARABI_PROBE_ENABLED(transfer_return);
+            break;
+        }
+        if(timed) m_start = now();
+    }
+
+    ~Scope() {
+        // a tool attaching while the operation is in progress
+        // only sees the return probes of subsequent operations
+        if(!m_start) return;
+        uint64_t latency = now() - m_start;
+        switch(m_kind) {
+        case Kind::Handler:
+            WARABI_PROBE(handler_return, m_name, m_size, m_segments, latency); break;
+        case Kind::Backend:
+            WARABI_PROBE(backend_return, m_name, m_size, m_segments, latency); break;
+        case Kind::Transfer:
+            WARABI_PROBE(transfer_return, m_name, m_size, m_segments, latency); break;
+        }
+    }
+#else
+    Scope(Kind, const char*, size_t, size_t) {}
+    ~Scope() {}
+#endif
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+};
+
+}
+
+}
+
+#endif
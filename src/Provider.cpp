@@ -52,10 +52,36 @@ void Provider::migrateTarget(const std::string &address, uint16_t provider_id, c
     self->migrateTarget(address, provider_id, options);
 }
 
+void Provider::setQoSConfig(const std::string& config) {
+    if(!self) throw Exception("Invalid warabi::Provider object");
+    json json_config;
+    try {
+        json_config = json::parse(config);
+    } catch(const std::exception& ex) {
+        throw Exception(fmt::format("Could not parse QoS configuration: {}", ex.what()));
+    }
+    self->setQoSConfig(json_config).check();
+}
+
+void Provider::setTransferManagerConfig(const std::string& config) {
+    if(!self) throw Exception("Invalid warabi::Provider object");
+    json json_config;
+    try {
+        json_config = json::parse(config);
+    } catch(const std::exception& ex) {
+        throw Exception(fmt::format("Could not parse transfer manager configuration: {}", ex.what()));
+    }
+    self->setTransferManagerConfig(json_config).check();
+}
+
 std::string Provider::getConfig() const {
     return self ? self->getConfig() : "null";
 }
 
+std::string Provider::getStats() const {
+    return self ? self->getStats() : "null";
+}
+
 Provider::operator bool() const {
     return static_cast<bool>(self);
 }
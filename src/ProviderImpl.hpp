@@ -13,6 +13,16 @@
 #include "warabi/TransferManager.hpp"
 #include "warabi/MigrationOptions.hpp"
 #include "BufferWrapper.hpp"
+#include "MemoryBackend.hpp"
+#include "PmemBackend.hpp"
+#include "AbtIOBackend.hpp"
+#include "AdmissionController.hpp"
+#include "QoSManager.hpp"
+#include "LeaseManager.hpp"
+#include "Tracer.hpp"
+#include "Probes.hpp"
+#include "Recorder.hpp"
+#include "Numa.hpp"
 #include "Defer.hpp"
 
 #include <thallium.hpp>
@@ -25,6 +35,8 @@
 #include <nlohmann/json.hpp>
 #include <spdlog/spdlog.h>
 
+#include <array>
+#include <optional>
 #include <tuple>
 
 #ifdef WARABI_HAS_REMI
@@ -76,12 +88,47 @@ class ProviderImpl : public tl::provider<ProviderImpl> {
     tl::auto_remote_procedure m_create_write_eager;
     tl::auto_remote_procedure m_read;
     tl::auto_remote_procedure m_read_eager;
+    tl::auto_remote_procedure m_read_leased;
+    tl::auto_remote_procedure m_readv;
+    tl::auto_remote_procedure m_readv_eager;
+    tl::auto_remote_procedure m_writev;
+    tl::auto_remote_procedure m_writev_eager;
+    tl::auto_remote_procedure m_advise;
     tl::auto_remote_procedure m_erase;
+    tl::auto_remote_procedure m_pin;
+    tl::auto_remote_procedure m_copy;
+    tl::auto_remote_procedure m_clone;
+    tl::auto_remote_procedure m_create_snapshot;
+    tl::auto_remote_procedure m_restore_snapshot;
+    tl::auto_remote_procedure m_delete_snapshot;
     tl::auto_remote_procedure m_get_remi_provider_id;
+    tl::auto_remote_procedure m_set_transfer_manager;
 
     // Backend
     std::shared_ptr<Backend>         m_target;
+    // Built-in type of m_target, used to call it without virtual dispatch
+    enum class TargetKind { Other, Memory, Pmem, AbtIO };
+    TargetKind                       m_target_kind = TargetKind::Other;
+    // Accessed with std::atomic_load/exchange so that it can be replaced
+    // at run time; handlers keep a reference for the duration of a transfer
     std::shared_ptr<TransferManager> m_transfer_manager;
+    tl::mutex                        m_transfer_manager_mutex;
+
+    // Admission control and quality of service
+    AdmissionController              m_admission;
+    QoSManager                       m_qos;
+
+    // Read leases for client-side caches
+    LeaseManager                     m_leases;
+
+    // NUMA node of the handlers
+    NumaPolicy                       m_numa;
+
+    // Whether this provider enabled tracing (the Tracer is per-process)
+    bool                             m_tracing = false;
+
+    // Recording of the requests for warabi-replay
+    Recorder                         m_recorder;
 
     ProviderImpl(
             const tl::engine& engine,
@@ -103,8 +150,23 @@ class ProviderImpl : public tl::provider<ProviderImpl> {
     , m_create_write_eager(define("warabi_create_write_eager",  &ProviderImpl::createWriteEagerRPC, pool))
     , m_read(define("warabi_read",  &ProviderImpl::readRPC, pool))
     , m_read_eager(define("warabi_read_eager",  &ProviderImpl::readEagerRPC, pool))
+    , m_read_leased(define("warabi_read_leased",  &ProviderImpl::readLeasedRPC, pool))
+    , m_readv(define("warabi_readv",  &ProviderImpl::readvRPC, pool))
+    , m_readv_eager(define("warabi_readv_eager",  &ProviderImpl::readvEagerRPC, pool))
+    , m_writev(define("warabi_writev",  &ProviderImpl::writevRPC, pool))
+    , m_writev_eager(define("warabi_writev_eager",  &ProviderImpl::writevEagerRPC, pool))
+    , m_advise(define("warabi_advise",  &ProviderImpl::adviseRPC, pool))
     , m_erase(define("warabi_erase",  &ProviderImpl::eraseRPC, pool))
+    , m_pin(define("warabi_pin",  &ProviderImpl::pinRPC, pool))
+    , m_copy(define("warabi_copy",  &ProviderImpl::copyRPC, pool))
+    , m_clone(define("warabi_clone",  &ProviderImpl::cloneRPC, pool))
+    , m_create_snapshot(define("warabi_create_snapshot",  &ProviderImpl::createSnapshotRPC, pool))
+    , m_restore_snapshot(define("warabi_restore_snapshot",  &ProviderImpl::restoreSnapshotRPC, pool))
+    , m_delete_snapshot(define("warabi_delete_snapshot",  &ProviderImpl::deleteSnapshotRPC, pool))
     , m_get_remi_provider_id(define("warabi_get_remi_provider_id",  &ProviderImpl::getREMIproviderIdRPC, pool))
+    , m_set_transfer_manager(define("warabi_set_transfer_manager",  &ProviderImpl::setTransferManagerRPC, pool))
+    , m_qos(engine)
+    , m_leases(engine)
     {
         trace("Registered provider with id {}", get_provider_id());
         json json_config;
@@ -164,7 +226,13 @@ class ProviderImpl : public tl::provider<ProviderImpl> {
                         "type": {"type": "string"},
                         "config": {"type": "object"}
                     }
-                }
+                },
+                "qos": {"type": "object"},
+                "admission": {"type": "object"},
+                "leases": {"type": "object"},
+                "tracing": {"type": "object"},
+                "recording": {"type": "object"},
+                "numa": {"type": "object"}
             }
         }
         )"_json;
@@ -188,6 +256,46 @@ class ProviderImpl : public tl::provider<ProviderImpl> {
             setTransferManager(transfer_manager_type, transfer_manager_config);
         }
 
+        if(json_config.contains("qos")) {
+            setQoSConfig(json_config["qos"]).check();
+        }
+
+        if(json_config.contains("admission")) {
+            auto admission_config_is_valid = AdmissionController::validate(json_config["admission"]);
+            if(!admission_config_is_valid.success())
+                throw Exception(admission_config_is_valid.error());
+            m_admission.configure(json_config["admission"]);
+        }
+
+        if(json_config.contains("leases")) {
+            auto leases_config_is_valid = LeaseManager::validate(json_config["leases"]);
+            if(!leases_config_is_valid.success())
+                throw Exception(leases_config_is_valid.error());
+            m_leases.configure(json_config["leases"]);
+        }
+
+        if(json_config.contains("tracing")) {
+            auto tracing_config_is_valid = Tracer::validate(json_config["tracing"]);
+            if(!tracing_config_is_valid.success())
+                throw Exception(tracing_config_is_valid.error());
+            Tracer::instance().configure(json_config["tracing"]);
+            m_tracing = true;
+        }
+
+        if(json_config.contains("recording")) {
+            auto recording_config_is_valid = Recorder::validate(json_config["recording"]);
+            if(!recording_config_is_valid.success())
+                throw Exception(recording_config_is_valid.error());
+            m_recorder.configure(json_config["recording"]).check();
+        }
+
+        if(json_config.contains("numa")) {
+            auto numa_config_is_valid = NumaPolicy::validate(json_config["numa"]);
+            if(!numa_config_is_valid.success())
+                throw Exception(numa_config_is_valid.error());
+            m_numa.configure(json_config["numa"]);
+        }
+
         if(json_config.contains("target")) {
             auto& target = json_config["target"];
             auto& target_type = target["type"].get_ref<const std::string&>();
@@ -208,6 +316,14 @@ class ProviderImpl : public tl::provider<ProviderImpl> {
         }
 #endif
         if(m_target) m_target->destroy();
+        if(m_tracing) {
+            auto flushed = Tracer::instance().flush();
+            if(!flushed.success()) error("{}", flushed.error());
+        }
+        if(m_recorder.enabled()) {
+            auto flushed = m_recorder.flush();
+            if(!flushed.success()) error("{}", flushed.error());
+        }
     }
 
     std::string getConfig() const {
@@ -220,11 +336,53 @@ class ProviderImpl : public tl::provider<ProviderImpl> {
         }
         config["transfer_manager"] = json::object();
         auto& tm = config["transfer_manager"];
-        tm["type"] = m_transfer_manager->name();
-        tm["config"] = json::parse(m_transfer_manager->getConfig());
+        auto transfer_manager = transferManager();
+        tm["type"] = transfer_manager->name();
+        tm["config"] = json::parse(transfer_manager->getConfig());
+        if(m_qos.enabled())
+            config["qos"] = m_qos.getConfig();
+        if(!m_admission.getConfig().is_null())
+            config["admission"] = m_admission.getConfig();
+        if(!m_leases.getConfig().is_null())
+            config["leases"] = m_leases.getConfig();
+        if(m_tracing)
+            config["tracing"] = Tracer::instance().getConfig();
+        if(m_recorder.enabled())
+            config["recording"] = m_recorder.getConfig();
+        if(!m_numa.getConfig().is_null())
+            config["numa"] = m_numa.getConfig();
         return config.dump();
     }
 
+    std::string getStats() const {
+        auto stats = json::object();
+        stats["admission"] = m_admission.getStats();
+        stats["qos"]       = m_qos.getStats();
+        stats["leases"]    = m_leases.getStats();
+        if(m_tracing)
+            stats["tracing"] = Tracer::instance().getStats();
+        if(m_recorder.enabled())
+            stats["recording"] = m_recorder.getStats();
+        stats["numa"]      = m_numa.getStats();
+        if(m_target)
+            stats["target"] = json::parse(m_target->getStats());
+        return stats.dump();
+    }
+
+    Result<bool> setQoSConfig(const json& config) {
+        if(config.is_null()) {
+            m_qos.configure(config);
+            return Result<bool>{};
+        }
+        auto valid = QoSManager::validate(config);
+        if(!valid.success()) {
+            error("{}", valid.error());
+            return valid;
+        }
+        m_qos.configure(config);
+        return valid;
+    }
+
     Result<bool> validateTargetConfig(
             const std::string& target_type,
             const json& target_config) {
@@ -241,16 +399,66 @@ class ProviderImpl : public tl::provider<ProviderImpl> {
             return result;
         } else {
             m_target = std::move(target.value());
+            m_target_kind = targetKindOf(m_target.get());
         }
         return result;
     }
 
+    static TargetKind targetKindOf(Backend* target) {
+        if(dynamic_cast<MemoryTarget*>(target)) return TargetKind::Memory;
+        if(dynamic_cast<PmemTarget*>(target))   return TargetKind::Pmem;
+        if(dynamic_cast<AbtIOTarget*>(target))  return TargetKind::AbtIO;
+        return TargetKind::Other;
+    }
+
+    /**
+     * @brief Call function on m_target, cast to its concrete type if it is
+     * one of the built-in (final) backends so that calls made by function
+     * are resolved statically. Other backends are called through Backend&.
+     * op ("read", "write"...) and segments describe the operation for
+     * tracing.
+     */
+    template<typename Segments, typename Function>
+    auto withTarget(const char* op, const Segments& segments, Function&& function) {
+        probe::Scope probe_scope{probe::Kind::Backend, op, totalSize(segments), segmentCount(segments)};
+        Tracer::Span span{"target", op};
+        switch(m_target_kind) {
+        case TargetKind::Memory:
+            return function(static_cast<MemoryTarget&>(*m_target));
+        case TargetKind::Pmem:
+            return function(static_cast<PmemTarget&>(*m_target));
+        case TargetKind::AbtIO:
+            return function(static_cast<AbtIOTarget&>(*m_target));
+        default:
+            return function(*m_target);
+        }
+    }
+
+    /**
+     * @brief Endpoint holding the bulk handle of a request:
+     * the sender's, unless another address was provided.
+     */
+    tl::endpoint lookupSource(const tl::request& req, const std::string& address) {
+        if(address.empty()) return req.get_endpoint();
+        Tracer::Span span{"provider", "lookup"};
+        return m_engine.lookup(address);
+    }
+
     Result<bool> validateTransferManagerConfig(
             const std::string& type,
             const json& config) {
         return TransferManagerFactory::validateConfig(type, config);
     }
 
+    std::shared_ptr<TransferManager> transferManager() const {
+        return std::atomic_load(&m_transfer_manager);
+    }
+
+    /**
+     * @brief Create a TransferManager and atomically replace the current one
+     * with it. Transfers that already started complete with the previous
+     * TransferManager; this function waits for them before destroying it.
+     */
     Result<bool> setTransferManager(const std::string& type,
                                     const json& config) {
 
@@ -260,17 +468,122 @@ class ProviderImpl : public tl::provider<ProviderImpl> {
             result.success() = false;
             result.error() = tm.error();
             return result;
-        } else {
-            m_transfer_manager = std::move(tm.value());
         }
+        auto previous = std::atomic_exchange(
+            &m_transfer_manager, std::shared_ptr<TransferManager>{std::move(tm.value())});
+        while(previous && previous.use_count() > 1)
+            tl::thread::sleep(m_engine, 1);
+        return result;
+    }
+
+    /**
+     * @brief Change the TransferManager at run time. The config has the
+     * format of the "transfer_manager" field of the provider's configuration.
+     * If its type is missing or is that of the current TransferManager, its
+     * "config" is merged into the current configuration (JSON merge patch),
+     * so that only the parameters to change need to be provided.
+     */
+    Result<bool> setTransferManagerConfig(const json& config) {
+        static const json schema = R"(
+        {
+            "type": "object",
+            "properties": {
+                "type": {"type": "string"},
+                "config": {"type": "object"}
+            }
+        }
+        )"_json;
+        Result<bool> result;
+        json_validator validator;
+        validator.set_root_schema(schema);
+        try {
+            validator.validate(config);
+        } catch(const std::exception& ex) {
+            result.success() = false;
+            result.error() = fmt::format(
+                "Error(s) while validating JSON config for warabi transfer manager: {}", ex.what());
+            error("{}", result.error());
+            return result;
+        }
+        std::unique_lock<tl::mutex> lock{m_transfer_manager_mutex};
+        std::string type;
+        auto tm_config = config.value("config", json::object());
+        {
+            auto current = transferManager();
+            type = config.value("type", current->name());
+            if(type == current->name()) {
+                auto merged = json::parse(current->getConfig());
+                merged.merge_patch(tm_config);
+                tm_config = std::move(merged);
+            }
+        }
+        result = validateTransferManagerConfig(type, tm_config);
+        if(!result.success()) {
+            error("{}", result.error());
+            return result;
+        }
+        result = setTransferManager(type, tm_config);
+        if(result.success())
+            info("Transfer manager changed to {} with configuration {}", type, tm_config.dump());
         return result;
     }
 
+    static size_t totalSize(const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes) {
+        return std::accumulate(regionOffsetSizes.begin(), regionOffsetSizes.end(), (size_t)0,
+                [](size_t acc, const std::pair<size_t, size_t>& p) { return acc + p.second; });
+    }
+
+    static std::vector<RegionID> regionIDs(const std::vector<RegionSegments>& regions) {
+        std::vector<RegionID> ids;
+        ids.reserve(regions.size());
+        for(auto& region : regions) ids.push_back(region.first);
+        return ids;
+    }
+
+    static size_t totalSize(const std::vector<RegionSegments>& regions) {
+        return std::accumulate(regions.begin(), regions.end(), (size_t)0,
+                [](size_t acc, const RegionSegments& r) { return acc + totalSize(r.second); });
+    }
+
+    static size_t segmentCount(const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes) {
+        return regionOffsetSizes.size();
+    }
+
+    static size_t segmentCount(const std::vector<RegionSegments>& regions) {
+        return std::accumulate(regions.begin(), regions.end(), (size_t)0,
+                [](size_t acc, const RegionSegments& r) { return acc + r.second.size(); });
+    }
+
+    template<typename Segments>
+    static probe::Scope handlerProbe(const char* rpc, const Segments& segments) {
+        return {probe::Kind::Handler, rpc, totalSize(segments), segmentCount(segments)};
+    }
+
+    template<typename ResultType>
+    static void rejectAsBusy(ResultType& result, const AdmissionController::Ticket& admission) {
+        result.success() = false;
+        result.error() = "Target is busy, retry later";
+        result.retryAfter() = admission.retryAfter();
+    }
+
     void createRPC(const tl::request& req,
-                   size_t size) {
+                   size_t size,
+                   uint64_t trace_id) {
         trace("Received create request with size {}", size);
+        probe::Scope probe_scope{probe::Kind::Handler, "create", size, 0};
+        auto recording = m_recorder.record(record::Op::Create, req);
+        recording.setSize(size);
+        Tracer::Scope trace_scope{Tracer::instance().accept(trace_id)};
+        Tracer::Span  trace_span{"provider", "create"};
         Result<RegionID> result;
         tl::auto_respond<decltype(result)> response{req, result};
+        m_numa.pinHandler();
+        auto admission = m_admission.admit(0);
+        if(!admission) {
+            rejectAsBusy(result, admission);
+            return;
+        }
+        auto ticket = m_qos.admit(req, 0);
         if(!m_target) {
             result.success() = false;
             result.error() = "No target found in the provider";
@@ -283,6 +596,7 @@ class ProviderImpl : public tl::provider<ProviderImpl> {
             return;
         }
         result = region.value()->getRegionID();
+        if(result.success()) recording.setCreated(result.value());
         trace("Successfully executed create request");
     }
 
@@ -292,24 +606,35 @@ class ProviderImpl : public tl::provider<ProviderImpl> {
                   thallium::bulk data,
                   const std::string& address,
                   size_t bulkOffset,
-                  bool persist) {
+                  bool persist,
+                  uint64_t trace_id) {
         trace("Received write request");
+        auto probe_scope = handlerProbe("write", regionOffsetSizes);
+        auto recording = m_recorder.record(record::Op::Write, req, (persist ? record::Flags::Persist : 0));
+        recording.add(region_id, regionOffsetSizes);
+        Tracer::Scope trace_scope{Tracer::instance().accept(trace_id)};
+        Tracer::Span  trace_span{"provider", "write"};
         Result<bool> result;
         tl::auto_respond<decltype(result)> response{req, result};
-        if(!m_target) {
-            result.success() = false;
-            result.error() = "No target found in the provider";
+        m_numa.pinHandler();
+        auto admission = m_admission.admit(totalSize(regionOffsetSizes));
+        if(!admission) {
+            rejectAsBusy(result, admission);
             return;
         }
-        auto region = m_target->write(region_id, persist);
-        if(!region.success()) {
+        auto ticket = m_qos.admit(req, totalSize(regionOffsetSizes));
+        if(!m_target) {
             result.success() = false;
-            result.error() = region.error();
+            result.error() = "No target found in the provider";
             return;
         }
-        auto source = address.empty() ? req.get_endpoint() : m_engine.lookup(address);
-        result = m_transfer_manager->pull(
-                *region.value(), regionOffsetSizes, data, source, bulkOffset, persist);
+        auto lease_guard = m_leases.acquireWrite(region_id);
+        auto source = lookupSource(req, address);
+        auto transfer_manager = transferManager();
+        result = withTarget("write", regionOffsetSizes, [&](auto& target) {
+            return target.pullSegments(region_id, regionOffsetSizes,
+                *transfer_manager, data, source, bulkOffset, persist);
+        });
         trace("Successfully executed write request");
     }
 
@@ -317,43 +642,62 @@ class ProviderImpl : public tl::provider<ProviderImpl> {
                        const RegionID& region_id,
                        const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
                        const BufferWrapper& buffer,
-                       bool persist) {
+                       bool persist,
+                       uint64_t trace_id) {
         trace("Received write_eager request");
+        auto probe_scope = handlerProbe("write_eager", regionOffsetSizes);
+        auto recording = m_recorder.record(record::Op::Write, req, record::Flags::Eager | (persist ? record::Flags::Persist : 0));
+        recording.add(region_id, regionOffsetSizes);
+        Tracer::Scope trace_scope{Tracer::instance().accept(trace_id)};
+        Tracer::Span  trace_span{"provider", "write_eager"};
         Result<bool> result;
         tl::auto_respond<decltype(result)> response{req, result};
-        if(!m_target) {
-            result.success() = false;
-            result.error() = "No target found in the provider";
+        m_numa.pinHandler();
+        auto admission = m_admission.admit(buffer.size());
+        if(!admission) {
+            rejectAsBusy(result, admission);
             return;
         }
-        auto region = m_target->write(region_id, persist);
-        if(!region.success()) {
+        auto ticket = m_qos.admit(req, buffer.size());
+        if(!m_target) {
             result.success() = false;
-            result.error() = region.error();
+            result.error() = "No target found in the provider";
             return;
         }
-        result = region.value()->write(regionOffsetSizes, buffer.data(), persist);
+        auto lease_guard = m_leases.acquireWrite(region_id);
+        result = withTarget("write", regionOffsetSizes, [&](auto& target) {
+            return target.writeSegments(region_id, regionOffsetSizes, buffer.data(), persist);
+        });
         trace("Successfully executed write_eager request");
     }
 
     void persistRPC(const tl::request& req,
                     const RegionID& region_id,
-                    const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes) {
+                    const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+                    uint64_t trace_id) {
         trace("Received persist request");
+        auto probe_scope = handlerProbe("persist", regionOffsetSizes);
+        auto recording = m_recorder.record(record::Op::Persist, req);
+        recording.add(region_id, regionOffsetSizes);
+        Tracer::Scope trace_scope{Tracer::instance().accept(trace_id)};
+        Tracer::Span  trace_span{"provider", "persist"};
         Result<bool> result;
         tl::auto_respond<decltype(result)> response{req, result};
-        if(!m_target) {
-            result.success() = false;
-            result.error() = "No target found in the provider";
+        m_numa.pinHandler();
+        auto admission = m_admission.admit(0);
+        if(!admission) {
+            rejectAsBusy(result, admission);
             return;
         }
-        auto region = m_target->write(region_id, true);
-        if(!region.success()) {
+        auto ticket = m_qos.admit(req, 0);
+        if(!m_target) {
             result.success() = false;
-            result.error() = region.error();
+            result.error() = "No target found in the provider";
             return;
         }
-        result = region.value()->persist(regionOffsetSizes);
+        result = withTarget("persist", regionOffsetSizes, [&](auto& target) {
+            return target.persistSegments(region_id, regionOffsetSizes);
+        });
         trace("Successfully executed persist request");
     }
 
@@ -361,57 +705,68 @@ class ProviderImpl : public tl::provider<ProviderImpl> {
                         thallium::bulk data,
                         const std::string& address,
                         size_t bulkOffset, size_t size,
-                        bool persist) {
+                        bool persist,
+                        uint64_t trace_id) {
         trace("Received create_write request");
+        probe::Scope probe_scope{probe::Kind::Handler, "create_write", size, 1};
+        auto recording = m_recorder.record(record::Op::CreateWrite, req, (persist ? record::Flags::Persist : 0));
+        recording.setSize(size);
+        Tracer::Scope trace_scope{Tracer::instance().accept(trace_id)};
+        Tracer::Span  trace_span{"provider", "create_write"};
         Result<RegionID> result;
         tl::auto_respond<decltype(result)> response{req, result};
-        if(!m_target) {
-            result.success() = false;
-            result.error() = "No target found in the provider";
+        m_numa.pinHandler();
+        auto admission = m_admission.admit(size);
+        if(!admission) {
+            rejectAsBusy(result, admission);
             return;
         }
-        auto region = m_target->create(size);
-        if(!region.success()) {
+        auto ticket = m_qos.admit(req, size);
+        if(!m_target) {
             result.success() = false;
-            result.error() = region.error();
+            result.error() = "No target found in the provider";
             return;
         }
-        result = region.value()->getRegionID();
-        auto source = address.empty() ? req.get_endpoint() : m_engine.lookup(address);
-        Result<bool> writeResult;
-        writeResult = m_transfer_manager->pull(
-                *region.value(), {{0, size}}, data, source, bulkOffset, persist);
-        if(!writeResult.success()) {
-            result.success() = false;
-            result.error() = writeResult.error();
-        }
+        auto source = lookupSource(req, address);
+        auto transfer_manager = transferManager();
+        result = m_target->createAndFill(size,
+            [&](WritableRegion& region) {
+                return transfer_manager->pull(
+                    region, {{0, size}}, data, source, bulkOffset, false);
+            }, persist);
+        if(result.success()) recording.setCreated(result.value());
         trace("Successfully executed create_write request");
     }
 
     void createWriteEagerRPC(const tl::request& req,
                              const BufferWrapper& buffer,
-                             bool persist) {
+                             bool persist,
+                             uint64_t trace_id) {
         trace("Received create_write_eager request");
+        probe::Scope probe_scope{probe::Kind::Handler, "create_write_eager", buffer.size(), 1};
+        auto recording = m_recorder.record(record::Op::CreateWrite, req, record::Flags::Eager | (persist ? record::Flags::Persist : 0));
+        recording.setSize(buffer.size());
+        Tracer::Scope trace_scope{Tracer::instance().accept(trace_id)};
+        Tracer::Span  trace_span{"provider", "create_write_eager"};
         Result<RegionID> result;
         tl::auto_respond<decltype(result)> response{req, result};
-        if(!m_target) {
-            result.success() = false;
-            result.error() = "No target found in the provider";
+        m_numa.pinHandler();
+        auto admission = m_admission.admit(buffer.size());
+        if(!admission) {
+            rejectAsBusy(result, admission);
             return;
         }
-        auto region = m_target->create(buffer.size());
-        if(!region.success()) {
+        auto ticket = m_qos.admit(req, buffer.size());
+        if(!m_target) {
             result.success() = false;
-            result.error() = region.error();
+            result.error() = "No target found in the provider";
             return;
         }
-        result = region.value()->getRegionID();
-        auto writeResult = region.value()->write(
-                {{0, buffer.size()}}, buffer.data(), persist);
-        if(!writeResult.success()) {
-            result.success() = false;
-            result.error() = writeResult.error();
-        }
+        result = m_target->createAndFill(buffer.size(),
+            [&](WritableRegion& region) {
+                return region.write({{0, buffer.size()}}, buffer.data(), false);
+            }, persist);
+        if(result.success()) recording.setCreated(result.value());
         trace("Successfully executed create_write_eager request");
     }
 
@@ -420,71 +775,624 @@ class ProviderImpl : public tl::provider<ProviderImpl> {
                  const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
                  thallium::bulk data,
                  const std::string& address,
-                 size_t bulkOffset) {
+                 size_t bulkOffset,
+                 uint64_t trace_id) {
         trace("Received read request");
+        auto probe_scope = handlerProbe("read", regionOffsetSizes);
+        auto recording = m_recorder.record(record::Op::Read, req);
+        recording.add(region_id, regionOffsetSizes);
+        Tracer::Scope trace_scope{Tracer::instance().accept(trace_id)};
+        Tracer::Span  trace_span{"provider", "read"};
         Result<bool> result;
         tl::auto_respond<decltype(result)> response{req, result};
-        if(!m_target) {
-            result.success() = false;
-            result.error() = "No target found in the provider";
+        m_numa.pinHandler();
+        auto admission = m_admission.admit(totalSize(regionOffsetSizes));
+        if(!admission) {
+            rejectAsBusy(result, admission);
             return;
         }
-        auto region = m_target->read(region_id);
-        if(!region.value()) {
+        auto ticket = m_qos.admit(req, totalSize(regionOffsetSizes));
+        if(!m_target) {
             result.success() = false;
-            result.error() = region.error();
+            result.error() = "No target found in the provider";
             return;
         }
-        auto source = address.empty() ? req.get_endpoint() : m_engine.lookup(address);
-        result = m_transfer_manager->push(
-                *region.value(), regionOffsetSizes, data, source, bulkOffset);
+        auto source = lookupSource(req, address);
+        auto transfer_manager = transferManager();
+        result = withTarget("read", regionOffsetSizes, [&](auto& target) {
+            return target.pushSegments(region_id, regionOffsetSizes,
+                *transfer_manager, data, source, bulkOffset);
+        });
         trace("Successfully executed read request");
     }
 
     void readEagerRPC(const tl::request& req,
                       const RegionID& region_id,
-                      const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes) {
+                      const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+                      uint64_t trace_id) {
         trace("Received read_eager request");
+        auto probe_scope = handlerProbe("read_eager", regionOffsetSizes);
+        auto recording = m_recorder.record(record::Op::Read, req, record::Flags::Eager);
+        recording.add(region_id, regionOffsetSizes);
+        Tracer::Scope trace_scope{Tracer::instance().accept(trace_id)};
+        Tracer::Span  trace_span{"provider", "read_eager"};
         Result<BufferWrapper> result;
         tl::auto_respond<decltype(result)> response{req, result};
+        m_numa.pinHandler();
+        auto admission = m_admission.admit(totalSize(regionOffsetSizes));
+        if(!admission) {
+            rejectAsBusy(result, admission);
+            return;
+        }
+        auto ticket = m_qos.admit(req, totalSize(regionOffsetSizes));
         if(!m_target) {
             result.success() = false;
             result.error() = "No target found in the provider";
             return;
         }
-        auto region = m_target->read(region_id);
-        if(!region.value()) {
+        size_t size = totalSize(regionOffsetSizes);
+        result.value().allocate(size);
+        auto ret = withTarget("read", regionOffsetSizes, [&](auto& target) {
+            return target.readSegments(region_id, regionOffsetSizes, result.value().data());
+        });
+        if(!ret.success()) {
             result.success() = false;
-            result.error() = region.error();
+            result.error() = ret.error();
+            result.evicted() = ret.evicted();
+        }
+        trace("Successfully executed read_eager request");
+    }
+
+    void readLeasedRPC(const tl::request& req,
+                       const RegionID& region_id,
+                       const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+                       uint64_t trace_id) {
+        trace("Received read_leased request");
+        auto probe_scope = handlerProbe("read_leased", regionOffsetSizes);
+        auto recording = m_recorder.record(record::Op::Read, req, record::Flags::Eager);
+        recording.add(region_id, regionOffsetSizes);
+        Tracer::Scope trace_scope{Tracer::instance().accept(trace_id)};
+        Tracer::Span  trace_span{"provider", "read_leased"};
+        Result<LeasedBuffer> result;
+        tl::auto_respond<decltype(result)> response{req, result};
+        m_numa.pinHandler();
+        auto admission = m_admission.admit(totalSize(regionOffsetSizes));
+        if(!admission) {
+            rejectAsBusy(result, admission);
             return;
         }
-        size_t size = std::accumulate(regionOffsetSizes.begin(), regionOffsetSizes.end(), (size_t)0,
-                [](size_t acc, const std::pair<size_t, size_t>& p) { return acc + p.second; });
-        result.value().allocate(size);
-        auto ret = region.value()->read(regionOffsetSizes, result.value().data());
+        auto ticket = m_qos.admit(req, totalSize(regionOffsetSizes));
+        if(!m_target) {
+            result.success() = false;
+            result.error() = "No target found in the provider";
+            return;
+        }
+        // the lease is granted before reading, so that
+        // a write can't slip between the read and the grant
+        result.value().lease_ms = m_leases.grant(region_id);
+        result.value().buffer.allocate(totalSize(regionOffsetSizes));
+        auto ret = withTarget("read", regionOffsetSizes, [&](auto& target) {
+            return target.readSegments(region_id, regionOffsetSizes, result.value().buffer.data());
+        });
         if(!ret.success()) {
             result.success() = false;
             result.error() = ret.error();
+            result.evicted() = ret.evicted();
         }
-        trace("Successfully executed read_eager request");
+        trace("Successfully executed read_leased request");
+    }
+
+    void readvRPC(const tl::request& req,
+                  const std::vector<RegionSegments>& regions,
+                  thallium::bulk data,
+                  const std::string& address,
+                  size_t bulkOffset,
+                  uint64_t trace_id) {
+        trace("Received readv request");
+        auto probe_scope = handlerProbe("readv", regions);
+        auto recording = m_recorder.record(record::Op::Read, req);
+        recording.add(regions);
+        Tracer::Scope trace_scope{Tracer::instance().accept(trace_id)};
+        Tracer::Span  trace_span{"provider", "readv"};
+        Result<bool> result;
+        tl::auto_respond<decltype(result)> response{req, result};
+        m_numa.pinHandler();
+        auto admission = m_admission.admit(totalSize(regions));
+        if(!admission) {
+            rejectAsBusy(result, admission);
+            return;
+        }
+        auto ticket = m_qos.admit(req, totalSize(regions));
+        if(!m_target) {
+            result.success() = false;
+            result.error() = "No target found in the provider";
+            return;
+        }
+        auto source = lookupSource(req, address);
+        auto transfer_manager = transferManager();
+        result = withTarget("read", regions, [&](auto& target) {
+            return target.pushRegions(regions, *transfer_manager, data, source, bulkOffset);
+        });
+        trace("Successfully executed readv request");
+    }
+
+    void readvEagerRPC(const tl::request& req,
+                       const std::vector<RegionSegments>& regions,
+                       uint64_t trace_id) {
+        trace("Received readv_eager request");
+        auto probe_scope = handlerProbe("readv_eager", regions);
+        auto recording = m_recorder.record(record::Op::Read, req, record::Flags::Eager);
+        recording.add(regions);
+        Tracer::Scope trace_scope{Tracer::instance().accept(trace_id)};
+        Tracer::Span  trace_span{"provider", "readv_eager"};
+        Result<BufferWrapper> result;
+        tl::auto_respond<decltype(result)> response{req, result};
+        m_numa.pinHandler();
+        auto admission = m_admission.admit(totalSize(regions));
+        if(!admission) {
+            rejectAsBusy(result, admission);
+            return;
+        }
+        auto ticket = m_qos.admit(req, totalSize(regions));
+        if(!m_target) {
+            result.success() = false;
+            result.error() = "No target found in the provider";
+            return;
+        }
+        result.value().allocate(totalSize(regions));
+        auto ret = withTarget("read", regions, [&](auto& target) {
+            return target.readRegions(regions, result.value().data());
+        });
+        if(!ret.success()) {
+            result.success() = false;
+            result.error() = ret.error();
+            result.evicted() = ret.evicted();
+        }
+        trace("Successfully executed readv_eager request");
+    }
+
+    void writevRPC(const tl::request& req,
+                   const std::vector<RegionSegments>& regions,
+                   thallium::bulk data,
+                   const std::string& address,
+                   size_t bulkOffset,
+                   bool persist,
+                   uint64_t trace_id) {
+        trace("Received writev request");
+        auto probe_scope = handlerProbe("writev", regions);
+        auto recording = m_recorder.record(record::Op::Write, req, (persist ? record::Flags::Persist : 0));
+        recording.add(regions);
+        Tracer::Scope trace_scope{Tracer::instance().accept(trace_id)};
+        Tracer::Span  trace_span{"provider", "writev"};
+        Result<bool> result;
+        tl::auto_respond<decltype(result)> response{req, result};
+        m_numa.pinHandler();
+        auto admission = m_admission.admit(totalSize(regions));
+        if(!admission) {
+            rejectAsBusy(result, admission);
+            return;
+        }
+        auto ticket = m_qos.admit(req, totalSize(regions));
+        if(!m_target) {
+            result.success() = false;
+            result.error() = "No target found in the provider";
+            return;
+        }
+        auto lease_guard = m_leases.acquireWrite(regionIDs(regions));
+        auto source = lookupSource(req, address);
+        auto transfer_manager = transferManager();
+        result = withTarget("write", regions, [&](auto& target) {
+            return target.pullRegions(regions, *transfer_manager, data, source, bulkOffset, persist);
+        });
+        trace("Successfully executed writev request");
+    }
+
+    void writevEagerRPC(const tl::request& req,
+                        const std::vector<RegionSegments>& regions,
+                        const BufferWrapper& buffer,
+                        bool persist,
+                        uint64_t trace_id) {
+        trace("Received writev_eager request");
+        auto probe_scope = handlerProbe("writev_eager", regions);
+        auto recording = m_recorder.record(record::Op::Write, req, record::Flags::Eager | (persist ? record::Flags::Persist : 0));
+        recording.add(regions);
+        Tracer::Scope trace_scope{Tracer::instance().accept(trace_id)};
+        Tracer::Span  trace_span{"provider", "writev_eager"};
+        Result<bool> result;
+        tl::auto_respond<decltype(result)> response{req, result};
+        m_numa.pinHandler();
+        auto admission = m_admission.admit(buffer.size());
+        if(!admission) {
+            rejectAsBusy(result, admission);
+            return;
+        }
+        auto ticket = m_qos.admit(req, buffer.size());
+        if(!m_target) {
+            result.success() = false;
+            result.error() = "No target found in the provider";
+            return;
+        }
+        if(buffer.size() != totalSize(regions)) {
+            result.success() = false;
+            result.error() = "Buffer size doesn't match the size of the segments";
+            return;
+        }
+        auto lease_guard = m_leases.acquireWrite(regionIDs(regions));
+        result = withTarget("write", regions, [&](auto& target) {
+            return target.writeRegions(regions, buffer.data(), persist);
+        });
+        trace("Successfully executed writev_eager request");
+    }
+
+    void adviseRPC(const tl::request& req,
+                   const std::vector<RegionSegments>& regions,
+                   uint8_t hint) {
+        trace("Received advise request");
+        auto probe_scope = handlerProbe("advise", regions);
+        Result<bool> result;
+        tl::auto_respond<decltype(result)> response{req, result};
+        m_numa.pinHandler();
+        // only prefetching causes I/O
+        size_t size = hint == (uint8_t)AccessHint::WillNeed ? totalSize(regions) : 0;
+        auto admission = m_admission.admit(size);
+        if(!admission) {
+            rejectAsBusy(result, admission);
+            return;
+        }
+        auto ticket = m_qos.admit(req, size);
+        if(!m_target) {
+            result.success() = false;
+            result.error() = "No target found in the provider";
+            return;
+        }
+        if(hint > (uint8_t)AccessHint::DontNeed) {
+            result.success() = false;
+            result.error() = fmt::format("Invalid access hint {}", hint);
+            return;
+        }
+        result = withTarget("advise", regions, [&](auto& target) {
+            return target.advise(regions, (AccessHint)hint);
+        });
+        trace("Successfully executed advise request");
     }
 
     void eraseRPC(const tl::request& req,
-                  const RegionID& region_id) {
+                  const RegionID& region_id,
+                  uint64_t trace_id) {
         trace("Received erase request");
+        probe::Scope probe_scope{probe::Kind::Handler, "erase", 0, 0};
+        auto recording = m_recorder.record(record::Op::Erase, req);
+        recording.add(region_id, {});
+        Tracer::Scope trace_scope{Tracer::instance().accept(trace_id)};
+        Tracer::Span  trace_span{"provider", "erase"};
         Result<bool> result;
         tl::auto_respond<decltype(result)> response{req, result};
+        m_numa.pinHandler();
+        auto admission = m_admission.admit(0);
+        if(!admission) {
+            rejectAsBusy(result, admission);
+            return;
+        }
+        auto ticket = m_qos.admit(req, 0);
         if(!m_target) {
             result.success() = false;
             result.error() = "No target found in the provider";
             return;
         }
+        auto lease_guard = m_leases.acquireWrite(region_id);
         result = m_target->erase(region_id);
         trace("Successfully executed erase request");
     }
 
+    void pinRPC(const tl::request& req,
+                const RegionID& region_id,
+                bool pinned) {
+        trace("Received pin request");
+        probe::Scope probe_scope{probe::Kind::Handler, "pin", 0, 0};
+        Result<bool> result;
+        tl::auto_respond<decltype(result)> response{req, result};
+        m_numa.pinHandler();
+        auto admission = m_admission.admit(0);
+        if(!admission) {
+            rejectAsBusy(result, admission);
+            return;
+        }
+        auto ticket = m_qos.admit(req, 0);
+        if(!m_target) {
+            result.success() = false;
+            result.error() = "No target found in the provider";
+            return;
+        }
+        result = m_target->pin(region_id, pinned);
+        trace("Successfully executed pin request");
+    }
+
+    // Size of the staging buffer used to copy regions
+    static constexpr size_t s_copy_chunk_size = 8*1024*1024;
+
+    /**
+     * @brief Read a region chunk by chunk into buffer and pass
+     * each chunk to sink(offset, size).
+     */
+    template<typename Sink>
+    Result<bool> copyChunks(const RegionID& source, size_t size,
+                            std::vector<char>& buffer, Sink&& sink) {
+        Result<bool> result;
+        for(size_t offset = 0; offset < size; offset += buffer.size()) {
+            size_t n = std::min(buffer.size(), size - offset);
+            std::vector<std::pair<size_t, size_t>> segment{{offset, n}};
+            result = withTarget("read", segment, [&](auto& target) {
+                return target.readSegments(source, segment, buffer.data());
+            });
+            if(!result.success()) return result;
+            result = sink(offset, n);
+            if(!result.success()) return result;
+        }
+        return result;
+    }
+
+    /**
+     * @brief Copy a region into a new region of the provider's own target.
+     */
+    Result<RegionID> copyLocally(const RegionID& source, size_t size, bool persist) {
+        Result<RegionID> result;
+        // the new region must be released before reading the source,
+        // since targets may lock the whole target while a region is held
+        auto region = m_target->create(size);
+        if(!region.success()) {
+            result.success() = false;
+            result.error() = region.error();
+            return result;
+        }
+        result = region.value()->getRegionID();
+        region.value().reset();
+        if(!result.success()) return result;
+        auto dest = result.value();
+        std::vector<char> buffer(std::min(size, s_copy_chunk_size));
+        auto copied = copyChunks(source, size, buffer,
+            [&](size_t offset, size_t n) {
+                std::vector<std::pair<size_t, size_t>> segment{{offset, n}};
+                return withTarget("write", segment, [&](auto& target) {
+                    return target.writeSegments(dest, segment, buffer.data(), persist);
+                });
+            });
+        if(!copied.success()) {
+            m_target->erase(dest);
+            result.success() = false;
+            result.error() = copied.error();
+            result.evicted() = copied.evicted();
+        }
+        return result;
+    }
+
+    /**
+     * @brief Copy a region into a new region of another provider. The
+     * source region is staged chunk by chunk in buffers from which the
+     * destination pulls directly into its target, using its own
+     * TransferManager, so the data crosses the network only once.
+     * Chunks are double-buffered: the next chunk is read from the target
+     * while the destination pulls the previous one.
+     */
+    Result<RegionID> copyToProvider(const RegionID& source, size_t size,
+                                    const tl::provider_handle& dest, bool persist) {
+        Result<RegionID> result;
+        auto self_address = static_cast<std::string>(m_engine.self());
+        try {
+            if(size > 0 && size <= s_copy_chunk_size) {
+                // single chunk: one create_write RPC to the destination
+                std::vector<char> buffer(size);
+                auto bulk = m_engine.expose(
+                    {{buffer.data(), buffer.size()}}, tl::bulk_mode::read_only);
+                auto copied = copyChunks(source, size, buffer,
+                    [&](size_t, size_t n) {
+                        result = m_create_write.on(dest)(bulk, self_address, 0, n, persist, Tracer::current());
+                        Result<bool> ret;
+                        ret.success() = result.success();
+                        return ret;
+                    });
+                if(!copied.success() && result.success()) {
+                    result.success() = false;
+                    result.error() = copied.error();
+                    result.evicted() = copied.evicted();
+                }
+                return result;
+            }
+            result = m_create.on(dest)(size, Tracer::current());
+            if(!result.success()) return result;
+            auto dest_region = result.value();
+
+            struct Stage {
+                std::vector<char>                 buffer;
+                tl::bulk                          bulk;
+                std::optional<tl::async_response> pending;
+            };
+            std::array<Stage, 2> stages;
+            for(auto& stage : stages) {
+                stage.buffer.resize(std::min(size, s_copy_chunk_size));
+                if(stage.buffer.empty()) continue;
+                stage.bulk = m_engine.expose(
+                    {{stage.buffer.data(), stage.buffer.size()}}, tl::bulk_mode::read_only);
+            }
+            Result<bool> copied;
+            auto complete = [&copied](Stage& stage) {
+                if(!stage.pending) return;
+                Result<bool> written = stage.pending->wait();
+                stage.pending.reset();
+                if(copied.success() && !written.success()) copied = std::move(written);
+            };
+            size_t i = 0;
+            for(size_t offset = 0; offset < size; offset += s_copy_chunk_size, ++i) {
+                auto& stage = stages[i % stages.size()];
+                // the buffer can be reused once the destination has pulled from it
+                complete(stage);
+                if(!copied.success()) break;
+                size_t n = std::min(s_copy_chunk_size, size - offset);
+                std::vector<std::pair<size_t, size_t>> segment{{offset, n}};
+                copied = withTarget("read", segment, [&](auto& target) {
+                    return target.readSegments(source, segment, stage.buffer.data());
+                });
+                if(!copied.success()) break;
+                stage.pending = m_write.on(dest).async(
+                    dest_region, segment, stage.bulk, self_address, (size_t)0, persist, Tracer::current());
+            }
+            for(auto& stage : stages) complete(stage);
+            if(!copied.success()) {
+                Result<bool> erased = m_erase.on(dest)(dest_region, Tracer::current());
+                (void)erased;
+                result.success() = false;
+                result.error() = copied.error();
+                result.evicted() = copied.evicted();
+                result.retryAfter() = copied.retryAfter();
+            }
+        } catch(const std::exception& ex) {
+            result.success() = false;
+            result.error() = fmt::format("Failed to copy region to destination provider: {}", ex.what());
+        }
+        return result;
+    }
+
+    void copyRPC(const tl::request& req,
+                 const RegionID& region_id,
+                 size_t size,
+                 const std::string& dest_address,
+                 uint16_t dest_provider_id,
+                 bool persist,
+                 bool remove_source,
+                 uint64_t trace_id) {
+        trace("Received copy request");
+        probe::Scope probe_scope{probe::Kind::Handler, "copy", size, 1};
+        Tracer::Scope trace_scope{Tracer::instance().accept(trace_id)};
+        Tracer::Span  trace_span{"provider", "copy"};
+        Result<RegionID> result;
+        tl::auto_respond<decltype(result)> response{req, result};
+        m_numa.pinHandler();
+        auto admission = m_admission.admit(size);
+        if(!admission) {
+            rejectAsBusy(result, admission);
+            return;
+        }
+        auto ticket = m_qos.admit(req, size);
+        if(!m_target) {
+            result.success() = false;
+            result.error() = "No target found in the provider";
+            return;
+        }
+        // the size given by the client is checked against the
+        // region's when the target can tell it
+        auto region_size = m_target->regionSize(region_id);
+        if(region_size.success() && region_size.value() != size) {
+            result.success() = false;
+            result.error() = fmt::format(
+                "Invalid size {} for a region of {} bytes", size, region_size.value());
+            return;
+        }
+        bool local = dest_address.empty()
+                  || (dest_provider_id == get_provider_id()
+                      && dest_address == static_cast<std::string>(m_engine.self()));
+        if(local && remove_source) {
+            // moving a region within its own target leaves it in place
+            result.value() = region_id;
+            return;
+        }
+        if(local) {
+            result = copyLocally(region_id, size, persist);
+        } else {
+            tl::provider_handle dest;
+            try {
+                dest = tl::provider_handle{m_engine.lookup(dest_address), dest_provider_id};
+            } catch(const std::exception& ex) {
+                result.success() = false;
+                result.error() = fmt::format("Failed to lookup destination address: {}", ex.what());
+                return;
+            }
+            result = copyToProvider(region_id, size, dest, persist);
+        }
+        if(result.success() && remove_source) {
+            auto lease_guard = m_leases.acquireWrite(region_id);
+            auto erased = m_target->erase(region_id);
+            if(!erased.success()) {
+                result.success() = false;
+                result.error() = fmt::format(
+                    "Region was copied but the source could not be erased: {}", erased.error());
+            }
+        }
+        trace("Successfully executed copy request");
+    }
+
+    void cloneRPC(const tl::request& req,
+                  const RegionID& region_id) {
+        trace("Received clone request");
+        probe::Scope probe_scope{probe::Kind::Handler, "clone", 0, 0};
+        Result<RegionID> result;
+        tl::auto_respond<decltype(result)> response{req, result};
+        m_numa.pinHandler();
+        auto admission = m_admission.admit(0);
+        if(!admission) {
+            rejectAsBusy(result, admission);
+            return;
+        }
+        auto ticket = m_qos.admit(req, 0);
+        if(!m_target) {
+            result.success() = false;
+            result.error() = "No target found in the provider";
+            return;
+        }
+        result = m_target->clone(region_id);
+        trace("Successfully executed clone request");
+    }
+
+    void createSnapshotRPC(const tl::request& req,
+                           const std::string& name) {
+        trace("Received create_snapshot request");
+        probe::Scope probe_scope{probe::Kind::Handler, "create_snapshot", 0, 0};
+        Result<bool> result;
+        tl::auto_respond<decltype(result)> response{req, result};
+        m_numa.pinHandler();
+        if(!m_target) {
+            result.success() = false;
+            result.error() = "No target found in the provider";
+            return;
+        }
+        result = m_target->createSnapshot(name);
+        trace("Successfully executed create_snapshot request");
+    }
+
+    void restoreSnapshotRPC(const tl::request& req,
+                            const std::string& name) {
+        trace("Received restore_snapshot request");
+        probe::Scope probe_scope{probe::Kind::Handler, "restore_snapshot", 0, 0};
+        Result<bool> result;
+        tl::auto_respond<decltype(result)> response{req, result};
+        m_numa.pinHandler();
+        if(!m_target) {
+            result.success() = false;
+            result.error() = "No target found in the provider";
+            return;
+        }
+        auto lease_guard = m_leases.acquireExclusive();
+        result = m_target->restoreSnapshot(name);
+        trace("Successfully executed restore_snapshot request");
+    }
+
+    void deleteSnapshotRPC(const tl::request& req,
+                           const std::string& name) {
+        trace("Received delete_snapshot request");
+        probe::Scope probe_scope{probe::Kind::Handler, "delete_snapshot", 0, 0};
+        Result<bool> result;
+        tl::auto_respond<decltype(result)> response{req, result};
+        m_numa.pinHandler();
+        if(!m_target) {
+            result.success() = false;
+            result.error() = "No target found in the provider";
+            return;
+        }
+        result = m_target->deleteSnapshot(name);
+        trace("Successfully executed delete_snapshot request");
+    }
+
     void getREMIproviderIdRPC(const tl::request& req) {
         trace("Received getREMIproviderId request");
+        probe::Scope probe_scope{probe::Kind::Handler, "get_remi_provider_id", 0, 0};
         Result<uint16_t> result;
         tl::auto_respond<decltype(result)> response{req, result};
 #ifndef WARABI_HAS_REMI
@@ -509,6 +1417,26 @@ class ProviderImpl : public tl::provider<ProviderImpl> {
         trace("Successfully executed getREMIproviderId request");
     }
 
+    void setTransferManagerRPC(const tl::request& req,
+                               const std::string& config) {
+        trace("Received set_transfer_manager request");
+        probe::Scope probe_scope{probe::Kind::Handler, "set_transfer_manager", 0, 0};
+        Result<bool> result;
+        tl::auto_respond<decltype(result)> response{req, result};
+        m_numa.pinHandler();
+        json json_config;
+        try {
+            json_config = json::parse(config);
+        } catch(const std::exception& ex) {
+            result.success() = false;
+            result.error() = fmt::format(
+                "Could not parse transfer manager configuration: {}", ex.what());
+            return;
+        }
+        result = setTransferManagerConfig(json_config);
+        trace("Successfully executed set_transfer_manager request");
+    }
+
     void migrateTarget(const std::string& dest_address,
                        uint16_t dest_provider_id,
                        const std::string& options) {
@@ -728,6 +1656,7 @@ class ProviderImpl : public tl::provider<ProviderImpl> {
         }
 
         m_target = std::move(target.value());
+        m_target_kind = targetKindOf(m_target.get());
 
         return 0;
     }
@@ -0,0 +1,455 @@
+/*
+ * (C) 2024 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __WARABI_QOS_MANAGER_HPP
+#define __WARABI_QOS_MANAGER_HPP
+
+#include <warabi/Result.hpp>
+#include "Tracer.hpp"
+#include <thallium.hpp>
+#include <nlohmann/json.hpp>
+#include <nlohmann/json-schema.hpp>
+#include <fmt/format.h>
+
+#include <chrono>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace warabi {
+
+namespace tl = thallium;
+
+/**
+ * @brief The QoSManager sits in front of the provider's RPC handlers.
+ * It does two things:
+ *
+ * - It rate-limits clients (or tenants, i.e. groups of clients) using
+ *   token buckets on both the number of operations and the number
+ *   of bytes they move.
+ * - It bounds the number of handlers concurrently accessing the target
+ *   and, when this bound is reached, grants slots to waiting handlers
+ *   in weighted-fair order across priority classes (e.g. "interactive"
+ *   and "bulk"), so that a flood of large requests cannot starve small
+ *   latency-sensitive ones.
+ *
+ * The QoSManager is disabled (and costs a single branch per RPC) when
+ * the provider's configuration does not have a "qos" field.
+ *
+ * Example of configuration:
+ *
+ * {
+ *     "max_concurrent": 8,
+ *     "classes": [
+ *         {"name": "interactive", "weight": 4, "max_size": 65536},
+ *         {"name": "bulk", "weight": 1}
+ *     ],
+ *     "tenants": {
+ *         "ofi+tcp://10.0.0.12:1234": "analysis"
+ *     },
+ *     "limits": {
+ *         "default":  {"ops_per_second": 10000, "bytes_per_second": 1073741824},
+ *         "analysis": {"ops_per_second": 0, "class": "interactive"}
+ *     }
+ * }
+ *
+ * A request is assigned the class forced by its client's limits, if any,
+ * otherwise the first class whose "max_size" is not exceeded by the request.
+ * A rate of 0 (or a missing rate) means unlimited. The state of a client
+ * is dropped once its token buckets have refilled, so that the memory used
+ * by the QoSManager does not grow with the number of clients ever seen.
+ */
+class QoSManager {
+
+    using json = nlohmann::json;
+    using clock = std::chrono::steady_clock;
+
+    struct TokenBucket {
+
+        double            m_rate  = 0.0; // tokens per second, 0 = unlimited
+        double            m_burst = 0.0; // maximum number of tokens
+        double            m_tokens = 0.0;
+        clock::time_point m_last = clock::now();
+
+        TokenBucket() = default;
+
+        TokenBucket(double rate, double burst)
+        : m_rate(rate)
+        , m_burst(burst > 0 ? burst : rate)
+        , m_tokens(m_burst) {}
+
+        /**
+         * @brief Consume n tokens and return the number of seconds
+         * the caller should wait before proceeding. The bucket is
+         * allowed to go into debt so that requests larger than the
+         * burst size still make progress.
+         */
+        double consume(double n) {
+            if(m_rate <= 0.0) return 0.0;
+            auto now = clock::now();
+            double elapsed = std::chrono::duration<double>(now - m_last).count();
+            m_last = now;
+            m_tokens = std::min(m_burst, m_tokens + elapsed * m_rate);
+            m_tokens -= n;
+            if(m_tokens >= 0.0) return 0.0;
+            return -m_tokens / m_rate;
+        }
+
+        /**
+         * @brief Whether the bucket has refilled completely at the
+         * given time, i.e. is equivalent to a newly created one.
+         */
+        bool full(clock::time_point now) const {
+            if(m_rate <= 0.0) return true;
+            double elapsed = std::chrono::duration<double>(now - m_last).count();
+            return m_tokens + elapsed * m_rate >= m_burst;
+        }
+    };
+
+    struct ClientState {
+        TokenBucket m_ops;
+        TokenBucket m_bytes;
+        ssize_t     m_class = -1; // forced class, -1 if determined by size
+    };
+
+    struct PriorityClass {
+        std::string                    m_name;
+        double                         m_weight   = 1.0;
+        size_t                         m_max_size = std::numeric_limits<size_t>::max();
+        double                         m_vtime    = 0.0;
+        std::deque<tl::eventual<void>*> m_waiters;
+        size_t                         m_granted  = 0;
+    };
+
+    public:
+
+    /**
+     * @brief RAII object returned by QoSManager::admit. Releases the
+     * concurrency slot it holds (if any) when destroyed.
+     */
+    class Ticket {
+
+        friend class QoSManager;
+
+        QoSManager* m_owner = nullptr;
+
+        Ticket(QoSManager* owner)
+        : m_owner(owner) {}
+
+        public:
+
+        Ticket() = default;
+
+        Ticket(const Ticket&) = delete;
+
+        Ticket(Ticket&& other)
+        : m_owner(other.m_owner) {
+            other.m_owner = nullptr;
+        }
+
+        Ticket& operator=(const Ticket&) = delete;
+
+        Ticket& operator=(Ticket&& other) {
+            if(this == &other) return *this;
+            if(m_owner) m_owner->release();
+            m_owner = other.m_owner;
+            other.m_owner = nullptr;
+            return *this;
+        }
+
+        ~Ticket() {
+            if(m_owner) m_owner->release();
+        }
+    };
+
+    QoSManager(tl::engine engine)
+    : m_engine(std::move(engine)) {}
+
+    QoSManager(const QoSManager&) = delete;
+    QoSManager& operator=(const QoSManager&) = delete;
+
+    /**
+     * @brief Validate a "qos" configuration object.
+     */
+    static Result<bool> validate(const json& config) {
+        static const json schema = R"(
+        {
+            "type": "object",
+            "properties": {
+                "max_concurrent": {"type": "integer", "minimum": 0},
+                "classes": {
+                    "type": "array",
+                    "items": {
+                        "type": "object",
+                        "properties": {
+                            "name": {"type": "string"},
+                            "weight": {"type": "number", "exclusiveMinimum": 0},
+                            "max_size": {"type": "integer", "minimum": 0}
+                        },
+                        "required": ["name"]
+                    }
+                },
+                "tenants": {
+                    "type": "object",
+                    "additionalProperties": {"type": "string"}
+                },
+                "limits": {
+                    "type": "object",
+                    "additionalProperties": {
+                        "type": "object",
+                        "properties": {
+                            "ops_per_second": {"type": "number", "minimum": 0},
+                            "bytes_per_second": {"type": "number", "minimum": 0},
+                            "ops_burst": {"type": "number", "minimum": 0},
+                            "bytes_burst": {"type": "number", "minimum": 0},
+                            "class": {"type": "string"}
+                        }
+                    }
+                }
+            }
+        }
+        )"_json;
+        Result<bool> result;
+        nlohmann::json_schema::json_validator validator;
+        validator.set_root_schema(schema);
+        try {
+            validator.validate(config);
+        } catch(const std::exception& ex) {
+            result.success() = false;
+            result.error() = fmt::format(
+                "Error(s) while validating JSON config for warabi QoS: {}", ex.what());
+            return result;
+        }
+        if(config.contains("limits")) {
+            for(auto& [key, limits] : config["limits"].items()) {
+                if(!limits.contains("class")) continue;
+                auto& cls = limits["class"].get_ref<const std::string&>();
+                bool found = false;
+                for(auto& c : config.value("classes", json::array()))
+                    found = found || (c["name"] == cls);
+                if(!found) {
+                    result.success() = false;
+                    result.error() = fmt::format(
+                        "Unknown QoS class \"{}\" in limits for \"{}\"", cls, key);
+                    return result;
+                }
+            }
+        }
+        return result;
+    }
+
+    /**
+     * @brief (Re)configure the QoSManager. This may be called while
+     * requests are in flight: token buckets are reset, waiting requests
+     * are re-queued according to the new classes, and the new
+     * concurrency bound applies to subsequent grants.
+     * The configuration is expected to have been validated.
+     */
+    void configure(const json& config) {
+        std::unique_lock<tl::mutex> lock{m_mutex};
+        std::vector<tl::eventual<void>*> pending;
+        for(auto& c : m_classes)
+            for(auto w : c.m_waiters) pending.push_back(w);
+        m_config = config;
+        m_enabled = !config.is_null();
+        m_max_concurrent = config.value("max_concurrent", (size_t)0);
+        m_tenants.clear();
+        for(auto& [addr, tenant] : config.value("tenants", json::object()).items())
+            m_tenants[addr] = tenant.get<std::string>();
+        m_clients.clear();
+        m_classes.clear();
+        for(auto& c : config.value("classes", json::array())) {
+            m_classes.emplace_back();
+            auto& cls = m_classes.back();
+            cls.m_name     = c["name"].get<std::string>();
+            cls.m_weight   = c.value("weight", 1.0);
+            cls.m_max_size = c.value("max_size", std::numeric_limits<size_t>::max());
+        }
+        if(m_classes.empty()) m_classes.emplace_back();
+        m_vtime = 0.0;
+        // waiting requests from the previous configuration are placed
+        // in the last (lowest-priority by convention) class
+        for(auto w : pending) m_classes.back().m_waiters.push_back(w);
+        grantLocked();
+    }
+
+    /**
+     * @brief Return the current configuration (null if disabled).
+     */
+    json getConfig() const {
+        std::unique_lock<tl::mutex> lock{m_mutex};
+        return m_config;
+    }
+
+    /**
+     * @brief Whether QoS is enabled.
+     */
+    bool enabled() const {
+        return m_enabled;
+    }
+
+    /**
+     * @brief Admit a request of the given size (in bytes) issued by the
+     * given endpoint. This function blocks the calling ULT until the
+     * request is allowed to proceed according to the client's rate
+     * limits and the weighted-fair concurrency bound.
+     */
+    Ticket admit(const tl::request& req, size_t size) {
+        if(!m_enabled) return Ticket{};
+        return admit(static_cast<std::string>(req.get_endpoint()), size);
+    }
+
+    /**
+     * @brief Same as above, with the client given by its address.
+     */
+    Ticket admit(const std::string& address, size_t size) {
+        if(!m_enabled) return Ticket{};
+        double wait_s = 0.0;
+        {
+            std::unique_lock<tl::mutex> lock{m_mutex};
+            expireClientsLocked();
+            auto& client = getClientLocked(address);
+            wait_s = std::max(client.m_ops.consume(1.0),
+                              client.m_bytes.consume((double)size));
+        }
+        if(wait_s > 0.0) {
+            Tracer::Span span{"provider", "qos_rate_wait"};
+            tl::thread::sleep(m_engine, wait_s * 1000.0);
+        }
+        if(m_max_concurrent == 0) return Ticket{};
+        tl::eventual<void> ev;
+        {
+            std::unique_lock<tl::mutex> lock{m_mutex};
+            if(m_max_concurrent == 0) return Ticket{};
+            // the classes may have been reconfigured while sleeping
+            auto cls = classOfLocked(address, size);
+            if(m_inflight < m_max_concurrent && !hasWaitersLocked()) {
+                m_inflight += 1;
+                advanceLocked(m_classes[cls]);
+                return Ticket{this};
+            }
+            m_classes[cls].m_waiters.push_back(&ev);
+        }
+        Tracer::Span span{"provider", "qos_slot_wait"};
+        ev.wait();
+        return Ticket{this};
+    }
+
+    /**
+     * @brief Return statistics about the QoSManager as a JSON object.
+     */
+    json getStats() const {
+        std::unique_lock<tl::mutex> lock{m_mutex};
+        auto stats = json::object();
+        stats["inflight"] = m_inflight;
+        stats["clients"] = m_clients.size();
+        auto& classes = stats["classes"] = json::object();
+        for(auto& c : m_classes) {
+            classes[c.m_name] = json::object();
+            classes[c.m_name]["granted"] = c.m_granted;
+            classes[c.m_name]["waiting"] = c.m_waiters.size();
+        }
+        return stats;
+    }
+
+    private:
+
+    ClientState& getClientLocked(const std::string& address) {
+        auto tenant_it = m_tenants.find(address);
+        const auto& key = tenant_it == m_tenants.end() ? address : tenant_it->second;
+        auto it = m_clients.find(key);
+        if(it != m_clients.end()) return it->second;
+        auto& state = m_clients[key];
+        const auto& limits = m_config.value("limits", json::object());
+        json l = limits.contains(key) ? limits[key] : limits.value("default", json::object());
+        state.m_ops = TokenBucket{l.value("ops_per_second", 0.0), l.value("ops_burst", 0.0)};
+        state.m_bytes = TokenBucket{l.value("bytes_per_second", 0.0), l.value("bytes_burst", 0.0)};
+        if(l.contains("class")) {
+            auto& name = l["class"].get_ref<const std::string&>();
+            for(size_t i = 0; i < m_classes.size(); ++i)
+                if(m_classes[i].m_name == name) state.m_class = i;
+        }
+        return state;
+    }
+
+    size_t classOfLocked(const std::string& address, size_t size) {
+        auto& client = getClientLocked(address);
+        return client.m_class >= 0 ? (size_t)client.m_class : classForSize(size);
+    }
+
+    void expireClientsLocked() {
+        auto now = clock::now();
+        if(now - m_last_expiration < std::chrono::seconds{1}) return;
+        m_last_expiration = now;
+        for(auto it = m_clients.begin(); it != m_clients.end();) {
+            if(it->second.m_ops.full(now) && it->second.m_bytes.full(now))
+                it = m_clients.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    size_t classForSize(size_t size) const {
+        for(size_t i = 0; i < m_classes.size(); ++i)
+            if(size <= m_classes[i].m_max_size) return i;
+        return m_classes.size() - 1;
+    }
+
+    bool hasWaitersLocked() const {
+        for(auto& c : m_classes)
+            if(!c.m_waiters.empty()) return true;
+        return false;
+    }
+
+    void advanceLocked(PriorityClass& cls) {
+        // start-time fair queuing: a class that was idle
+        // does not get to accumulate credit while idle
+        cls.m_vtime = std::max(cls.m_vtime, m_vtime) + 1.0 / cls.m_weight;
+        cls.m_granted += 1;
+    }
+
+    void grantLocked() {
+        while((m_max_concurrent == 0 || m_inflight < m_max_concurrent)) {
+            PriorityClass* next = nullptr;
+            for(auto& c : m_classes) {
+                if(c.m_waiters.empty()) continue;
+                auto start = std::max(c.m_vtime, m_vtime);
+                if(!next || start < std::max(next->m_vtime, m_vtime)) next = &c;
+            }
+            if(!next) return;
+            m_vtime = std::max(next->m_vtime, m_vtime);
+            advanceLocked(*next);
+            auto ev = next->m_waiters.front();
+            next->m_waiters.pop_front();
+            m_inflight += 1;
+            ev->set_value();
+        }
+    }
+
+    void release() {
+        std::unique_lock<tl::mutex> lock{m_mutex};
+        m_inflight -= 1;
+        grantLocked();
+    }
+
+    tl::engine                                   m_engine;
+    mutable tl::mutex                            m_mutex;
+    json                                         m_config;
+    std::atomic<bool>                            m_enabled{false};
+    std::atomic<size_t>                          m_max_concurrent{0};
+    size_t                                       m_inflight = 0;
+    double                                       m_vtime = 0.0;
+    clock::time_point                            m_last_expiration = clock::now();
+    std::vector<PriorityClass>                   m_classes;
+    std::unordered_map<std::string, std::string> m_tenants;
+    std::unordered_map<std::string, ClientState> m_clients;
+};
+
+}
+
+#endif
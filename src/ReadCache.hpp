@@ -0,0 +1,203 @@
+/*
+ * (C) 2024 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __WARABI_READ_CACHE_HPP
+#define __WARABI_READ_CACHE_HPP
+
+#include <warabi/RegionID.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <list>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace warabi {
+
+/**
+ * @brief The ReadCache keeps, on the client side, segments of regions
+ * read under a lease granted by the provider (see LeaseManager). A
+ * segment is served from the cache only while its lease is valid, and
+ * any segment contained in a cached one can be served. The cache is
+ * bounded to a capacity in bytes, evicting the least recently used
+ * segments first.
+ */
+class ReadCache {
+
+    using Clock = std::chrono::steady_clock;
+    using Key   = std::pair<RegionID, size_t>; // region and offset
+
+    struct Entry {
+        std::vector<char>         data;
+        Clock::time_point         expiry;
+        std::list<Key>::iterator  lru;
+    };
+
+    using Extents = std::map<size_t, Entry>; // by offset in the region
+
+    mutable std::mutex             m_mutex;
+    size_t                         m_capacity = 0;
+    size_t                         m_size     = 0;
+    size_t                         m_max_extent = 0; // largest segment ever cached
+    std::map<RegionID, Extents>    m_regions;
+    std::list<Key>                 m_lru; // most recently used first
+    size_t                         m_hits   = 0;
+    size_t                         m_misses = 0;
+
+    public:
+
+    using time_point = Clock::time_point;
+
+    static time_point now() {
+        return Clock::now();
+    }
+
+    /**
+     * @brief Set the capacity of the cache in bytes (0 disables it).
+     */
+    void setCapacity(size_t capacity) {
+        std::unique_lock<std::mutex> lock{m_mutex};
+        m_capacity = capacity;
+        while(m_size > m_capacity) evictOne();
+    }
+
+    bool enabled() const {
+        std::unique_lock<std::mutex> lock{m_mutex};
+        return m_capacity != 0;
+    }
+
+    /**
+     * @brief Copy the given segments of the region into data if they
+     * are all covered by valid cached segments. Returns false otherwise.
+     */
+    bool lookup(const RegionID& region,
+                const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+                char* data) {
+        std::unique_lock<std::mutex> lock{m_mutex};
+        auto it = m_regions.find(region);
+        if(it == m_regions.end()) {
+            m_misses += 1;
+            return false;
+        }
+        auto t = now();
+        std::vector<std::pair<const char*, Entry*>> sources;
+        sources.reserve(regionOffsetSizes.size());
+        for(auto& segment : regionOffsetSizes) {
+            auto entry = findCovering(it->second, segment.first, segment.second, t);
+            if(!entry) {
+                m_misses += 1;
+                return false;
+            }
+            sources.push_back({entry->second.data.data() + (segment.first - entry->first),
+                               &entry->second});
+        }
+        for(size_t i = 0; i < sources.size(); ++i) {
+            std::memcpy(data, sources[i].first, regionOffsetSizes[i].second);
+            data += regionOffsetSizes[i].second;
+            m_lru.splice(m_lru.begin(), m_lru, sources[i].second->lru);
+        }
+        m_hits += 1;
+        return true;
+    }
+
+    /**
+     * @brief Cache segments of a region read under a lease valid until
+     * expiry. data holds the segments back to back.
+     */
+    void insert(const RegionID& region,
+                const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+                const char* data, time_point expiry) {
+        std::unique_lock<std::mutex> lock{m_mutex};
+        for(auto& segment : regionOffsetSizes) {
+            const char* src = data;
+            data += segment.second;
+            if(segment.second == 0 || segment.second > m_capacity) continue;
+            auto rit = m_regions.find(region);
+            if(rit != m_regions.end()) {
+                auto it = rit->second.find(segment.first);
+                if(it != rit->second.end()) erase(region, rit->second, it);
+            }
+            while(m_size + segment.second > m_capacity && !m_lru.empty()) evictOne();
+            auto& entry = m_regions[region][segment.first];
+            entry.data.assign(src, src + segment.second);
+            entry.expiry = expiry;
+            entry.lru = m_lru.insert(m_lru.begin(), Key{region, segment.first});
+            m_size += segment.second;
+            m_max_extent = std::max(m_max_extent, segment.second);
+        }
+    }
+
+    /**
+     * @brief Drop all the cached segments of a region.
+     */
+    void invalidate(const RegionID& region) {
+        std::unique_lock<std::mutex> lock{m_mutex};
+        auto it = m_regions.find(region);
+        if(it == m_regions.end()) return;
+        for(auto& extent : it->second) {
+            m_size -= extent.second.data.size();
+            m_lru.erase(extent.second.lru);
+        }
+        m_regions.erase(it);
+    }
+
+    /**
+     * @brief Drop all the cached segments.
+     */
+    void clear() {
+        std::unique_lock<std::mutex> lock{m_mutex};
+        m_regions.clear();
+        m_lru.clear();
+        m_size = 0;
+    }
+
+    size_t hits() const {
+        std::unique_lock<std::mutex> lock{m_mutex};
+        return m_hits;
+    }
+
+    size_t misses() const {
+        std::unique_lock<std::mutex> lock{m_mutex};
+        return m_misses;
+    }
+
+    private:
+
+    Extents::value_type* findCovering(Extents& extents, size_t offset, size_t size, time_point t) {
+        auto it = extents.upper_bound(offset);
+        // cached segments may overlap, so look at all of those starting
+        // before offset that may be large enough, from the closest one
+        while(it != extents.begin()) {
+            --it;
+            if(it->first + m_max_extent < offset + size) break;
+            if(it->second.expiry <= t) continue;
+            if(it->first + it->second.data.size() >= offset + size)
+                return &*it;
+        }
+        return nullptr;
+    }
+
+    void erase(const RegionID& region, Extents& extents, Extents::iterator it) {
+        m_size -= it->second.data.size();
+        m_lru.erase(it->second.lru);
+        extents.erase(it);
+        if(extents.empty()) m_regions.erase(region);
+    }
+
+    void evictOne() {
+        if(m_lru.empty()) return;
+        auto key = m_lru.back();
+        auto& extents = m_regions[key.first];
+        auto it = extents.find(key.second);
+        erase(key.first, extents, it);
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,188 @@
+/*
+ * (C) 2024 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __WARABI_RECORD_FORMAT_HPP
+#define __WARABI_RECORD_FORMAT_HPP
+
+#include <warabi/RegionID.hpp>
+#include <warabi/Result.hpp>
+#include <fmt/format.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace warabi {
+
+/**
+ * @brief Binary format of the I/O traces written by the Recorder of a
+ * provider and read by warabi-replay. Integers are stored in the byte
+ * order of the recording machine.
+ *
+ * The file starts with an 8-byte magic ("WARABIRC") and a 32-bit version,
+ * followed by records. Each record has a fixed 36-byte header:
+ *
+ *   u8  op, u8 flags, u16 reserved, u32 client, u32 count,
+ *   u64 start (ns since the recording started),
+ *   u64 duration (ns), u64 size (bytes)
+ *
+ * followed by count regions, each made of its 16-byte RegionID, a u32
+ * number of segments and that many (u64 offset, u64 size) pairs. Create
+ * records have the created region as their only region (without segments).
+ * Client records (op Client) associate a client index with the address of
+ * the client, stored in the count bytes that follow their header.
+ */
+namespace record {
+
+static constexpr char     Magic[8] = {'W','A','R','A','B','I','R','C'};
+static constexpr uint32_t Version  = 1;
+
+enum class Op : uint8_t {
+    Client      = 0,
+    Create      = 1,
+    Write       = 2,
+    Persist     = 3,
+    CreateWrite = 4,
+    Read        = 5,
+    Erase       = 6
+};
+
+enum Flags : uint8_t {
+    Persist = 1 << 0, // the data was persisted by the write
+    Eager   = 1 << 1  // the data was sent with the RPC rather than by RDMA
+};
+
+inline const char* opName(Op op) {
+    switch(op) {
+    case Op::Client:      return "client";
+    case Op::Create:      return "create";
+    case Op::Write:       return "write";
+    case Op::Persist:     return "persist";
+    case Op::CreateWrite: return "create_write";
+    case Op::Read:        return "read";
+    case Op::Erase:       return "erase";
+    }
+    return "unknown";
+}
+
+struct Record {
+    Op                          op       = Op::Client;
+    uint8_t                     flags    = 0;
+    uint32_t                    client   = 0;
+    uint64_t                    start    = 0;
+    uint64_t                    duration = 0;
+    uint64_t                    size     = 0;
+    std::vector<RegionSegments> regions;
+    std::string                 address; // Client records only
+};
+
+template<typename T>
+inline void put(std::vector<char>& out, T value) {
+    auto p = reinterpret_cast<const char*>(&value);
+    out.insert(out.end(), p, p + sizeof(T));
+}
+
+/**
+ * @brief Append the encoding of a record to out.
+ */
+inline void encode(const Record& r, std::vector<char>& out) {
+    put<uint8_t>(out, (uint8_t)r.op);
+    put<uint8_t>(out, r.flags);
+    put<uint16_t>(out, 0);
+    put<uint32_t>(out, r.client);
+    put<uint32_t>(out, r.op == Op::Client ? r.address.size() : r.regions.size());
+    put<uint64_t>(out, r.start);
+    put<uint64_t>(out, r.duration);
+    put<uint64_t>(out, r.size);
+    if(r.op == Op::Client) {
+        out.insert(out.end(), r.address.begin(), r.address.end());
+        return;
+    }
+    for(auto& region : r.regions) {
+        out.insert(out.end(), region.first.begin(), region.first.end());
+        put<uint32_t>(out, region.second.size());
+        for(auto& segment : region.second) {
+            put<uint64_t>(out, segment.first);
+            put<uint64_t>(out, segment.second);
+        }
+    }
+}
+
+/**
+ * @brief Sequential reader of a trace file.
+ */
+class Reader {
+
+    std::ifstream m_file;
+
+    template<typename T>
+    bool get(T& value) {
+        return (bool)m_file.read(reinterpret_cast<char*>(&value), sizeof(T));
+    }
+
+    public:
+
+    Result<bool> open(const std::string& path) {
+        Result<bool> result;
+        m_file.open(path, std::ios::binary);
+        char magic[sizeof(Magic)];
+        uint32_t version = 0;
+        if(!m_file) {
+            result.success() = false;
+            result.error() = fmt::format("Could not open trace file {}", path);
+        } else if(!m_file.read(magic, sizeof(magic))
+               || std::memcmp(magic, Magic, sizeof(Magic)) != 0
+               || !get(version)) {
+            result.success() = false;
+            result.error() = fmt::format("{} is not a warabi trace file", path);
+        } else if(version != Version) {
+            result.success() = false;
+            result.error() = fmt::format("Unsupported trace file version {}", version);
+        }
+        return result;
+    }
+
+    /**
+     * @brief Read the next record. Returns false at the end of the
+     * file (a truncated last record is ignored).
+     */
+    bool next(Record& r) {
+        uint8_t op = 0;
+        uint16_t reserved = 0;
+        uint32_t count = 0;
+        if(!(get(op) && get(r.flags) && get(reserved) && get(r.client) && get(count)
+          && get(r.start) && get(r.duration) && get(r.size)))
+            return false;
+        r.op = (Op)op;
+        r.regions.clear();
+        r.address.clear();
+        if(r.op == Op::Client) {
+            r.address.resize(count);
+            return (bool)m_file.read(r.address.data(), count);
+        }
+        r.regions.resize(count);
+        for(auto& region : r.regions) {
+            uint32_t segments = 0;
+            if(!m_file.read(reinterpret_cast<char*>(region.first.data()), region.first.size())
+            || !get(segments))
+                return false;
+            region.second.resize(segments);
+            for(auto& segment : region.second) {
+                uint64_t offset = 0, size = 0;
+                if(!(get(offset) && get(size))) return false;
+                segment = {offset, size};
+            }
+        }
+        return true;
+    }
+};
+
+}
+
+}
+
+#endif
@@ -0,0 +1,333 @@
+/*
+ * (C) 2024 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __WARABI_RECORDER_HPP
+#define __WARABI_RECORDER_HPP
+
+#include <warabi/Result.hpp>
+#include <warabi/RegionID.hpp>
+#include "RecordFormat.hpp"
+#include <nlohmann/json.hpp>
+#include <nlohmann/json-schema.hpp>
+#include <fmt/format.h>
+#include <thallium.hpp>
+
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace warabi {
+
+/**
+ * @brief The Recorder logs the data-path requests received by a provider
+ * (operation, client, regions and segments, sizes, persist flag, start
+ * time and duration) to a binary trace file (see RecordFormat.hpp) that
+ * warabi-replay can re-issue against another provider.
+ *
+ * Records are encoded into an in-memory buffer of "buffer_size" bytes.
+ * Full buffers are queued, in the order in which they were filled, to a
+ * writer thread that appends them to the file, so that handlers never
+ * wait for the file system (the writer is a plain thread rather than a
+ * ULT since std::ofstream would block the execution stream running it).
+ * The remaining records are written when the provider is destroyed.
+ *
+ * Recording is disabled unless the provider is configured with a
+ * "recording" object. Example of configuration (with default values):
+ *
+ * {
+ *     "path": "warabi-{pid}.trace",
+ *     "buffer_size": 1048576
+ * }
+ */
+class Recorder {
+
+    using json  = nlohmann::json;
+    using Clock = std::chrono::steady_clock;
+
+    public:
+
+    /**
+     * @brief RAII object recording a request when it is destroyed,
+     * with the time elapsed since it was created as duration.
+     */
+    class Entry {
+
+        friend class Recorder;
+
+        Recorder*      m_owner = nullptr;
+        record::Record m_record;
+
+        Entry(Recorder* owner, record::Op op, uint32_t client, uint8_t flags)
+        : m_owner(owner) {
+            m_record.op     = op;
+            m_record.client = client;
+            m_record.flags  = flags;
+            m_record.start  = owner->elapsed();
+        }
+
+        public:
+
+        Entry() = default;
+
+        Entry(const Entry&) = delete;
+        Entry& operator=(const Entry&) = delete;
+
+        /**
+         * @brief Add segments of a region to the record.
+         */
+        void add(const RegionID& region,
+                 const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes) {
+            if(!m_owner) return;
+            m_record.regions.emplace_back(region, regionOffsetSizes);
+            for(auto& segment : regionOffsetSizes)
+                m_record.size += segment.second;
+        }
+
+        void add(const std::vector<RegionSegments>& regions) {
+            for(auto& region : regions) add(region.first, region.second);
+        }
+
+        /**
+         * @brief Set the size of the request (create requests).
+         */
+        void setSize(size_t size) {
+            m_record.size = size;
+        }
+
+        /**
+         * @brief Set the region created by a create request.
+         */
+        void setCreated(const RegionID& region) {
+            if(!m_owner) return;
+            m_record.regions.emplace_back(region, std::vector<std::pair<size_t, size_t>>{});
+        }
+
+        ~Entry() {
+            if(!m_owner) return;
+            m_record.duration = m_owner->elapsed() - m_record.start;
+            m_owner->append(m_record);
+        }
+    };
+
+    Recorder() = default;
+
+    Recorder(const Recorder&) = delete;
+    Recorder& operator=(const Recorder&) = delete;
+
+    ~Recorder() {
+        auto flushed = flush();
+        (void)flushed;
+        if(!m_writer.joinable()) return;
+        {
+            std::unique_lock<std::mutex> lock{m_mutex};
+            m_stop = true;
+        }
+        m_queue_cv.notify_one();
+        m_writer.join();
+    }
+
+    /**
+     * @brief Validate a "recording" configuration object.
+     */
+    static Result<bool> validate(const json& config) {
+        static const json schema = R"(
+        {
+            "type": "object",
+            "properties": {
+                "path": {"type": "string"},
+                "buffer_size": {"type": "integer", "minimum": 4096}
+            }
+        }
+        )"_json;
+        Result<bool> result;
+        nlohmann::json_schema::json_validator validator;
+        validator.set_root_schema(schema);
+        try {
+            validator.validate(config);
+        } catch(const std::exception& ex) {
+            result.success() = false;
+            result.error() = fmt::format(
+                "Error(s) while validating JSON config for warabi recording: {}", ex.what());
+        }
+        return result;
+    }
+
+    /**
+     * @brief Configure the Recorder and open its trace file (the
+     * configuration is expected to have been validated).
+     */
+    Result<bool> configure(const json& config) {
+        Result<bool> result;
+        auto path = config.value("path", std::string{"warabi-{pid}.trace"});
+        auto pid = path.find("{pid}");
+        if(pid != std::string::npos)
+            path.replace(pid, 5, std::to_string(getpid()));
+        if(m_enabled) {
+            result.success() = false;
+            result.error() = "Recording is already enabled";
+            return result;
+        }
+        m_file.open(path, std::ios::binary | std::ios::trunc);
+        if(!m_file) {
+            result.success() = false;
+            result.error() = fmt::format("Could not open recording file {}", path);
+            return result;
+        }
+        m_file.write(record::Magic, sizeof(record::Magic));
+        m_file.write(reinterpret_cast<const char*>(&record::Version), sizeof(record::Version));
+        m_buffer_size = config.value("buffer_size", (size_t)1048576);
+        m_buffer.reserve(m_buffer_size);
+        m_start   = Clock::now();
+        m_config  = config;
+        m_writer  = std::thread{[this]() { writeQueued(); }};
+        m_enabled = true;
+        return result;
+    }
+
+    /**
+     * @brief Return the configuration (null if never configured).
+     */
+    const json& getConfig() const {
+        return m_config;
+    }
+
+    bool enabled() const {
+        return m_enabled;
+    }
+
+    /**
+     * @brief Start recording a request from the sender of req.
+     * The returned Entry does nothing if recording is disabled.
+     */
+    Entry record(record::Op op, const thallium::request& req, uint8_t flags = 0) {
+        if(!m_enabled) return Entry{};
+        return Entry{this, op, clientOf(req), flags};
+    }
+
+    /**
+     * @brief Write the buffered records to the file, waiting
+     * for the writer thread to have written them.
+     */
+    Result<bool> flush() {
+        Result<bool> result;
+        if(!m_enabled) return result;
+        std::unique_lock<std::mutex> lock{m_mutex};
+        enqueueLocked();
+        auto queued = m_queued;
+        m_written_cv.wait(lock, [this, queued]() { return m_written >= queued; });
+        if(m_failed) {
+            result.success() = false;
+            result.error() = "Failed to write recording file";
+        }
+        return result;
+    }
+
+    /**
+     * @brief Return statistics as a JSON object.
+     */
+    json getStats() const {
+        auto stats = json::object();
+        stats["records"] = m_records.load();
+        stats["bytes"]   = m_bytes.load();
+        return stats;
+    }
+
+    private:
+
+    uint64_t elapsed() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Clock::now() - m_start).count();
+    }
+
+    uint32_t clientOf(const thallium::request& req) {
+        auto address = static_cast<std::string>(req.get_endpoint());
+        std::unique_lock<std::mutex> lock{m_mutex};
+        auto it = m_clients.find(address);
+        if(it != m_clients.end()) return it->second;
+        uint32_t id = m_clients.size();
+        m_clients.emplace(address, id);
+        record::Record r;
+        r.op      = record::Op::Client;
+        r.client  = id;
+        r.address = address;
+        record::encode(r, m_buffer);
+        return id;
+    }
+
+    void append(const record::Record& r) {
+        std::unique_lock<std::mutex> lock{m_mutex};
+        auto before = m_buffer.size();
+        record::encode(r, m_buffer);
+        m_bytes.fetch_add(m_buffer.size() - before, std::memory_order_relaxed);
+        m_records.fetch_add(1, std::memory_order_relaxed);
+        if(m_buffer.size() >= m_buffer_size) enqueueLocked();
+    }
+
+    /**
+     * @brief Queue the current buffer for the writer thread. Buffers are
+     * queued under the same lock as records are encoded, so they reach
+     * the file in order (e.g. a Client record before the records using it).
+     */
+    void enqueueLocked() {
+        if(m_buffer.empty()) return;
+        m_queue.push_back(std::move(m_buffer));
+        m_buffer = std::vector<char>{};
+        m_buffer.reserve(m_buffer_size);
+        m_queued += 1;
+        m_queue_cv.notify_one();
+    }
+
+    void writeQueued() {
+        std::unique_lock<std::mutex> lock{m_mutex};
+        while(true) {
+            m_queue_cv.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+            if(m_queue.empty()) return;
+            auto data = std::move(m_queue.front());
+            m_queue.pop_front();
+            lock.unlock();
+            m_file.write(data.data(), data.size());
+            m_file.flush();
+            bool failed = !m_file;
+            lock.lock();
+            m_failed = m_failed || failed;
+            m_written += 1;
+            m_written_cv.notify_all();
+        }
+    }
+
+    json                                      m_config;
+    bool                                      m_enabled = false;
+    Clock::time_point                         m_start;
+    std::mutex                                m_mutex;
+    std::vector<char>                         m_buffer;
+    size_t                                    m_buffer_size = 1048576;
+    std::unordered_map<std::string, uint32_t> m_clients;
+    // full buffers waiting for the writer thread, which is
+    // the only one writing to m_file once recording is enabled
+    std::deque<std::vector<char>>             m_queue;
+    std::condition_variable                   m_queue_cv;
+    std::condition_variable                   m_written_cv;
+    size_t                                    m_queued = 0;
+    size_t                                    m_written = 0;
+    bool                                      m_failed = false;
+    bool                                      m_stop = false;
+    std::thread                               m_writer;
+    std::ofstream                             m_file;
+    std::atomic<size_t>                       m_records{0};
+    std::atomic<size_t>                       m_bytes{0};
+};
+
+}
+
+#endif
@@ -0,0 +1,248 @@
+/*
+ * (C) 2024 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#include "warabi/TransferManager.hpp"
+#include <fmt/format.h>
+#include <nlohmann/json.hpp>
+#include <nlohmann/json-schema.hpp>
+#include <limits>
+#include <memory>
+#include <numeric>
+
+namespace warabi {
+
+using nlohmann::json;
+using nlohmann::json_schema::json_validator;
+
+/**
+ * @brief The RouterTransferManager dispatches each pull and push to one of
+ * several other TransferManagers, depending on the total size and number of
+ * segments of the transfer. This lets small transfers go directly to the
+ * target (__default__) while large ones are pipelined through a bounded
+ * amount of memory (pipeline), for instance.
+ *
+ * Rules are evaluated in order and the first one whose bounds (inclusive,
+ * all optional) match the transfer is used. Transfers matching no rule go
+ * to the "default" TransferManager (__default__ if not specified).
+ * Rules with the same type and configuration share the same TransferManager.
+ *
+ * Example of configuration:
+ *
+ * {
+ *     "rules": [
+ *         {"max_size": 65536, "type": "__default__"},
+ *         {"min_segments": 64, "type": "__default__"}
+ *     ],
+ *     "default": {
+ *         "type": "pipeline",
+ *         "config": {
+ *             "num_pools": 4,
+ *             "num_buffers_per_pool": 8,
+ *             "first_buffer_size": 1048576,
+ *             "buffer_size_multiplier": 2
+ *         }
+ *     }
+ * }
+ */
+class RouterTransferManager : public TransferManager {
+
+    using json = nlohmann::json;
+
+    static constexpr size_t Unbounded = std::numeric_limits<size_t>::max();
+
+    struct Rule {
+        size_t                           min_size     = 0;
+        size_t                           max_size     = Unbounded;
+        size_t                           min_segments = 0;
+        size_t                           max_segments = Unbounded;
+        std::shared_ptr<TransferManager> manager;
+
+        bool matches(size_t size, size_t segments) const {
+            return size >= min_size && size <= max_size
+                && segments >= min_segments && segments <= max_segments;
+        }
+    };
+
+    json                             m_config;
+    std::vector<Rule>                m_rules;
+    std::shared_ptr<TransferManager> m_default;
+
+    TransferManager& route(const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes) const {
+        auto size = std::accumulate(regionOffsetSizes.begin(), regionOffsetSizes.end(), (size_t)0,
+                [](size_t acc, const std::pair<size_t, size_t>& p) { return acc + p.second; });
+        for(auto& rule : m_rules)
+            if(rule.matches(size, regionOffsetSizes.size()))
+                return *rule.manager;
+        return *m_default;
+    }
+
+    public:
+
+    RouterTransferManager(json config, std::vector<Rule> rules,
+                          std::shared_ptr<TransferManager> defaultManager)
+    : m_config(std::move(config))
+    , m_rules(std::move(rules))
+    , m_default(std::move(defaultManager)) {}
+
+    RouterTransferManager(RouterTransferManager&&) = default;
+    RouterTransferManager(const RouterTransferManager&) = default;
+    RouterTransferManager& operator=(RouterTransferManager&&) = default;
+    RouterTransferManager& operator=(const RouterTransferManager&) = default;
+    virtual ~RouterTransferManager() = default;
+
+    std::string getConfig() const override {
+        return m_config.dump();
+    }
+
+    Result<bool> pull(
+            WritableRegion& region,
+            const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+            thallium::bulk data,
+            thallium::endpoint address,
+            size_t bulkOffset,
+            bool persist) override {
+        return route(regionOffsetSizes).pull(
+            region, regionOffsetSizes, std::move(data), std::move(address), bulkOffset, persist);
+    }
+
+    Result<bool> push(
+            ReadableRegion& region,
+            const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+            thallium::bulk data,
+            thallium::endpoint address,
+            size_t bulkOffset) override {
+        return route(regionOffsetSizes).push(
+            region, regionOffsetSizes, std::move(data), std::move(address), bulkOffset);
+    }
+
+    static Result<std::unique_ptr<TransferManager>> create(
+            const thallium::engine& engine, const json& config) {
+        Result<std::unique_ptr<TransferManager>> result;
+
+        // TransferManagers already created, indexed by their type and configuration
+        std::unordered_map<std::string, std::shared_ptr<TransferManager>> managers;
+        auto getManager = [&](const json& spec) -> Result<std::shared_ptr<TransferManager>> {
+            Result<std::shared_ptr<TransferManager>> r;
+            auto type = spec.value("type", "__default__");
+            auto tm_config = spec.value("config", json::object());
+            auto key = type + tm_config.dump();
+            auto it = managers.find(key);
+            if(it != managers.end()) {
+                r.value() = it->second;
+                return r;
+            }
+            auto tm = TransferManagerFactory::createTransferManager(type, engine, tm_config);
+            if(!tm.success()) {
+                r.success() = false;
+                r.error() = tm.error();
+                return r;
+            }
+            r.value() = std::move(tm.value());
+            managers.emplace(key, r.value());
+            return r;
+        };
+
+        // the configuration returned by getConfig includes the
+        // complete configuration of each TransferManager
+        auto full_config = config;
+        if(!full_config.contains("default"))
+            full_config["default"] = json::object();
+
+        std::vector<Rule> rules;
+        for(auto& rule_config : full_config["rules"]) {
+            Rule rule;
+            rule.min_size     = rule_config.value("min_size", rule.min_size);
+            rule.max_size     = rule_config.value("max_size", rule.max_size);
+            rule.min_segments = rule_config.value("min_segments", rule.min_segments);
+            rule.max_segments = rule_config.value("max_segments", rule.max_segments);
+            auto tm = getManager(rule_config);
+            if(!tm.success()) {
+                result.success() = false;
+                result.error() = tm.error();
+                return result;
+            }
+            rule.manager = std::move(tm.value());
+            rule_config["type"] = rule.manager->name();
+            rule_config["config"] = json::parse(rule.manager->getConfig());
+            rules.push_back(std::move(rule));
+        }
+
+        auto& default_config = full_config["default"];
+        auto tm = getManager(default_config);
+        if(!tm.success()) {
+            result.success() = false;
+            result.error() = tm.error();
+            return result;
+        }
+        default_config["type"] = tm.value()->name();
+        default_config["config"] = json::parse(tm.value()->getConfig());
+
+        result.value() = std::make_unique<RouterTransferManager>(
+            std::move(full_config), std::move(rules), std::move(tm.value()));
+        return result;
+    }
+
+    static Result<bool> validate(const json& config) {
+        static const json schema = R"(
+        {
+            "type": "object",
+            "properties": {
+                "rules": {
+                    "type": "array",
+                    "items": {
+                        "type": "object",
+                        "properties": {
+                            "min_size": {"type": "integer", "minimum": 0},
+                            "max_size": {"type": "integer", "minimum": 0},
+                            "min_segments": {"type": "integer", "minimum": 0},
+                            "max_segments": {"type": "integer", "minimum": 0},
+                            "type": {"type": "string"},
+                            "config": {"type": "object"}
+                        },
+                        "required": ["type"]
+                    }
+                },
+                "default": {
+                    "type": "object",
+                    "properties": {
+                        "type": {"type": "string"},
+                        "config": {"type": "object"}
+                    }
+                }
+            },
+            "required": ["rules"]
+        }
+        )"_json;
+
+        Result<bool> result;
+
+        json_validator validator;
+        validator.set_root_schema(schema);
+        try {
+            validator.validate(config);
+        } catch(const std::exception& ex) {
+            result.success() = false;
+            result.error() = fmt::format(
+                "Error(s) while validating JSON config for warabi RouterTransferManager: {}", ex.what());
+            return result;
+        }
+
+        // validate the configuration of each TransferManager
+        auto rules = config["rules"];
+        rules.push_back(config.value("default", json::object()));
+        for(auto& rule : rules) {
+            auto type = rule.value("type", "__default__");
+            auto tm_config = rule.value("config", json::object());
+            result = TransferManagerFactory::validateConfig(type, tm_config);
+            if(!result.success()) return result;
+        }
+
+        return result;
+    }
+};
+
+WARABI_REGISTER_TRANSFER_MANAGER(router, RouterTransferManager);
+
+}
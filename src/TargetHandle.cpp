@@ -11,6 +11,8 @@
 #include "ClientImpl.hpp"
 #include "TargetHandleImpl.hpp"
 #include "BufferWrapper.hpp"
+#include "Tracer.hpp"
+#include "Probes.hpp"
 
 #include <thallium/serialization/stl/string.hpp>
 #include <thallium/serialization/stl/vector.hpp>
@@ -52,26 +54,111 @@ void TargetHandle::setEagerReadThreshold(size_t size) {
     self->m_eager_read_threshold = size;
 }
 
+void TargetHandle::setReadCacheCapacity(size_t capacity) {
+    if(not self) throw Exception("Invalid warabi::TargetHandle object");
+    self->m_read_cache.setCapacity(capacity);
+}
+
+void TargetHandle::setRetryPolicy(size_t maxRetries, size_t maxBackoffMs) {
+    if(not self) throw Exception("Invalid warabi::TargetHandle object");
+    self->m_max_retries = maxRetries;
+    self->m_max_backoff_ms = maxBackoffMs;
+}
+
+/**
+ * @brief Send an RPC using issue() and process its result using complete(),
+ * retrying if the provider is busy. If async is false, the call is
+ * synchronous and a null pointer is returned. Otherwise, the returned
+ * AsyncRequestImpl will process the result when waited on.
+ */
+template<typename ResultType, typename Issue, typename Complete>
+static std::shared_ptr<AsyncRequestImpl> sendWithRetry(
+        const std::shared_ptr<TargetHandleImpl>& self,
+        Issue&& issue, Complete&& complete, bool async) {
+    self->throttle();
+    auto async_response = issue();
+    if(!async) { // synchronous call
+        complete(self->waitWithRetry<ResultType>(async_response, issue));
+        return nullptr;
+    }
+    // asynchronous call
+    auto async_request_impl =
+        std::make_shared<AsyncRequestImpl>(std::move(async_response));
+    async_request_impl->m_wait_callback =
+        [self, issue=std::forward<Issue>(issue), complete=std::forward<Complete>(complete)]
+        (AsyncRequestImpl& async_request_impl) {
+            complete(self->waitWithRetry<ResultType>(
+                *async_request_impl.m_async_response, issue));
+        };
+    return async_request_impl;
+}
+
+static size_t totalSize(const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes) {
+    size_t size = 0;
+    for(auto& segment : regionOffsetSizes)
+        size += segment.second;
+    return size;
+}
+
+static size_t totalSize(const std::vector<RegionSegments>& regions) {
+    size_t size = 0;
+    for(auto& region : regions)
+        size += totalSize(region.second);
+    return size;
+}
+
+static size_t segmentCount(const std::vector<RegionSegments>& regions) {
+    size_t count = 0;
+    for(auto& region : regions)
+        count += region.second.size();
+    return count;
+}
+
+/**
+ * @brief Same as sendWithRetry for the RPCs that carry a trace ID: issue()
+ * is passed the ID to send (0 if the request is not sampled) and, if the
+ * request is traced, a "client" span named after the RPC covers it from
+ * before it is sent until its response is processed. The client_issue and
+ * client_complete USDT probes (see Probes.hpp) fire at the same points,
+ * with the size and number of segments of the request.
+ */
+template<typename ResultType, typename Issue, typename Complete>
+static std::shared_ptr<AsyncRequestImpl> sendTraced(
+        const std::shared_ptr<TargetHandleImpl>& self, const char* name,
+        size_t size, size_t segments,
+        Issue&& issue, Complete&& complete, bool async) {
+    auto trace_id = Tracer::instance().sample();
+    auto start    = trace_id ? Tracer::now() : 0;
+    uint64_t issued = WARABI_PROBE_ENABLED(client_complete) ? probe::now() : 0;
+    if(WARABI_PROBE_ENABLED(client_issue))
+        WARABI_PROBE(client_issue, name, size, segments);
+    return sendWithRetry<ResultType>(self,
+        [issue=std::forward<Issue>(issue), trace_id]() { return issue(trace_id); },
+        [complete=std::forward<Complete>(complete), name, size, segments, trace_id, start, issued]
+        (ResultType&& response) {
+            if(trace_id)
+                Tracer::instance().record("client", name, trace_id, start, Tracer::now() - start);
+            if(issued) {
+                uint64_t latency = probe::now() - issued;
+                WARABI_PROBE(client_complete, name, size, segments, latency);
+            }
+            complete(std::move(response));
+        }, async);
+}
+
 void TargetHandle::create(RegionID* region, size_t size,
                           AsyncRequest* req) const
 {
     if(not self) throw Exception("Invalid warabi::TargetHandle object");
     auto& rpc = self->m_client->m_create;
     auto& ph  = self->m_ph;
-    auto async_response = rpc.on(ph).async(size);
-    if(req == nullptr) { // synchronous call
-        Result<RegionID> response = async_response.wait();
-        if(region) *region = std::move(response).valueOrThrow();
-    } else { // asynchronous call
-        auto async_request_impl =
-            std::make_shared<AsyncRequestImpl>(std::move(async_response));
-        async_request_impl->m_wait_callback =
-            [region](AsyncRequestImpl& async_request_impl) {
-                Result<RegionID> response = async_request_impl.m_async_response.wait();
-                if(region) *region = std::move(response).value();
-            };
-        *req = AsyncRequest(std::move(async_request_impl));
-    }
+    auto async_request_impl = sendTraced<Result<RegionID>>(self, "create", size, 0,
+        [&rpc, ph, size](uint64_t trace_id) { return rpc.on(ph).async(size, trace_id); },
+        [region](Result<RegionID>&& response) {
+            if(region) *region = std::move(response).valueOrThrow();
+            else response.check();
+        }, req != nullptr);
+    if(req) *req = AsyncRequest(std::move(async_request_impl));
 }
 
 void TargetHandle::write(const RegionID& region,
@@ -91,6 +178,7 @@ void TargetHandle::write(const RegionID& region,
                          AsyncRequest* req) const
 {
     if(not self) throw Exception("Invalid warabi::TargetHandle object");
+    self->m_read_cache.invalidate(region);
     size_t size = std::accumulate(regionOffsetSizes.begin(),
                                   regionOffsetSizes.end(), (size_t)0,
         [](size_t s, const std::pair<size_t, size_t>& segment) {
@@ -105,21 +193,14 @@ void TargetHandle::write(const RegionID& region,
     // eager path
     auto& rpc = self->m_client->m_write_eager;
     auto& ph  = self->m_ph;
-    auto buffer = BufferWrapper::Ref(data, size);
-    auto async_response = rpc.on(ph).async(region, regionOffsetSizes, buffer, persist);
-    if(req == nullptr) { // synchronous call
-        Result<bool> response = async_response.wait();
-        response.check();
-    } else { // asynchronous call
-        auto async_request_impl =
-            std::make_shared<AsyncRequestImpl>(std::move(async_response));
-        async_request_impl->m_wait_callback =
-            [](AsyncRequestImpl& async_request_impl) {
-                Result<bool> response = async_request_impl.m_async_response.wait();
-                response.check();
-            };
-        *req = AsyncRequest(std::move(async_request_impl));
-    }
+    auto async_request_impl = sendTraced<Result<bool>>(self, "write_eager",
+        size, regionOffsetSizes.size(),
+        [&rpc, ph, region, regionOffsetSizes, data, size, persist](uint64_t trace_id) {
+            return rpc.on(ph).async(region, regionOffsetSizes, BufferWrapper::Ref(data, size), persist, trace_id);
+        },
+        [](Result<bool>&& response) { response.check(); },
+        req != nullptr);
+    if(req) *req = AsyncRequest(std::move(async_request_impl));
 }
 
 void TargetHandle::write(const RegionID& region,
@@ -143,22 +224,17 @@ void TargetHandle::write(const RegionID& region,
                          AsyncRequest* req) const
 {
     if(not self) throw Exception("Invalid warabi::TargetHandle object");
+    self->m_read_cache.invalidate(region);
     auto& rpc = self->m_client->m_write;
     auto& ph  = self->m_ph;
-    auto async_response = rpc.on(ph).async(region, regionOffsetSizes, data, address, bulkOffset, persist);
-    if(req == nullptr) { // synchronous call
-        Result<bool> response = async_response.wait();
-        response.check();
-    } else { // asynchronous call
-        auto async_request_impl =
-            std::make_shared<AsyncRequestImpl>(std::move(async_response));
-        async_request_impl->m_wait_callback =
-            [](AsyncRequestImpl& async_request_impl) {
-                Result<bool> response = async_request_impl.m_async_response.wait();
-                response.check();
-            };
-        *req = AsyncRequest(std::move(async_request_impl));
-    }
+    auto async_request_impl = sendTraced<Result<bool>>(self, "write",
+        totalSize(regionOffsetSizes), regionOffsetSizes.size(),
+        [&rpc, ph, region, regionOffsetSizes, data, address, bulkOffset, persist](uint64_t trace_id) {
+            return rpc.on(ph).async(region, regionOffsetSizes, data, address, bulkOffset, persist, trace_id);
+        },
+        [](Result<bool>&& response) { response.check(); },
+        req != nullptr);
+    if(req) *req = AsyncRequest(std::move(async_request_impl));
 }
 
 void TargetHandle::persist(const RegionID& region,
@@ -175,20 +251,14 @@ void TargetHandle::persist(const RegionID& region,
     if(not self) throw Exception("Invalid warabi::TargetHandle object");
     auto& rpc = self->m_client->m_persist;
     auto& ph  = self->m_ph;
-    auto async_response = rpc.on(ph).async(region, regionOffsetSizes);
-    if(req == nullptr) { // synchronous call
-        Result<bool> response = async_response.wait();
-        response.check();
-    } else { // asynchronous call
-        auto async_request_impl =
-            std::make_shared<AsyncRequestImpl>(std::move(async_response));
-        async_request_impl->m_wait_callback =
-            [](AsyncRequestImpl& async_request_impl) {
-                Result<bool> response = async_request_impl.m_async_response.wait();
-                response.check();
-            };
-        *req = AsyncRequest(std::move(async_request_impl));
-    }
+    auto async_request_impl = sendTraced<Result<bool>>(self, "persist",
+        totalSize(regionOffsetSizes), regionOffsetSizes.size(),
+        [&rpc, ph, region, regionOffsetSizes](uint64_t trace_id) {
+            return rpc.on(ph).async(region, regionOffsetSizes, trace_id);
+        },
+        [](Result<bool>&& response) { response.check(); },
+        req != nullptr);
+    if(req) *req = AsyncRequest(std::move(async_request_impl));
 }
 
 void TargetHandle::createAndWrite(RegionID* region,
@@ -206,23 +276,16 @@ void TargetHandle::createAndWrite(RegionID* region,
     // eager path
     auto& rpc = self->m_client->m_create_write_eager;
     auto& ph  = self->m_ph;
-    auto async_response = rpc.on(ph).async(
-        BufferWrapper::Ref(data, size), persist);
-    if(req == nullptr) { // synchronous call
-        Result<RegionID> response = async_response.wait();
-        if(region) *region = std::move(response).valueOrThrow();
-        else response.check();
-    } else { // asynchronous call
-        auto async_request_impl =
-            std::make_shared<AsyncRequestImpl>(std::move(async_response));
-        async_request_impl->m_wait_callback =
-            [region](AsyncRequestImpl& async_request_impl) {
-                Result<RegionID> response = async_request_impl.m_async_response.wait();
-                if(region) *region = std::move(response).valueOrThrow();
-                else response.check();
-            };
-        *req = AsyncRequest(std::move(async_request_impl));
-    }
+    auto async_request_impl = sendTraced<Result<RegionID>>(self, "create_write_eager",
+        size, 1,
+        [&rpc, ph, data, size, persist](uint64_t trace_id) {
+            return rpc.on(ph).async(BufferWrapper::Ref(data, size), persist, trace_id);
+        },
+        [region](Result<RegionID>&& response) {
+            if(region) *region = std::move(response).valueOrThrow();
+            else response.check();
+        }, req != nullptr);
+    if(req) *req = AsyncRequest(std::move(async_request_impl));
 }
 
 void TargetHandle::createAndWrite(
@@ -236,22 +299,15 @@ void TargetHandle::createAndWrite(
     if(not self) throw Exception("Invalid warabi::TargetHandle object");
     auto& rpc = self->m_client->m_create_write;
     auto& ph  = self->m_ph;
-    auto async_response = rpc.on(ph).async(data, address, bulkOffset, size, persist);
-    if(req == nullptr) { // synchronous call
-        Result<RegionID> response = async_response.wait();
-        if(region) *region = std::move(response).valueOrThrow();
-        else response.check();
-    } else { // asynchronous call
-        auto async_request_impl =
-            std::make_shared<AsyncRequestImpl>(std::move(async_response));
-        async_request_impl->m_wait_callback =
-            [region](AsyncRequestImpl& async_request_impl) {
-                Result<RegionID> response = async_request_impl.m_async_response.wait();
-                if(region) *region = std::move(response).valueOrThrow();
-                else response.check();
-            };
-        *req = AsyncRequest(std::move(async_request_impl));
-    }
+    auto async_request_impl = sendTraced<Result<RegionID>>(self, "create_write", size, 1,
+        [&rpc, ph, data, address, bulkOffset, size, persist](uint64_t trace_id) {
+            return rpc.on(ph).async(data, address, bulkOffset, size, persist, trace_id);
+        },
+        [region](Result<RegionID>&& response) {
+            if(region) *region = std::move(response).valueOrThrow();
+            else response.check();
+        }, req != nullptr);
+    if(req) *req = AsyncRequest(std::move(async_request_impl));
 }
 
 void TargetHandle::read(
@@ -280,28 +336,57 @@ void TargetHandle::read(
         read(region, regionOffsetSizes, std::move(bulk), "", 0, req);
         return;
     }
+    if(self->m_read_cache.enabled()) {
+        readCached(region, regionOffsetSizes, data, size, req);
+        return;
+    }
     // eager path
     auto& rpc = self->m_client->m_read_eager;
     auto& ph  = self->m_ph;
-    auto async_response = rpc.on(ph).async(region, regionOffsetSizes);
-    if(req == nullptr) { // synchronous call
-        Result<BufferWrapper> response = async_response.wait();
-        response.check();
-        // TODO we are forced to do a copy here, ideally thallium's packed_data
-        // should give us a way to deserialize directly into an existing BufferWrapper
-        std::memcpy(data, response.value().data(), size);
-    } else { // asynchronous call
-        auto async_request_impl =
-            std::make_shared<AsyncRequestImpl>(std::move(async_response));
-        async_request_impl->m_wait_callback =
-            [data, size](AsyncRequestImpl& async_request_impl) {
-                Result<BufferWrapper> response = async_request_impl.m_async_response.wait();
-                response.check();
-                // TODO same as above
-                std::memcpy(data, response.value().data(), size);
-            };
-        *req = AsyncRequest(std::move(async_request_impl));
+    auto async_request_impl = sendTraced<Result<BufferWrapper>>(self, "read_eager",
+        size, regionOffsetSizes.size(),
+        [&rpc, ph, region, regionOffsetSizes](uint64_t trace_id) {
+            return rpc.on(ph).async(region, regionOffsetSizes, trace_id);
+        },
+        [data, size](Result<BufferWrapper>&& response) {
+            response.check();
+            // TODO we are forced to do a copy here, ideally thallium's packed_data
+            // should give us a way to deserialize directly into an existing BufferWrapper
+            std::memcpy(data, response.value().data(), size);
+        }, req != nullptr);
+    if(req) *req = AsyncRequest(std::move(async_request_impl));
+}
+
+void TargetHandle::readCached(
+        const RegionID& region,
+        const std::vector<std::pair<size_t, size_t>>& regionOffsetSizes,
+        char* data, size_t size,
+        AsyncRequest* req) const
+{
+    auto cache = &self->m_read_cache;
+    if(cache->lookup(region, regionOffsetSizes, data)) {
+        if(req) *req = AsyncRequest(std::make_shared<AsyncRequestImpl>());
+        return;
     }
+    // the lease is counted from before the request is sent,
+    // so it expires here before it expires on the provider
+    auto sent = ReadCache::now();
+    auto& rpc = self->m_client->m_read_leased;
+    auto& ph  = self->m_ph;
+    auto async_request_impl = sendTraced<Result<LeasedBuffer>>(self, "read_leased",
+        size, regionOffsetSizes.size(),
+        [&rpc, ph, region, regionOffsetSizes](uint64_t trace_id) {
+            return rpc.on(ph).async(region, regionOffsetSizes, trace_id);
+        },
+        [cache, sent, region, regionOffsetSizes, data, size](Result<LeasedBuffer>&& response) {
+            response.check();
+            std::memcpy(data, response.value().buffer.data(), size);
+            auto lease_ms = response.value().lease_ms;
+            if(lease_ms)
+                cache->insert(region, regionOffsetSizes, data,
+                              sent + std::chrono::milliseconds(lease_ms));
+        }, req != nullptr);
+    if(req) *req = AsyncRequest(std::move(async_request_impl));
 }
 
 void TargetHandle::read(
@@ -326,42 +411,278 @@ void TargetHandle::read(
     if(not self) throw Exception("Invalid warabi::TargetHandle object");
     auto& rpc = self->m_client->m_read;
     auto& ph  = self->m_ph;
-    auto async_response = rpc.on(ph).async(region, regionOffsetSizes, data, address, bulkOffset);
-    if(req == nullptr) { // synchronous call
-        Result<bool> response = async_response.wait();
-        response.check();
-    } else { // asynchronous call
-        auto async_request_impl =
-            std::make_shared<AsyncRequestImpl>(std::move(async_response));
-        async_request_impl->m_wait_callback =
-            [](AsyncRequestImpl& async_request_impl) {
-                Result<bool> response = async_request_impl.m_async_response.wait();
-                response.check();
-            };
-        *req = AsyncRequest(std::move(async_request_impl));
+    auto async_request_impl = sendTraced<Result<bool>>(self, "read",
+        totalSize(regionOffsetSizes), regionOffsetSizes.size(),
+        [&rpc, ph, region, regionOffsetSizes, data, address, bulkOffset](uint64_t trace_id) {
+            return rpc.on(ph).async(region, regionOffsetSizes, data, address, bulkOffset, trace_id);
+        },
+        [](Result<bool>&& response) { response.check(); },
+        req != nullptr);
+    if(req) *req = AsyncRequest(std::move(async_request_impl));
+}
+
+void TargetHandle::readv(
+        const std::vector<RegionSegments>& regions,
+        char* data,
+        AsyncRequest* req) const
+{
+    if(not self) throw Exception("Invalid warabi::TargetHandle object");
+    size_t size = totalSize(regions);
+    if(size >= self->m_eager_read_threshold) {
+        auto bulk = self->m_client->m_engine.expose({{data, size}}, tl::bulk_mode::write_only);
+        readv(regions, std::move(bulk), "", 0, req);
+        return;
+    }
+    // eager path
+    auto& rpc = self->m_client->m_readv_eager;
+    auto& ph  = self->m_ph;
+    auto async_request_impl = sendTraced<Result<BufferWrapper>>(self, "readv_eager",
+        size, segmentCount(regions),
+        [&rpc, ph, regions](uint64_t trace_id) {
+            return rpc.on(ph).async(regions, trace_id);
+        },
+        [data, size](Result<BufferWrapper>&& response) {
+            response.check();
+            std::memcpy(data, response.value().data(), size);
+        }, req != nullptr);
+    if(req) *req = AsyncRequest(std::move(async_request_impl));
+}
+
+void TargetHandle::readv(
+        const std::vector<RegionSegments>& regions,
+        thallium::bulk data,
+        const std::string& address,
+        size_t bulkOffset,
+        AsyncRequest* req) const
+{
+    if(not self) throw Exception("Invalid warabi::TargetHandle object");
+    auto& rpc = self->m_client->m_readv;
+    auto& ph  = self->m_ph;
+    auto async_request_impl = sendTraced<Result<bool>>(self, "readv",
+        totalSize(regions), segmentCount(regions),
+        [&rpc, ph, regions, data, address, bulkOffset](uint64_t trace_id) {
+            return rpc.on(ph).async(regions, data, address, bulkOffset, trace_id);
+        },
+        [](Result<bool>&& response) { response.check(); },
+        req != nullptr);
+    if(req) *req = AsyncRequest(std::move(async_request_impl));
+}
+
+void TargetHandle::writev(
+        const std::vector<RegionSegments>& regions,
+        const char* data,
+        bool persist,
+        AsyncRequest* req) const
+{
+    if(not self) throw Exception("Invalid warabi::TargetHandle object");
+    for(auto& r : regions) self->m_read_cache.invalidate(r.first);
+    size_t size = totalSize(regions);
+    if(size >= self->m_eager_write_threshold) {
+        auto bulk = self->m_client->m_engine.expose(
+                {{const_cast<char*>(data), size}}, tl::bulk_mode::read_only);
+        writev(regions, std::move(bulk), "", 0, persist, req);
+        return;
     }
+    // eager path
+    auto& rpc = self->m_client->m_writev_eager;
+    auto& ph  = self->m_ph;
+    auto async_request_impl = sendTraced<Result<bool>>(self, "writev_eager",
+        size, segmentCount(regions),
+        [&rpc, ph, regions, data, size, persist](uint64_t trace_id) {
+            return rpc.on(ph).async(regions, BufferWrapper::Ref(data, size), persist, trace_id);
+        },
+        [](Result<bool>&& response) { response.check(); },
+        req != nullptr);
+    if(req) *req = AsyncRequest(std::move(async_request_impl));
+}
+
+void TargetHandle::writev(
+        const std::vector<RegionSegments>& regions,
+        thallium::bulk data,
+        const std::string& address,
+        size_t bulkOffset,
+        bool persist,
+        AsyncRequest* req) const
+{
+    if(not self) throw Exception("Invalid warabi::TargetHandle object");
+    for(auto& r : regions) self->m_read_cache.invalidate(r.first);
+    auto& rpc = self->m_client->m_writev;
+    auto& ph  = self->m_ph;
+    auto async_request_impl = sendTraced<Result<bool>>(self, "writev",
+        totalSize(regions), segmentCount(regions),
+        [&rpc, ph, regions, data, address, bulkOffset, persist](uint64_t trace_id) {
+            return rpc.on(ph).async(regions, data, address, bulkOffset, persist, trace_id);
+        },
+        [](Result<bool>&& response) { response.check(); },
+        req != nullptr);
+    if(req) *req = AsyncRequest(std::move(async_request_impl));
+}
+
+void TargetHandle::advise(
+        const std::vector<RegionSegments>& regions,
+        AccessHint hint,
+        AsyncRequest* req) const
+{
+    if(not self) throw Exception("Invalid warabi::TargetHandle object");
+    auto& rpc = self->m_client->m_advise;
+    auto& ph  = self->m_ph;
+    auto async_request_impl = sendWithRetry<Result<bool>>(self,
+        [&rpc, ph, regions, hint]() {
+            return rpc.on(ph).async(regions, (uint8_t)hint);
+        },
+        [](Result<bool>&& response) { response.check(); },
+        req != nullptr);
+    if(req) *req = AsyncRequest(std::move(async_request_impl));
+}
+
+void TargetHandle::prefetch(
+        const std::vector<RegionSegments>& regions,
+        AsyncRequest* req) const
+{
+    advise(regions, AccessHint::WillNeed, req);
 }
 
 void TargetHandle::erase(const RegionID& region,
                          AsyncRequest* req) const
 {
     if(not self) throw Exception("Invalid warabi::TargetHandle object");
+    self->m_read_cache.invalidate(region);
     auto& rpc = self->m_client->m_erase;
     auto& ph  = self->m_ph;
-    auto async_response = rpc.on(ph).async(region);
-    if(req == nullptr) { // synchronous call
-        Result<bool> response = async_response.wait();
-        response.check();
-    } else { // asynchronous call
-        auto async_request_impl =
-            std::make_shared<AsyncRequestImpl>(std::move(async_response));
-        async_request_impl->m_wait_callback =
-            [](AsyncRequestImpl& async_request_impl) {
-                Result<bool> response = async_request_impl.m_async_response.wait();
-                response.check();
-            };
-        *req = AsyncRequest(std::move(async_request_impl));
-    }
+    auto async_request_impl = sendTraced<Result<bool>>(self, "erase", 0, 0,
+        [&rpc, ph, region](uint64_t trace_id) { return rpc.on(ph).async(region, trace_id); },
+        [](Result<bool>&& response) { response.check(); },
+        req != nullptr);
+    if(req) *req = AsyncRequest(std::move(async_request_impl));
+}
+
+void TargetHandle::pin(const RegionID& region,
+                       AsyncRequest* req) const
+{
+    if(not self) throw Exception("Invalid warabi::TargetHandle object");
+    auto& rpc = self->m_client->m_pin;
+    auto& ph  = self->m_ph;
+    auto async_request_impl = sendWithRetry<Result<bool>>(self,
+        [&rpc, ph, region]() { return rpc.on(ph).async(region, true); },
+        [](Result<bool>&& response) { response.check(); },
+        req != nullptr);
+    if(req) *req = AsyncRequest(std::move(async_request_impl));
+}
+
+void TargetHandle::unpin(const RegionID& region,
+                         AsyncRequest* req) const
+{
+    if(not self) throw Exception("Invalid warabi::TargetHandle object");
+    auto& rpc = self->m_client->m_pin;
+    auto& ph  = self->m_ph;
+    auto async_request_impl = sendWithRetry<Result<bool>>(self,
+        [&rpc, ph, region]() { return rpc.on(ph).async(region, false); },
+        [](Result<bool>&& response) { response.check(); },
+        req != nullptr);
+    if(req) *req = AsyncRequest(std::move(async_request_impl));
+}
+
+static std::shared_ptr<AsyncRequestImpl> sendCopy(
+        const std::shared_ptr<TargetHandleImpl>& self,
+        const std::shared_ptr<TargetHandleImpl>& destination,
+        const RegionID& source, size_t size,
+        RegionID* region, bool persist, bool removeSource,
+        bool async)
+{
+    if(not self || not destination)
+        throw Exception("Invalid warabi::TargetHandle object");
+    auto& rpc = self->m_client->m_copy;
+    auto& ph  = self->m_ph;
+    auto dest_address = static_cast<std::string>(destination->m_ph);
+    auto dest_provider_id = destination->m_ph.provider_id();
+    return sendTraced<Result<RegionID>>(self, removeSource ? "move" : "copy", size, 1,
+        [&rpc, ph, source, size, dest_address, dest_provider_id, persist, removeSource](uint64_t trace_id) {
+            return rpc.on(ph).async(source, size, dest_address, dest_provider_id,
+                                    persist, removeSource, trace_id);
+        },
+        [region](Result<RegionID>&& response) {
+            if(region) *region = std::move(response).valueOrThrow();
+            else response.check();
+        }, async);
+}
+
+void TargetHandle::copy(const RegionID& source, size_t size,
+                        const TargetHandle& destination,
+                        RegionID* region,
+                        bool persist,
+                        AsyncRequest* req) const
+{
+    auto async_request_impl = sendCopy(self, destination.self, source, size,
+                                       region, persist, false, req != nullptr);
+    if(req) *req = AsyncRequest(std::move(async_request_impl));
+}
+
+void TargetHandle::move(const RegionID& source, size_t size,
+                        const TargetHandle& destination,
+                        RegionID* region,
+                        bool persist,
+                        AsyncRequest* req) const
+{
+    if(self) self->m_read_cache.invalidate(source);
+    auto async_request_impl = sendCopy(self, destination.self, source, size,
+                                       region, persist, true, req != nullptr);
+    if(req) *req = AsyncRequest(std::move(async_request_impl));
+}
+
+void TargetHandle::clone(const RegionID& source,
+                         RegionID* region,
+                         AsyncRequest* req) const
+{
+    if(not self) throw Exception("Invalid warabi::TargetHandle object");
+    auto& rpc = self->m_client->m_clone;
+    auto& ph  = self->m_ph;
+    auto async_request_impl = sendWithRetry<Result<RegionID>>(self,
+        [&rpc, ph, source]() { return rpc.on(ph).async(source); },
+        [region](Result<RegionID>&& response) {
+            if(region) *region = std::move(response).valueOrThrow();
+            else response.check();
+        }, req != nullptr);
+    if(req) *req = AsyncRequest(std::move(async_request_impl));
+}
+
+void TargetHandle::createSnapshot(const std::string& name,
+                                  AsyncRequest* req) const
+{
+    if(not self) throw Exception("Invalid warabi::TargetHandle object");
+    auto& rpc = self->m_client->m_create_snapshot;
+    auto& ph  = self->m_ph;
+    auto async_request_impl = sendWithRetry<Result<bool>>(self,
+        [&rpc, ph, name]() { return rpc.on(ph).async(name); },
+        [](Result<bool>&& response) { response.check(); },
+        req != nullptr);
+    if(req) *req = AsyncRequest(std::move(async_request_impl));
+}
+
+void TargetHandle::restoreSnapshot(const std::string& name,
+                                   AsyncRequest* req) const
+{
+    if(not self) throw Exception("Invalid warabi::TargetHandle object");
+    self->m_read_cache.clear();
+    auto& rpc = self->m_client->m_restore_snapshot;
+    auto& ph  = self->m_ph;
+    auto async_request_impl = sendWithRetry<Result<bool>>(self,
+        [&rpc, ph, name]() { return rpc.on(ph).async(name); },
+        [](Result<bool>&& response) { response.check(); },
+        req != nullptr);
+    if(req) *req = AsyncRequest(std::move(async_request_impl));
+}
+
+void TargetHandle::deleteSnapshot(const std::string& name,
+                                  AsyncRequest* req) const
+{
+    if(not self) throw Exception("Invalid warabi::TargetHandle object");
+    auto& rpc = self->m_client->m_delete_snapshot;
+    auto& ph  = self->m_ph;
+    auto async_request_impl = sendWithRetry<Result<bool>>(self,
+        [&rpc, ph, name]() { return rpc.on(ph).async(name); },
+        [](Result<bool>&& response) { response.check(); },
+        req != nullptr);
+    if(req) *req = AsyncRequest(std::move(async_request_impl));
 }
 
 }
@@ -7,7 +7,12 @@
 #define __WARABI_TARGET_HANDLE_IMPL_H
 
 #include <thallium.hpp>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <random>
 #include "ClientImpl.hpp"
+#include "ReadCache.hpp"
 
 namespace tl = thallium;
 
@@ -23,12 +28,73 @@ class TargetHandleImpl {
     size_t m_eager_write_threshold = 2048;
     size_t m_eager_read_threshold = 2048;
 
+    // Retry policy for requests rejected because the target is busy
+    size_t m_max_retries = 8;
+    size_t m_max_backoff_ms = 1000;
+
+    // Time (in milliseconds since epoch of the steady clock) before which
+    // the provider asked us not to send anything new
+    std::atomic<int64_t> m_busy_until{0};
+
+    // Segments read under a lease (disabled unless given a capacity)
+    ReadCache m_read_cache;
+
     TargetHandleImpl() = default;
 
     TargetHandleImpl(const std::shared_ptr<ClientImpl>& client,
                        tl::provider_handle&& ph)
     : m_client(client)
     , m_ph(std::move(ph)) {}
+
+    /**
+     * @brief If the provider recently signaled that it was busy,
+     * wait until the time it suggested before sending a new request.
+     */
+    void throttle() const {
+        auto until = m_busy_until.load(std::memory_order_relaxed);
+        auto now   = nowMs();
+        if(until > now)
+            tl::thread::sleep(m_client->m_engine, until - now);
+    }
+
+    /**
+     * @brief Wait for the response of an RPC. If the provider rejected
+     * the RPC because it was busy, issue() is called to send it again after
+     * a jittered exponential backoff, until it is either accepted or the
+     * maximum number of retries is reached.
+     */
+    template<typename ResultType, typename Issue>
+    ResultType waitWithRetry(tl::async_response& async_response, const Issue& issue) {
+        for(size_t attempt = 0; ; ++attempt) {
+            ResultType result = async_response.wait();
+            if(result.success() || !result.retryAfter() || attempt >= m_max_retries)
+                return result;
+            backoff(attempt, result.retryAfter());
+            async_response = issue();
+        }
+    }
+
+    private:
+
+    static int64_t nowMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void backoff(size_t attempt, uint32_t retryAfter) {
+        // let other requests sent through this handle know
+        // that they should hold off for at least retryAfter ms
+        auto until = nowMs() + retryAfter;
+        auto prev  = m_busy_until.load(std::memory_order_relaxed);
+        while(prev < until && !m_busy_until.compare_exchange_weak(prev, until)) {}
+        // exponential backoff, starting from the provider's hint,
+        // with "equal jitter" to avoid synchronized retries
+        double delay = (double)retryAfter * (double)(1ULL << std::min<size_t>(attempt, 16));
+        delay = std::min(delay, (double)std::max<size_t>(m_max_backoff_ms, retryAfter));
+        thread_local std::minstd_rand rng{std::random_device{}()};
+        std::uniform_real_distribution<double> jitter{0.5, 1.0};
+        tl::thread::sleep(m_client->m_engine, delay * jitter(rng));
+    }
 };
 
 }
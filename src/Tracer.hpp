@@ -0,0 +1,332 @@
+/*
+ * (C) 2024 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef __WARABI_TRACER_HPP
+#define __WARABI_TRACER_HPP
+
+#include <warabi/Result.hpp>
+#include <nlohmann/json.hpp>
+#include <nlohmann/json-schema.hpp>
+#include <fmt/format.h>
+#include <abt.h>
+
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace warabi {
+
+/**
+ * @brief The Tracer records spans (named intervals of time) of the
+ * requests going through warabi, on the client (TargetHandle) and on
+ * the server (provider handlers, TransferManager, target I/O), and
+ * writes them to a JSON file in the Chrome trace event format, which
+ * can be opened in Perfetto or chrome://tracing.
+ *
+ * A request is traced if it is sampled ("sample_rate") by the process
+ * that issues it. Its trace ID is then sent along with its RPC, so
+ * that the provider traces it too. Within a process, the trace ID of
+ * the request being handled is stored in ULT-local storage, so that
+ * nested components record their spans without it being passed to
+ * them. In the trace, each request gets its own track, on which its
+ * spans nest.
+ *
+ * Spans are recorded in a ring buffer of "buffer_size" events with a
+ * single atomic increment; the oldest ones are overwritten when it is
+ * full. The buffer is allocated when tracing is first enabled and
+ * never reallocated afterwards. It is written to "output" ("{pid}" is replaced with
+ * the process ID) when the Provider or Client that enabled tracing is
+ * destroyed.
+ *
+ * There is a single Tracer per process, enabled by the "tracing" field
+ * of a provider's configuration or by Client::setTracingConfig.
+ * Example of configuration (with default values):
+ *
+ * {
+ *     "sample_rate": 1.0,
+ *     "buffer_size": 65536,
+ *     "output": "warabi-trace-{pid}.json"
+ * }
+ */
+class Tracer {
+
+    using json = nlohmann::json;
+
+    struct Event {
+        const char* category = nullptr;
+        const char* name     = nullptr;
+        uint64_t    trace_id = 0;
+        int64_t     start    = 0; // us since epoch
+        int64_t     duration = 0; // us
+    };
+
+    public:
+
+    /**
+     * @brief RAII object making a trace ID the current
+     * one of the calling ULT until it is destroyed.
+     */
+    class Scope {
+
+        uint64_t m_previous = 0;
+        bool     m_active   = false;
+
+        public:
+
+        Scope(uint64_t trace_id)
+        : m_active(trace_id != 0) {
+            if(!m_active) return;
+            m_previous = current();
+            setCurrent(trace_id);
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        ~Scope() {
+            if(m_active) setCurrent(m_previous);
+        }
+    };
+
+    /**
+     * @brief RAII object recording a span of the current request
+     * (if it is traced) from its construction to its destruction.
+     */
+    class Span {
+
+        const char* m_category;
+        const char* m_name;
+        uint64_t    m_trace_id = 0;
+        int64_t     m_start    = 0;
+
+        public:
+
+        Span(const char* category, const char* name)
+        : m_category(category)
+        , m_name(name) {
+            if(!instance().enabled()) return;
+            m_trace_id = current();
+            if(m_trace_id) m_start = now();
+        }
+
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+
+        ~Span() {
+            if(m_trace_id)
+                instance().record(m_category, m_name, m_trace_id, m_start, now() - m_start);
+        }
+    };
+
+    static Tracer& instance() {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    /**
+     * @brief Current time in microseconds since epoch.
+     */
+    static int64_t now() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     * @brief Trace ID of the request handled by the calling ULT (0 if none).
+     */
+    static uint64_t current() {
+        void* value = nullptr;
+        if(ABT_key_get(key(), &value) != ABT_SUCCESS) return 0;
+        return (uint64_t)(uintptr_t)value;
+    }
+
+    /**
+     * @brief Validate a "tracing" configuration object.
+     */
+    static Result<bool> validate(const json& config) {
+        static const json schema = R"(
+        {
+            "type": "object",
+            "properties": {
+                "sample_rate": {"type": "number", "minimum": 0, "maximum": 1},
+                "buffer_size": {"type": "integer", "minimum": 1},
+                "output": {"type": "string"}
+            }
+        }
+        )"_json;
+        Result<bool> result;
+        nlohmann::json_schema::json_validator validator;
+        validator.set_root_schema(schema);
+        try {
+            validator.validate(config);
+        } catch(const std::exception& ex) {
+            result.success() = false;
+            result.error() = fmt::format(
+                "Error(s) while validating JSON config for warabi tracing: {}", ex.what());
+        }
+        return result;
+    }
+
+    /**
+     * @brief Configure and enable the Tracer (the configuration
+     * is expected to have been validated).
+     *
+     * The ring buffer and output file are set by the first call only:
+     * record() writes into the buffer without locking, so it is never
+     * reallocated while the Tracer is enabled. Subsequent calls (e.g.
+     * another provider with a "tracing" field) only change the
+     * sample rate.
+     */
+    void configure(const json& config) {
+        std::unique_lock<std::mutex> lock{m_mutex};
+        m_sample_rate.store(config.value("sample_rate", 1.0), std::memory_order_relaxed);
+        if(enabled()) {
+            m_config["sample_rate"] = m_sample_rate.load(std::memory_order_relaxed);
+            return;
+        }
+        m_output = config.value("output", std::string{"warabi-trace-{pid}.json"});
+        auto pid = m_output.find("{pid}");
+        if(pid != std::string::npos)
+            m_output.replace(pid, 5, std::to_string(getpid()));
+        m_events.assign(config.value("buffer_size", (size_t)65536), Event{});
+        m_next   = 0;
+        m_config = config;
+        m_enabled.store(true, std::memory_order_release);
+    }
+
+    /**
+     * @brief Return the configuration (null if never configured).
+     */
+    json getConfig() const {
+        std::unique_lock<std::mutex> lock{m_mutex};
+        return m_config;
+    }
+
+    bool enabled() const {
+        return m_enabled.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Decide whether a new request is traced, returning
+     * its trace ID if it is, and 0 otherwise.
+     */
+    uint64_t sample() {
+        if(!enabled()) return 0;
+        thread_local std::mt19937_64 rng{std::random_device{}()};
+        auto sample_rate = m_sample_rate.load(std::memory_order_relaxed);
+        if(sample_rate < 1.0
+        && std::uniform_real_distribution<double>{0.0, 1.0}(rng) >= sample_rate)
+            return 0;
+        uint64_t trace_id = 0;
+        while(!trace_id) trace_id = rng();
+        return trace_id;
+    }
+
+    /**
+     * @brief Trace ID to use for a request received with the given
+     * trace ID: the same if the sender traced it, a new one if this
+     * process samples it, 0 if it is not traced.
+     */
+    uint64_t accept(uint64_t trace_id) {
+        if(!enabled()) return 0;
+        return trace_id ? trace_id : sample();
+    }
+
+    /**
+     * @brief Record a span.
+     */
+    void record(const char* category, const char* name,
+                uint64_t trace_id, int64_t start, int64_t duration) {
+        if(!enabled()) return;
+        auto i = m_next.fetch_add(1, std::memory_order_relaxed);
+        m_events[i % m_events.size()] = Event{category, name, trace_id, start, duration};
+    }
+
+    /**
+     * @brief Write the recorded spans to the output file.
+     * Spans recorded while the file is written may be missing
+     * or, if the ring buffer wraps around, torn.
+     */
+    Result<bool> flush() {
+        Result<bool> result;
+        std::unique_lock<std::mutex> lock{m_mutex};
+        if(!enabled()) return result;
+        std::ofstream out{m_output};
+        if(!out) {
+            result.success() = false;
+            result.error() = fmt::format("Could not open trace file {}", m_output);
+            return result;
+        }
+        auto pid = getpid();
+        out << "{\"traceEvents\":[\n";
+        out << fmt::format(
+            "{{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":{},\"args\":{{\"name\":\"warabi {}\"}}}}",
+            pid, pid);
+        size_t count = std::min<size_t>(m_next.load(), m_events.size());
+        for(size_t i = 0; i < count; ++i) {
+            auto& e = m_events[i];
+            if(!e.name) continue;
+            // one track per request, so that its spans nest
+            out << fmt::format(
+                ",\n{{\"name\":\"{}\",\"cat\":\"{}\",\"ph\":\"X\",\"ts\":{},\"dur\":{},"
+                "\"pid\":{},\"tid\":{},\"args\":{{\"trace_id\":\"{:016x}\"}}}}",
+                e.name, e.category, e.start, e.duration,
+                pid, e.trace_id & 0x7fffffff, e.trace_id);
+        }
+        out << "\n]}\n";
+        return result;
+    }
+
+    /**
+     * @brief Return statistics as a JSON object.
+     */
+    json getStats() const {
+        auto stats = json::object();
+        size_t recorded = 0, capacity = 0;
+        if(enabled()) {
+            recorded = m_next.load();
+            capacity = m_events.size();
+        }
+        stats["recorded"]    = recorded;
+        stats["overwritten"] = recorded > capacity ? recorded - capacity : 0;
+        return stats;
+    }
+
+    private:
+
+    Tracer() = default;
+
+    static ABT_key key() {
+        static ABT_key k = []() {
+            ABT_key k;
+            ABT_key_create(nullptr, &k);
+            return k;
+        }();
+        return k;
+    }
+
+    static void setCurrent(uint64_t trace_id) {
+        ABT_key_set(key(), (void*)(uintptr_t)trace_id);
+    }
+
+    mutable std::mutex  m_mutex;
+    json                m_config;
+    std::atomic<bool>   m_enabled{false};
+    std::atomic<double> m_sample_rate{1.0};
+    std::string         m_output;
+    std::vector<Event>  m_events;
+    std::atomic<size_t> m_next{0};
+};
+
+}
+
+#endif
@@ -62,6 +62,24 @@ extern "C" char* warabi_client_get_config(warabi_client_t client) {
     return strdup(config.c_str());
 }
 
+extern "C" warabi_err_t warabi_client_set_tracing_config(
+        warabi_client_t client,
+        const char* config) {
+    try {
+        client->setTracingConfig(config);
+    } HANDLE_WARABI_ERROR;
+}
+
+extern "C" warabi_err_t warabi_client_set_transfer_manager_config(
+        warabi_client_t client,
+        const char* address,
+        uint16_t provider_id,
+        const char* config) {
+    try {
+        client->setTransferManagerConfig(address, provider_id, config);
+    } HANDLE_WARABI_ERROR;
+}
+
 extern "C" warabi_err_t warabi_create(
         warabi_target_handle_t th,
         size_t size,
@@ -318,6 +336,105 @@ extern "C" warabi_err_t warabi_read_multi_bulk(
     } HANDLE_WARABI_ERROR;
 }
 
+static std::vector<warabi::RegionSegments> toRegionSegments(
+        size_t count,
+        const warabi_region_t* regions,
+        const size_t* segmentCounts,
+        const size_t* regionOffsets,
+        const size_t* regionSizes) {
+    std::vector<warabi::RegionSegments> result(count);
+    size_t j = 0;
+    for(size_t i=0; i < count; ++i) {
+        result[i].first = *reinterpret_cast<const warabi::RegionID*>(&regions[i]);
+        result[i].second.resize(segmentCounts[i]);
+        for(auto& segment : result[i].second) {
+            segment.first  = regionOffsets[j];
+            segment.second = regionSizes[j];
+            ++j;
+        }
+    }
+    return result;
+}
+
+extern "C" warabi_err_t warabi_readv(
+        warabi_target_handle_t th,
+        size_t count,
+        const warabi_region_t* regions,
+        const size_t* segmentCounts,
+        const size_t* regionOffsets,
+        const size_t* regionSizes,
+        char* data,
+        warabi_async_request_t* req) {
+    try {
+        auto segments = toRegionSegments(
+            count, regions, segmentCounts, regionOffsets, regionSizes);
+        if(req) {
+            warabi::AsyncRequest async_req;
+            th->readv(segments, data, &async_req);
+            *req = new warabi_async_request{std::move(async_req)};
+        } else {
+            th->readv(segments, data);
+        }
+    } HANDLE_WARABI_ERROR;
+}
+
+extern "C" warabi_err_t warabi_writev(
+        warabi_target_handle_t th,
+        size_t count,
+        const warabi_region_t* regions,
+        const size_t* segmentCounts,
+        const size_t* regionOffsets,
+        const size_t* regionSizes,
+        const char* data,
+        bool persist,
+        warabi_async_request_t* req) {
+    try {
+        auto segments = toRegionSegments(
+            count, regions, segmentCounts, regionOffsets, regionSizes);
+        if(req) {
+            warabi::AsyncRequest async_req;
+            th->writev(segments, data, persist, &async_req);
+            *req = new warabi_async_request{std::move(async_req)};
+        } else {
+            th->writev(segments, data, persist);
+        }
+    } HANDLE_WARABI_ERROR;
+}
+
+extern "C" warabi_err_t warabi_advise(
+        warabi_target_handle_t th,
+        size_t count,
+        const warabi_region_t* regions,
+        const size_t* segmentCounts,
+        const size_t* regionOffsets,
+        const size_t* regionSizes,
+        warabi_access_hint_t hint,
+        warabi_async_request_t* req) {
+    try {
+        auto segments = toRegionSegments(
+            count, regions, segmentCounts, regionOffsets, regionSizes);
+        if(req) {
+            warabi::AsyncRequest async_req;
+            th->advise(segments, (warabi::AccessHint)hint, &async_req);
+            *req = new warabi_async_request{std::move(async_req)};
+        } else {
+            th->advise(segments, (warabi::AccessHint)hint);
+        }
+    } HANDLE_WARABI_ERROR;
+}
+
+extern "C" warabi_err_t warabi_prefetch(
+        warabi_target_handle_t th,
+        size_t count,
+        const warabi_region_t* regions,
+        const size_t* segmentCounts,
+        const size_t* regionOffsets,
+        const size_t* regionSizes,
+        warabi_async_request_t* req) {
+    return warabi_advise(th, count, regions, segmentCounts,
+                         regionOffsets, regionSizes, WARABI_ACCESS_WILLNEED, req);
+}
+
 extern "C" warabi_err_t warabi_erase(
         warabi_target_handle_t th,
         warabi_region_t region,
@@ -336,10 +453,152 @@ extern "C" warabi_err_t warabi_erase(
     } HANDLE_WARABI_ERROR;
 }
 
+extern "C" warabi_err_t warabi_pin(
+        warabi_target_handle_t th,
+        warabi_region_t region,
+        warabi_async_request_t* req) {
+    try {
+        auto region_id = reinterpret_cast<warabi::RegionID*>(&region);
+        if(req) {
+            warabi::AsyncRequest async_req;
+            th->pin(*region_id, &async_req);
+            *req = new warabi_async_request{std::move(async_req)};
+        } else {
+            th->pin(*region_id);
+        }
+
+    } HANDLE_WARABI_ERROR;
+}
+
+extern "C" warabi_err_t warabi_unpin(
+        warabi_target_handle_t th,
+        warabi_region_t region,
+        warabi_async_request_t* req) {
+    try {
+        auto region_id = reinterpret_cast<warabi::RegionID*>(&region);
+        if(req) {
+            warabi::AsyncRequest async_req;
+            th->unpin(*region_id, &async_req);
+            *req = new warabi_async_request{std::move(async_req)};
+        } else {
+            th->unpin(*region_id);
+        }
+
+    } HANDLE_WARABI_ERROR;
+}
+
+extern "C" warabi_err_t warabi_copy(
+        warabi_target_handle_t th,
+        warabi_region_t source,
+        size_t size,
+        warabi_target_handle_t dest,
+        bool persist,
+        warabi_region_t* region,
+        warabi_async_request_t* req) {
+    try {
+        auto source_id = reinterpret_cast<warabi::RegionID*>(&source);
+        auto rid = reinterpret_cast<warabi::RegionID*>(region);
+        if(req) {
+            warabi::AsyncRequest async_req;
+            th->copy(*source_id, size, *dest, rid, persist, &async_req);
+            *req = new warabi_async_request{std::move(async_req)};
+        } else {
+            th->copy(*source_id, size, *dest, rid, persist);
+        }
+    } HANDLE_WARABI_ERROR;
+}
+
+extern "C" warabi_err_t warabi_move(
+        warabi_target_handle_t th,
+        warabi_region_t source,
+        size_t size,
+        warabi_target_handle_t dest,
+        bool persist,
+        warabi_region_t* region,
+        warabi_async_request_t* req) {
+    try {
+        auto source_id = reinterpret_cast<warabi::RegionID*>(&source);
+        auto rid = reinterpret_cast<warabi::RegionID*>(region);
+        if(req) {
+            warabi::AsyncRequest async_req;
+            th->move(*source_id, size, *dest, rid, persist, &async_req);
+            *req = new warabi_async_request{std::move(async_req)};
+        } else {
+            th->move(*source_id, size, *dest, rid, persist);
+        }
+    } HANDLE_WARABI_ERROR;
+}
+
+extern "C" warabi_err_t warabi_clone(
+        warabi_target_handle_t th,
+        warabi_region_t source,
+        warabi_region_t* region,
+        warabi_async_request_t* req) {
+    try {
+        auto source_id = reinterpret_cast<warabi::RegionID*>(&source);
+        auto rid = reinterpret_cast<warabi::RegionID*>(region);
+        if(req) {
+            warabi::AsyncRequest async_req;
+            th->clone(*source_id, rid, &async_req);
+            *req = new warabi_async_request{std::move(async_req)};
+        } else {
+            th->clone(*source_id, rid);
+        }
+    } HANDLE_WARABI_ERROR;
+}
+
+extern "C" warabi_err_t warabi_create_snapshot(
+        warabi_target_handle_t th,
+        const char* name,
+        warabi_async_request_t* req) {
+    try {
+        if(req) {
+            warabi::AsyncRequest async_req;
+            th->createSnapshot(name, &async_req);
+            *req = new warabi_async_request{std::move(async_req)};
+        } else {
+            th->createSnapshot(name);
+        }
+    } HANDLE_WARABI_ERROR;
+}
+
+extern "C" warabi_err_t warabi_restore_snapshot(
+        warabi_target_handle_t th,
+        const char* name,
+        warabi_async_request_t* req) {
+    try {
+        if(req) {
+            warabi::AsyncRequest async_req;
+            th->restoreSnapshot(name, &async_req);
+            *req = new warabi_async_request{std::move(async_req)};
+        } else {
+            th->restoreSnapshot(name);
+        }
+    } HANDLE_WARABI_ERROR;
+}
+
+extern "C" warabi_err_t warabi_delete_snapshot(
+        warabi_target_handle_t th,
+        const char* name,
+        warabi_async_request_t* req) {
+    try {
+        if(req) {
+            warabi::AsyncRequest async_req;
+            th->deleteSnapshot(name, &async_req);
+            *req = new warabi_async_request{std::move(async_req)};
+        } else {
+            th->deleteSnapshot(name);
+        }
+    } HANDLE_WARABI_ERROR;
+}
+
 extern "C" warabi_err_t warabi_wait(warabi_async_request_t req) {
     warabi_err_t err = nullptr;
     try {
         req->wait();
+    } catch(const warabi::EvictedException& ex) {
+        err = static_cast<warabi_err*>(static_cast<warabi::Exception*>(
+            new warabi::EvictedException{ex.what()}));
     } catch(const std::exception& ex) {
         err = static_cast<warabi_err*>(new warabi::Exception{ex.what()});
     }
@@ -368,3 +627,20 @@ extern "C" warabi_err_t warabi_set_eager_read_threshold(
         th->setEagerReadThreshold(size);
     } HANDLE_WARABI_ERROR;
 }
+
+extern "C" warabi_err_t warabi_set_read_cache_capacity(
+        warabi_target_handle_t th,
+        size_t capacity) {
+    try {
+        th->setReadCacheCapacity(capacity);
+    } HANDLE_WARABI_ERROR;
+}
+
+extern "C" warabi_err_t warabi_set_retry_policy(
+        warabi_target_handle_t th,
+        size_t max_retries,
+        size_t max_backoff_ms) {
+    try {
+        th->setRetryPolicy(max_retries, max_backoff_ms);
+    } HANDLE_WARABI_ERROR;
+}
@@ -10,6 +10,11 @@ extern "C" const char* warabi_err_message(warabi_err_t err) {
     return err->what();
 }
 
+extern "C" int warabi_err_is_evicted(warabi_err_t err) {
+    return dynamic_cast<const warabi::EvictedException*>(
+        static_cast<const warabi::Exception*>(err)) != nullptr;
+}
+
 extern "C" void warabi_err_free(warabi_err_t err) {
     delete static_cast<warabi::Exception*>(err);
 }
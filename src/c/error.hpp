@@ -13,6 +13,10 @@ struct warabi_err : public warabi::Exception {
 };
 
 #define HANDLE_WARABI_ERROR                                                \
+    catch(const warabi::EvictedException& ex) {                            \
+        return static_cast<warabi_err*>(static_cast<warabi::Exception*>(   \
+            new warabi::EvictedException{ex.what()}));                     \
+    }                                                                      \
     catch(const std::exception& ex) {                                      \
         return static_cast<warabi_err*>(new warabi::Exception{ex.what()}); \
     }                                                                      \
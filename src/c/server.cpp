@@ -41,6 +41,10 @@ extern "C" char* warabi_provider_get_config(warabi_provider_t provider) {
     return strdup(provider->getConfig().c_str());
 }
 
+extern "C" char* warabi_provider_get_stats(warabi_provider_t provider) {
+    return strdup(provider->getStats().c_str());
+}
+
 extern "C" warabi_err_t warabi_provider_migrate(warabi_provider_t provider,
                                                 const char* dest_addr,
                                                 uint16_t dest_provider_id,
@@ -50,3 +54,17 @@ extern "C" warabi_err_t warabi_provider_migrate(warabi_provider_t provider,
             dest_addr, dest_provider_id, migration_config ? migration_config : "");
     } HANDLE_WARABI_ERROR;
 }
+
+extern "C" warabi_err_t warabi_provider_set_qos_config(warabi_provider_t provider,
+                                                       const char* qos_config) {
+    try {
+        provider->setQoSConfig(qos_config ? qos_config : "null");
+    } HANDLE_WARABI_ERROR;
+}
+
+extern "C" warabi_err_t warabi_provider_set_transfer_manager_config(warabi_provider_t provider,
+                                                                    const char* tm_config) {
+    try {
+        provider->setTransferManagerConfig(tm_config ? tm_config : "{}");
+    } HANDLE_WARABI_ERROR;
+}
@@ -0,0 +1,46 @@
+/*
+ * (C) 2024 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#include "Numa.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_all.hpp>
+#include <nlohmann/json.hpp>
+#include <thread>
+
+using json = nlohmann::json;
+
+TEST_CASE("NumaPolicy tests", "[numa]") {
+
+    warabi::NumaPolicy policy0, policy1, other0;
+    policy0.configure(R"({"node": 0, "pin_handlers": true})"_json);
+    policy1.configure(R"({"node": 1, "pin_handlers": true})"_json);
+    other0.configure(R"({"node": 0, "pin_handlers": true})"_json);
+
+    // each thread acts as an execution stream shared by the three policies,
+    // a separate thread keeps the test's own thread unpinned
+    auto runHandlers = [&]() {
+        for(int i = 0; i < 4; ++i) {
+            policy0.pinHandler();
+            policy1.pinHandler();
+            other0.pinHandler();
+        }
+    };
+    std::thread{runHandlers}.join();
+    if(policy0.getStats()["pinned_threads"] == 0)
+        SKIP("Threads cannot be pinned to NUMA node 0 here");
+    std::thread{runHandlers}.join();
+
+    // each stream is pinned once per policy, and the stream pinned to
+    // node 0 is not moved to node 1, nor back to node 0 afterwards
+    auto stats0 = policy0.getStats();
+    REQUIRE(stats0["pinned_threads"] == 2);
+    REQUIRE(stats0["pin_conflicts"] == 0);
+    auto stats1 = policy1.getStats();
+    REQUIRE(stats1["pinned_threads"] == 0);
+    REQUIRE(stats1["pin_conflicts"] == 2);
+    auto other_stats0 = other0.getStats();
+    REQUIRE(other_stats0["pinned_threads"] == 2);
+    REQUIRE(other_stats0["pin_conflicts"] == 0);
+}
@@ -4,6 +4,7 @@
  * See COPYRIGHT in top-level directory.
  */
 #include <warabi/Provider.hpp>
+#include <warabi/Client.hpp>
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/catch_all.hpp>
 #include <nlohmann/json.hpp>
@@ -58,4 +59,228 @@ TEST_CASE("Provider tests", "[provider]") {
         REQUIRE(config["transfer_manager"].contains("config"));
         REQUIRE(config["transfer_manager"]["config"].is_object());
     }
+
+    SECTION("Create a provider with a router transfer manager") {
+
+        std::string input_config = R"(
+            {
+                "target": {
+                    "type": "memory",
+                    "config": {}
+                },
+                "transfer_manager": {
+                    "type": "router",
+                    "config": {
+                        "rules": [
+                            {"max_size": 65536, "type": "__default__"},
+                            {"min_segments": 64, "type": "__default__"}
+                        ],
+                        "default": {
+                            "type": "pipeline",
+                            "config": {
+                                "num_pools": 1,
+                                "num_buffers_per_pool": 4,
+                                "first_buffer_size": 1048576,
+                                "buffer_size_multiplier": 2
+                            }
+                        }
+                    }
+                }
+            }
+        )";
+
+        warabi::Provider provider(mid, 42, input_config);
+        REQUIRE(static_cast<bool>(provider));
+
+        auto config = json::parse(provider.getConfig());
+        auto& tm = config["transfer_manager"];
+        REQUIRE(tm["type"] == "router");
+        REQUIRE(tm["config"]["rules"].size() == 2);
+        REQUIRE(tm["config"]["rules"][0]["config"].is_object());
+        REQUIRE(tm["config"]["default"]["type"] == "pipeline");
+
+        std::string invalid_config = R"(
+            {
+                "transfer_manager": {
+                    "type": "router",
+                    "config": {
+                        "rules": [{"max_size": 65536, "type": "pipeline", "config": {}}]
+                    }
+                }
+            }
+        )";
+        REQUIRE_THROWS_AS(warabi::Provider(mid, 43, invalid_config), warabi::Exception);
+    }
+
+    SECTION("Change the transfer manager at run time") {
+
+        std::string input_config = R"(
+            {
+                "target": {
+                    "type": "memory",
+                    "config": {}
+                }
+            }
+        )";
+
+        warabi::Provider provider(mid, 42, input_config);
+        REQUIRE(static_cast<bool>(provider));
+
+        auto config = json::parse(provider.getConfig());
+        REQUIRE(config["transfer_manager"]["type"] == "__default__");
+
+        REQUIRE_NOTHROW(provider.setTransferManagerConfig(R"(
+            {
+                "type": "pipeline",
+                "config": {
+                    "num_pools": 1,
+                    "num_buffers_per_pool": 4,
+                    "first_buffer_size": 1048576,
+                    "buffer_size_multiplier": 2
+                }
+            }
+        )"));
+        config = json::parse(provider.getConfig());
+        REQUIRE(config["transfer_manager"]["type"] == "pipeline");
+        REQUIRE(config["transfer_manager"]["config"]["num_buffers_per_pool"] == 4);
+
+        // changing only some parameters of the current transfer manager, remotely
+        warabi::Client client(mid);
+        std::string addr = thallium::engine(mid).self();
+        REQUIRE_NOTHROW(client.setTransferManagerConfig(
+            addr, 42, R"({"config": {"num_buffers_per_pool": 16}})"));
+        config = json::parse(provider.getConfig());
+        REQUIRE(config["transfer_manager"]["type"] == "pipeline");
+        REQUIRE(config["transfer_manager"]["config"]["num_buffers_per_pool"] == 16);
+        REQUIRE(config["transfer_manager"]["config"]["first_buffer_size"] == 1048576);
+
+        REQUIRE_THROWS_AS(provider.setTransferManagerConfig(
+            R"({"config": {"num_pools": 0}})"), warabi::Exception);
+        REQUIRE_THROWS_AS(provider.setTransferManagerConfig(
+            R"({"type": "unknown"})"), warabi::Exception);
+        REQUIRE_THROWS_AS(client.setTransferManagerConfig(
+            addr, 42, R"({"config": {"buffer_size_multiplier": 1}})"), warabi::Exception);
+
+        REQUIRE_NOTHROW(provider.setTransferManagerConfig(R"({"type": "__default__"})"));
+        config = json::parse(provider.getConfig());
+        REQUIRE(config["transfer_manager"]["type"] == "__default__");
+    }
+
+    SECTION("Create a provider with QoS and change it at run time") {
+
+        std::string input_config = R"(
+            {
+                "target": {
+                    "type": "memory",
+                    "config": {}
+                },
+                "qos": {
+                    "max_concurrent": 4,
+                    "classes": [
+                        {"name": "interactive", "weight": 4, "max_size": 4096},
+                        {"name": "bulk", "weight": 1}
+                    ],
+                    "limits": {
+                        "default": {"ops_per_second": 100000}
+                    }
+                }
+            }
+        )";
+
+        warabi::Provider provider(mid, 42, input_config);
+        REQUIRE(static_cast<bool>(provider));
+
+        auto config = json::parse(provider.getConfig());
+        REQUIRE(config.contains("qos"));
+        REQUIRE(config["qos"]["max_concurrent"] == 4);
+
+        REQUIRE_NOTHROW(provider.setQoSConfig(R"({"max_concurrent": 8})"));
+        config = json::parse(provider.getConfig());
+        REQUIRE(config["qos"]["max_concurrent"] == 8);
+
+        REQUIRE_THROWS_AS(provider.setQoSConfig(R"({"max_concurrent": -1})"), warabi::Exception);
+        REQUIRE_THROWS_AS(provider.setQoSConfig(
+            R"({"limits": {"default": {"class": "unknown"}}})"), warabi::Exception);
+
+        REQUIRE_NOTHROW(provider.setQoSConfig("null"));
+        config = json::parse(provider.getConfig());
+        REQUIRE(!config.contains("qos"));
+    }
+
+    SECTION("Create a provider with admission control") {
+
+        std::string input_config = R"(
+            {
+                "target": {
+                    "type": "memory",
+                    "config": {}
+                },
+                "admission": {
+                    "max_inflight_ops": 16,
+                    "max_inflight_bytes": 1048576,
+                    "retry_after_ms": 5
+                }
+            }
+        )";
+
+        warabi::Provider provider(mid, 42, input_config);
+        REQUIRE(static_cast<bool>(provider));
+
+        auto config = json::parse(provider.getConfig());
+        REQUIRE(config.contains("admission"));
+        REQUIRE(config["admission"]["max_inflight_ops"] == 16);
+
+        std::string invalid_config = R"(
+            {
+                "admission": {"retry_after_ms": 0}
+            }
+        )";
+        REQUIRE_THROWS_AS(warabi::Provider(mid, 43, invalid_config), warabi::Exception);
+    }
+
+    SECTION("Create a provider with a NUMA policy and get its statistics") {
+
+        std::string input_config = R"(
+            {
+                "target": {
+                    "type": "memory",
+                    "config": {"numa_node": 0}
+                },
+                "transfer_manager": {
+                    "type": "pipeline",
+                    "config": {
+                        "num_pools": 1,
+                        "num_buffers_per_pool": 4,
+                        "first_buffer_size": 1048576,
+                        "buffer_size_multiplier": 2,
+                        "numa_node": 0
+                    }
+                },
+                "numa": {
+                    "node": 0,
+                    "pin_handlers": true
+                }
+            }
+        )";
+
+        warabi::Provider provider(mid, 42, input_config);
+        REQUIRE(static_cast<bool>(provider));
+
+        auto config = json::parse(provider.getConfig());
+        REQUIRE(config.contains("numa"));
+        REQUIRE(config["numa"]["node"] == 0);
+
+        auto stats = json::parse(provider.getStats());
+        REQUIRE(stats["numa"]["node"] == 0);
+        REQUIRE(stats.contains("admission"));
+        REQUIRE(stats.contains("qos"));
+        REQUIRE(stats["target"]["numa_node"] == 0);
+
+        std::string invalid_config = R"(
+            {
+                "numa": {"node": -1}
+            }
+        )";
+        REQUIRE_THROWS_AS(warabi::Provider(mid, 43, invalid_config), warabi::Exception);
+    }
 }
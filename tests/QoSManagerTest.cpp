@@ -0,0 +1,151 @@
+/*
+ * (C) 2024 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#include "QoSManager.hpp"
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_all.hpp>
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "defer.hpp"
+
+using json = nlohmann::json;
+namespace tl = thallium;
+
+static double secondsSince(std::chrono::steady_clock::time_point t) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+}
+
+static size_t numWaiting(const warabi::QoSManager& qos) {
+    size_t waiting = 0;
+    for(auto& [name, cls] : qos.getStats()["classes"].items())
+        waiting += cls["waiting"].get<size_t>();
+    return waiting;
+}
+
+TEST_CASE("QoSManager tests", "[qos]") {
+
+    tl::engine engine("na+sm", THALLIUM_SERVER_MODE);
+    DEFER(engine.finalize());
+
+    warabi::QoSManager qos{engine};
+
+    SECTION("Rate-limit the operations and bytes of a client") {
+
+        qos.configure(R"(
+            {
+                "limits": {
+                    "default": {"ops_per_second": 20, "ops_burst": 1},
+                    "tenant": {"bytes_per_second": 4096, "bytes_burst": 4096}
+                },
+                "tenants": {"client-b": "tenant"}
+            }
+        )"_json);
+
+        // the first operation uses the burst, the next 4 wait 50ms each
+        auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < 5; ++i) qos.admit(std::string{"client-a"}, 0);
+        REQUIRE(secondsSince(start) >= 0.15);
+
+        // other clients have their own bucket
+        start = std::chrono::steady_clock::now();
+        qos.admit(std::string{"client-c"}, 0);
+        REQUIRE(secondsSince(start) < 0.05);
+
+        // the tenant's bytes are limited, not its operations
+        start = std::chrono::steady_clock::now();
+        qos.admit(std::string{"client-b"}, 4096);
+        qos.admit(std::string{"client-b"}, 1024);
+        REQUIRE(secondsSince(start) >= 0.2);
+
+        // buckets that have refilled are dropped
+        REQUIRE(qos.getStats()["clients"] == 3);
+        tl::thread::sleep(engine, 1100);
+        qos.admit(std::string{"client-a"}, 0);
+        REQUIRE(qos.getStats()["clients"] == 1);
+    }
+
+    SECTION("Grant concurrency slots in weighted-fair order") {
+
+        qos.configure(R"(
+            {
+                "max_concurrent": 1,
+                "classes": [
+                    {"name": "interactive", "weight": 3, "max_size": 4096},
+                    {"name": "bulk", "weight": 1}
+                ]
+            }
+        )"_json);
+
+        // hold the only slot while the other requests queue up
+        auto holder = qos.admit(std::string{"holder"}, 0);
+
+        std::vector<std::string> order;
+        std::vector<tl::managed<tl::thread>> ults;
+        auto pool = engine.get_handler_pool();
+        for(int i = 0; i < 8; ++i) {
+            ults.push_back(pool.make_thread([&]() {
+                auto ticket = qos.admit(std::string{"bulk-client"}, 1048576);
+                order.push_back("bulk");
+            }));
+            ults.push_back(pool.make_thread([&]() {
+                auto ticket = qos.admit(std::string{"interactive-client"}, 64);
+                order.push_back("interactive");
+            }));
+        }
+        while(numWaiting(qos) != 16) tl::thread::yield();
+
+        holder = warabi::QoSManager::Ticket{};
+        for(auto& ult : ults) ult->join();
+
+        REQUIRE(order.size() == 16);
+        auto stats = qos.getStats();
+        REQUIRE(stats["inflight"] == 0);
+        REQUIRE(stats["classes"]["bulk"]["granted"] == 8);
+        REQUIRE(stats["classes"]["interactive"]["granted"] == 9);
+
+        // interactive requests get about 3 slots for each bulk one,
+        // but bulk requests are not starved
+        auto first = std::vector<std::string>(order.begin(), order.begin() + 8);
+        auto interactive = std::count(first.begin(), first.end(), "interactive");
+        REQUIRE(interactive >= 5);
+        REQUIRE(interactive <= 7);
+        REQUIRE(std::find(order.begin(), order.begin() + 4, "bulk") != order.begin() + 4);
+    }
+
+    SECTION("Reconfigure while a request waits for its rate limit") {
+
+        qos.configure(R"(
+            {
+                "max_concurrent": 1,
+                "classes": [
+                    {"name": "small", "max_size": 64},
+                    {"name": "medium", "max_size": 4096},
+                    {"name": "large"}
+                ],
+                "limits": {
+                    "default": {"ops_per_second": 10, "ops_burst": 1}
+                }
+            }
+        )"_json);
+
+        // use the burst so that the next request sleeps for 100ms
+        qos.admit(std::string{"client"}, 1048576);
+        bool admitted = false;
+        auto ult = engine.get_handler_pool().make_thread([&]() {
+            auto ticket = qos.admit(std::string{"client"}, 1048576);
+            admitted = true;
+        });
+        tl::thread::yield();
+
+        // the class the request was headed to no longer exists
+        qos.configure(R"({"max_concurrent": 1, "classes": [{"name": "single"}]})"_json);
+        ult->join();
+        REQUIRE(admitted);
+        REQUIRE(qos.getStats()["classes"]["single"]["granted"] == 1);
+    }
+}
@@ -9,11 +9,14 @@
 #include <warabi/Provider.hpp>
 #include "defer.hpp"
 #include "configs.hpp"
+#include <nlohmann/json.hpp>
+#include <filesystem>
+#include <fstream>
 
 TEST_CASE("Target test", "[target]") {
 
     auto target_type = GENERATE(as<std::string>{}, "memory", "pmdk", "abtio");
-    auto tm_type = GENERATE(as<std::string>{}, "__default__", "pipeline");
+    auto tm_type = GENERATE(as<std::string>{}, "__default__", "pipeline", "router");
 
     CAPTURE(target_type);
     CAPTURE(tm_type);
@@ -83,6 +86,10 @@ TEST_CASE("Target test", "[target]") {
             REQUIRE_NOTHROW(th.read(regionID, 0, out.data(), out.size()));
             REQUIRE(std::memcmp(in.data(), out.data(), in.size()) == 0);
 
+            /* pin and unpin the region */
+            REQUIRE_NOTHROW(th.pin(regionID));
+            REQUIRE_NOTHROW(th.unpin(regionID));
+
             /* erase the region */
             REQUIRE_NOTHROW(th.erase(regionID));
 
@@ -90,6 +97,76 @@ TEST_CASE("Target test", "[target]") {
             REQUIRE_THROWS_AS(th.erase(invalidID), warabi::Exception);
         }
 
+        SECTION("With vectored API") {
+
+            // testing both eager and bulk paths
+            auto data_size = GENERATE(64, 196);
+            CAPTURE(data_size);
+
+            std::vector<char> in(data_size);
+            for(size_t i = 0; i < in.size(); ++i) in[i] = 'A' + (i % 26);
+
+            /* create three regions */
+            std::vector<warabi::RegionID> regionIDs(3);
+            for(auto& regionID : regionIDs)
+                REQUIRE_NOTHROW(th.create(&regionID, data_size));
+
+            /* write the first half of the buffer in segments of the regions */
+            size_t q = data_size/4;
+            std::vector<warabi::RegionSegments> segments = {
+                {regionIDs[0], {{0, q}}},
+                {regionIDs[1], {{q, q}, {3*q, q}}},
+                {regionIDs[2], {}}
+            };
+            REQUIRE_NOTHROW(th.writev(segments, in.data(), true));
+
+            /* read them back in a single call */
+            std::vector<char> out(2*q);
+            REQUIRE_NOTHROW(th.readv(segments, out.data()));
+            REQUIRE(std::memcmp(in.data(), out.data(), 2*q) == 0);
+
+            /* check the layout through single-region reads */
+            REQUIRE_NOTHROW(th.read(regionIDs[1], 3*q, out.data(), q));
+            REQUIRE(std::memcmp(in.data() + 2*q, out.data(), q) == 0);
+
+            /* write then read whole regions */
+            segments = {
+                {regionIDs[2], {{0, in.size()}}},
+                {regionIDs[0], {{0, in.size()}}}
+            };
+            std::vector<char> in2(2*in.size());
+            for(size_t i = 0; i < in2.size(); ++i) in2[i] = 'a' + (i % 26);
+            REQUIRE_NOTHROW(th.writev(segments, in2.data()));
+            out.resize(in2.size());
+            REQUIRE_NOTHROW(th.readv(segments, out.data()));
+            REQUIRE(out == in2);
+
+            /* access hints don't change the data */
+            REQUIRE_NOTHROW(th.prefetch(segments));
+            if(target_type == "abtio") {
+                auto stats = nlohmann::json::parse(provider.getStats());
+                REQUIRE(stats["target"]["readahead_bytes"] == in2.size());
+            }
+            REQUIRE_NOTHROW(th.advise(segments, warabi::AccessHint::Sequential));
+            REQUIRE_NOTHROW(th.advise(segments, warabi::AccessHint::DontNeed));
+            REQUIRE_NOTHROW(th.readv(segments, out.data()));
+            REQUIRE(out == in2);
+
+            /* one invalid region fails the whole call */
+            segments.push_back({invalidID, {{0, q}}});
+            out.resize(out.size() + q);
+            REQUIRE_THROWS_AS(th.readv(segments, out.data()), warabi::Exception);
+
+            /* out-of-bounds segment */
+            if(target_type == "memory") {
+                segments = {{regionIDs[0], {{data_size - 1, 2}}}};
+                REQUIRE_THROWS_AS(th.readv(segments, out.data()), warabi::Exception);
+            }
+
+            for(auto& regionID : regionIDs)
+                REQUIRE_NOTHROW(th.erase(regionID));
+        }
+
         SECTION("With non-blocking API") {
 
             // testing both eager and bulk paths
@@ -158,3 +235,613 @@ TEST_CASE("Target test", "[target]") {
         }
     }
 }
+
+TEST_CASE("Pmem target arenas", "[target]") {
+
+    // fewer and more arenas than PMDK's default of one per CPU
+    auto num_arenas = GENERATE(1u, 3u, 256u);
+    CAPTURE(num_arenas);
+
+    auto target_config = nlohmann::json::parse(makeConfigForBackend("pmdk"));
+    target_config["num_arenas"] = num_arenas;
+    auto pr_config = nlohmann::json{
+        {"target", {{"type", "pmdk"}, {"config", target_config}}}
+    }.dump();
+
+    auto engine = thallium::engine("na+sm", THALLIUM_SERVER_MODE, false, 4);
+    DEFER(engine.finalize());
+
+    warabi::Provider provider(engine, 42, pr_config);
+    auto stats = nlohmann::json::parse(provider.getStats());
+    REQUIRE(stats["target"]["shards"].size() == 2);
+    for(auto& shard : stats["target"]["shards"])
+        REQUIRE(shard["automatic_arenas"] == num_arenas);
+
+    warabi::Client client(engine);
+    auto th = client.makeTargetHandle(engine.self(), 42);
+    std::string data(1000, 'x');
+    for(int i = 0; i < 16; ++i) {
+        warabi::RegionID region;
+        REQUIRE_NOTHROW(th.createAndWrite(&region, data.data(), data.size()));
+    }
+}
+
+TEST_CASE("Memory target in cache mode", "[target]") {
+
+    auto eviction = GENERATE(as<std::string>{}, "lru", "clock");
+    CAPTURE(eviction);
+
+    auto pr_config = std::string{"{\"target\":{\"type\":\"memory\",\"config\":{"}
+                   + "\"capacity\":1024,\"eviction\":\"" + eviction + "\"}}}";
+
+    auto engine = thallium::engine("na+sm", THALLIUM_SERVER_MODE);
+    DEFER(engine.finalize());
+
+    warabi::Provider provider(engine, 42, pr_config);
+
+    warabi::Client client(engine);
+    auto th = client.makeTargetHandle(engine.self(), 42);
+
+    std::vector<char> in(512, 'A');
+    std::vector<char> out(512);
+
+    /* fill the target */
+    warabi::RegionID regionA, regionB, regionC;
+    REQUIRE_NOTHROW(th.createAndWrite(&regionA, in.data(), in.size()));
+    REQUIRE_NOTHROW(th.createAndWrite(&regionB, in.data(), in.size()));
+
+    /* with A pinned, creating C has to evict B */
+    REQUIRE_NOTHROW(th.pin(regionA));
+    REQUIRE_NOTHROW(th.createAndWrite(&regionC, in.data(), in.size()));
+    REQUIRE_THROWS_AS(th.read(regionB, 0, out.data(), out.size()), warabi::EvictedException);
+    REQUIRE_THROWS_AS(th.write(regionB, 0, in.data(), in.size()), warabi::EvictedException);
+    REQUIRE_THROWS_AS(th.pin(regionB), warabi::EvictedException);
+    REQUIRE_NOTHROW(th.read(regionA, 0, out.data(), out.size()));
+    REQUIRE(out == in);
+
+    /* a region larger than the capacity can't be created */
+    warabi::RegionID regionD;
+    REQUIRE_THROWS_AS(th.create(&regionD, 2048), warabi::Exception);
+
+    /* nothing can be evicted when all the regions are pinned */
+    REQUIRE_NOTHROW(th.pin(regionC));
+    REQUIRE_THROWS_AS(th.create(&regionD, 512), warabi::Exception);
+
+    /* unpinning more times than pinning is an error */
+    REQUIRE_NOTHROW(th.unpin(regionA));
+    REQUIRE_THROWS_AS(th.unpin(regionA), warabi::Exception);
+    REQUIRE_NOTHROW(th.create(&regionD, 512));
+    REQUIRE_THROWS_AS(th.read(regionA, 0, out.data(), out.size()), warabi::EvictedException);
+    REQUIRE_NOTHROW(th.read(regionC, 0, out.data(), out.size()));
+}
+
+TEST_CASE("Memory target in cache mode with clones and snapshots", "[target]") {
+
+    auto eviction = GENERATE(as<std::string>{}, "lru", "clock");
+    CAPTURE(eviction);
+
+    auto pr_config = std::string{"{\"target\":{\"type\":\"memory\",\"config\":{"}
+                   + "\"capacity\":2048,\"eviction\":\"" + eviction + "\"}}}";
+
+    auto engine = thallium::engine("na+sm", THALLIUM_SERVER_MODE);
+    DEFER(engine.finalize());
+
+    warabi::Provider provider(engine, 42, pr_config);
+    auto usedBytes = [&provider]() {
+        return nlohmann::json::parse(provider.getStats())["target"]["used_bytes"].get<size_t>();
+    };
+
+    warabi::Client client(engine);
+    auto th = client.makeTargetHandle(engine.self(), 42);
+
+    std::vector<char> in(512, 'A');
+    std::vector<char> in2(512, 'B');
+    std::vector<char> out(512);
+
+    /* a clone and a snapshot share the memory of region A */
+    warabi::RegionID regionA, cloneA, regionB, regionC, cloneC, regionD;
+    REQUIRE_NOTHROW(th.createAndWrite(&regionA, in.data(), in.size()));
+    REQUIRE_NOTHROW(th.clone(regionA, &cloneA));
+    REQUIRE_NOTHROW(th.createSnapshot("checkpoint"));
+    REQUIRE_NOTHROW(th.createAndWrite(&regionB, in.data(), in.size()));
+    REQUIRE_NOTHROW(th.createAndWrite(&regionC, in.data(), in.size()));
+    REQUIRE(usedBytes() == 1536);
+
+    /* writing to the clone gives it its own copy, which still fits */
+    REQUIRE_NOTHROW(th.write(cloneA, 0, in2.data(), in2.size()));
+    REQUIRE(usedBytes() == 2048);
+
+    /* A's memory is still held by the snapshot, so
+     * its copy can only be made by evicting B */
+    REQUIRE_NOTHROW(th.pin(cloneA));
+    REQUIRE_NOTHROW(th.pin(regionC));
+    REQUIRE_NOTHROW(th.write(regionA, 0, in2.data(), in2.size()));
+    REQUIRE(usedBytes() == 2048);
+    REQUIRE_THROWS_AS(th.read(regionB, 0, out.data(), out.size()), warabi::EvictedException);
+    REQUIRE_NOTHROW(th.read(regionA, 0, out.data(), out.size()));
+    REQUIRE(out == in2);
+    REQUIRE_NOTHROW(th.pin(regionA));
+
+    /* C and its clone share their memory, evicting either frees nothing */
+    REQUIRE_NOTHROW(th.clone(regionC, &cloneC));
+    REQUIRE_NOTHROW(th.unpin(regionC));
+    REQUIRE_THROWS_WITH(th.create(&regionD, 512),
+        Catch::Matchers::ContainsSubstring("shared with clones or snapshots"));
+    REQUIRE_THROWS_AS(th.write(cloneC, 0, in2.data(), in2.size()), warabi::Exception);
+    REQUIRE(usedBytes() == 2048);
+    REQUIRE_NOTHROW(th.read(regionC, 0, out.data(), out.size()));
+    REQUIRE(out == in);
+    REQUIRE_NOTHROW(th.read(cloneC, 0, out.data(), out.size()));
+    REQUIRE(out == in);
+
+    /* deleting the snapshot frees the original memory of A */
+    REQUIRE_NOTHROW(th.deleteSnapshot("checkpoint"));
+    REQUIRE(usedBytes() == 1536);
+    REQUIRE_NOTHROW(th.create(&regionD, 512));
+    REQUIRE(usedBytes() == 2048);
+}
+
+TEST_CASE("Region copy and move", "[target]") {
+
+    auto tm_type = GENERATE(as<std::string>{}, "__default__", "pipeline", "router");
+    CAPTURE(tm_type);
+
+    auto pr_config = makeConfigForProvider("memory", tm_type);
+
+    auto engine = thallium::engine("na+sm", THALLIUM_SERVER_MODE);
+    DEFER(engine.finalize());
+
+    warabi::Provider provider1(engine, 42, pr_config);
+    warabi::Provider provider2(engine, 43, pr_config);
+
+    warabi::Client client(engine);
+    auto th1 = client.makeTargetHandle(engine.self(), 42);
+    auto th2 = client.makeTargetHandle(engine.self(), 43);
+
+    // small regions are copied with one RPC, large ones chunk by chunk
+    // (three 8 MiB chunks, so that the staging buffers get reused)
+    auto data_size = GENERATE(196, 20*1024*1024);
+    CAPTURE(data_size);
+
+    std::vector<char> in(data_size);
+    for(size_t i = 0; i < in.size(); ++i) in[i] = 'A' + (i % 26);
+    std::vector<char> out(in.size());
+
+    warabi::RegionID source;
+    REQUIRE_NOTHROW(th1.createAndWrite(&source, in.data(), in.size()));
+
+    /* copy within the same target */
+    warabi::RegionID local_copy;
+    REQUIRE_NOTHROW(th1.copy(source, in.size(), th1, &local_copy));
+    REQUIRE(local_copy != source);
+    REQUIRE_NOTHROW(th1.read(local_copy, 0, out.data(), out.size()));
+    REQUIRE(out == in);
+
+    /* copy to another provider */
+    warabi::RegionID remote_copy;
+    REQUIRE_NOTHROW(th1.copy(source, in.size(), th2, &remote_copy));
+    std::fill(out.begin(), out.end(), 0);
+    REQUIRE_NOTHROW(th2.read(remote_copy, 0, out.data(), out.size()));
+    REQUIRE(out == in);
+
+    /* move to another provider, asynchronously */
+    warabi::RegionID moved;
+    warabi::AsyncRequest req;
+    REQUIRE_NOTHROW(th1.move(local_copy, in.size(), th2, &moved, false, &req));
+    REQUIRE_NOTHROW(req.wait());
+    std::fill(out.begin(), out.end(), 0);
+    REQUIRE_NOTHROW(th2.read(moved, 0, out.data(), out.size()));
+    REQUIRE(out == in);
+    REQUIRE_THROWS_AS(th1.read(local_copy, 0, out.data(), out.size()), warabi::Exception);
+
+    /* moving within the same target leaves the region in place */
+    warabi::RegionID same;
+    REQUIRE_NOTHROW(th1.move(source, in.size(), th1, &same));
+    REQUIRE(same == source);
+
+    /* the size must match the region's */
+    REQUIRE_THROWS_AS(th1.copy(source, in.size() - 1, th2, &remote_copy), warabi::Exception);
+
+    /* copying an invalid region fails */
+    warabi::RegionID invalidID;
+    std::memset(invalidID.data(), 234, invalidID.size());
+    REQUIRE_THROWS_AS(th1.copy(invalidID, in.size(), th2, &remote_copy), warabi::Exception);
+}
+
+TEST_CASE("Region clones and target snapshots", "[target]") {
+
+    auto target_type = GENERATE(as<std::string>{}, "memory", "abtio");
+    CAPTURE(target_type);
+
+    // small extents so that regions span several of them, and an
+    // alignment that doesn't divide the filesystem's block size
+    auto pr_config = target_type == "memory"
+        ? std::string{R"({"target":{"type":"memory","config":{"extent_size":4096}}})"}
+        : std::string{R"({"target":{"type":"abtio","config":{)"
+                      R"("path":"/tmp/warabi-abtio-test-target.dat",)"
+                      R"("create_if_missing":true,"override_if_exists":true,"alignment":24}}})"};
+
+    auto engine = thallium::engine("na+sm", THALLIUM_SERVER_MODE);
+    DEFER(engine.finalize());
+
+    warabi::Provider provider(engine, 42, pr_config);
+
+    warabi::Client client(engine);
+    auto th = client.makeTargetHandle(engine.self(), 42);
+
+    std::vector<char> in(10000);
+    for(size_t i = 0; i < in.size(); ++i) in[i] = 'A' + (i % 26);
+    std::vector<char> out(in.size());
+
+    warabi::RegionID original;
+    REQUIRE_NOTHROW(th.createAndWrite(&original, in.data(), in.size()));
+
+    /* clone the region, then modify the clone */
+    warabi::RegionID cloned;
+    REQUIRE_NOTHROW(th.clone(original, &cloned));
+    REQUIRE_NOTHROW(th.read(cloned, 0, out.data(), out.size()));
+    REQUIRE(out == in);
+
+    std::string patch = "modified";
+    REQUIRE_NOTHROW(th.write(cloned, 5000, patch.data(), patch.size()));
+    REQUIRE_NOTHROW(th.read(original, 0, out.data(), out.size()));
+    REQUIRE(out == in);
+    REQUIRE_NOTHROW(th.read(cloned, 5000, out.data(), patch.size()));
+    REQUIRE(std::string(out.data(), patch.size()) == patch);
+
+    /* clone a small region that does not start on a block boundary */
+    warabi::RegionID small, small_clone;
+    REQUIRE_NOTHROW(th.createAndWrite(&small, patch.data(), patch.size()));
+    REQUIRE_NOTHROW(th.clone(small, &small_clone));
+    std::string small_out(patch.size(), '\0');
+    REQUIRE_NOTHROW(th.read(small_clone, 0, small_out.data(), small_out.size()));
+    REQUIRE(small_out == patch);
+    if(target_type == "abtio") {
+        auto stats = nlohmann::json::parse(provider.getStats());
+        REQUIRE(stats["target"]["clones"] == 2);
+    }
+
+    /* snapshot the target, modify it, and roll back */
+    REQUIRE_NOTHROW(th.createSnapshot("checkpoint"));
+    REQUIRE_THROWS_AS(th.createSnapshot("checkpoint"), warabi::Exception);
+
+    std::vector<char> in2(in.size(), 'z');
+    REQUIRE_NOTHROW(th.write(original, 0, in2.data(), in2.size()));
+    warabi::RegionID created_after;
+    REQUIRE_NOTHROW(th.createAndWrite(&created_after, in2.data(), in2.size()));
+
+    REQUIRE_NOTHROW(th.restoreSnapshot("checkpoint"));
+    REQUIRE_NOTHROW(th.read(original, 0, out.data(), out.size()));
+    REQUIRE(out == in);
+    REQUIRE_NOTHROW(th.read(small_clone, 0, small_out.data(), small_out.size()));
+    REQUIRE(small_out == patch);
+    if(target_type == "memory") {
+        REQUIRE_THROWS_AS(th.read(created_after, 0, out.data(), out.size()), warabi::Exception);
+    }
+
+    /* the target remains usable after the restore */
+    warabi::RegionID created_after_restore;
+    REQUIRE_NOTHROW(th.createAndWrite(&created_after_restore, in2.data(), in2.size()));
+    REQUIRE_NOTHROW(th.read(created_after_restore, 0, out.data(), out.size()));
+    REQUIRE(out == in2);
+
+    REQUIRE_NOTHROW(th.deleteSnapshot("checkpoint"));
+    REQUIRE_THROWS_AS(th.deleteSnapshot("checkpoint"), warabi::Exception);
+    REQUIRE_THROWS_AS(th.restoreSnapshot("checkpoint"), warabi::Exception);
+}
+
+TEST_CASE("AbtIO target with the legacy sync option", "[target]") {
+
+    auto durability = GENERATE(as<std::string>{}, "", "none", "per_write", "periodic", "on_persist");
+    CAPTURE(durability);
+
+    auto target_config = nlohmann::json::parse(makeConfigForBackend("abtio"));
+    target_config["sync"] = true;
+    if(!durability.empty()) target_config["durability"] = durability;
+    auto pr_config = nlohmann::json{
+        {"target", {{"type", "abtio"}, {"config", target_config}}}
+    }.dump();
+
+    auto engine = thallium::engine("na+sm", THALLIUM_SERVER_MODE);
+    DEFER(engine.finalize());
+
+    // an explicit durability wins over "sync", which is then dropped
+    warabi::Provider provider(engine, 42, pr_config);
+    auto config = nlohmann::json::parse(provider.getConfig())["target"]["config"];
+    REQUIRE(!config.contains("sync"));
+    REQUIRE(config["durability"] == (durability.empty() ? "per_write" : durability));
+
+    // the returned configuration gives back the same target
+    warabi::Provider provider2(engine, 43, nlohmann::json{
+        {"target", {{"type", "abtio"}, {"config", config}}}
+    }.dump());
+    auto config2 = nlohmann::json::parse(provider2.getConfig())["target"]["config"];
+    REQUIRE(config2["durability"] == config["durability"]);
+}
+
+TEST_CASE("AbtIO target with O_DIRECT", "[target]") {
+
+    auto durability = GENERATE(as<std::string>{}, "none", "per_write", "periodic", "on_persist");
+    CAPTURE(durability);
+
+    // O_DIRECT is not supported by tmpfs, so the file is
+    // created in the working directory rather than in /tmp
+    auto path = (std::filesystem::current_path() / "warabi-abtio-directio-test.dat").string();
+    auto pr_config = fmt::format(R"({{
+        "target": {{
+            "type": "abtio",
+            "config": {{
+                "path": "{}",
+                "create_if_missing": true,
+                "override_if_exists": true,
+                "directio": true,
+                "durability": "{}",
+                "sync_interval_ms": 10,
+                "sync_bytes": 4096
+            }}
+        }}
+    }})", path, durability);
+
+    // several handler ESs so that writes to the same block really race
+    auto engine = thallium::engine("na+sm", THALLIUM_SERVER_MODE, false, 4);
+    DEFER(engine.finalize());
+    DEFER(std::filesystem::remove(path));
+
+    warabi::Provider provider(engine, 42, pr_config);
+    auto config = nlohmann::json::parse(provider.getConfig());
+    REQUIRE(config["target"]["config"]["durability"] == durability);
+    if(!config["target"]["config"]["directio"].get<bool>())
+        WARN("O_DIRECT is not supported here, the test runs with buffered I/O");
+
+    warabi::Client client(engine);
+    auto th = client.makeTargetHandle(engine.self(), 42);
+    th.setEagerReadThreshold(128);
+    th.setEagerWriteThreshold(128);
+
+    /* a small region first, so that the next one does not start on a block */
+    std::string head = "head";
+    warabi::RegionID first;
+    REQUIRE_NOTHROW(th.createAndWrite(&first, head.data(), head.size()));
+
+    /* expected stores the content the region should have */
+    std::vector<char> expected(3*4096 + 100);
+    for(size_t i = 0; i < expected.size(); ++i) expected[i] = 'a' + (i % 26);
+    warabi::RegionID region;
+    REQUIRE_NOTHROW(th.createAndWrite(&region, expected.data(), expected.size(), true));
+
+    auto check = [&]() {
+        std::vector<char> out(expected.size());
+        REQUIRE_NOTHROW(th.read(region, 0, out.data(), out.size()));
+        REQUIRE(out == expected);
+    };
+    check();
+
+    /* unaligned writes spanning block boundaries */
+    std::string small = "across-a-block-boundary";
+    REQUIRE_NOTHROW(th.write(region, 4090, small.data(), small.size()));
+    std::copy(small.begin(), small.end(), expected.begin() + 4090);
+    std::vector<char> large(5010, 'X');
+    REQUIRE_NOTHROW(th.write(region, {{1, 5000}, {8190, 10}}, large.data()));
+    std::fill(expected.begin() + 1, expected.begin() + 5001, 'X');
+    std::fill(expected.begin() + 8190, expected.begin() + 8200, 'X');
+    check();
+
+    /* access hints have no page cache to act on */
+    REQUIRE_NOTHROW(th.prefetch({{region, {{0, expected.size()}}}}));
+    auto stats = nlohmann::json::parse(provider.getStats());
+    if(config["target"]["config"]["directio"].get<bool>()) {
+        REQUIRE(stats["target"]["ignored_hints"] == 1);
+        REQUIRE(stats["target"]["readahead_bytes"] == 0);
+    } else {
+        REQUIRE(stats["target"]["readahead_bytes"] == expected.size());
+    }
+
+    /* unaligned reads spanning block boundaries */
+    std::vector<char> out(300);
+    REQUIRE_NOTHROW(th.read(region, {{4000, 200}, {12280, 100}}, out.data()));
+    REQUIRE(std::equal(out.begin(), out.begin() + 200, expected.begin() + 4000));
+    REQUIRE(std::equal(out.begin() + 200, out.end(), expected.begin() + 12280));
+
+    /* concurrent writes to disjoint bytes of the same block
+     * must not undo each other's read-modify-write */
+    std::vector<std::string> patches;
+    for(int i = 0; i < 16; ++i) patches.push_back(fmt::format("patch-{:02}", i));
+    std::vector<warabi::AsyncRequest> requests(patches.size());
+    for(size_t i = 0; i < patches.size(); ++i) {
+        size_t offset = 4096 + 3 + i*200;
+        REQUIRE_NOTHROW(th.write(region, offset, patches[i].data(), patches[i].size(),
+                                 false, &requests[i]));
+        std::copy(patches[i].begin(), patches[i].end(), expected.begin() + offset);
+    }
+    for(auto& req : requests) REQUIRE_NOTHROW(req.wait());
+    check();
+
+    /* persist works in every durability mode */
+    REQUIRE_NOTHROW(th.persist(region, 0, expected.size()));
+    std::string tail = "tail";
+    REQUIRE_NOTHROW(th.write(region, expected.size() - tail.size(), tail.data(), tail.size(), true));
+    std::copy(tail.begin(), tail.end(), expected.end() - tail.size());
+    check();
+
+    std::string first_out(head.size(), '\0');
+    REQUIRE_NOTHROW(th.read(first, 0, first_out.data(), first_out.size()));
+    REQUIRE(first_out == head);
+}
+
+TEST_CASE("Client read cache with leases", "[target]") {
+
+    auto pr_config = std::string{"{\"target\":{\"type\":\"memory\",\"config\":{}},"}
+                   + "\"leases\":{\"duration_ms\":100}}";
+
+    auto engine = thallium::engine("na+sm", THALLIUM_SERVER_MODE);
+    DEFER(engine.finalize());
+
+    warabi::Provider provider(engine, 42, pr_config);
+
+    warabi::Client client(engine);
+    auto reader = client.makeTargetHandle(engine.self(), 42);
+    auto writer = client.makeTargetHandle(engine.self(), 42);
+    reader.setReadCacheCapacity(1024);
+
+    std::vector<char> in(256, 'A');
+    std::vector<char> out(256);
+
+    warabi::RegionID regionID;
+    REQUIRE_NOTHROW(writer.createAndWrite(&regionID, in.data(), in.size()));
+
+    /* the first read caches the region, the next ones may hit the cache */
+    REQUIRE_NOTHROW(reader.read(regionID, 0, out.data(), out.size()));
+    REQUIRE(out == in);
+    REQUIRE_NOTHROW(reader.read(regionID, 0, out.data(), out.size()));
+    REQUIRE(out == in);
+    std::vector<char> part(16);
+    REQUIRE_NOTHROW(reader.read(regionID, {{8, 8}, {64, 8}}, part.data()));
+    REQUIRE(part == std::vector<char>(16, 'A'));
+
+    /* asynchronous reads can be served from the cache too */
+    warabi::AsyncRequest req;
+    REQUIRE_NOTHROW(reader.read(regionID, 0, out.data(), out.size(), &req));
+    REQUIRE_NOTHROW(req.wait());
+    REQUIRE(out == in);
+
+    /* a write from another client waits for the lease to expire,
+     * so the reader never sees stale data */
+    std::fill(in.begin(), in.end(), 'B');
+    REQUIRE_NOTHROW(writer.write(regionID, 0, in.data(), in.size()));
+    REQUIRE_NOTHROW(reader.read(regionID, 0, out.data(), out.size()));
+    REQUIRE(out == in);
+
+    /* erased regions are not served from the cache */
+    REQUIRE_NOTHROW(writer.erase(regionID));
+    REQUIRE_THROWS_AS(reader.read(regionID, 0, out.data(), out.size()), warabi::Exception);
+}
+
+TEST_CASE("Admission control", "[target]") {
+
+    // a write to a leased region waits for the lease to expire while
+    // holding the provider's only admission slot, so that other requests
+    // are rejected as busy in the meantime
+    auto pr_config = std::string{R"({
+        "target": {"type": "memory", "config": {}},
+        "admission": {"max_inflight_ops": 1, "retry_after_ms": 5},
+        "leases": {"duration_ms": 200}
+    })"};
+
+    auto engine = thallium::engine("na+sm", THALLIUM_SERVER_MODE, false, 2);
+    DEFER(engine.finalize());
+
+    warabi::Provider provider(engine, 42, pr_config);
+
+    warabi::Client client(engine);
+    auto reader = client.makeTargetHandle(engine.self(), 42);
+    auto writer = client.makeTargetHandle(engine.self(), 42);
+    auto impatient = client.makeTargetHandle(engine.self(), 42);
+    auto patient = client.makeTargetHandle(engine.self(), 42);
+    reader.setReadCacheCapacity(1024);
+    impatient.setRetryPolicy(0, 1000);
+
+    std::vector<char> in(256, 'A');
+    std::vector<char> out(256);
+    warabi::RegionID regionID;
+    REQUIRE_NOTHROW(writer.createAndWrite(&regionID, in.data(), in.size()));
+    REQUIRE_NOTHROW(reader.read(regionID, 0, out.data(), out.size()));
+
+    std::fill(in.begin(), in.end(), 'B');
+    warabi::AsyncRequest pending;
+    REQUIRE_NOTHROW(writer.write(regionID, 0, in.data(), in.size(), false, &pending));
+    thallium::thread::sleep(engine, 50);
+
+    /* without retries, the request fails with a BusyException */
+    bool busy = false;
+    try {
+        impatient.read(regionID, 0, out.data(), out.size());
+    } catch(const warabi::BusyException& ex) {
+        busy = true;
+        REQUIRE(ex.retryAfter() > 0);
+    }
+    REQUIRE(busy);
+
+    /* with the default retry policy, it succeeds once the write is done */
+    REQUIRE_NOTHROW(patient.read(regionID, 0, out.data(), out.size()));
+    REQUIRE_NOTHROW(pending.wait());
+    REQUIRE_NOTHROW(patient.read(regionID, 0, out.data(), out.size()));
+    REQUIRE(out == in);
+
+    auto stats = nlohmann::json::parse(provider.getStats());
+    REQUIRE(stats["admission"]["rejected"].get<size_t>() > 0);
+}
+
+TEST_CASE("Request tracing", "[target]") {
+
+    auto trace_file = (std::filesystem::temp_directory_path() / "warabi-test-trace.json").string();
+    std::filesystem::remove(trace_file);
+    auto tracing = std::string{"{\"output\":\""} + trace_file + "\"}";
+    auto pr_config = std::string{"{\"target\":{\"type\":\"memory\",\"config\":{}},"}
+                   + "\"tracing\":" + tracing + "}";
+
+    auto engine = thallium::engine("na+sm", THALLIUM_SERVER_MODE);
+    DEFER(engine.finalize());
+
+    {
+        warabi::Provider provider(engine, 42, pr_config);
+
+        warabi::Client client(engine);
+        REQUIRE_THROWS_AS(client.setTracingConfig("{\"sample_rate\":2}"), warabi::Exception);
+        REQUIRE_NOTHROW(client.setTracingConfig(tracing));
+        auto target = client.makeTargetHandle(engine.self(), 42);
+
+        std::vector<char> in(256, 'A');
+        std::vector<char> out(256);
+        warabi::RegionID regionID;
+        REQUIRE_NOTHROW(target.createAndWrite(&regionID, in.data(), in.size()));
+        REQUIRE_NOTHROW(target.read(regionID, 0, out.data(), out.size()));
+        REQUIRE(out == in);
+
+        auto stats = nlohmann::json::parse(provider.getStats());
+        REQUIRE(stats["tracing"]["recorded"].get<size_t>() > 0);
+    }
+
+    /* the trace is written when the provider is destroyed */
+    std::ifstream f{trace_file};
+    REQUIRE(f.good());
+    std::string content{std::istreambuf_iterator<char>{f}, std::istreambuf_iterator<char>{}};
+    REQUIRE(content.find("\"traceEvents\"") != std::string::npos);
+    REQUIRE(content.find("\"create_write_eager\"") != std::string::npos);
+    std::filesystem::remove(trace_file);
+}
+
+TEST_CASE("Request recording", "[target]") {
+
+    auto trace_file = (std::filesystem::temp_directory_path() / "warabi-test.trace").string();
+    auto pr_config = std::string{"{\"target\":{\"type\":\"memory\",\"config\":{}},"}
+                   + "\"recording\":{\"path\":\"" + trace_file + "\"}}";
+
+    auto engine = thallium::engine("na+sm", THALLIUM_SERVER_MODE);
+    DEFER(engine.finalize());
+
+    {
+        warabi::Provider provider(engine, 42, pr_config);
+
+        warabi::Client client(engine);
+        auto target = client.makeTargetHandle(engine.self(), 42);
+
+        std::vector<char> in(256, 'A');
+        std::vector<char> out(256);
+        warabi::RegionID regionID;
+        REQUIRE_NOTHROW(target.createAndWrite(&regionID, in.data(), in.size()));
+        REQUIRE_NOTHROW(target.write(regionID, {{0, 16}, {64, 16}}, in.data()));
+        REQUIRE_NOTHROW(target.read(regionID, 0, out.data(), out.size()));
+        REQUIRE_NOTHROW(target.erase(regionID));
+
+        auto stats = nlohmann::json::parse(provider.getStats());
+        REQUIRE(stats["recording"]["records"].get<size_t>() == 4);
+    }
+
+    /* the records are written when the provider is destroyed */
+    REQUIRE(std::filesystem::file_size(trace_file) > 4*32);
+    std::ifstream f{trace_file, std::ios::binary};
+    char magic[8];
+    REQUIRE(f.read(magic, sizeof(magic)));
+    REQUIRE(std::string(magic, sizeof(magic)) == "WARABIRC");
+    std::filesystem::remove(trace_file);
+}
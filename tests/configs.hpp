@@ -4,20 +4,26 @@
 
 static inline std::string makeConfigForBackend(const std::string& type) {
     if(type == "memory") {
-        return R"({})";
+        return R"({
+            "copy": {"non_temporal_threshold": 64},
+            "huge_page_size": 2097152
+        })";
     }
     if(type == "pmdk") {
         return R"({
             "path": "/tmp/warabi-pmdk-test-target.dat",
             "create_if_missing_with_size": 10485760,
-            "override_if_exists": true
+            "override_if_exists": true,
+            "num_shards": 2,
+            "alloc_classes": [128, 1024]
         })";
     }
     if(type == "abtio") {
         return R"({
             "path": "/tmp/warabi-abtio-test-target.dat",
             "create_if_missing": true,
-            "override_if_exists": true
+            "override_if_exists": true,
+            "max_inflight_ops": 4
         })";
     }
     return "{}";
@@ -32,7 +38,24 @@ static inline std::string makeConfigForTransferManager(const std::string& type)
             "num_pools": 2,
             "num_buffers_per_pool": 8,
             "first_buffer_size": 1024,
-            "buffer_size_multiplier": 2
+            "buffer_size_multiplier": 2,
+            "transparent_huge_pages": true
+        })";
+    }
+    if(type == "router") {
+        return R"({
+            "rules": [
+                {"max_size": 256, "type": "__default__"}
+            ],
+            "default": {
+                "type": "pipeline",
+                "config": {
+                    "num_pools": 2,
+                    "num_buffers_per_pool": 8,
+                    "first_buffer_size": 1024,
+                    "buffer_size_multiplier": 2
+                }
+            }
         })";
     }
     return "{}";